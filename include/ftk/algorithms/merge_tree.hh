@@ -0,0 +1,440 @@
+#ifndef _FTK_MERGE_TREE_HH
+#define _FTK_MERGE_TREE_HH
+
+#include <ftk/config.hh>
+#include <ftk/object.hh>
+#include <ftk/basic/contour_tree.hh>
+#include <ftk/algorithms/radix_sort.hh>
+#include <ftk/mesh/simplex_csr.hh>
+#include <ftk/mesh/simplicial_regular_mesh.hh>
+#include <vector>
+#include <queue>
+#include <limits>
+#include <cstring>
+#include <functional>
+
+namespace ftk {
+
+// Merge trees and contour trees of piecewise linear scalar fields given by
+// vertex values and a flat (CSR) vertex adjacency.  Ties are broken by
+// vertex ids (simulation of simplicity), so that all ranks are distinct.
+//
+// A merge tree is built in two stages:
+//  1. (parallel) every vertex follows its steepest ascending (join tree)
+//     or descending (split tree) edge, and pointer jumping labels each
+//     vertex with the extremum it flows to.  Edges between different
+//     regions are collected per chunk of vertices.
+//  2. (serial, only over region boundaries) the boundary edges are swept
+//     from the top with a union-find over the extrema, as in Kruskal's
+//     algorithm.  The lower endpoint of the edge that first connects two
+//     components is the saddle where they merge; the younger extremum
+//     (elder rule) dies there and forms a persistence pair with it.
+// The second stage can be repeated with extra vertices to augment the
+// tree, e.g. with the nodes of the opposite tree for contour trees.
+
+// Ranks of the vertices in ascending order of (value, id), with a
+// parallel radix sort on the order-preserving bit patterns of the values
+template <typename I=int, typename F=double>
+std::vector<I> rank_vertices(size_t n, const F* values,
+    int nthreads = std::thread::hardware_concurrency())
+{
+  struct record {
+    uint64_t key;
+    I id;
+  };
+
+  std::vector<record> records(n);
+  object::parallel_for(n, [&](int i) {
+    const double x = values[i];
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    records[i].key = (bits >> 63) ? ~bits : (bits | (uint64_t(1) << 63));
+    records[i].id = i;
+  }, FTK_THREAD_PTHREAD, nthreads, false);
+
+  parallel_radix_sort(records, 8, [](const record& r, int p) {
+    return int((r.key >> (8*p)) & 0xff);
+  }, nthreads);
+
+  std::vector<I> rank(n);
+  object::parallel_for(n, [&](int i) {
+    rank[records[i].id] = i;
+  }, FTK_THREAD_PTHREAD, nthreads, false);
+  return rank;
+}
+
+template <typename I=int>
+struct merge_tree {
+  // join tree (superlevel sets; leaves are maxima) or split tree
+  // (sublevel sets; leaves are minima) of the vertex ranks
+  merge_tree(const csr_adjacency<I>& adj, const std::vector<I>& rank, bool join = true,
+      int nthreads = std::thread::hardware_concurrency());
+
+  // sweeps the region boundaries; augment lists extra vertices to be
+  // inserted as (regular) nodes of the tree
+  void build(const std::vector<I>& augment = {});
+
+  bool is_join_tree() const {return join;}
+
+  // the extremum whose steepest ascending/descending region contains each vertex
+  const std::vector<I>& get_labels() const {return label;}
+  const std::vector<I>& get_extrema() const {return extrema;}
+  const std::vector<I>& get_saddles() const {return saddles;}
+
+  // (extremum, saddle) pairs, and the extrema that survive until the end
+  // of the sweep, i.e. the global maximum (join) or minimum (split) of
+  // each connected component
+  const std::vector<std::pair<I, I>>& get_persistence_pairs() const {return pairs;}
+  const std::vector<I>& get_essential_extrema() const {return essential;}
+
+  // nodes are the extrema, saddles, root, and augmented vertices; arcs go
+  // from the lower to the higher value regardless of the tree direction
+  const contour_tree<I>& get_tree() const {return tree;}
+
+protected:
+  struct boundary_edge_t {
+    I v; // lower endpoint in the sweep direction
+    I a, b; // labels of the two endpoints
+  };
+
+  const bool join;
+  const int nthreads;
+  size_t n = 0;
+  I root = -1; // lowest vertex in the sweep direction
+
+  std::vector<I> up; // rank in the sweep direction
+  std::vector<I> label, extrema, saddles;
+  std::vector<I> extremum_index; // index in extrema of each extremum vertex
+  std::vector<boundary_edge_t> boundary; // sorted from the top
+
+  std::vector<std::pair<I, I>> pairs;
+  std::vector<I> essential;
+  contour_tree<I> tree;
+};
+
+template <typename I>
+merge_tree<I>::merge_tree(const csr_adjacency<I>& adj, const std::vector<I>& rank, bool join_, int nthreads_) :
+  join(join_), nthreads(std::max(1, nthreads_)), n(adj.size())
+{
+  if (rank.size() != n)
+    fatal("the number of vertex ranks does not match the adjacency");
+  if (n == 0) return;
+
+  const int nchunks = std::max(1, (int)std::min(size_t(nthreads), (n + 4095) / 4096));
+  const size_t chunk_size = (n + nchunks - 1) / nchunks;
+  auto for_chunks = [&](std::function<void(int, size_t, size_t)> f) {
+    object::parallel_for(nchunks, [&](int c) {
+      f(c, std::min(n, c * chunk_size), std::min(n, (c+1) * chunk_size));
+    }, FTK_THREAD_PTHREAD, nchunks, false);
+  };
+
+  up.resize(n);
+  for_chunks([&](int, size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; i ++)
+      up[i] = join ? rank[i] : I(n - 1 - rank[i]);
+  });
+
+  // steepest ascent in the sweep direction
+  std::vector<I> next(n);
+  for_chunks([&](int, size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; i ++) {
+      I best = i;
+      for (const I *p = adj.begin(i); p != adj.end(i); p ++)
+        if (up[*p] > up[best]) best = *p;
+      next[i] = best;
+    }
+  });
+
+  // pointer jumping; each round halves the remaining path lengths
+  label = next;
+  std::vector<I> label1(n);
+  std::vector<char> changed(nchunks, 1);
+  while (std::find(changed.begin(), changed.end(), 1) != changed.end()) {
+    for_chunks([&](int c, size_t i0, size_t i1) {
+      char ch = 0;
+      for (size_t i = i0; i < i1; i ++) {
+        label1[i] = label[label[i]];
+        ch |= label1[i] != label[i];
+      }
+      changed[c] = ch;
+    });
+    label.swap(label1);
+  }
+
+  // extrema and region boundaries, collected per chunk in vertex order
+  std::vector<std::vector<I>> chunk_extrema(nchunks);
+  std::vector<std::vector<boundary_edge_t>> chunk_boundary(nchunks);
+  std::vector<I> chunk_root(nchunks, -1);
+  for_chunks([&](int c, size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; i ++) {
+      if (next[i] == I(i)) chunk_extrema[c].push_back(i);
+      if (up[i] == 0) chunk_root[c] = i;
+      for (const I *p = adj.begin(i); p != adj.end(i); p ++)
+        if (up[*p] > up[i] && label[*p] != label[i])
+          chunk_boundary[c].push_back({I(i), label[i], label[*p]});
+    }
+  });
+
+  extremum_index.assign(n, -1);
+  for (int c = 0; c < nchunks; c ++) {
+    for (const auto e : chunk_extrema[c]) {
+      extremum_index[e] = extrema.size();
+      extrema.push_back(e);
+    }
+    boundary.insert(boundary.end(), chunk_boundary[c].begin(), chunk_boundary[c].end());
+    if (chunk_root[c] >= 0) root = chunk_root[c];
+  }
+
+  parallel_radix_sort(boundary, radix_sort_ndigits(n), [&](const boundary_edge_t& e, int p) {
+    return int((uint64_t(n - 1 - up[e.v]) >> (8*p)) & 0xff);
+  }, nthreads);
+}
+
+template <typename I>
+void merge_tree<I>::build(const std::vector<I>& augment)
+{
+  tree = contour_tree<I>();
+  saddles.clear();
+  pairs.clear();
+  essential.clear();
+  if (n == 0) return;
+
+  const size_t ne = extrema.size();
+  std::vector<I> parent(ne), tail(ne), top(ne); // top is the elder extremum of the component
+  for (size_t i = 0; i < ne; i ++) {
+    parent[i] = i;
+    tail[i] = top[i] = extrema[i];
+    tree.add_node(extrema[i]);
+  }
+
+  auto find = [&](I x) {
+    while (parent[x] != x) {
+      parent[x] = parent[parent[x]];
+      x = parent[x];
+    }
+    return x;
+  };
+
+  auto attach = [&](I r, I v) { // extend the component r down to node v
+    if (tail[r] == v) return;
+    tree.add_node(v);
+    if (join) tree.add_arc(v, tail[r]);
+    else tree.add_arc(tail[r], v);
+    tail[r] = v;
+  };
+
+  std::vector<I> verts(augment);
+  verts.push_back(root);
+  std::sort(verts.begin(), verts.end(), [&](I i, I j) {return up[i] > up[j];});
+  verts.erase(std::unique(verts.begin(), verts.end()), verts.end());
+
+  // boundary edges and augmented vertices, both from the top
+  size_t i = 0, j = 0;
+  while (i < boundary.size() || j < verts.size()) {
+    if (j == verts.size() || (i < boundary.size() && up[boundary[i].v] >= up[verts[j]])) {
+      const auto &e = boundary[i ++];
+      const I ra = find(extremum_index[e.a]), rb = find(extremum_index[e.b]);
+      if (ra == rb) continue;
+
+      if (saddles.empty() || saddles.back() != e.v)
+        saddles.push_back(e.v);
+      attach(ra, e.v);
+      attach(rb, e.v);
+
+      const bool a_is_elder = up[top[ra]] > up[top[rb]];
+      const I elder = a_is_elder ? ra : rb, younger = a_is_elder ? rb : ra;
+      pairs.emplace_back(top[younger], e.v);
+      parent[younger] = elder;
+    } else {
+      const I v = verts[j ++];
+      attach(find(extremum_index[label[v]]), v);
+    }
+  }
+
+  for (size_t r = 0; r < ne; r ++)
+    if (parent[r] == I(r))
+      essential.push_back(top[r]);
+}
+
+// Contour tree from the join and split trees augmented with the nodes of
+// each other (Carr et al.): leaves are peeled off one at a time
+template <typename I>
+contour_tree<I> merge_join_and_split_trees(contour_tree<I> jt, contour_tree<I> st)
+{
+  contour_tree<I> ct;
+  std::queue<I> Q;
+
+  for (const auto i : jt.get_nodes()) {
+    ct.add_node(i);
+    if (jt.upper_degree(i) + st.lower_degree(i) == 1)
+      Q.push(i);
+  }
+
+  while (!Q.empty()) {
+    const I i = Q.front();
+    Q.pop();
+
+    I j;
+    if (jt.upper_degree(i) == 0 && st.lower_degree(i) == 1) { // upper leaf
+      j = jt.lower_node(i);
+      ct.add_arc(j, i);
+    } else if (st.lower_degree(i) == 0 && jt.upper_degree(i) == 1) { // lower leaf
+      j = st.upper_node(i);
+      ct.add_arc(i, j);
+    } else
+      continue; // i is no longer a leaf, or is the last node
+
+    jt.reduce_node(i);
+    st.reduce_node(i);
+
+    if (jt.upper_degree(j) + st.lower_degree(j) == 1) // new leaf
+      Q.push(j);
+  }
+
+  return ct;
+}
+
+// Join, split, and contour trees of vertex values on the given adjacency
+template <typename I=int, typename F=double>
+contour_tree<I> build_join_tree(const csr_adjacency<I>& adj, const F* values,
+    int nthreads = std::thread::hardware_concurrency())
+{
+  merge_tree<I> jt(adj, rank_vertices<I, F>(adj.size(), values, nthreads), true, nthreads);
+  jt.build();
+  return jt.get_tree();
+}
+
+template <typename I=int, typename F=double>
+contour_tree<I> build_split_tree(const csr_adjacency<I>& adj, const F* values,
+    int nthreads = std::thread::hardware_concurrency())
+{
+  merge_tree<I> st(adj, rank_vertices<I, F>(adj.size(), values, nthreads), false, nthreads);
+  st.build();
+  return st.get_tree();
+}
+
+template <typename I=int, typename F=double>
+contour_tree<I> build_contour_tree(const csr_adjacency<I>& adj, const F* values,
+    int nthreads = std::thread::hardware_concurrency())
+{
+  const auto rank = rank_vertices<I, F>(adj.size(), values, nthreads);
+  merge_tree<I> jt(adj, rank, true, nthreads), st(adj, rank, false, nthreads);
+  jt.build();
+  st.build();
+
+  const auto &jnodes = jt.get_tree().get_nodes(), 
+             &snodes = st.get_tree().get_nodes();
+  const std::vector<I> jaug(snodes.begin(), snodes.end()), 
+                       saug(jnodes.begin(), jnodes.end());
+  jt.build(jaug);
+  st.build(saug);
+
+  return merge_join_and_split_trees<I>(jt.get_tree(), st.get_tree());
+}
+
+// Persistence of the critical vertices, used to simplify critical points
+// that are detected in cells rather than on vertices:
+//  - maximum[i]: persistence of the maximum at i, or -1 if i is not a maximum
+//  - minimum[i]: persistence of the minimum at i, or -1 if i is not a minimum
+//  - saddle[i]: smallest persistence of the pairs that die at i, or
+//    infinity if i is not a saddle of the join or split tree
+// Surviving (global) extrema have infinite persistence.
+template <typename F=double>
+struct vertex_persistence_t {
+  std::vector<F> maximum, minimum, saddle;
+
+  template <typename I=int, typename T=F>
+  void compute(const csr_adjacency<I>& adj, const T* values,
+      int nthreads = std::thread::hardware_concurrency());
+};
+
+template <typename F>
+template <typename I, typename T>
+void vertex_persistence_t<F>::compute(const csr_adjacency<I>& adj, const T* values, int nthreads)
+{
+  const size_t n = adj.size();
+  const F inf = std::numeric_limits<F>::infinity();
+  const auto rank = rank_vertices<I, T>(n, values, nthreads);
+
+  saddle.assign(n, inf);
+  for (int k = 0; k < 2; k ++) {
+    merge_tree<I> t(adj, rank, k == 0, nthreads);
+    t.build();
+
+    auto &result = k == 0 ? maximum : minimum;
+    result.assign(n, F(-1));
+    for (const auto &pair : t.get_persistence_pairs()) {
+      const F p = std::abs(F(values[pair.first]) - F(values[pair.second]));
+      result[pair.first] = p;
+      saddle[pair.second] = std::min(saddle[pair.second], p);
+    }
+    for (const auto e : t.get_essential_extrema())
+      result[e] = inf;
+  }
+}
+
+// Vertex adjacency of the lattice points of a simplicial regular mesh,
+// indexed in the linear order of the mesh lattice (the first dimension is
+// the fastest), i.e. the layout of ndarrays over the same lattice
+inline csr_adjacency<int> regular_mesh_vertex_adjacency(const simplicial_regular_mesh& m,
+    int nthreads = std::thread::hardware_concurrency())
+{
+  const int nd = m.nd();
+  std::vector<std::vector<int>> offsets;
+  for (int t = 0; t < m.ntypes(1); t ++) {
+    const auto e = m.unit_simplex(1, t);
+    std::vector<int> o(nd), o1(nd);
+    for (int j = 0; j < nd; j ++) {
+      o[j] = e[1][j] - e[0][j];
+      o1[j] = -o[j];
+    }
+    offsets.push_back(o);
+    offsets.push_back(o1);
+  }
+  std::sort(offsets.begin(), offsets.end());
+  offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+
+  std::vector<size_t> sizes(nd), strides(nd);
+  size_t n = 1;
+  for (int j = 0; j < nd; j ++) {
+    sizes[j] = m.ub(j) - m.lb(j) + 1;
+    strides[j] = n;
+    n *= sizes[j];
+  }
+
+  auto for_neighbors = [&](size_t i, std::function<void(int)> f) {
+    std::vector<long> x(nd);
+    for (int j = 0; j < nd; j ++)
+      x[j] = (i / strides[j]) % sizes[j];
+    for (const auto &o : offsets) {
+      long k = 0;
+      bool inside = true;
+      for (int j = 0; j < nd && inside; j ++) {
+        const long y = x[j] + o[j];
+        inside = y >= 0 && y < long(sizes[j]);
+        k += y * strides[j];
+      }
+      if (inside) f(k);
+    }
+  };
+
+  csr_adjacency<int> adj;
+  adj.ptr.assign(n + 1, 0);
+  object::parallel_for(n, [&](int i) {
+    for_neighbors(i, [&](int) {adj.ptr[i+1] ++;});
+  }, FTK_THREAD_PTHREAD, nthreads, false);
+  for (size_t i = 0; i < n; i ++)
+    adj.ptr[i+1] += adj.ptr[i];
+
+  adj.idx.resize(adj.ptr[n]);
+  object::parallel_for(n, [&](int i) {
+    size_t p = adj.ptr[i];
+    for_neighbors(i, [&](int k) {adj.idx[p ++] = k;});
+  }, FTK_THREAD_PTHREAD, nthreads, false);
+
+  return adj;
+}
+
+} // namespace ftk
+
+#endif
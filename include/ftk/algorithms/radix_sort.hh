@@ -0,0 +1,76 @@
+#ifndef _FTK_RADIX_SORT_HH
+#define _FTK_RADIX_SORT_HH
+
+#include <ftk/config.hh>
+#include <ftk/object.hh>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+namespace ftk {
+
+// Stable LSD radix sort with 8-bit digits.  digit(x, p) returns the p-th
+// least significant digit (0..255) of the key of x; npasses is the number
+// of digits of the key.  Each pass builds per-chunk histograms and
+// scatters the chunks in parallel; passes in which all keys share the same
+// digit are skipped.
+template <typename T, typename Digit>
+void parallel_radix_sort(std::vector<T>& a, int npasses, Digit digit,
+    int nthreads = std::thread::hardware_concurrency())
+{
+  const size_t n = a.size();
+  if (n <= 1) return;
+
+  const int nchunks = std::max(1, (int)std::min(size_t(std::max(1, nthreads)), (n + 4095) / 4096));
+  const size_t chunk_size = (n + nchunks - 1) / nchunks;
+
+  std::vector<T> b(n);
+  std::vector<size_t> hist(size_t(nchunks) * 256);
+
+  for (int p = 0; p < npasses; p ++) {
+    std::fill(hist.begin(), hist.end(), 0);
+    object::parallel_for(nchunks, [&](int c) {
+      size_t *h = &hist[size_t(c) * 256];
+      const size_t i1 = std::min(n, (c+1) * chunk_size);
+      for (size_t i = c * chunk_size; i < i1; i ++)
+        h[digit(a[i], p)] ++;
+    }, FTK_THREAD_PTHREAD, nchunks, false);
+
+    // offsets ordered by digit first and by chunk second, which keeps the sort stable
+    bool trivial = false;
+    size_t sum = 0;
+    for (int d = 0; d < 256; d ++) {
+      size_t total = 0;
+      for (int c = 0; c < nchunks; c ++) {
+        const size_t cnt = hist[size_t(c) * 256 + d];
+        hist[size_t(c) * 256 + d] = sum;
+        sum += cnt;
+        total += cnt;
+      }
+      if (total == n) trivial = true;
+    }
+    if (trivial) continue;
+
+    object::parallel_for(nchunks, [&](int c) {
+      size_t *h = &hist[size_t(c) * 256];
+      const size_t i1 = std::min(n, (c+1) * chunk_size);
+      for (size_t i = c * chunk_size; i < i1; i ++)
+        b[h[digit(a[i], p)] ++] = a[i];
+    }, FTK_THREAD_PTHREAD, nchunks, false);
+
+    a.swap(b);
+  }
+}
+
+// number of 8-bit digits needed to represent nonnegative integers smaller than n
+inline int radix_sort_ndigits(size_t n)
+{
+  int nd = 0;
+  for (size_t m = n > 0 ? n - 1 : 0; m > 0; m >>= 8)
+    nd ++;
+  return std::max(1, nd);
+}
+
+}
+
+#endif
@@ -4,6 +4,9 @@
 #include <ftk/config.hh>
 #include <set>
 #include <map>
+#include <vector>
+#include <cstdio>
+#include <functional>
 
 namespace ftk {
 
@@ -11,6 +14,8 @@ template <class IdType>
 struct contour_tree {
   void add_node(IdType i) { nodes.insert(i); }
   bool has_node(IdType i) const { return nodes.find(i) != nodes.end(); }
+  const std::set<IdType>& get_nodes() const { return nodes; }
+  size_t size() const { return nodes.size(); }
 
   void add_arc(IdType lo, IdType hi) {
     upper_links[lo].insert(hi);
@@ -65,15 +70,15 @@ struct contour_tree {
     else return IdType(-1);
   }
 
-  const std::set<IdType>& upper_nodes(IdType i) const {
+  std::set<IdType> upper_nodes(IdType i) const {
     auto it = upper_links.find(i);
-    if (it != upper_links.end()) return it.second;
+    if (it != upper_links.end()) return it->second;
     else return std::set<IdType>();
   }
 
-  const std::set<IdType>& lower_nodes(IdType i) const {
+  std::set<IdType> lower_nodes(IdType i) const {
     auto it = lower_links.find(i);
-    if (it != lower_links.end()) return it.second;
+    if (it != lower_links.end()) return it->second;
     else return std::set<IdType>();
   }
 
@@ -82,7 +87,7 @@ struct contour_tree {
     for (const auto &kv : upper_links) {
       IdType i = kv.first;
       for (const auto j : kv.second) 
-        fprintf(stdout, "%zu -- %zu\n", i, j);
+        fprintf(stdout, "%lld -- %lld\n", (long long)i, (long long)j);
     }
     fprintf(stdout, "}\n");
   }
@@ -92,8 +97,8 @@ struct contour_tree {
     for (const auto &kv : upper_links) {
       IdType i = kv.first;
       for (const auto j : kv.second) {
-        fprintf(stderr, "%zu(%f) -- %zu(%f);\n", 
-            i, value(i), j, value(j));
+        fprintf(stderr, "%lld(%f) -- %lld(%f);\n", 
+            (long long)i, (double)value(i), (long long)j, (double)value(j));
       }
     }
   }
@@ -4,18 +4,31 @@
 #include <ftk/config.hh>
 #include <ftk/utils/gather.hh>
 #include <map>
+#include <set>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <type_traits>
 
 namespace ftk {
 
-template <typename T, class Compare = std::less<T>>
+// Distributed union-find that is safe to use from multiple threads.
+// Elements are kept either in a dense array of atomics (integral ids in
+// [0, n), see the second constructor), where find/unite are lock-free
+// CAS loops, or in a hash-sharded set of maps with one lock per shard.
+// Sets are always linked to the smaller root, so the root of a set is
+// its smallest element and every parent is smaller than its children;
+// this keeps concurrent path halving free of cycles.
+template <typename T, class Compare = std::less<T>, class Hash = std::hash<T>>
 struct duf {
-  duf(diy::mpi::communicator c = MPI_COMM_WORLD) : comm(c) {}
+  duf(diy::mpi::communicator c = MPI_COMM_WORLD) : shards(new shard_t[nshards]), comm(c) {}
+  duf(diy::mpi::communicator c, size_t n); // dense storage for ids in [0, n); T must be integral
 
   void unite(T, T);
   T find(T) const;
   
-  size_t size() const { return parents.size(); }
+  size_t size() const;
   bool has(T i) const; //  { return parents.find(i) != parents.end(); }
 
   void sync();
@@ -23,51 +36,178 @@ struct duf {
 
   std::set<T, Compare> get_roots() const;
 
+  bool is_dense() const { return dense; }
+
 private:
-  mutable std::map<T, T, Compare> parents; // parents in the local process
-  mutable std::mutex mutex;
+  static bool less(const T& a, const T& b) { return Compare()(a, b); }
+
+  // dense storage
+  typedef typename std::conditional<std::is_integral<T>::value, T, size_t>::type dense_t;
+  dense_t find_dense(dense_t) const;
+  void unite_dense(dense_t, dense_t);
+
+  bool dense = false;
+  size_t dense_size = 0;
+  std::unique_ptr<std::atomic<dense_t>[]> dense_parents;
+  mutable std::unique_ptr<std::atomic<bool>[]> dense_touched;
+
+  // sharded storage
+  static constexpr int nshards = 64;
+  struct alignas(64) shard_t {
+    std::mutex mutex;
+    std::map<T, T, Compare> parents; // parents in the local process
+  };
+  shard_t& shard(const T& i) const { return shards[Hash()(i) % nshards]; }
+  T parent(const T& i) const; // inserts i if it does not exist
+
+  mutable std::unique_ptr<shard_t[]> shards;
 
   diy::mpi::communicator comm;
 };
 
 //////
-template <typename T, class Compare>
-bool duf<T, Compare>::has(T i) const
+template <typename T, class Compare, class Hash>
+duf<T, Compare, Hash>::duf(diy::mpi::communicator c, size_t n) : 
+  dense(true),
+  dense_size(n),
+  dense_parents(new std::atomic<dense_t>[n]),
+  dense_touched(new std::atomic<bool>[n]),
+  comm(c)
 {
-  std::lock_guard<std::mutex> guard(mutex);
-  return parents.find(i) != parents.end();
+  static_assert(std::is_integral<T>::value, "dense duf requires integral ids");
+  for (size_t i = 0; i < n; i ++) {
+    dense_parents[i].store(dense_t(i), std::memory_order_relaxed);
+    dense_touched[i].store(false, std::memory_order_relaxed);
+  }
 }
 
-template <typename T, class Compare>
-void duf<T, Compare>::unite(T i, T j)
+template <typename T, class Compare, class Hash>
+bool duf<T, Compare, Hash>::has(T i) const
 {
-  i = find(i); // i <-- root(i)
-  j = find(j); // j <-- root(j)
+  if constexpr (std::is_integral<T>::value) {
+    if (is_dense())
+      return dense_touched[i].load(std::memory_order_relaxed);
+  }
+
+  shard_t &s = shard(i);
+  std::lock_guard<std::mutex> guard(s.mutex);
+  return s.parents.find(i) != s.parents.end();
+}
+
+template <typename T, class Compare, class Hash>
+size_t duf<T, Compare, Hash>::size() const
+{
+  size_t n = 0;
+  if (is_dense()) {
+    for (size_t i = 0; i < dense_size; i ++)
+      if (dense_touched[i].load(std::memory_order_relaxed)) n ++;
+  } else {
+    for (int k = 0; k < nshards; k ++) {
+      std::lock_guard<std::mutex> guard(shards[k].mutex);
+      n += shards[k].parents.size();
+    }
+  }
+  return n;
+}
+
+template <typename T, class Compare, class Hash>
+void duf<T, Compare, Hash>::unite(T i, T j)
+{
+  if constexpr (std::is_integral<T>::value) {
+    if (is_dense()) {
+      unite_dense(i, j);
+      return;
+    }
+  }
+
+  while (1) {
+    i = find(i); // i <-- root(i)
+    j = find(j); // j <-- root(j)
   
-  if (i == j) return;
-  if (i > j) std::swap(i, j); // ensure i<j
+    if (i == j) return;
+    if (less(j, i)) std::swap(i, j); // ensure i<j
 
-  // critical section
-  {
-    std::lock_guard<std::mutex> guard(mutex);
-    parents[j] = i; 
+    // link j to i if j is still a root; otherwise another thread got there first, retry
+    shard_t &s = shard(j);
+    std::lock_guard<std::mutex> guard(s.mutex);
+    T &pj = s.parents[j];
+    if (pj == j) {
+      pj = i;
+      return;
+    }
   }
 }
 
-template <typename T, class Compare>
-T duf<T, Compare>::find(T i) const
+template <typename T, class Compare, class Hash>
+T duf<T, Compare, Hash>::parent(const T& i) const
 {
-  std::lock_guard<std::mutex> guard(mutex);
+  shard_t &s = shard(i);
+  std::lock_guard<std::mutex> guard(s.mutex);
   
-  if (parents.find(i) == parents.end()) { // if i does not exist, insert i to the graph and return i as the root
-    parents.insert({i, i}); // parents[i] = i;
+  auto it = s.parents.find(i);
+  if (it == s.parents.end()) { // if i does not exist, insert i to the graph and return i as the root
+    s.parents.insert({i, i});
     return i;
-  } else {
-    while (i != parents[i]) {
-      parents[i] = parents[parents[i]];
-      i = parents[i];
+  } else 
+    return it->second;
+}
+
+template <typename T, class Compare, class Hash>
+T duf<T, Compare, Hash>::find(T i) const
+{
+  if constexpr (std::is_integral<T>::value) {
+    if (is_dense()) 
+      return find_dense(i);
+  }
+
+  while (1) {
+    const T p = parent(i);
+    if (p == i) return i;
+
+    const T gp = parent(p);
+    if (gp == p) return p;
+
+    { // path halving; only one shard is locked at a time
+      shard_t &s = shard(i);
+      std::lock_guard<std::mutex> guard(s.mutex);
+      T &pi = s.parents[i];
+      if (pi == p) pi = gp;
     }
-    return i;
+    i = gp;
+  }
+}
+
+template <typename T, class Compare, class Hash>
+typename duf<T, Compare, Hash>::dense_t duf<T, Compare, Hash>::find_dense(dense_t i) const
+{
+  if (!dense_touched[i].load(std::memory_order_relaxed))
+    dense_touched[i].store(true, std::memory_order_relaxed);
+
+  while (1) {
+    dense_t p = dense_parents[i].load(std::memory_order_acquire);
+    if (p == i) return i;
+
+    const dense_t gp = dense_parents[p].load(std::memory_order_acquire);
+    if (gp == p) return p;
+
+    dense_parents[i].compare_exchange_weak(p, gp, std::memory_order_release, std::memory_order_relaxed); // path halving
+    i = gp;
+  }
+}
+
+template <typename T, class Compare, class Hash>
+void duf<T, Compare, Hash>::unite_dense(dense_t i, dense_t j)
+{
+  while (1) {
+    i = find_dense(i);
+    j = find_dense(j);
+
+    if (i == j) return;
+    if (less(j, i)) std::swap(i, j);
+
+    dense_t expected = j; // j is expected to be still a root
+    if (dense_parents[j].compare_exchange_strong(expected, i, std::memory_order_acq_rel))
+      return;
   }
 }
 
@@ -81,19 +221,31 @@ void duf<T>::print() const
 }
 #endif
 
-template <typename T, class Compare>
-std::set<T, Compare> duf<T, Compare>::get_roots() const
+template <typename T, class Compare, class Hash>
+std::set<T, Compare> duf<T, Compare, Hash>::get_roots() const
 {
   std::set<T, Compare> roots;
-  for (const auto &kv : parents) {
-    if (kv.first == find(kv.second))
-      roots.insert(kv.first);
+  if constexpr (std::is_integral<T>::value) {
+    if (is_dense()) {
+      for (size_t i = 0; i < dense_size; i ++)
+        if (dense_touched[i].load(std::memory_order_relaxed) && 
+            size_t(dense_parents[i].load(std::memory_order_acquire)) == i)
+          roots.insert(T(i));
+      return roots;
+    }
+  }
+
+  for (int k = 0; k < nshards; k ++) {
+    std::lock_guard<std::mutex> guard(shards[k].mutex);
+    for (const auto &kv : shards[k].parents)
+      if (kv.first == kv.second)
+        roots.insert(kv.first);
   }
   return roots;
 }
 
-template <typename T, class Compare>
-void duf<T, Compare>::sync()
+template <typename T, class Compare, class Hash>
+void duf<T, Compare, Hash>::sync()
 {
   if (comm.size() == 1) return; // no need to sync
 
@@ -5,6 +5,10 @@
 // #include <ftk/utils/serialization.hh>
 #include <ftk/features/feature_curve.hh>
 #include <map>
+#include <list>
+#include <cstdio>
+#include <cstring>
+#include <limits>
 
 #if FTK_HAVE_VTK
 #include <vtkUnsignedIntArray.h>
@@ -50,8 +54,17 @@ public: // IO
   void write_json(const std::string& filename, int indent=0) const;
   void read_json(const std::string& filename);
 
+  // native binary format: a fixed-size header, the points of all curves
+  // stored contiguously curve by curve, and a trailing index with one
+  // fixed-size entry (id, offset, time range, statistics) per curve, so
+  // that individual curves or time windows can be read by seeking
   void write_binary(const std::string& filename) const;
   void read_binary(const std::string& filename);
+  void read_binary(const std::string& filename, int t0, int t1); // curves intercepted by [t0, t1]
+
+  static bool is_binary_file(const std::string& filename);
+  static size_t read_binary_ncurves(const std::string& filename);
+  static feature_curve_t read_binary_curve(const std::string& filename, size_t i); // the i-th curve in the file
 
   void write_text(std::ostream& os, /*const int cpdims,*/ const std::vector<std::string>& scalar_components) const;
   void write_text(const std::string& filename, /*cpdims,*/ const std::vector<std::string>& scalar_components) const;
@@ -63,6 +76,21 @@ public: // IO
   vtkSmartPointer<vtkPolyData> to_vtp(const std::vector<std::string> scalar_components = {}) const;
 #endif
 
+protected:
+  struct binary_header_t {
+    char magic[8];
+    uint32_t version, byte_order, nvars, point_record_size, index_entry_size, reserved;
+    uint64_t ncurves, npoints, index_offset;
+  };
+  static constexpr const char* binary_magic = "FTKCURVE";
+  static constexpr uint32_t binary_version = 1, binary_byte_order = 0x01020304;
+
+  static size_t binary_point_record_size(uint32_t nvars) {return 7*sizeof(double) + sizeof(int32_t) + nvars*sizeof(double) + sizeof(uint32_t) + 1 + sizeof(uint64_t);}
+  static size_t binary_index_entry_size(uint32_t nvars) {return 4*sizeof(uint32_t) + 2*sizeof(uint64_t) + 10*sizeof(double) + 3*nvars*sizeof(double);}
+
+  static FILE* open_binary(const std::string& filename, binary_header_t& h);
+  static feature_curve_t read_binary_curve(FILE *fp, const binary_header_t& h, size_t i, bool with_points = true);
+
 protected:
   int get_new_id() const {
     if (empty()) return 0; 
@@ -138,8 +166,7 @@ inline void feature_curve_set_t::write(const std::string& filename, const std::s
 {
   const int fmt = file_extension(filename, format);
   if (fmt == FILE_EXT_BIN || fmt == FILE_EXT_NULL) {
-    fatal("file writer not implemented yet");
-    // diy::serializeToFile(*this, filename);
+    write_binary(filename);
   } else {
 #if FTK_HAVE_VTK
     write_polydata(filename, to_vtp({}), format);
@@ -153,7 +180,11 @@ inline void feature_curve_set_t::write(const std::string& filename, const std::s
 
 inline void feature_curve_set_t::read(const std::string& format, const std::string& filename)
 {
-  // TODO
+  const int fmt = file_extension(filename, format);
+  if (fmt == FILE_EXT_BIN || fmt == FILE_EXT_NULL)
+    read_binary(filename);
+  else 
+    fatal("file reader not implemented yet");
 }
 
 inline void feature_curve_set_t::write_json(const std::string& filename, int indent) const
@@ -168,12 +199,238 @@ inline void feature_curve_set_t::read_json(const std::string& filename)
 
 inline void feature_curve_set_t::write_binary(const std::string& filename) const
 {
-  // TODO
+  const uint32_t nv = FTK_CP_MAX_NUM_VARS;
+
+  binary_header_t h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, binary_magic, sizeof(h.magic));
+  h.version = binary_version;
+  h.byte_order = binary_byte_order;
+  h.nvars = nv;
+  h.point_record_size = binary_point_record_size(nv);
+  h.index_entry_size = binary_index_entry_size(nv);
+  h.ncurves = size();
+  for (const auto &kv : *this)
+    h.npoints += kv.second.size();
+  h.index_offset = sizeof(h) + h.npoints * h.point_record_size;
+
+  FILE *fp = fopen(filename.c_str(), "wb");
+  if (!fp) fatal("cannot open file " + filename);
+  fwrite(&h, sizeof(h), 1, fp);
+
+  std::vector<char> buf;
+  auto put = [&](char* &q, const void *x, size_t n) { memcpy(q, x, n); q += n; };
+
+  for (const auto &kv : *this) { // points
+    const auto &curve = kv.second;
+    buf.resize(curve.size() * h.point_record_size);
+    char *q = buf.data();
+    for (const auto &p : curve) {
+      const int32_t timestep = p.timestep;
+      const uint32_t type = p.type;
+      const uint8_t ordinal = p.ordinal;
+      const uint64_t tag = p.tag;
+      put(q, p.x.data(), 3*sizeof(double));
+      put(q, &p.t, sizeof(double));
+      put(q, &timestep, sizeof(int32_t));
+      put(q, p.scalar.data(), nv*sizeof(double));
+      put(q, p.v.data(), 3*sizeof(double));
+      put(q, &type, sizeof(uint32_t));
+      put(q, &ordinal, 1);
+      put(q, &tag, sizeof(uint64_t));
+    }
+    fwrite(buf.data(), 1, buf.size(), fp);
+  }
+
+  buf.resize(h.ncurves * h.index_entry_size);
+  char *q = buf.data();
+  uint64_t offset = sizeof(h);
+  for (const auto &kv : *this) { // index
+    const auto &curve = kv.second;
+    const int32_t id = kv.first;
+    const uint32_t flags = (curve.complete ? 1 : 0) | (curve.loop ? 2 : 0), 
+                   consistent_type = curve.consistent_type, 
+                   padding = 0;
+    const uint64_t npoints = curve.size();
+
+    // the time range is derived from the points, as statistics may not be up to date
+    double tmin = std::numeric_limits<double>::max(), 
+           tmax = std::numeric_limits<double>::lowest();
+    for (const auto &p : curve) {
+      tmin = std::min(tmin, p.t);
+      tmax = std::max(tmax, p.t);
+    }
+
+    put(q, &id, sizeof(int32_t));
+    put(q, &flags, sizeof(uint32_t));
+    put(q, &consistent_type, sizeof(uint32_t));
+    put(q, &padding, sizeof(uint32_t));
+    put(q, &offset, sizeof(uint64_t));
+    put(q, &npoints, sizeof(uint64_t));
+    put(q, &tmin, sizeof(double));
+    put(q, &tmax, sizeof(double));
+    put(q, curve.bbmin.data(), 3*sizeof(double));
+    put(q, curve.bbmax.data(), 3*sizeof(double));
+    put(q, &curve.vmmin, sizeof(double));
+    put(q, &curve.vmmax, sizeof(double));
+    put(q, curve.min.data(), nv*sizeof(double));
+    put(q, curve.max.data(), nv*sizeof(double));
+    put(q, curve.persistence.data(), nv*sizeof(double));
+
+    offset += npoints * h.point_record_size;
+  }
+  fwrite(buf.data(), 1, buf.size(), fp);
+  fclose(fp);
+}
+
+inline FILE* feature_curve_set_t::open_binary(const std::string& filename, binary_header_t& h)
+{
+  FILE *fp = fopen(filename.c_str(), "rb");
+  if (!fp) fatal("cannot open file " + filename);
+
+  if (fread(&h, sizeof(h), 1, fp) != 1 || memcmp(h.magic, binary_magic, sizeof(h.magic)) != 0) {
+    fclose(fp);
+    fatal("not an ftk binary curve file: " + filename);
+  }
+  if (h.byte_order != binary_byte_order || h.version > binary_version) {
+    fclose(fp);
+    fatal("unsupported version or byte order of binary curve file: " + filename);
+  }
+  if (h.point_record_size != binary_point_record_size(h.nvars) || 
+      h.index_entry_size != binary_index_entry_size(h.nvars)) {
+    fclose(fp);
+    fatal("corrupted binary curve file: " + filename);
+  }
+  return fp;
+}
+
+inline feature_curve_t feature_curve_set_t::read_binary_curve(FILE *fp, const binary_header_t& h, size_t i, bool with_points)
+{
+  const uint32_t nv = std::min(h.nvars, uint32_t(FTK_CP_MAX_NUM_VARS)); // number of variables to keep
+  std::vector<char> buf(std::max(h.index_entry_size, h.point_record_size));
+  auto get = [&](const char* &q, void *x, size_t n) { memcpy(x, q, n); q += n; };
+
+  feature_curve_t curve;
+  curve.max.fill(0); curve.min.fill(0); curve.persistence.fill(0);
+
+  fseeko(fp, h.index_offset + i * h.index_entry_size, SEEK_SET);
+  if (fread(buf.data(), h.index_entry_size, 1, fp) != 1) 
+    fatal("cannot read binary curve index");
+  
+  int32_t id;
+  uint32_t flags, padding;
+  uint64_t offset, npoints;
+  const char *q = buf.data();
+  get(q, &id, sizeof(int32_t));
+  get(q, &flags, sizeof(uint32_t));
+  get(q, &curve.consistent_type, sizeof(uint32_t));
+  get(q, &padding, sizeof(uint32_t));
+  get(q, &offset, sizeof(uint64_t));
+  get(q, &npoints, sizeof(uint64_t));
+  get(q, &curve.tmin, sizeof(double));
+  get(q, &curve.tmax, sizeof(double));
+  get(q, curve.bbmin.data(), 3*sizeof(double));
+  get(q, curve.bbmax.data(), 3*sizeof(double));
+  get(q, &curve.vmmin, sizeof(double));
+  get(q, &curve.vmmax, sizeof(double));
+  get(q, curve.min.data(), nv*sizeof(double)); q += (h.nvars - nv) * sizeof(double);
+  get(q, curve.max.data(), nv*sizeof(double)); q += (h.nvars - nv) * sizeof(double);
+  get(q, curve.persistence.data(), nv*sizeof(double));
+  curve.id = id;
+  curve.complete = flags & 1;
+  curve.loop = flags & 2;
+
+  if (!with_points) return curve;
+
+  buf.resize(npoints * h.point_record_size);
+  fseeko(fp, offset, SEEK_SET);
+  if (npoints > 0 && fread(buf.data(), h.point_record_size, npoints, fp) != npoints)
+    fatal("cannot read binary curve points");
+
+  curve.resize(npoints);
+  q = buf.data();
+  for (auto &p : curve) {
+    int32_t timestep;
+    uint32_t type;
+    uint8_t ordinal;
+    uint64_t tag;
+    get(q, p.x.data(), 3*sizeof(double));
+    get(q, &p.t, sizeof(double));
+    get(q, &timestep, sizeof(int32_t));
+    get(q, p.scalar.data(), nv*sizeof(double)); q += (h.nvars - nv) * sizeof(double);
+    get(q, p.v.data(), 3*sizeof(double));
+    get(q, &type, sizeof(uint32_t));
+    get(q, &ordinal, 1);
+    get(q, &tag, sizeof(uint64_t));
+    p.timestep = timestep;
+    p.type = type;
+    p.ordinal = ordinal;
+    p.tag = tag;
+    p.id = id;
+  }
+  return curve;
 }
 
 inline void feature_curve_set_t::read_binary(const std::string& filename)
 {
-  // TODO
+  binary_header_t h;
+  FILE *fp = open_binary(filename, h);
+
+  clear();
+  for (size_t i = 0; i < h.ncurves; i ++) {
+    feature_curve_t curve = read_binary_curve(fp, h, i);
+    insert({curve.id, curve});
+  }
+  fclose(fp);
+}
+
+inline void feature_curve_set_t::read_binary(const std::string& filename, int t0, int t1)
+{
+  binary_header_t h;
+  FILE *fp = open_binary(filename, h);
+
+  clear();
+  for (size_t i = 0; i < h.ncurves; i ++) {
+    const feature_curve_t summary = read_binary_curve(fp, h, i, false);
+    if (summary.tmax < t0 || summary.tmin > t1) continue; // skip points of curves out of the window
+
+    auto curve = read_binary_curve(fp, h, i).intercept(t0, t1);
+    if (!curve.empty())
+      insert({summary.id, curve});
+  }
+  fclose(fp);
+}
+
+inline bool feature_curve_set_t::is_binary_file(const std::string& filename)
+{
+  FILE *fp = fopen(filename.c_str(), "rb");
+  if (!fp) return false;
+
+  char magic[8];
+  const bool b = fread(magic, sizeof(magic), 1, fp) == 1 && memcmp(magic, binary_magic, sizeof(magic)) == 0;
+  fclose(fp);
+  return b;
+}
+
+inline size_t feature_curve_set_t::read_binary_ncurves(const std::string& filename)
+{
+  binary_header_t h;
+  FILE *fp = open_binary(filename, h);
+  fclose(fp);
+  return h.ncurves;
+}
+
+inline feature_curve_t feature_curve_set_t::read_binary_curve(const std::string& filename, size_t i)
+{
+  binary_header_t h;
+  FILE *fp = open_binary(filename, h);
+  if (i >= h.ncurves) {
+    fclose(fp);
+    fatal("curve index out of range");
+  }
+  auto curve = read_binary_curve(fp, h, i);
+  fclose(fp);
+  return curve;
 }
 
 
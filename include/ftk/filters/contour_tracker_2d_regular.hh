@@ -60,18 +60,20 @@ public:
 
 protected:
   typedef simplicial_regular_mesh_element element_t;
+  typedef simplicial_regular_mesh_element_fixed<3> fixed_element_t;
 
   feature_surface_t surfaces;
+  std::set<element_t> related_cells;
 
 protected:
-  bool check_simplex(const element_t& s, feature_point_t& cp);
+  bool check_simplex(const fixed_element_t& s, feature_point_t& cp);
   void trace_intersections();
   void trace_connected_components();
 
   void build_surfaces();
 
-  virtual void simplex_coordinates(const std::vector<std::vector<int>>& vertices, double X[][3]) const;
-  virtual void simplex_scalars(const std::vector<std::vector<int>>& vertices, double values[]) const;
+  virtual void simplex_coordinates(const int vertices[2][3], double X[][3]) const;
+  virtual void simplex_scalars(const int vertices[2][3], double values[]) const;
 };
 
 
@@ -117,7 +119,7 @@ inline void contour_tracker_2d_regular::build_surfaces()
     } else {
       // fprintf(stderr, "irregular count=%d\n", count); // WIP: triangulation
     }
-  }, FTK_THREAD_PTHREAD, nthreads, enable_set_affinity);
+  }, thread_backend, nthreads, enable_set_affinity);
 
   surfaces.relabel();
   fprintf(stderr, "#pts=%zu, #tri=%zu\n", surfaces.pts.size(), surfaces.tris.size());
@@ -154,17 +156,19 @@ inline void contour_tracker_2d_regular::finalize()
 inline void contour_tracker_2d_regular::reset()
 {
   surfaces.clear();
+  related_cells.clear();
   contour_tracker_regular::reset();
 }
 
 inline bool contour_tracker_2d_regular::check_simplex(
-    const element_t& e, feature_point_t& p)
+    const fixed_element_t& e, feature_point_t& p)
 {
   if (!e.valid(m)) return false; // check if the 2-simplex is valid
-  const auto &vertices = e.vertices(m); // obtain the vertices of the simplex
+  int vertices[2][3]; // obtain the vertices of the simplex
+  e.vertices(m, vertices);
   
   int indices[3];
-  simplex_indices(vertices, indices);
+  simplex_indices(2, vertices, indices);
   
   double f[2];
   simplex_scalars(vertices, f);
@@ -204,9 +208,10 @@ inline void contour_tracker_2d_regular::update_timestep()
 {
   if (comm.rank() == 0) fprintf(stderr, "current_timestep=%d\n", current_timestep);
 
-  auto func = [=](element_t e) {
+  auto func = [=](const fixed_element_t& fe) {
     feature_point_t p;
-    if (check_simplex(e, p)) {
+    if (check_simplex(fe, p)) {
+      const element_t e(fe);
       std::lock_guard<std::mutex> guard(mutex);
       // std::cerr << e << std::endl;
 
@@ -224,23 +229,23 @@ inline void contour_tracker_2d_regular::update_timestep()
     }
   };
 
-  m.element_for_ordinal(1, current_timestep, func, xl, nthreads, enable_set_affinity);
+  m.element_for_ordinal_fixed<3>(1, current_timestep, func, thread_backend, nthreads, enable_set_affinity);
   if (field_data_snapshots.size() >= 2) // interval
-    m.element_for_interval(1, current_timestep, current_timestep+1, func, xl, nthreads, enable_set_affinity);
+    m.element_for_interval_fixed<3>(1, current_timestep, current_timestep+1, func, thread_backend, nthreads, enable_set_affinity);
 }
 
 inline void contour_tracker_2d_regular::simplex_coordinates(
-    const std::vector<std::vector<int>>& vertices, double X[][3]) const
+    const int vertices[2][3], double X[][3]) const
 {
-  for (int i = 0; i < vertices.size(); i ++)
+  for (int i = 0; i < 2; i ++)
     for (int j = 0; j < 3; j ++)
       X[i][j] = vertices[i][j];
 }
 
 inline void contour_tracker_2d_regular::simplex_scalars(
-    const std::vector<std::vector<int>>& vertices, double values[]) const
+    const int vertices[2][3], double values[]) const
 {
-  for (int i = 0; i < vertices.size(); i ++) {
+  for (int i = 0; i < 2; i ++) {
     const int iv = vertices[i][2] == current_timestep ? 0 : 1;
     values[i] = field_data_snapshots[iv].scalar(
         vertices[i][0] - local_array_domain.start(0), 
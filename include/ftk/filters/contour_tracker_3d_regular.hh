@@ -19,6 +19,7 @@
 #include <ftk/ndarray/grad.hh>
 #include <ftk/ndarray/writer.hh>
 #include <ftk/mesh/simplicial_regular_mesh.hh>
+#include <ftk/mesh/pentachoron_assembly.hh>
 #include <ftk/filters/contour_tracker_regular.hh>
 #include <ftk/utils/gather.hh>
 
@@ -77,16 +78,17 @@ protected:
 
 protected:
   typedef simplicial_regular_mesh_element element_t;
+  typedef simplicial_regular_mesh_element_fixed<4> fixed_element_t;
 
   feature_volume_t isovolume;
   
 protected:
-  bool check_simplex(const element_t& s, feature_point_t& cp);
+  bool check_simplex(const fixed_element_t& s, feature_point_t& cp);
   void trace_intersections();
   void trace_connected_components();
 
-  void simplex_coordinates(const std::vector<std::vector<int>>& vertices, double X[][4]) const;
-  void simplex_values(const std::vector<std::vector<int>>& vertices, double scalars[], double gradients[][3]) const;
+  void simplex_coordinates(const int vertices[2][4], double X[][4]) const;
+  void simplex_values(const int vertices[2][4], double scalars[], double gradients[][3]) const;
 };
 
 
@@ -95,79 +97,18 @@ inline void contour_tracker_3d_regular::build_isovolume()
 {
   fprintf(stderr, "building isovolumes...\n");
 
+  std::vector<uint64_t> tags;
   int i = 0;
   for (auto &kv : intersections) { 
     kv.second.id = i ++;
     isovolume.pts.push_back(kv.second);
+    tags.push_back(kv.first.to_integer(m));
   }
 
-  std::mutex my_mutex;
-  auto add_tet = [&](int i0, int i1, int i2, int i3) {
-    std::lock_guard<std::mutex> guard(my_mutex);
-    isovolume.conn.push_back({i0, i1, i2, i3});
-  };
-  
-  parallel_for<element_t>(related_cells, [&](const element_t &e) {
-    int count = 0;
-    int ids[6]; // 6 intersected edges max
-
-    std::set<element_t> unique_edges;
-    for (auto tet : e.sides(m))
-      for (auto tri : tet.sides(m))
-        for (auto edge : tri.sides(m))
-          unique_edges.insert(edge);
-
-    for (auto edge : unique_edges)
-      if (intersections.find(edge) != intersections.end())
-        ids[count ++] = intersections[edge].id;
-
-    if (count == 4) {
-      add_tet(ids[0], ids[1], ids[2], ids[3]);
-    } else if (count == 6) {
-      // triangulation. // if the pentachoron has six intersected 2-edges, the isovolume must be a prism
-      // (1) find two tets, each of which has a triangular isosurface patch
-      // (2) sort vertices of each patch
-      // (3) staircase triangulation
-
-      int quadrilaterals[3][4], quadrilaterals_count = 0;
-      int triangles[2][3], triangle_count = 0;
-
-      for (auto tet : e.sides(m)) {
-        int my_count = 0;
-        int my_ids[4];
-
-        std::set<element_t> my_unique_edges;
-        for (auto tri : tet.sides(m))
-          if (tri.valid(m)) 
-            for (auto edge : tri.sides(m))
-              if (edge.valid(m))
-                my_unique_edges.insert(edge);
-
-        for (auto edge : my_unique_edges)
-          if (intersections.find(edge) != intersections.end())
-            my_ids[my_count ++] = intersections[edge].id;
-
-        // fprintf(stderr, "my_count=%d\n", my_count);
-        if (my_count == 3) { // triangle
-          for (int i = 0; i < 3; i ++)
-            triangles[triangle_count][i] = my_ids[i];
-          triangle_count ++;
-        } else if (my_count == 4) { // quadrilateral
-          for (int i = 0; i < 4; i ++) 
-            quadrilaterals[quadrilaterals_count][i] = my_ids[i];
-          quadrilaterals_count ++;
-        }
-      }
-      // fprintf(stderr, "triangle_count=%d\n", triangle_count);
-      assert(triangle_count == 2);
-      assert(quadrilaterals_count == 3);
-
-      // staircase triangulatio8n
-      add_tet(triangles[0][0], triangles[0][1], triangles[0][2], triangles[1][2]);
-      add_tet(triangles[0][0], triangles[0][1], triangles[1][1], triangles[1][2]);
-      add_tet(triangles[0][0], triangles[1][0], triangles[1][1], triangles[1][2]);
-    }
-  }, FTK_THREAD_PTHREAD, nthreads, enable_set_affinity);
+  pentachoron_assembly assembly(m, 1);
+  isovolume.conn = assembly.assemble<4>(tags, thread_backend, nthreads, enable_set_affinity);
+  if (assembly.n_irregular() && comm.rank() == get_root_proc())
+    fprintf(stderr, "#irregular_pentachora=%zu\n", assembly.n_irregular());
 
   isovolume.relabel();
   fprintf(stderr, "isovolumes built, #pts=%zu, #tet=%zu\n", isovolume.pts.size(), isovolume.conn.size());
@@ -181,7 +122,6 @@ inline void contour_tracker_3d_regular::finalize()
     fprintf(stderr, "max_accumulated_kernel_time=%f\n", accumulated_kernel_time);
   
   diy::mpi::gather(comm, intersections, intersections, get_root_proc());
-  diy::mpi::gather(comm, related_cells, related_cells, get_root_proc());
 
   if (comm.rank() == get_root_proc()) {
     build_isovolume();
@@ -217,13 +157,14 @@ inline void contour_tracker_3d_regular::reset()
 }
 
 inline bool contour_tracker_3d_regular::check_simplex(
-    const element_t& e, feature_point_t& p)
+    const fixed_element_t& e, feature_point_t& p)
 {
   if (!e.valid(m)) return false; // check if the 2-simplex is valid
-  const auto &vertices = e.vertices(m); // obtain the vertices of the simplex
+  int vertices[2][4]; // obtain the vertices of the simplex
+  e.vertices(m, vertices);
   
   int indices[2];
-  simplex_indices(vertices, indices);
+  simplex_indices(2, vertices, indices);
   
   double f[2], g[2][3];
   simplex_values(vertices, f, g);
@@ -279,38 +220,12 @@ inline void contour_tracker_3d_regular::update_timestep()
   typedef std::chrono::high_resolution_clock clock_type;
   auto t0 = clock_type::now();
   
-  auto get_relatetd_cels = [&](element_t e) {
-    std::set<element_t> my_related_cells;
-    
-    auto tris = e.side_of(m);
-    for (auto tri : tris) {
-      if (tri.valid(m)) {
-        auto tets = tri.side_of(m);
-        for (auto tet : tets) {
-          if (tet.valid(m)) {
-            auto pents = tet.side_of(m);
-            for (auto pent : pents) 
-              if (pent.valid(m))
-                my_related_cells.insert(pent); 
-          }
-        }
-      }
-    }
-
-    return my_related_cells;
-  };
-
-  auto func = [=](element_t e) {
+  auto func = [=](const fixed_element_t& fe) {
     feature_point_t p;
-    if (check_simplex(e, p)) {
-      std::set<element_t> my_related_cells = get_relatetd_cels(e);
-     
-      {
-        std::lock_guard<std::mutex> guard(mutex);
-        // std::cerr << e << std::endl;
-        intersections[e] = p;
-        related_cells.insert(my_related_cells.begin(), my_related_cells.end());
-      }
+    if (check_simplex(fe, p)) {
+      const element_t e(fe);
+      std::lock_guard<std::mutex> guard(mutex);
+      intersections[e] = p;
     }
   };
 
@@ -379,8 +294,6 @@ inline void contour_tracker_3d_regular::update_timestep()
       cp.timestep = current_timestep;
 
       intersections[e] = cp;
-      std::set<element_t> my_related_cells = get_relatetd_cels(e);
-      related_cells.insert(my_related_cells.begin(), my_related_cells.end());
     }
 
     if (field_data_snapshots.size() >= 2) { // interval
@@ -406,8 +319,6 @@ inline void contour_tracker_3d_regular::update_timestep()
         cp.timestep = current_timestep;
       
         intersections[e] = cp;
-        std::set<element_t> my_related_cells = get_relatetd_cels(e);
-        related_cells.insert(my_related_cells.begin(), my_related_cells.end());
       }
     }
 #else
@@ -415,9 +326,9 @@ inline void contour_tracker_3d_regular::update_timestep()
 #endif
 
   } else {
-    element_for_ordinal(1, func);
+    element_for_ordinal_fixed<4>(1, func);
     if (field_data_snapshots.size() >= 2) // interval
-      element_for_interval(1, func);
+      element_for_interval_fixed<4>(1, func);
   }
   
   auto t1 = clock_type::now();
@@ -425,17 +336,17 @@ inline void contour_tracker_3d_regular::update_timestep()
 }
 
 inline void contour_tracker_3d_regular::simplex_coordinates(
-    const std::vector<std::vector<int>>& vertices, double X[][4]) const
+    const int vertices[2][4], double X[][4]) const
 {
-  for (int i = 0; i < vertices.size(); i ++)
+  for (int i = 0; i < 2; i ++)
     for (int j = 0; j < 4; j ++)
       X[i][j] = vertices[i][j];
 }
 
 inline void contour_tracker_3d_regular::simplex_values(
-    const std::vector<std::vector<int>>& vertices, double scalars[], double grads[][3]) const
+    const int vertices[2][4], double scalars[], double grads[][3]) const
 {
-  for (int i = 0; i < vertices.size(); i ++) {
+  for (int i = 0; i < 2; i ++) {
     const int iv = vertices[i][3] == current_timestep ? 0 : 1;
     scalars[i] = field_data_snapshots[iv].scalar(
         vertices[i][0] - local_array_domain.start(0), 
@@ -20,7 +20,6 @@ protected:
   typedef simplicial_regular_mesh_element element_t;
   
   std::map<element_t, feature_point_t> intersections;
-  std::set<element_t> related_cells;
 
 protected:
   void build_isovolumes();
@@ -34,7 +33,6 @@ inline void contour_tracker_regular::reset()
 {
   current_timestep = 0;
   intersections.clear();
-  related_cells.clear();
   contour_tracker::reset();
 }
 
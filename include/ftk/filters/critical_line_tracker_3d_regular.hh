@@ -7,6 +7,8 @@
 #include <ftk/numeric/critical_point_test.hh>
 #include <ftk/numeric/inverse_linear_interpolation_solver.hh>
 #include <ftk/numeric/linear_interpolation.hh>
+#include <ftk/mesh/pentachoron_assembly.hh>
+#include <ftk/filters/surface_slab_stitcher.hh>
 
 extern std::vector<ftk::feature_point_lite_t> 
 extract_3dclt_cuda(
@@ -35,6 +37,12 @@ struct critical_line_tracker_3d_regular : public virtual critical_line_tracker,
 public:
   void build_vortex_surfaces();
 
+  // build the surface between timesteps t and t+1 as soon as t+1 is
+  // processed and pass it to the callback on the root proc, instead of
+  // keeping all intersections until finalize()
+  void set_enable_streaming_surfaces(bool b) { enable_streaming_surfaces = b; }
+  void set_surface_slab_callback(std::function<void(int/*t*/, const feature_surface_t&)> f) { surface_slab_callback = f; }
+
   void read_surfaces(const std::string& filename, std::string format="auto");
 
   void write_sliced(const std::string& pattern) const;
@@ -54,10 +62,13 @@ protected:
   typedef simplicial_regular_mesh_element element_t;
   
   std::map<element_t, feature_point_t> intersections;
-  std::set<element_t> related_cells;
 
   feature_surface_t surfaces;
 
+  bool enable_streaming_surfaces = false;
+  std::function<void(int, const feature_surface_t&)> surface_slab_callback;
+  surface_slab_stitcher stitcher;
+
 protected:
   virtual bool check_simplex(const element_t& s, feature_point_t& cp) const;
   
@@ -66,8 +77,6 @@ protected:
       float X[][4],
       float UV[][2]) const;
 
-  std::set<element_t> get_relatetd_cels(const element_t& e);
-
   virtual std::vector<std::string> varnames() const { return {}; } // varnames for additional variables stored in scalar
 };
 
@@ -80,12 +89,13 @@ inline void critical_line_tracker_3d_regular::finalize()
   if (comm.rank() == get_root_proc())
     fprintf(stderr, "max_accumulated_kernel_time=%f\n", accumulated_kernel_time);
   
+  if (enable_streaming_surfaces) // slabs are already built in update_timestep()
+    return;
+
   diy::mpi::gather(comm, intersections, intersections, get_root_proc());
-  diy::mpi::gather(comm, related_cells, related_cells, get_root_proc());
   
   if (comm.rank() == get_root_proc()) {
-    fprintf(stderr, "#intersections=%zu, #related_cells=%zu\n", 
-        intersections.size(), related_cells.size());
+    fprintf(stderr, "#intersections=%zu\n", intersections.size());
  
     if (start_timestep == current_timestep) // single timestep
       build_vortex_lines();
@@ -128,82 +138,22 @@ inline void critical_line_tracker_3d_regular::build_vortex_lines()
   fprintf(stderr, "done, #curves=%zu\n", traced_curves.size());
 }
   
-inline std::set<simplicial_regular_mesh_element> critical_line_tracker_3d_regular::get_relatetd_cels(const simplicial_regular_mesh_element& e) 
-{
-  std::set<simplicial_regular_mesh_element> my_related_cells;
-  
-  auto tets = e.side_of(m);
-  for (auto tet : tets) {
-    if (tet.valid(m)) {
-      auto pents = tet.side_of(m);
-      for (auto pent : pents)
-        if (pent.valid(m))
-          my_related_cells.insert(pent);
-    }
-  }
-
-  return my_related_cells;
-}
-
 inline void critical_line_tracker_3d_regular::build_vortex_surfaces()
 {
   fprintf(stderr, "building vortex surfaces...\n");
 
+  std::vector<uint64_t> tags;
   int i = 0;
   for (auto &kv : intersections) {
     kv.second.id = i ++;
     surfaces.pts.push_back(kv.second);
+    tags.push_back(kv.first.to_integer(m));
   }
 
-  std::mutex my_mutex;
-  auto add_tri = [&](int i0, int i1, int i2) {
-    std::lock_guard<std::mutex> guard(my_mutex);
-    surfaces.tris.push_back({i0, i1, i2});
-  };
-  
-  for (const auto &kv : intersections) {
-    std::set<element_t> my_related_cells = get_relatetd_cels(kv.first);
-    related_cells.insert(my_related_cells.begin(), my_related_cells.end());
-  }
-
-  parallel_for<element_t>(related_cells, [&](const element_t &e) {
-    int count = 0;
-    int ids[6];
-
-    std::set<element_t> unique_tris;
-    for (auto tet : e.sides(m))
-      for (auto tri : tet.sides(m))
-        unique_tris.insert(tri);
-
-    for (auto tri : unique_tris)
-      if (intersections.find(tri) != intersections.end())
-        ids[count ++] = intersections[tri].id;
-
-    if (count == 3) {
-      add_tri(ids[0], ids[1], ids[2]);
-    } else if (count == 4) {
-      // std::lock_guard<std::mutex> guard(my_mutex);
-      // surfaces.quads.push_back({ids[0], ids[1], ids[2], ids[3]});
-      add_tri(ids[0], ids[1], ids[2]);
-      add_tri(ids[0], ids[1], ids[3]);
-      add_tri(ids[0], ids[2], ids[3]);
-      add_tri(ids[1], ids[2], ids[3]);
-    } else if (count == 5) {
-      // std::lock_guard<std::mutex> guard(my_mutex);
-      // surfaces.pentagons.push_back({ids[0], ids[1], ids[2], ids[3], ids[4]});
-      add_tri(ids[0], ids[1], ids[2]);
-      add_tri(ids[0], ids[1], ids[3]);
-      add_tri(ids[0], ids[1], ids[4]);
-      add_tri(ids[0], ids[2], ids[3]);
-      add_tri(ids[0], ids[2], ids[4]);
-      add_tri(ids[0], ids[3], ids[4]);
-      add_tri(ids[1], ids[2], ids[3]);
-      add_tri(ids[1], ids[2], ids[4]);
-      add_tri(ids[2], ids[3], ids[4]);
-    } else {
-      fprintf(stderr, "irregular count=%d\n", count); // WIP: triangulation
-    }
-  }, FTK_THREAD_PTHREAD, nthreads, enable_set_affinity);
+  pentachoron_assembly assembly(m, 2);
+  surfaces.tris = assembly.assemble<3>(tags, thread_backend, nthreads, enable_set_affinity);
+  if (assembly.n_irregular() && comm.rank() == get_root_proc())
+    fprintf(stderr, "#irregular_pentachora=%zu\n", assembly.n_irregular());
 
   surfaces.relabel();
   fprintf(stderr, "#pts=%zu, #tri=%zu\n", surfaces.pts.size(), surfaces.tris.size());
@@ -215,6 +165,7 @@ inline void critical_line_tracker_3d_regular::reset()
 
   field_data_snapshots.clear();
   intersections.clear();
+  stitcher.clear();
 
   critical_line_tracker::reset();
 }
@@ -284,13 +235,8 @@ inline void critical_line_tracker_3d_regular::update_timestep()
   auto func = [=](element_t e) {
     feature_point_t p;
     if (check_simplex(e, p)) {
-      // std::set<element_t> my_related_cells = get_relatetd_cels(e);
-
-      {
-        std::lock_guard<std::mutex> guard(mutex);
-        intersections[e] = p;
-        // related_cells.insert(my_related_cells.begin(), my_related_cells.end());
-      }
+      std::lock_guard<std::mutex> guard(mutex);
+      intersections[e] = p;
     }
   };
 
@@ -361,8 +307,6 @@ inline void critical_line_tracker_3d_regular::update_timestep()
       cp.timestep = current_timestep;
 
       intersections[e] = cp;
-      std::set<element_t> my_related_cells = get_relatetd_cels(e);
-      related_cells.insert(my_related_cells.begin(), my_related_cells.end());
     }
 
     if (field_data_snapshots.size() >= 2) { // interval
@@ -388,8 +332,6 @@ inline void critical_line_tracker_3d_regular::update_timestep()
         cp.timestep = current_timestep;
       
         intersections[e] = cp;
-        std::set<element_t> my_related_cells = get_relatetd_cels(e);
-        related_cells.insert(my_related_cells.begin(), my_related_cells.end());
       }
     }
 
@@ -404,6 +346,10 @@ inline void critical_line_tracker_3d_regular::update_timestep()
   
   auto t1 = clock_type::now();
   accumulated_kernel_time += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() * 1e-9;
+
+  if (enable_streaming_surfaces && current_timestep > start_timestep)
+    stitcher.stream(comm, get_root_proc(), m, current_timestep - 1, intersections, 
+        surface_slab_callback, thread_backend, nthreads, enable_set_affinity);
 }
   
 inline void critical_line_tracker_3d_regular::simplex_values(
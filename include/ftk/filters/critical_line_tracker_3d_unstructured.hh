@@ -176,9 +176,9 @@ inline void critical_line_tracker_3d_unstructured::update_timestep()
     }
   };
 
-  m->element_for_ordinal(2, current_timestep, func, xl, nthreads, enable_set_affinity);
+  m->element_for_ordinal(2, current_timestep, func, thread_backend, nthreads, enable_set_affinity);
   if (field_data_snapshots.size() >= 2)
-    m->element_for_interval(2, current_timestep, func, xl, nthreads, enable_set_affinity);
+    m->element_for_interval(2, current_timestep, func, thread_backend, nthreads, enable_set_affinity);
 }
 
 #if FTK_HAVE_VTK
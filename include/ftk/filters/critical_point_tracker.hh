@@ -14,6 +14,13 @@
 #include <ftk/geometry/write_polydata.hh>
 #include <ftk/utils/gather.hh>
 #include <ftk/utils/redistribution.hh>
+#include <ftk/utils/neighbor_exchange.hh>
+#include <ftk/utils/direct_mapped_cache.hh>
+#include <ftk/utils/thread_local_buffer.hh>
+#include <ftk/mesh/simplex_csr.hh>
+#include <ftk/algorithms/merge_tree.hh>
+#include <ftk/numeric/critical_point_type.hh>
+#include <ftk/filters/feature_curve_set_post_processor.hh>
 #include <iomanip>
 
 namespace ftk {
@@ -31,6 +38,8 @@ struct critical_point_tracker : public virtual tracker {
   void reset() {
     field_data_snapshots.clear();
     traced_critical_points.clear();
+    derivative_cache_epoch = next_cache_epoch();
+    next_persistence_timestep = -1;
   }
 
   void set_enable_robust_detection(bool b) { enable_robust_detection = b; }
@@ -39,6 +48,12 @@ struct critical_point_tracker : public virtual tracker {
   void set_enable_discarding_interval_points(bool b) { enable_discarding_interval_points = b; }
   void set_enable_discarding_degenerate_points(bool b) { enable_discarding_degenerate_points = b; }
   void set_enable_ignoring_degenerate_points(bool b) { enable_ignoring_degenerate_points = b; }
+  void set_enable_lock_free_detection(bool b) { enable_lock_free_detection = b; }
+  void set_enable_distributed_tracing(bool b) { enable_distributed_tracing = b; }
+  void set_enable_lazy_derivatives(bool b) { enable_lazy_derivatives = b; }
+  void set_enable_derivative_cache(bool b) { enable_derivative_cache = b; }
+  void set_persistence_threshold(double p) { persistence_threshold = p; }
+  void set_streaming_post_processing_options(const std::string& s) { streaming_post_processor.parse_ops(s); }
 
   void set_type_filter(unsigned int);
 
@@ -67,6 +82,7 @@ public:
 public: // i/o for traced critical points (trajectories)
   const feature_curve_set_t& get_traced_critical_points() const {return traced_critical_points;}
   feature_curve_set_t& get_traced_critical_points() {return traced_critical_points;}
+  void gather_traced_critical_points(); // to the root proc, if traced w/ distributed tracing
 
   json get_traced_critical_points_json() const {return json(traced_critical_points);}
   void write_traced_critical_points_json(const std::string& filename, int indent=0) const;
@@ -131,6 +147,10 @@ public: // inputs
   virtual void push_scalar_field_snapshot(const ndarray<double> &scalar);
   virtual void push_vector_field_snapshot(const ndarray<double> &vector);
 
+  // single-precision inputs; converted to double unless the tracker stores float snapshots
+  virtual void push_scalar_field_snapshot(const ndarray<float> &scalar) { push_scalar_field_snapshot(ndarray<double>(scalar)); }
+  virtual void push_vector_field_snapshot(const ndarray<float> &vector) { push_vector_field_snapshot(ndarray<double>(vector)); }
+
 protected:
   bool filter_critical_point_type(const feature_point_t& cp);
 
@@ -146,17 +166,74 @@ protected:
       std::function<unsigned long long(I)> elementt_to_tag
   );
 
+  void finalize_streaming_trajectories(); // complete and post process the remaining streamed trajectories
+
 	template <typename I> // mesh element type
 	std::vector<feature_curve_t> trace_critical_points_offline(
 		std::map<I, feature_point_t> &discrete_critical_points, // id of each cp will be updated
 		std::function<std::set<I>(I)> neighbors);
 
+  template <typename I> // w/o gathering to the root proc; curves are added to traced_critical_points directly
+  void trace_critical_points_offline_distributed(
+      std::map<I, feature_point_t> &discrete_critical_points,
+      std::function<std::set<I>(I)> neighbors);
+
+  template <typename I> // adjacency among sorted discrete critical points in their indices, computed once in parallel; rows are sorted and free of self loops
+  csr_adjacency<int> build_critical_point_graph(
+      const std::vector<I> &elements,
+      std::function<std::set<I>(I)> neighbors);
+
+  // Persistence-based simplification of the discrete critical points
+  // detected at the current timestep, based on the merge trees of the
+  // first scalar component of the snapshots in the window.  The vertices
+  // of the cell of each point and their one-rings are searched: maxima
+  // (minima) are kept only if a vertex maximum (minimum) that reaches the
+  // threshold is found there, and saddles are dropped if a merge saddle of
+  // a pair below the threshold is found.  adj is the spatial vertex
+  // adjacency, and cell_vertices returns the (snapshot, spatial vertex)
+  // pairs of the cell of a point.  The persistence of the second snapshot
+  // is kept and reused as the first one on the next timestep.
+  template <typename I> // mesh element type
+  void simplify_critical_points_by_persistence(
+      std::map<I, feature_point_t> &discrete_critical_points,
+      const csr_adjacency<int> &adj,
+      std::function<void(const feature_point_t&, std::vector<std::pair<int, int>>&)> cell_vertices);
+
+  template <typename I> // stitch each connected component into linear trajectories
+  std::vector<feature_curve_t> trace_connected_components(
+      std::map<I, std::map<I, feature_point_t>> &ccs,
+      std::function<std::set<I>(I)> neighbors);
+
+  template <typename I> // same, with the graph of all elements in ccs (sorted) already built
+  std::vector<feature_curve_t> trace_connected_components(
+      std::map<I, std::map<I, feature_point_t>> &ccs,
+      const std::vector<I> &elements,
+      const csr_adjacency<int> &graph);
+
 protected:
-  struct field_data_snapshot_t {
-    ndarray<double> scalar, vector, jacobian;
+  template <typename T>
+  struct typed_field_data_snapshot_t {
+    ndarray<T> scalar, vector, jacobian;
+  };
+
+  // double-precision storage, plus single-precision storage used by the
+  // regular trackers for float inputs; only one of them is filled
+  struct field_data_snapshot_t : public typed_field_data_snapshot_t<double> {
+    typed_field_data_snapshot_t<float> f32;
+
+    bool is_single_precision() const { return !f32.scalar.empty() || !f32.vector.empty(); }
+
+    template <typename T> 
+    const typed_field_data_snapshot_t<T>& typed() const {
+      if constexpr (std::is_same<T, float>::value) return f32;
+      else return *this;
+    }
   };
 
   std::deque<field_data_snapshot_t> field_data_snapshots;
+
+  template <typename T> // snapshots in the window must have the same precision
+  void emplace_typed_field_data_snapshot(typed_field_data_snapshot_t<T>&& s);
   
   // for robust detection
   double vector_field_resolution = std::numeric_limits<double>::max(); // min abs nonzero value of vector field.  for robust cp detection w/o gmp
@@ -183,6 +260,15 @@ protected:
   bool enable_discarding_interval_points = false;
   bool enable_discarding_degenerate_points = false;
   bool enable_ignoring_degenerate_points = false;
+  bool enable_lock_free_detection = false; // collect detected points in per-thread buffers
+  bool enable_distributed_tracing = false; // trajectories stay on the ranks that stitch them
+  bool enable_lazy_derivatives = false; // derive gradients/jacobians of scalar snapshots on the fly instead of storing them
+  bool enable_derivative_cache = false; // per-thread cache of gradients derived on the fly
+  double persistence_threshold = 0; // simplify discrete critical points by persistence if positive
+  vertex_persistence_t<double> next_persistence; // of the next snapshot, reused on the next timestep
+  int next_persistence_timestep = -1;
+  feature_curve_set_post_processor_t streaming_post_processor; // applied to streamed trajectories once complete
+  uint64_t derivative_cache_epoch = next_cache_epoch();
 };
 
 ///////
@@ -228,6 +314,20 @@ inline void critical_point_tracker::push_vector_field_snapshot(const ndarray<dou
   field_data_snapshots.emplace_back(snapshot);
 }
 
+template <typename T>
+void critical_point_tracker::emplace_typed_field_data_snapshot(typed_field_data_snapshot_t<T>&& s)
+{
+  field_data_snapshot_t snapshot;
+  if constexpr (std::is_same<T, float>::value) snapshot.f32 = std::move(s);
+  else static_cast<typed_field_data_snapshot_t<double>&>(snapshot) = std::move(s);
+
+  if (!field_data_snapshots.empty() && 
+      field_data_snapshots.back().is_single_precision() != snapshot.is_single_precision())
+    fatal("cannot mix single- and double-precision snapshots");
+
+  field_data_snapshots.emplace_back( std::move(snapshot) );
+}
+
 inline bool critical_point_tracker::pop_field_data_snapshot()
 {
   if (field_data_snapshots.size() > 0) {
@@ -354,13 +454,17 @@ inline void critical_point_tracker::read_critical_points_binary(const std::strin
 inline void critical_point_tracker::write_traced_critical_points_binary(const std::string& filename) const
 {
   if (is_root_proc()) 
-    diy::serializeToFile(traced_critical_points, filename);
+    traced_critical_points.write_binary(filename);
 }
 
 inline void critical_point_tracker::read_traced_critical_points_binary(const std::string& filename)
 {
-  if (is_root_proc()) 
-    diy::unserializeFromFile(filename, traced_critical_points);
+  if (is_root_proc()) {
+    if (feature_curve_set_t::is_binary_file(filename))
+      traced_critical_points.read_binary(filename);
+    else // legacy diy-serialized files
+      diy::unserializeFromFile(filename, traced_critical_points);
+  }
 }
 
 inline void critical_point_tracker::write_traced_critical_points_text(const std::string& filename) const
@@ -537,10 +641,12 @@ void critical_point_tracker::trace_critical_points_online(
   //   std::cerr << "----" << kv.second.tag << ", " << kv.first << ", " << tag_to_element(kv.second.tag) << std::endl;
 
   // 1. continue existing trajectories
-  trajectories.foreach([&](feature_curve_t& traj) {
+  std::vector<feature_curve_set_t::iterator> completed;
+  for (auto it = trajectories.begin(); it != trajectories.end(); it ++) {
+    auto &traj = it->second;
     if (traj.complete) {
       // fprintf(stderr, "traj already complete.\n");
-      return; // continue;
+      continue;
     }
     bool continued = false;
 
@@ -600,8 +706,11 @@ void critical_point_tracker::trace_critical_points_online(
         break;
     }
 
-    if (!continued) traj.complete = true;
-  });
+    if (!continued) {
+      traj.complete = true;
+      completed.push_back(it);
+    }
+  }
 
   // 2. generate new trajectories for the rest of discrete critical points
   std::set<I> elements;
@@ -637,9 +746,28 @@ void critical_point_tracker::trace_critical_points_online(
   // 3. clear discrete critical points
   discrete_critical_points.clear();
 
+  // 4. post process trajectories that are complete as of this timestep
+  streaming_post_processor.set_number_of_threads(nthreads);
+  streaming_post_processor.filter(trajectories, completed);
+
   // write_sliced_critical_points_text(current_timestep, std::cerr);
 }
 
+inline void critical_point_tracker::finalize_streaming_trajectories()
+{
+  if (!is_root_proc()) return;
+
+  std::vector<feature_curve_set_t::iterator> remaining;
+  for (auto it = traced_critical_points.begin(); it != traced_critical_points.end(); it ++)
+    if (!it->second.complete) {
+      it->second.complete = true;
+      remaining.push_back(it);
+    }
+
+  streaming_post_processor.set_number_of_threads(nthreads);
+  streaming_post_processor.filter(traced_critical_points, remaining);
+}
+
 inline void critical_point_tracker::update_traj_statistics()
 {
   traced_critical_points.foreach([](feature_curve_t& t) {
@@ -671,6 +799,11 @@ std::vector<feature_curve_t> critical_point_tracker::trace_critical_points_offli
 	std::function<std::set<element_t>(element_t)> neighbors)
 {
   std::vector<feature_curve_t> traced_critical_points;
+
+  if (enable_distributed_tracing) {
+    trace_critical_points_offline_distributed<element_t>(discrete_critical_points, neighbors);
+    return traced_critical_points; // already added w/ global ids
+  }
  
 #if 0
 	std::map<element_t, feature_point_t> all_discrete_critical_points;
@@ -685,66 +818,61 @@ std::vector<feature_curve_t> critical_point_tracker::trace_critical_points_offli
 
 #if 1
   // fprintf(stderr, "dUF..\n");
-  duf<element_t> uf(comm);
   diy::mpi::gather(comm, discrete_critical_points, discrete_critical_points, get_root_proc()); // TODO FIXME
   if (!is_root_proc()) discrete_critical_points.clear();
+
+  // compact ids: the i-th element in the (sorted) map; the smallest id in 
+  // each set is also the smallest element, so roots are the same as with element ids
+  std::vector<element_t> elements;
+  elements.reserve(discrete_critical_points.size());
+  for (const auto &kv : discrete_critical_points)
+    elements.push_back(kv.first);
   
-  for (const auto &kv : discrete_critical_points) {
-    for (const auto &n : neighbors(kv.first))
-      // if (true) // (discrete_critical_points.find(n) != discrete_critical_points.end())
-      if (discrete_critical_points.find(n) != discrete_critical_points.end())
-        uf.unite(kv.first, n);
-  }
+  const auto graph = build_critical_point_graph<element_t>(elements, neighbors);
+
+  duf<int> uf(comm, elements.size());
+  object::parallel_for(elements.size(), [&](int i) {
+    for (const int *p = graph.begin(i); p != graph.end(i); p ++)
+      uf.unite(i, *p);
+  }, thread_backend, nthreads, enable_set_affinity);
   // fprintf(stderr, "dUF sync...\n");
   uf.sync();
   // fprintf(stderr, "dUF done.\n");
   // fprintf(stderr, "dUF done., #pts=%zu, #roots=%zu\n", discrete_critical_points.size(), uf.get_roots().size());
 
   std::map<element_t/*root*/, std::map<element_t, feature_point_t>> ccs, rccs; // distributed cc
+  int i = 0;
   for (const auto &kv : discrete_critical_points)
-    ccs[ uf.find(kv.first) ].insert(kv);
-
-  redistribute(comm, ccs, rccs);
-  
-  std::mutex my_mutex;
-  // for (auto &cc : rccs) { 
-  object::parallel_for_container<std::map<element_t, std::map<element_t, feature_point_t>>>
-    (rccs, [&](typename std::map<element_t, std::map<element_t, feature_point_t>>::iterator icc) {
-    std::set<element_t> component;
-    for (const auto &kv : icc->second)
-      component.insert(kv.first);
+    ccs[ elements[uf.find(i ++)] ].insert(kv);
 
-    auto linear_graphs = ftk::connected_component_to_linear_components<element_t>(component, neighbors);
-    for (int j = 0; j < linear_graphs.size(); j ++) {
-      const unsigned int id = traced_critical_points.size(); 
-
-      feature_curve_t traj; 
-      traj.loop = is_loop(linear_graphs[j], neighbors);
-      for (int k = 0; k < linear_graphs[j].size(); k ++) {
-        // auto &cp = discrete_critical_points[linear_graphs[j][k]];
-        auto cp = icc->second.at(linear_graphs[j][k]);
-        cp.id = id;
-
-        traj.push_back(cp);
-        // sum1 ++;
-      }
-      
-      {
-        std::lock_guard<std::mutex> guard(my_mutex);
-        traced_critical_points.emplace_back(traj);
-      }
-    }
-  });
+  if (comm.size() == 1) // components stay here, and so does the graph
+    traced_critical_points = trace_connected_components<element_t>(ccs, elements, graph);
+  else {
+    redistribute(comm, ccs, rccs);
+    traced_critical_points = trace_connected_components<element_t>(rccs, neighbors);
+  }
 
   fprintf(stderr, "rank=%d, #curves=%zu\n", comm.rank(), traced_critical_points.size());
 
   // FIXME: need to know earlier if the output trajectories will be written (into pvtp) later.  In this case, no gathering is needed
-  diy::mpi::gather<std::vector<feature_curve_t>>(comm, traced_critical_points, traced_critical_points, get_root_proc(), 
-      [](const std::vector<feature_curve_t>& in, std::vector<feature_curve_t>& out) {
+  // loop flags are not in the diy layout of feature_curve_t and are sent along
+  std::vector<std::pair<feature_curve_t, bool>> curves;
+  for (const auto &traj : traced_critical_points)
+    curves.push_back(std::make_pair(traj, traj.loop));
+  diy::mpi::gather<std::vector<std::pair<feature_curve_t, bool>>>(comm, curves, curves, get_root_proc(), 
+      [](const std::vector<std::pair<feature_curve_t, bool>>& in, std::vector<std::pair<feature_curve_t, bool>>& out) {
         for (const auto& v : in)
           out.push_back(v);
       });
 
+  if (is_root_proc()) {
+    traced_critical_points.clear();
+    for (auto &kv : curves) {
+      kv.first.loop = kv.second;
+      traced_critical_points.push_back(kv.first);
+    }
+  }
+
   if (comm.rank() == 0) 
     fprintf(stderr, "total curves: %zu\n", traced_critical_points.size());
 #endif
@@ -816,6 +944,313 @@ std::vector<feature_curve_t> critical_point_tracker::trace_critical_points_offli
   return traced_critical_points;
 }
 
+template <typename element_t>
+csr_adjacency<int> critical_point_tracker::build_critical_point_graph(
+    const std::vector<element_t> &elements,
+    std::function<std::set<element_t>(element_t)> neighbors)
+{
+  // each row is emitted by one thread in ascending order, and the order is kept by the csr build
+  thread_local_buffer<std::pair<int, int>> buffer; // (row, col)
+  object::parallel_for(elements.size(), [&](int i) {
+    auto &local = buffer.local();
+    for (const auto &e : neighbors(elements[i])) {
+      auto it = std::lower_bound(elements.begin(), elements.end(), e);
+      if (it != elements.end() && *it == e && it - elements.begin() != i)
+        local.push_back(std::make_pair(i, int(it - elements.begin())));
+    }
+  }, thread_backend, nthreads, enable_set_affinity);
+
+  const auto pairs = buffer.merge();
+  std::vector<int> rows(pairs.size()), cols(pairs.size());
+  for (size_t k = 0; k < pairs.size(); k ++) {
+    rows[k] = pairs[k].first;
+    cols[k] = pairs[k].second;
+  }
+
+  csr_adjacency<int> graph;
+  graph.build(elements.size(), rows, cols);
+  return graph;
+}
+
+template <typename element_t>
+void critical_point_tracker::simplify_critical_points_by_persistence(
+    std::map<element_t, feature_point_t> &discrete_critical_points,
+    const csr_adjacency<int> &adj,
+    std::function<void(const feature_point_t&, std::vector<std::pair<int, int>>&)> cell_vertices)
+{
+  if (persistence_threshold <= 0 || field_data_snapshots.empty()) return;
+
+  const size_t n = adj.size();
+  std::vector<vertex_persistence_t<double>> persistence(std::min(size_t(2), field_data_snapshots.size()));
+  std::vector<double> values(n);
+  for (size_t k = 0; k < persistence.size(); k ++) {
+    const auto &snapshot = field_data_snapshots[k];
+    const bool f32 = snapshot.is_single_precision();
+    const size_t nelem = f32 ? snapshot.f32.scalar.nelem() : snapshot.scalar.nelem();
+    if (nelem == 0 || nelem % n != 0) {
+      warn("persistence-based simplification requires scalar fields; skipped");
+      return;
+    }
+
+    if (k == 0 && next_persistence_timestep == current_timestep && next_persistence.maximum.size() == n) {
+      persistence[0] = std::move(next_persistence); // the second snapshot of the last timestep
+      continue;
+    }
+
+    const size_t nc = nelem / n; // the first component is used
+    for (size_t i = 0; i < n; i ++)
+      values[i] = f32 ? snapshot.f32.scalar[i*nc] : snapshot.scalar[i*nc];
+    persistence[k].compute(adj, values.data(), nthreads);
+  }
+
+  std::vector<element_t> removed;
+  std::vector<std::pair<int, int>> verts;
+  for (const auto &kv : discrete_critical_points) {
+    const auto &cp = kv.second;
+    if (cp.timestep != current_timestep) continue;
+
+    verts.clear();
+    cell_vertices(cp, verts);
+
+    double pmax = -1, pmin = -1, psaddle = std::numeric_limits<double>::infinity();
+    for (const auto &v : verts) {
+      if (size_t(v.first) >= persistence.size()) continue;
+      const auto &p = persistence[v.first];
+      auto visit = [&](int i) {
+        pmax = std::max(pmax, p.maximum[i]);
+        pmin = std::max(pmin, p.minimum[i]);
+        psaddle = std::min(psaddle, p.saddle[i]);
+      };
+      visit(v.second);
+      for (const int *q = adj.begin(v.second); q != adj.end(v.second); q ++)
+        visit(*q);
+    }
+
+    bool keep = true;
+    if (cp.type == CRITICAL_POINT_2D_MAXIMUM) keep = pmax >= persistence_threshold; // same as 3D
+    else if (cp.type == CRITICAL_POINT_2D_MINIMUM) keep = pmin >= persistence_threshold;
+    else if (cp.type == CRITICAL_POINT_2D_SADDLE) keep = psaddle >= persistence_threshold;
+
+    if (!keep) removed.push_back(kv.first);
+  }
+
+  for (const auto &e : removed)
+    discrete_critical_points.erase(e);
+
+  next_persistence_timestep = -1;
+  if (persistence.size() > 1) {
+    next_persistence = std::move(persistence[1]);
+    next_persistence_timestep = current_timestep + 1;
+  }
+}
+
+template <typename element_t>
+std::vector<feature_curve_t> critical_point_tracker::trace_connected_components(
+    std::map<element_t, std::map<element_t, feature_point_t>> &ccs,
+    std::function<std::set<element_t>(element_t)> neighbors)
+{
+  std::vector<element_t> elements;
+  for (const auto &cc : ccs)
+    for (const auto &kv : cc.second)
+      elements.push_back(kv.first);
+  std::sort(elements.begin(), elements.end());
+
+  return trace_connected_components<element_t>(ccs, elements, 
+      build_critical_point_graph<element_t>(elements, neighbors));
+}
+
+template <typename element_t>
+std::vector<feature_curve_t> critical_point_tracker::trace_connected_components(
+    std::map<element_t, std::map<element_t, feature_point_t>> &ccs,
+    const std::vector<element_t> &elements,
+    const csr_adjacency<int> &graph)
+{
+  std::vector<feature_curve_t> traced_critical_points;
+  std::vector<char> visited(elements.size(), 0); // components are disjoint
+  std::mutex my_mutex;
+  // for (auto &cc : ccs) { 
+  object::parallel_for_container<std::map<element_t, std::map<element_t, feature_point_t>>>
+    (ccs, [&](typename std::map<element_t, std::map<element_t, feature_point_t>>::iterator icc) {
+    std::vector<int> component;
+    component.reserve(icc->second.size());
+    for (const auto &kv : icc->second) // ascending, as the map
+      component.push_back(std::lower_bound(elements.begin(), elements.end(), kv.first) - elements.begin());
+
+    auto linear_graphs = ftk::connected_component_to_linear_components<int>(component, graph, visited);
+    for (int j = 0; j < linear_graphs.size(); j ++) {
+      feature_curve_t traj; 
+      traj.loop = is_loop(linear_graphs[j], graph);
+      for (int k = 0; k < linear_graphs[j].size(); k ++)
+        traj.push_back( icc->second.at(elements[linear_graphs[j][k]]) );
+      
+      {
+        std::lock_guard<std::mutex> guard(my_mutex);
+        const unsigned int id = traced_critical_points.size(); 
+        for (auto &cp : traj)
+          cp.id = id;
+        traced_critical_points.emplace_back(traj);
+      }
+    }
+  }, thread_backend, nthreads, enable_set_affinity);
+
+  return traced_critical_points;
+}
+
+template <typename element_t>
+void critical_point_tracker::trace_critical_points_offline_distributed(
+    std::map<element_t, feature_point_t> &discrete_critical_points,
+    std::function<std::set<element_t>(element_t)> neighbors)
+{
+  // 1. local components; neighbors that are not local are ghost candidates
+  const int n = discrete_critical_points.size();
+  std::vector<element_t> elements;
+  elements.reserve(n);
+  for (const auto &kv : discrete_critical_points)
+    elements.push_back(kv.first);
+
+  auto index = [&](const element_t& e) {
+    auto it = std::lower_bound(elements.begin(), elements.end(), e);
+    return (it != elements.end() && *it == e) ? int(it - elements.begin()) : -1;
+  };
+
+  duf<int> uf(comm, n);
+  std::vector<std::vector<element_t>> ghosts(n);
+  object::parallel_for(n, [&](int i) {
+    for (const auto &e : neighbors(elements[i])) {
+      const int k = index(e);
+      if (k >= 0) uf.unite(i, k);
+      else ghosts[i].push_back(e);
+    }
+  }, thread_backend, nthreads, enable_set_affinity);
+
+  // 2. ghosts are the candidates that are critical on a neighbor rank; the 
+  //    ranks exchange their critical elements that have ghost candidates
+  const std::set<int> neighbor_ranks = get_neighbor_ranks();
+  std::set<element_t> remote; // critical elements of neighbor ranks that may touch local ones
+  {
+    std::vector<element_t> candidates;
+    for (int i = 0; i < n; i ++)
+      if (!ghosts[i].empty())
+        candidates.push_back(elements[i]);
+
+    std::map<int, std::vector<element_t>> outgoing, incoming;
+    for (const int r : neighbor_ranks)
+      outgoing[r] = candidates;
+    diy::mpi::neighbor_exchange(comm, neighbor_ranks, outgoing, incoming);
+
+    for (const auto &kv : incoming)
+      remote.insert(kv.second.begin(), kv.second.end());
+  }
+
+  std::vector<int> root(n);
+  std::vector<element_t> label(elements); // per local root: smallest element of the global component
+  std::vector<bool> shared(n, false); // per local root: the component spans multiple ranks
+  std::vector<int> boundary;
+  std::map<element_t, std::vector<int>> ghost_adjacency;
+  for (int i = 0; i < n; i ++) {
+    root[i] = uf.find(i);
+
+    auto &g = ghosts[i];
+    g.erase(std::remove_if(g.begin(), g.end(), [&](const element_t& e) {
+      return remote.find(e) == remote.end();
+    }), g.end());
+
+    // elements duplicated on partition boundaries are also exchanged
+    if (!g.empty() || remote.find(elements[i]) != remote.end()) {
+      boundary.push_back(i);
+      for (const auto &e : g)
+        ghost_adjacency[e].push_back(i);
+    }
+  }
+
+  // 3. min-label propagation over boundary elements, exchanged with neighbor ranks 
+  //    only; after the first round, only the labels changed in the last round are sent
+  std::vector<bool> updated(n, true); // per local root
+  while (1) {
+    std::map<element_t, element_t> boundary_labels;
+    for (const int i : boundary)
+      if (updated[root[i]])
+        boundary_labels[elements[i]] = label[root[i]];
+    std::fill(updated.begin(), updated.end(), false);
+
+    std::map<int, std::map<element_t, element_t>> outgoing, incoming;
+    for (const int r : neighbor_ranks)
+      outgoing[r] = boundary_labels;
+    diy::mpi::neighbor_exchange(comm, neighbor_ranks, outgoing, incoming);
+
+    int changed = 0;
+    auto merge = [&](int i, const element_t& l) {
+      const int r = root[i];
+      shared[r] = true;
+      if (l < label[r]) {
+        label[r] = l;
+        updated[r] = true;
+        changed = 1;
+      }
+    };
+
+    for (const auto &kv : incoming)
+      for (const auto &el : kv.second) {
+        const int k = index(el.first);
+        if (k >= 0) merge(k, el.second); // elements duplicated on partition boundaries
+        auto it = ghost_adjacency.find(el.first);
+        if (it != ghost_adjacency.end())
+          for (const int i : it->second)
+            merge(i, el.second);
+      }
+
+    int any_changed = 0;
+    diy::mpi::all_reduce(comm, changed, any_changed, diy::mpi::maximum<int>());
+    if (!any_changed) break;
+  }
+
+  // 4. components that span multiple ranks are stitched by one rank (chosen by the 
+  //    hash of the label); the others stay where they are
+  std::map<element_t, std::map<element_t, feature_point_t>> local_ccs, shared_ccs, ccs;
+  int i = 0;
+  for (const auto &kv : discrete_critical_points) {
+    const int r = root[i ++];
+    if (shared[r]) shared_ccs[label[r]].insert(kv);
+    else local_ccs[label[r]].insert(kv);
+  }
+
+  redistribute(comm, shared_ccs, ccs);
+  for (auto &kv : local_ccs)
+    ccs[kv.first].insert(kv.second.begin(), kv.second.end());
+
+  auto curves = trace_connected_components<element_t>(ccs, neighbors);
+
+  // 5. globally unique ids
+  int ncurves = curves.size(), offset = 0;
+  diy::mpi::scan(comm, ncurves, offset, std::plus<int>());
+  offset -= ncurves;
+
+  for (int k = 0; k < ncurves; k ++) {
+    for (auto &cp : curves[k])
+      cp.id = offset + k;
+    traced_critical_points.add(curves[k], offset + k);
+  }
+}
+
+inline void critical_point_tracker::gather_traced_critical_points()
+{
+  if (comm.size() == 1) return;
+
+  // loop flags are not in the diy layout of feature_curve_t, which is kept for 
+  // binary archives; curve ids are globally unique after distributed tracing
+  std::set<int> loops;
+  for (const auto &kv : traced_critical_points)
+    if (kv.second.loop)
+      loops.insert(kv.first);
+
+  diy::mpi::gather(comm, traced_critical_points, traced_critical_points, get_root_proc());
+  diy::mpi::gather(comm, loops, loops, get_root_proc());
+  if (!is_root_proc()) traced_critical_points.clear();
+  else 
+    for (auto &kv : traced_critical_points)
+      kv.second.loop = loops.find(kv.first) != loops.end();
+}
+
 inline void critical_point_tracker::slice_traced_critical_points()
 {
   int sum0 = 0;
@@ -850,8 +1285,11 @@ inline bool critical_point_tracker::advance_timestep()
 inline void critical_point_tracker::update_vector_field_scaling_factor(int minbits, int maxbits)
 {
   // vector_field_resolution = std::numeric_limits<double>::max();
-  for (const auto &s : field_data_snapshots)
+  for (const auto &s : field_data_snapshots) {
     vector_field_resolution = std::min(vector_field_resolution, s.vector.resolution());
+    if (!s.f32.vector.empty())
+      vector_field_resolution = std::min(vector_field_resolution, double(s.f32.vector.resolution()));
+  }
   
   int nbits = std::ceil(std::log2(1.0 / vector_field_resolution));
   nbits = std::max(minbits, std::min(nbits, maxbits));
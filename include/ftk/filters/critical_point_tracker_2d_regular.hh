@@ -118,22 +118,35 @@ struct critical_point_tracker_2d_regular : public critical_point_tracker_regular
 
   void update_timestep();
 
-  void push_scalar_field_snapshot(const ndarray<double>&);
-  void push_vector_field_snapshot(const ndarray<double>&);
+  // float inputs are stored in single precision and evaluated in double
+  void push_scalar_field_snapshot(const ndarray<double>& s) { push_typed_scalar_field_snapshot(s); }
+  void push_vector_field_snapshot(const ndarray<double>& v) { push_typed_vector_field_snapshot(v); }
+  void push_scalar_field_snapshot(const ndarray<float>&);
+  void push_vector_field_snapshot(const ndarray<float>&);
 
 protected:
   typedef simplicial_regular_mesh_element element_t;
+  typedef simplicial_regular_mesh_element_fixed<3> fixed_element_t;
+
+  template <typename T> void push_typed_scalar_field_snapshot(const ndarray<T>&);
+  template <typename T> void push_typed_vector_field_snapshot(const ndarray<T>&);
   
 protected:
-  bool check_simplex(const element_t& s, feature_point_t& cp);
+  template <typename S> // S is the value type of the snapshots
+  bool check_simplex(const fixed_element_t& s, feature_point_t& cp);
   void trace_intersections();
   void trace_connected_components();
 
-  virtual void simplex_coordinates(const std::vector<std::vector<int>>& vertices, double X[][4]) const;
-  template <typename T=double> void simplex_vectors(const std::vector<std::vector<int>>& vertices, T v[][2]) const;
-  virtual void simplex_scalars(const std::vector<std::vector<int>>& vertices, double values[]) const;
-  virtual void simplex_jacobians(const std::vector<std::vector<int>>& vertices, 
+  virtual void simplex_coordinates(const int vertices[3][3], double X[][4]) const;
+  template <typename S, typename T=double> void simplex_vectors(const int vertices[3][3], T v[][2]) const;
+  template <typename S> void simplex_scalars(const int vertices[3][3], double values[]) const;
+  template <typename S> void simplex_jacobians(const int vertices[3][3], 
       double Js[][2][2]) const;
+
+  // gradient of a scalar snapshot at local array index (x, y) of timestep t, 
+  // used when derivatives are not materialized
+  template <typename S>
+  void derived_gradient(const typed_field_data_snapshot_t<S>& s, int t, int x, int y, double g[2]) const;
   
   void put_critical_points(const std::vector<feature_point_t>&);
 };
@@ -148,7 +161,8 @@ inline void critical_point_tracker_2d_regular::finalize()
     fprintf(stderr, "max_accumulated_kernel_time=%f\n", accumulated_kernel_time);
 
   if (enable_streaming_trajectories) {
-    // done
+    // trajectories are already traced
+    finalize_streaming_trajectories();
   } else {
     // fprintf(stderr, "rank=%d, root=%d, #cp=%zu\n", comm.rank(), get_root_proc(), discrete_critical_points.size());
     // diy::mpi::gather(comm, discrete_critical_points, discrete_critical_points, get_root_proc());
@@ -235,29 +249,57 @@ inline void critical_point_tracker_2d_regular::reset()
   critical_point_tracker::reset();
 }
 
-inline void critical_point_tracker_2d_regular::push_scalar_field_snapshot(const ndarray<double>& s)
+inline void critical_point_tracker_2d_regular::push_scalar_field_snapshot(const ndarray<float>& s)
+{
+  if (xl == FTK_XL_NONE) push_typed_scalar_field_snapshot(s);
+  else push_typed_scalar_field_snapshot(ndarray<double>(s)); // accelerators take double arrays
+}
+
+inline void critical_point_tracker_2d_regular::push_vector_field_snapshot(const ndarray<float>& v)
+{
+  if (xl == FTK_XL_NONE) push_typed_vector_field_snapshot(v);
+  else push_typed_vector_field_snapshot(ndarray<double>(v));
+}
+
+template <typename T>
+inline void critical_point_tracker_2d_regular::push_typed_scalar_field_snapshot(const ndarray<T>& s)
 {
-  field_data_snapshot_t snapshot;
+  typed_field_data_snapshot_t<T> snapshot;
 
   snapshot.scalar = s;
   if (vector_field_source == SOURCE_DERIVED) {
-    snapshot.vector = gradient2D(s);
-    if (jacobian_field_source == SOURCE_DERIVED)
-      snapshot.jacobian = jacobian2D<double, true>(snapshot.vector);
+    if (enable_lazy_derivatives && xl == FTK_XL_NONE) {
+      // only the scalar is stored; gradients and jacobians are derived in 
+      // simplex_vectors and simplex_jacobians.  the resolution of the 
+      // gradient field is updated here in place of the materialized field
+      for (int j = 0; j < s.dim(1); j ++)
+        for (int i = 0; i < s.dim(0); i ++) {
+          T g[2];
+          gradient2D_at(s, i, j, g);
+          for (int k = 0; k < 2; k ++)
+            if (g[k] != T(0))
+              vector_field_resolution = std::min(vector_field_resolution, double(std::abs(g[k])));
+        }
+    } else {
+      snapshot.vector = gradient2D(s);
+      if (jacobian_field_source == SOURCE_DERIVED)
+        snapshot.jacobian = jacobian2D<T, true>(snapshot.vector);
+    }
   }
 
-  field_data_snapshots.emplace_back( snapshot );
+  emplace_typed_field_data_snapshot( std::move(snapshot) );
 }
 
-inline void critical_point_tracker_2d_regular::push_vector_field_snapshot(const ndarray<double>& v)
+template <typename T>
+inline void critical_point_tracker_2d_regular::push_typed_vector_field_snapshot(const ndarray<T>& v)
 {
-  field_data_snapshot_t snapshot;
+  typed_field_data_snapshot_t<T> snapshot;
  
   snapshot.vector = v;
   if (jacobian_field_source == SOURCE_DERIVED)
     snapshot.jacobian = jacobian2D(snapshot.vector);
 
-  field_data_snapshots.emplace_back( snapshot );
+  emplace_typed_field_data_snapshot( std::move(snapshot) );
 }
 
 inline void critical_point_tracker_2d_regular::update_timestep()
@@ -273,12 +315,12 @@ inline void critical_point_tracker_2d_regular::update_timestep()
 
   // scan 2-simplices
   // fprintf(stderr, "tracking 2D critical points...\n");
-  auto func2 = [=](element_t e) {
+  const bool single_precision = field_data_snapshots[0].is_single_precision();
+  auto func2 = [=](const fixed_element_t& e) {
       feature_point_t cp;
-      if (check_simplex(e, cp)) {
-        std::lock_guard<std::mutex> guard(mutex);
+      if (single_precision ? check_simplex<float>(e, cp) : check_simplex<double>(e, cp)) {
         if (filter_critical_point_type(cp)) {
-          discrete_critical_points[e] = cp;
+          push_detected_critical_point(e, cp);
           // std::cerr << "tag=" << cp.tag << ", " << e << "\t" << element_t(m, 2, cp.tag) << std::endl;
           // assert(element_t(m, 2, cp.tag) == e);
         }
@@ -322,10 +364,13 @@ inline void critical_point_tracker_2d_regular::update_timestep()
   };
 
   if (xl == FTK_XL_NONE) {
-    element_for_ordinal(2, func2);
-    if (field_data_snapshots.size() >= 2) { // interval
-      element_for_interval(2, func2);
+    element_for_ordinal_fixed<3>(2, func2);
+    if (field_data_snapshots.size() >= 2) // interval
+      element_for_interval_fixed<3>(2, func2);
+    merge_detected_critical_points();
+    simplify_critical_points_by_persistence();
 
+    if (field_data_snapshots.size() >= 2) {
       if (enable_streaming_trajectories)
         grow();
     }
@@ -492,31 +537,31 @@ inline void critical_point_tracker_2d_regular::trace_connected_components()
 }
 
 inline void critical_point_tracker_2d_regular::simplex_coordinates(
-    const std::vector<std::vector<int>>& vertices, double X[][4]) const
+    const int vertices[3][3], double X[][4]) const
 {
   if (mode_phys_coords == REGULAR_COORDS_SIMPLE) {
-    for (int i = 0; i < vertices.size(); i ++) {
+    for (int i = 0; i < 3; i ++) {
       X[i][0] = vertices[i][0]; // x
       X[i][1] = vertices[i][1]; // y
       X[i][2] = 0.0; // z
       X[i][3] = vertices[i][2]; // t
     }
   } else if (mode_phys_coords == REGULAR_COORDS_BOUNDS) {
-    for (int i = 0; i < vertices.size(); i ++) {
+    for (int i = 0; i < 3; i ++) {
       X[i][0] = ((vertices[i][0] - array_domain.lower_bound(0)) / double(array_domain.size(0)-1)) * (bounds_coords[1] - bounds_coords[0]) + bounds_coords[0] ; // x
       X[i][1] = ((vertices[i][1] - array_domain.lower_bound(1)) / double(array_domain.size(1)-1)) * (bounds_coords[3] - bounds_coords[2]) + bounds_coords[2] ; // y
       X[i][2] = 0.0; // z
       X[i][3] = vertices[i][2]; // t
     }
   } else if (mode_phys_coords == REGULAR_COORDS_RECTILINEAR) {
-    for (int i = 0; i < vertices.size(); i ++) {
+    for (int i = 0; i < 3; i ++) {
       X[i][0] = rectilinear_coords[0][ vertices[i][0] ]; // x
       X[i][1] = rectilinear_coords[1][ vertices[i][1] ]; // y
       X[i][2] = 0.0; // z
       X[i][3] = vertices[i][2]; // t
     }
   } else if (mode_phys_coords == REGULAR_COORDS_EXPLICIT) {
-    for (int i = 0; i < vertices.size(); i ++) {
+    for (int i = 0; i < 3; i ++) {
       X[i][0] = explicit_coords(0, vertices[i][0], vertices[i][1]); // x
       X[i][1] = explicit_coords(1, vertices[i][0], vertices[i][1]); // y
       if (explicit_coords.dim(0) > 2) // z
@@ -528,68 +573,104 @@ inline void critical_point_tracker_2d_regular::simplex_coordinates(
   }
 #if 0
   if (use_explicit_coords) {
-    for (int i = 0; i < vertices.size(); i ++) {
+    for (int i = 0; i < 3; i ++) {
       for (int j = 0; j < 2; j ++) 
         X[i][j] = coords(j, vertices[i][0], vertices[i][1]);
       X[i][2] = vertices[i][2];
     }
   } else {
-    for (int i = 0; i < vertices.size(); i ++)
+    for (int i = 0; i < 3; i ++)
       for (int j = 0; j < 3; j ++)
         X[i][j] = vertices[i][j];
   }
 #endif
 }
 
-template <typename T>
+template <typename S, typename T>
 inline void critical_point_tracker_2d_regular::simplex_vectors(
-    const std::vector<std::vector<int>>& vertices, T v[][2]) const
+    const int vertices[3][3], T v[][2]) const
 {
-  for (int i = 0; i < vertices.size(); i ++) {
+  for (int i = 0; i < 3; i ++) {
     const int iv = vertices[i][2] == current_timestep ? 0 : 1;
-    for (int j = 0; j < 2; j ++)
-      v[i][j] = field_data_snapshots[iv].vector(j, 
-          vertices[i][0] - local_array_domain.start(0), 
-          vertices[i][1] - local_array_domain.start(1));
+    const auto &s = field_data_snapshots[iv].typed<S>();
+    const int x = vertices[i][0] - local_array_domain.start(0), 
+              y = vertices[i][1] - local_array_domain.start(1);
+    if (s.vector.empty()) { // lazy derivatives
+      double g[2];
+      derived_gradient(s, vertices[i][2], x, y, g);
+      for (int j = 0; j < 2; j ++)
+        v[i][j] = g[j];
+    } else {
+      for (int j = 0; j < 2; j ++)
+        v[i][j] = s.vector(j, x, y);
+    }
   }
 }
 
+template <typename S>
+inline void critical_point_tracker_2d_regular::derived_gradient(
+    const typed_field_data_snapshot_t<S>& s, int t, int x, int y, double g[2]) const
+{
+  auto derive = [&](double gk[2]) {
+    S gs[2];
+    gradient2D_at(s.scalar, x, y, gs);
+    gk[0] = gs[0]; gk[1] = gs[1];
+  };
+
+  if (enable_derivative_cache) {
+    const uint64_t key = (uint64_t(t) * s.scalar.dim(1) + y) * s.scalar.dim(0) + x;
+    direct_mapped_cache<double, 2>::get(derivative_cache_epoch, key, g, derive);
+  } else 
+    derive(g);
+}
+
+template <typename S>
 inline void critical_point_tracker_2d_regular::simplex_scalars(
-    const std::vector<std::vector<int>>& vertices, double values[]) const
+    const int vertices[3][3], double values[]) const
 {
-  for (int i = 0; i < vertices.size(); i ++) {
+  for (int i = 0; i < 3; i ++) {
     const int iv = vertices[i][2] == current_timestep ? 0 : 1;
-    values[i] = field_data_snapshots[iv].scalar(
+    values[i] = field_data_snapshots[iv].typed<S>().scalar(
         vertices[i][0] - local_array_domain.start(0), 
         vertices[i][1] - local_array_domain.start(1));
   }
 }
 
+template <typename S>
 inline void critical_point_tracker_2d_regular::simplex_jacobians(
-    const std::vector<std::vector<int>>& vertices, 
+    const int vertices[3][3], 
     double Js[][2][2]) const
 {
-  for (int i = 0; i < vertices.size(); i ++) {
+  for (int i = 0; i < 3; i ++) {
     const int iv = vertices[i][2] == current_timestep ? 0 : 1;
-    for (int j = 0; j < 2; j ++) {
-      for (int k = 0; k < 2; k ++) {
-        Js[i][j][k] = field_data_snapshots[iv].jacobian(k, j, 
-            vertices[i][0] - local_array_domain.start(0), 
-            vertices[i][1] - local_array_domain.start(1));
-      }
+    const auto &s = field_data_snapshots[iv].typed<S>();
+    const int x = vertices[i][0] - local_array_domain.start(0), 
+              y = vertices[i][1] - local_array_domain.start(1);
+    if (s.jacobian.empty()) { // lazy derivatives
+      S H[2][2];
+      hessian2D_at(s.scalar, x, y, H);
+      for (int j = 0; j < 2; j ++)
+        for (int k = 0; k < 2; k ++)
+          Js[i][j][k] = H[k][j];
+    } else {
+      for (int j = 0; j < 2; j ++)
+        for (int k = 0; k < 2; k ++)
+          Js[i][j][k] = s.jacobian(k, j, x, y);
     }
   }
 }
 
+template <typename S>
 inline bool critical_point_tracker_2d_regular::check_simplex(
-    const simplicial_regular_mesh_element& e,
+    const fixed_element_t& e,
     feature_point_t& cp)
 {
   if (!e.valid(m)) return false; // check if the 2-simplex is valid
-  const auto &vertices = e.vertices(m); // obtain the vertices of the simplex
+  int vertices[3][3]; // obtain the vertices of the simplex
+  e.vertices(m, vertices);
  
-  double v[3][2]; // obtain vector values
-  simplex_vectors(vertices, v);
+  double v[3][2]; // obtain vector values; computations below are in double regardless of S
+  simplex_vectors<S>(vertices, v);
 
 #if FTK_HAVE_GMP
   typedef mpf_class fp_t;
@@ -617,7 +698,7 @@ inline bool critical_point_tracker_2d_regular::check_simplex(
 
   // robust critical point test
   int indices[3];
-  simplex_indices(vertices, indices);
+  simplex_indices(3, vertices, indices);
   bool succ = robust_critical_point_in_simplex2(vf, indices);
   if (!succ) return false;
 
@@ -642,7 +723,7 @@ inline bool critical_point_tracker_2d_regular::check_simplex(
 
   if (scalar_field_source != SOURCE_NONE) {
     double values[3];
-    simplex_scalars(vertices, values);
+    simplex_scalars<S>(vertices, values);
     cp.scalar[0] = lerp_s2(values, mu);
   }
 
@@ -664,7 +745,7 @@ inline bool critical_point_tracker_2d_regular::check_simplex(
     double J[2][2] = {0}; // jacobian
     if (jacobian_field_source != SOURCE_NONE) { // lerp jacobian
       double Js[3][2][2];
-      simplex_jacobians(vertices, Js);
+      simplex_jacobians<S>(vertices, Js);
       lerp_s2m2x2(Js, mu, J);
       ftk::make_symmetric2x2(J); // TODO
     } else {
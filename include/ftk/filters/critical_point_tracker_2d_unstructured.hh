@@ -21,6 +21,7 @@
 #include <ftk/geometry/curve2vtk.hh>
 #include <ftk/filters/critical_point_tracker_regular.hh>
 #include <ftk/filters/unstructured_2d_tracker.hh>
+#include <ftk/utils/thread_local_buffer.hh>
 #include <ftk/ndarray.hh>
 #include <ftk/ndarray/grad.hh>
 #include <ftk/mesh/simplicial_regular_mesh.hh>
@@ -77,6 +78,10 @@ protected:
 protected:
   std::map<int, feature_point_t> discrete_critical_points;
   // std::vector<std::vector<critical_point_t>> traced_critical_points;
+
+  // per-thread buffers for lock-free detection; cp.tag is the element id
+  thread_local_buffer<feature_point_t> detected_critical_points;
+  void merge_detected_critical_points();
 };
 
 ////////////////////////
@@ -237,26 +242,41 @@ inline void critical_point_tracker_2d_unstructured::update_timestep()
   auto func = [&](int i) {
     feature_point_t cp;
     if (check_simplex(i, cp)) {
-      std::lock_guard<std::mutex> guard(mutex);
-
       if (enable_ignoring_degenerate_points) {
         if (cp.type == 0 || cp.type == 1) return;
       }
 
       if (filter_critical_point_type(cp)) {
-        // if (discrete_critical_points.find(i) != discrete_critical_points.end())
-        //   fprintf(stderr, "FATAL: overwritting cp!!\n");
-        // discrete_critical_points[i] = cp;
-        discrete_critical_points[cp.tag] = cp;
+        if (enable_lock_free_detection)
+          detected_critical_points.local().push_back(cp);
+        else {
+          std::lock_guard<std::mutex> guard(mutex);
+          discrete_critical_points[cp.tag] = cp;
+        }
       }
     }
   };
 
-  m->element_for_ordinal(2, current_timestep, func, m->is_partial(), xl, nthreads, enable_set_affinity);
+  m->element_for_ordinal(2, current_timestep, func, m->is_partial(), thread_backend, nthreads, enable_set_affinity);
   // fprintf(stderr, "#dcp=%zu\n", discrete_critical_points.size());
   if (field_data_snapshots.size() >= 2)
-    m->element_for_interval(2, current_timestep, func, m->is_partial(), xl, nthreads, enable_set_affinity);
+    m->element_for_interval(2, current_timestep, func, m->is_partial(), thread_backend, nthreads, enable_set_affinity);
   // fprintf(stderr, "#dcp=%zu\n", discrete_critical_points.size());
+  merge_detected_critical_points();
+
+  if (persistence_threshold > 0) {
+    if (m->is_partial()) 
+      warn("persistence-based simplification is not available on partial meshes");
+    else
+      simplify_critical_points_by_persistence<int>(discrete_critical_points, 
+          m->get_m2()->get_vertex_edge_vertex_csr(), 
+          [&](const feature_point_t& cp, std::vector<std::pair<int, int>>& verts) {
+            int tri[3];
+            m->get_simplex(2, cp.tag, tri);
+            for (int j = 0; j < 3; j ++)
+              verts.push_back(std::make_pair(m->flat_vertex_time(tri[j]) == current_timestep ? 0 : 1, m->flat_vertex_id(tri[j])));
+          });
+  }
 
   if (enable_streaming_trajectories) {
     // grow trajectories
@@ -282,7 +302,8 @@ inline void critical_point_tracker_2d_unstructured::finalize()
   fprintf(stderr, "finalizing...\n");
 
   if (enable_streaming_trajectories)  {
-    // already done
+    // trajectories are already traced
+    finalize_streaming_trajectories();
   } else {
     // Convert connected components to geometries
     auto neighbors = [&](int f) {
@@ -342,8 +363,19 @@ inline std::vector<feature_point_t> critical_point_tracker_2d_unstructured::get_
 inline void critical_point_tracker_2d_unstructured::put_critical_points(const std::vector<feature_point_t>& data)
 {
   // fprintf(stderr, "##cps=%zu\n", data.size());
-  for (const auto& cp : data)
-    discrete_critical_points[cp.tag] = cp;
+  for (const auto& cp : data) // amortized constant time if tags are sorted and new
+    discrete_critical_points.emplace_hint(discrete_critical_points.end(), cp.tag, cp)->second = cp;
+}
+
+inline void critical_point_tracker_2d_unstructured::merge_detected_critical_points()
+{
+  if (!enable_lock_free_detection) return;
+
+  auto cps = detected_critical_points.merge();
+  std::sort(cps.begin(), cps.end(), [](const feature_point_t& a, const feature_point_t& b) {
+    return a.tag < b.tag;
+  });
+  put_critical_points(cps);
 }
 
 }
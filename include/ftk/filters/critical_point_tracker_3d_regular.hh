@@ -67,22 +67,35 @@ struct critical_point_tracker_3d_regular : public critical_point_tracker_regular
 
   void update_timestep();
   
-  void push_scalar_field_snapshot(const ndarray<double>&);
-  void push_vector_field_snapshot(const ndarray<double>&);
+  // float inputs are stored in single precision and evaluated in double
+  void push_scalar_field_snapshot(const ndarray<double>& s) { push_typed_scalar_field_snapshot(s); }
+  void push_vector_field_snapshot(const ndarray<double>& v) { push_typed_vector_field_snapshot(v); }
+  void push_scalar_field_snapshot(const ndarray<float>&);
+  void push_vector_field_snapshot(const ndarray<float>&);
   
 protected:
   typedef simplicial_regular_mesh_element element_t;
+  typedef simplicial_regular_mesh_element_fixed<4> fixed_element_t;
+  
+  template <typename T> void push_typed_scalar_field_snapshot(const ndarray<T>&);
+  template <typename T> void push_typed_vector_field_snapshot(const ndarray<T>&);
 
 protected:
-  bool check_simplex(const element_t& s, feature_point_t& cp);
+  template <typename S> // S is the value type of the snapshots
+  bool check_simplex(const fixed_element_t& s, feature_point_t& cp);
   void trace_intersections();
   void trace_connected_components();
 
-  virtual void simplex_coordinates(const std::vector<std::vector<int>>& vertices, double X[][4]) const;
-  virtual void simplex_vectors(const std::vector<std::vector<int>>& vertices, double v[4][3]) const;
-  virtual void simplex_scalars(const std::vector<std::vector<int>>& vertices, double values[4]) const;
-  virtual void simplex_jacobians(const std::vector<std::vector<int>>& vertices, 
+  virtual void simplex_coordinates(const int vertices[4][4], double X[][4]) const;
+  template <typename S> void simplex_vectors(const int vertices[4][4], double v[4][3]) const;
+  template <typename S> void simplex_scalars(const int vertices[4][4], double values[4]) const;
+  template <typename S> void simplex_jacobians(const int vertices[4][4], 
       double Js[4][3][3]) const;
+
+  // gradient of a scalar snapshot at local array index (x, y, z) of timestep t, 
+  // used when derivatives are not materialized
+  template <typename S>
+  void derived_gradient(const typed_field_data_snapshot_t<S>& s, int t, int x, int y, int z, double g[3]) const;
   
   void put_critical_points(const std::vector<feature_point_t>&);
 };
@@ -97,7 +110,8 @@ inline void critical_point_tracker_3d_regular::finalize()
     fprintf(stderr, "max_accumulated_kernel_time=%f\n", accumulated_kernel_time);
  
   if (enable_streaming_trajectories) {
-    // already done
+    // trajectories are already traced
+    finalize_streaming_trajectories();
   } else {
     // diy::mpi::gather(comm, discrete_critical_points, discrete_critical_points, get_root_proc());
 
@@ -122,29 +136,56 @@ inline void critical_point_tracker_3d_regular::finalize()
   update_traj_statistics();
 }
 
-inline void critical_point_tracker_3d_regular::push_scalar_field_snapshot(const ndarray<double>& s)
+inline void critical_point_tracker_3d_regular::push_scalar_field_snapshot(const ndarray<float>& s)
+{
+  if (xl == FTK_XL_NONE) push_typed_scalar_field_snapshot(s);
+  else push_typed_scalar_field_snapshot(ndarray<double>(s)); // accelerators take double arrays
+}
+
+inline void critical_point_tracker_3d_regular::push_vector_field_snapshot(const ndarray<float>& v)
 {
-  field_data_snapshot_t snapshot;
+  if (xl == FTK_XL_NONE) push_typed_vector_field_snapshot(v);
+  else push_typed_vector_field_snapshot(ndarray<double>(v));
+}
+
+template <typename T>
+inline void critical_point_tracker_3d_regular::push_typed_scalar_field_snapshot(const ndarray<T>& s)
+{
+  typed_field_data_snapshot_t<T> snapshot;
   
   snapshot.scalar = s;
   if (vector_field_source == SOURCE_DERIVED) {
-    snapshot.vector = gradient3D(s);
-    if (jacobian_field_source == SOURCE_DERIVED)
-      snapshot.jacobian = jacobian3D(snapshot.vector);
+    if (enable_lazy_derivatives && xl == FTK_XL_NONE) {
+      // only the scalar is stored; see critical_point_tracker_2d_regular
+      for (int k = 0; k < s.dim(2); k ++)
+        for (int j = 0; j < s.dim(1); j ++)
+          for (int i = 0; i < s.dim(0); i ++) {
+            T g[3];
+            gradient3D_at(s, i, j, k, g);
+            for (int c = 0; c < 3; c ++)
+              if (g[c] != T(0))
+                vector_field_resolution = std::min(vector_field_resolution, double(std::abs(g[c])));
+          }
+    } else {
+      snapshot.vector = gradient3D(s);
+      if (jacobian_field_source == SOURCE_DERIVED)
+        snapshot.jacobian = jacobian3D(snapshot.vector);
+    }
   }
 
-  field_data_snapshots.emplace_back( snapshot );
+  emplace_typed_field_data_snapshot( std::move(snapshot) );
 }
 
-inline void critical_point_tracker_3d_regular::push_vector_field_snapshot(const ndarray<double>& v)
+template <typename T>
+inline void critical_point_tracker_3d_regular::push_typed_vector_field_snapshot(const ndarray<T>& v)
 {
-  field_data_snapshot_t snapshot;
+  typed_field_data_snapshot_t<T> snapshot;
  
   snapshot.vector = v;
   if (jacobian_field_source == SOURCE_DERIVED)
     snapshot.jacobian = jacobian3D(snapshot.vector);
 
-  field_data_snapshots.emplace_back( snapshot );
+  emplace_typed_field_data_snapshot( std::move(snapshot) );
 }
 
 inline void critical_point_tracker_3d_regular::update_timestep()
@@ -161,11 +202,11 @@ inline void critical_point_tracker_3d_regular::update_timestep()
 
   // scan 3-simplices
   // fprintf(stderr, "tracking 3D critical points...\n");
-  auto func3 = [=](element_t e) {
+  const bool single_precision = field_data_snapshots[0].is_single_precision();
+  auto func3 = [=](const fixed_element_t& e) {
       feature_point_t cp;
-      if (check_simplex(e, cp)) {
-        std::lock_guard<std::mutex> guard(mutex);
-        discrete_critical_points[e] = cp;
+      if (single_precision ? check_simplex<float>(e, cp) : check_simplex<double>(e, cp)) {
+        push_detected_critical_point(e, cp);
         // fprintf(stderr, "x={%f, %f, %f}, t=%f, cond=%f, type=%d\n", cp[0], cp[1], cp[2], cp.t, cp.cond, cp.type);
       }
     };
@@ -193,10 +234,13 @@ inline void critical_point_tracker_3d_regular::update_timestep()
   };
 
   if (xl == FTK_XL_NONE) {
-    element_for_ordinal(3, func3);
-    if (field_data_snapshots.size() >= 2) { // interval
-      element_for_interval(3, func3);
-      
+    element_for_ordinal_fixed<4>(3, func3);
+    if (field_data_snapshots.size() >= 2) // interval
+      element_for_interval_fixed<4>(3, func3);
+    merge_detected_critical_points();
+    simplify_critical_points_by_persistence();
+
+    if (field_data_snapshots.size() >= 2) {
       if (enable_streaming_trajectories)
         grow();
     }
@@ -340,37 +384,37 @@ inline void critical_point_tracker_3d_regular::trace_connected_components()
 }
 
 inline void critical_point_tracker_3d_regular::simplex_coordinates(
-    const std::vector<std::vector<int>>& vertices, double X[][4]) const
+    const int vertices[4][4], double X[][4]) const
 {
 #if 0 // legacy
-  for (int i = 0; i < vertices.size(); i ++)
+  for (int i = 0; i < 4; i ++)
     for (int j = 0; j < 4; j ++)
       X[i][j] = vertices[i][j];
 #endif
 
   if (mode_phys_coords == REGULAR_COORDS_SIMPLE) {
-    for (int i = 0; i < vertices.size(); i ++) {
+    for (int i = 0; i < 4; i ++) {
       X[i][0] = vertices[i][0]; // x
       X[i][1] = vertices[i][1]; // y
       X[i][2] = vertices[i][2]; // z
       X[i][3] = vertices[i][3]; // t
     }
   } else if (mode_phys_coords == REGULAR_COORDS_BOUNDS) {
-    for (int i = 0; i < vertices.size(); i ++) {
+    for (int i = 0; i < 4; i ++) {
       X[i][0] = ((vertices[i][0] - array_domain.lower_bound(0)) / double(array_domain.size(0)-1)) * (bounds_coords[1] - bounds_coords[0]) + bounds_coords[0] ; // x
       X[i][1] = ((vertices[i][1] - array_domain.lower_bound(1)) / double(array_domain.size(1)-1)) * (bounds_coords[3] - bounds_coords[2]) + bounds_coords[2] ; // y
       X[i][2] = ((vertices[i][2] - array_domain.lower_bound(2)) / double(array_domain.size(2)-1)) * (bounds_coords[5] - bounds_coords[4]) + bounds_coords[4]; // z
       X[i][3] = vertices[i][3]; // t
     }
   } else if (mode_phys_coords == REGULAR_COORDS_RECTILINEAR) {
-    for (int i = 0; i < vertices.size(); i ++) {
+    for (int i = 0; i < 4; i ++) {
       X[i][0] = rectilinear_coords[0][ vertices[i][0] ]; // x
       X[i][1] = rectilinear_coords[1][ vertices[i][1] ]; // y
       X[i][2] = rectilinear_coords[2][ vertices[i][2] ]; // z
       X[i][3] = vertices[i][3]; // t
     }
   } else if (mode_phys_coords == REGULAR_COORDS_EXPLICIT) {
-    for (int i = 0; i < vertices.size(); i ++) {
+    for (int i = 0; i < 4; i ++) {
       X[i][0] = explicit_coords(0, vertices[i][0], vertices[i][1]); // x
       X[i][1] = explicit_coords(1, vertices[i][0], vertices[i][1]); // y
       X[i][2] = explicit_coords(2, vertices[i][0], vertices[i][1]);
@@ -379,58 +423,93 @@ inline void critical_point_tracker_3d_regular::simplex_coordinates(
   }
 }
 
+template <typename S>
 inline void critical_point_tracker_3d_regular::simplex_vectors(
-    const std::vector<std::vector<int>>& vertices, double v[4][3]) const
+    const int vertices[4][4], double v[4][3]) const
 {
   for (int i = 0; i < 4; i ++) {
     const int iv = vertices[i][3] == current_timestep ? 0 : 1;
-    for (int j = 0; j < 3; j ++)
-      v[i][j] = field_data_snapshots[iv].vector(j, 
-          vertices[i][0] - local_array_domain.start(0), 
-          vertices[i][1] - local_array_domain.start(1),
-          vertices[i][2] - local_array_domain.start(2));
+    const auto &s = field_data_snapshots[iv].typed<S>();
+    const int x = vertices[i][0] - local_array_domain.start(0), 
+              y = vertices[i][1] - local_array_domain.start(1),
+              z = vertices[i][2] - local_array_domain.start(2);
+    if (s.vector.empty()) // lazy derivatives
+      derived_gradient(s, vertices[i][3], x, y, z, v[i]);
+    else {
+      for (int j = 0; j < 3; j ++)
+        v[i][j] = s.vector(j, x, y, z);
+    }
   }
 }
 
+template <typename S>
+inline void critical_point_tracker_3d_regular::derived_gradient(
+    const typed_field_data_snapshot_t<S>& s, int t, int x, int y, int z, double g[3]) const
+{
+  auto derive = [&](double gk[3]) {
+    S gs[3];
+    gradient3D_at(s.scalar, x, y, z, gs);
+    for (int c = 0; c < 3; c ++)
+      gk[c] = gs[c];
+  };
+
+  if (enable_derivative_cache) {
+    const uint64_t key = ((uint64_t(t) * s.scalar.dim(2) + z) * s.scalar.dim(1) + y) * s.scalar.dim(0) + x;
+    direct_mapped_cache<double, 3>::get(derivative_cache_epoch, key, g, derive);
+  } else 
+    derive(g);
+}
+
+template <typename S>
 inline void critical_point_tracker_3d_regular::simplex_scalars(
-    const std::vector<std::vector<int>>& vertices, double values[4]) const
+    const int vertices[4][4], double values[4]) const
 {
   for (int i = 0; i < 4; i ++) {
     const int iv = vertices[i][3] == current_timestep ? 0 : 1;
-    values[i] = field_data_snapshots[iv].scalar(
+    values[i] = field_data_snapshots[iv].typed<S>().scalar(
         vertices[i][0] - local_array_domain.start(0), 
         vertices[i][1] - local_array_domain.start(1), 
         vertices[i][2] - local_array_domain.start(2));
   }
 }
 
+template <typename S>
 inline void critical_point_tracker_3d_regular::simplex_jacobians(
-    const std::vector<std::vector<int>>& vertices, 
+    const int vertices[4][4], 
     double Js[4][3][3]) const
 {
   for (int i = 0; i < 4; i ++) {
     const int iv = vertices[i][3] == current_timestep ? 0 : 1;
-    for (int j = 0; j < 3; j ++) {
-      for (int k = 0; k < 3; k ++) {
-        Js[i][j][k] = field_data_snapshots[iv].jacobian(k, j, 
-            vertices[i][0] - local_array_domain.start(0), 
-            vertices[i][1] - local_array_domain.start(1), 
-            vertices[i][2] - local_array_domain.start(2));
-      }
+    const auto &s = field_data_snapshots[iv].typed<S>();
+    const int x = vertices[i][0] - local_array_domain.start(0), 
+              y = vertices[i][1] - local_array_domain.start(1),
+              z = vertices[i][2] - local_array_domain.start(2);
+    if (s.jacobian.empty()) { // lazy derivatives
+      S H[3][3];
+      hessian3D_at(s.scalar, x, y, z, H);
+      for (int j = 0; j < 3; j ++)
+        for (int k = 0; k < 3; k ++)
+          Js[i][j][k] = H[k][j];
+    } else {
+      for (int j = 0; j < 3; j ++)
+        for (int k = 0; k < 3; k ++)
+          Js[i][j][k] = s.jacobian(k, j, x, y, z);
     }
   }
 }
 
 
+template <typename S>
 inline bool critical_point_tracker_3d_regular::check_simplex(
-    const simplicial_regular_mesh_element& e,
+    const fixed_element_t& e,
     feature_point_t& cp)
 {
   if (!e.valid(m)) return false; // check if the 2-simplex is valid
-  const auto &vertices = e.vertices(m);
+  int vertices[4][4];
+  e.vertices(m, vertices);
 
-  double v[4][3]; // vector values on vertices
-  simplex_vectors(vertices, v);
+  double v[4][3]; // vector values on vertices; computations below are in double regardless of S
+  simplex_vectors<S>(vertices, v);
   
   double mu[4]; // check intersection
   double cond; // condition number
@@ -460,7 +539,7 @@ inline bool critical_point_tracker_3d_regular::check_simplex(
 #endif
 
     int indices[4];
-    simplex_indices(vertices, indices);
+    simplex_indices(4, vertices, indices);
     bool succ = robust_critical_point_in_simplex3(vf, indices);
     if (!succ) return false;
   } else {
@@ -480,12 +559,12 @@ inline bool critical_point_tracker_3d_regular::check_simplex(
 
   if (scalar_field_source != SOURCE_NONE) {
     double values[4];
-    simplex_scalars(vertices, values);
+    simplex_scalars<S>(vertices, values);
     cp.scalar[0] = lerp_s3(values, mu);
   }
 
   double Js[4][3][3], J[3][3];
-  simplex_jacobians(vertices, Js);
+  simplex_jacobians<S>(vertices, Js);
   ftk::lerp_s3m3x3(Js, mu, J);
 
   cp.type = ftk::critical_point_type_3d(J, is_jacobian_field_symmetric);
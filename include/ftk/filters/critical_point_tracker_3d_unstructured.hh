@@ -20,6 +20,7 @@
 #include <ftk/geometry/curve2vtk.hh>
 #include <ftk/filters/critical_point_tracker_regular.hh>
 #include <ftk/filters/unstructured_3d_tracker.hh>
+#include <ftk/utils/thread_local_buffer.hh>
 #include <ftk/ndarray.hh>
 #include <ftk/ndarray/grad.hh>
 #include <ftk/mesh/simplicial_regular_mesh.hh>
@@ -51,8 +52,11 @@ struct critical_point_tracker_3d_unstructured :
 
   void update_timestep();
 
-  void push_scalar_field_snapshot(const ndarray<double>&) {} // TODO
-  void push_vector_field_snapshot(const ndarray<double>&) {} // TODO
+  // gradients and jacobians (hessians) are derived on the mesh with least squares
+  void push_scalar_field_snapshot(const ndarray<double>&);
+  void push_vector_field_snapshot(const ndarray<double>&);
+  void push_scalar_field_snapshot(const ndarray<float>& s) { push_scalar_field_snapshot(ndarray<double>(s)); }
+  void push_vector_field_snapshot(const ndarray<float>& v) { push_vector_field_snapshot(ndarray<double>(v)); }
 
 public:
   std::vector<feature_point_t> get_critical_points() const;
@@ -72,6 +76,10 @@ protected:
 protected:
   std::map<int, feature_point_t> discrete_critical_points;
   // std::vector<std::vector<critical_point_t>> traced_critical_points;
+
+  // per-thread buffers for lock-free detection; cp.tag is the element id
+  thread_local_buffer<feature_point_t> detected_critical_points;
+  void merge_detected_critical_points();
 };
 
 ////////////////////////
@@ -100,6 +108,27 @@ inline void critical_point_tracker_3d_unstructured::simplex_values(
   }
 }
 
+inline void critical_point_tracker_3d_unstructured::push_scalar_field_snapshot(const ndarray<double>& s)
+{
+  const size_t n0 = m3->n(0);
+  ndarray<double> scalar = s;
+  scalar.reshape({1, n0});
+
+  const ndarray<double> grad = m3->vertex_gradient(s);
+  ndarray<double> H = m3->vertex_gradient(grad);
+  for (size_t k = 0; k < n0; k ++) // symmetrize
+    for (int j = 0; j < 3; j ++)
+      for (int j1 = j+1; j1 < 3; j1 ++)
+        H(j, j1, k) = H(j1, j, k) = 0.5 * (H(j, j1, k) + H(j1, j, k));
+
+  push_field_data_snapshot(scalar, grad, H);
+}
+
+inline void critical_point_tracker_3d_unstructured::push_vector_field_snapshot(const ndarray<double>& v)
+{
+  push_field_data_snapshot(ndarray<double>(), v, m3->vertex_gradient(v));
+}
+
 inline bool critical_point_tracker_3d_unstructured::check_simplex(int i, feature_point_t& cp)
 {
   int tet[4];
@@ -149,8 +178,6 @@ inline bool critical_point_tracker_3d_unstructured::check_simplex(int i, feature
   cp.x[2] = x[2];
   cp.t = x[3];
 
-  fprintf(stderr, "X=%f, %f, %f, %f, tet=%d, tettype=%d\n", x[0], x[1], x[2], x[3], i, m->tet_type(i));
-
   if (!field_data_snapshots[0].scalar.empty())
     for (int k = 0; k < get_num_scalar_components(); k ++)
       cp.scalar[k] = f[0][k] * mu[0] + f[1][k] * mu[1] + f[2][k] * mu[2] + f[3][k] * mu[3];
@@ -158,7 +185,7 @@ inline bool critical_point_tracker_3d_unstructured::check_simplex(int i, feature
   if (!field_data_snapshots[0].jacobian.empty()) {
     double H[3][3]; // hessian or jacobian
     ftk::lerp_s3m3x3(Js, mu, H);
-    cp.type = ftk::critical_point_type_3d(H, true);
+    cp.type = ftk::critical_point_type_3d(H, !field_data_snapshots[0].scalar.empty());
   }
   
   cp.tag = i;
@@ -179,25 +206,36 @@ inline void critical_point_tracker_3d_unstructured::update_timestep()
   auto func = [&](int i) {
     feature_point_t cp;
     if (check_simplex(i, cp)) {
-      std::lock_guard<std::mutex> guard(mutex);
-
       if (enable_ignoring_degenerate_points) {
         if (cp.type == 0 || cp.type == 1) return;
       }
 
       if (filter_critical_point_type(cp)) {
-        // if (discrete_critical_points.find(i) != discrete_critical_points.end())
-        //   fprintf(stderr, "FATAL: overwritting cp!!\n");
-        discrete_critical_points[i] = cp;
+        if (enable_lock_free_detection)
+          detected_critical_points.local().push_back(cp);
+        else {
+          std::lock_guard<std::mutex> guard(mutex);
+          discrete_critical_points[i] = cp;
+        }
       }
     }
   };
 
-  m->element_for_ordinal(3, current_timestep, func, xl, nthreads, enable_set_affinity);
+  m->element_for_ordinal(3, current_timestep, func, thread_backend, nthreads, enable_set_affinity);
   // fprintf(stderr, "#dcp=%zu\n", discrete_critical_points.size());
   if (field_data_snapshots.size() >= 2)
-    m->element_for_interval(3, current_timestep, func, xl, nthreads, enable_set_affinity);
+    m->element_for_interval(3, current_timestep, func, thread_backend, nthreads, enable_set_affinity);
   // fprintf(stderr, "#dcp=%zu\n", discrete_critical_points.size());
+  merge_detected_critical_points();
+
+  simplify_critical_points_by_persistence<int>(discrete_critical_points, 
+      m->get_m3()->get_vertex_edge_vertex_csr(), 
+      [&](const feature_point_t& cp, std::vector<std::pair<int, int>>& verts) {
+        int tet[4];
+        m->get_simplex(3, cp.tag, tet);
+        for (int j = 0; j < 4; j ++)
+          verts.push_back(std::make_pair(m->flat_vertex_time(tet[j]) == current_timestep ? 0 : 1, m->flat_vertex_id(tet[j])));
+      });
 
   if (enable_streaming_trajectories) {
     // grow trajectories
@@ -223,7 +261,8 @@ inline void critical_point_tracker_3d_unstructured::finalize()
   fprintf(stderr, "finalizing...\n");
 
   if (enable_streaming_trajectories)  {
-    // already done
+    // trajectories are already traced
+    finalize_streaming_trajectories();
   } else {
     // Convert connected components to geometries
     auto neighbors = [&](int f) {
@@ -290,8 +329,19 @@ inline std::vector<feature_point_t> critical_point_tracker_3d_unstructured::get_
 inline void critical_point_tracker_3d_unstructured::put_critical_points(const std::vector<feature_point_t>& data)
 {
   // fprintf(stderr, "##cps=%zu\n", data.size());
-  for (const auto& cp : data)
-    discrete_critical_points[cp.tag] = cp;
+  for (const auto& cp : data) // amortized constant time if tags are sorted and new
+    discrete_critical_points.emplace_hint(discrete_critical_points.end(), cp.tag, cp)->second = cp;
+}
+
+inline void critical_point_tracker_3d_unstructured::merge_detected_critical_points()
+{
+  if (!enable_lock_free_detection) return;
+
+  auto cps = detected_critical_points.merge();
+  std::sort(cps.begin(), cps.end(), [](const feature_point_t& a, const feature_point_t& b) {
+    return a.tag < b.tag;
+  });
+  put_critical_points(cps);
 }
 
 }
@@ -6,6 +6,7 @@
 #include <ftk/filters/critical_point_tracker.hh>
 #include <ftk/filters/regular_tracker.hh>
 #include <ftk/utils/gather.hh>
+#include <ftk/utils/thread_local_buffer.hh>
 
 namespace ftk {
 
@@ -20,6 +21,18 @@ protected:
   std::map<element_t, feature_point_t> discrete_critical_points;
   std::vector<std::set<element_t>> connected_components;
 
+  // per-thread buffers for lock-free detection; cp.tag is the 64-bit element id
+  thread_local_buffer<feature_point_t> detected_critical_points;
+  template <typename E> // element_t or simplicial_regular_mesh_element_fixed
+  void push_detected_critical_point(const E& e, const feature_point_t& cp);
+  void merge_detected_critical_points();
+
+  // persistence-based simplification on the spatial lattice of the local array 
+  // domain; with multiple processes, each process only sees its own block, so 
+  // the persistence of features that cross blocks depends on the decomposition
+  csr_adjacency<int> spatial_vertex_adjacency; // built on first use
+  void simplify_critical_points_by_persistence();
+
 public: // cp io
   const std::map<element_t, feature_point_t>& get_discrete_critical_points() const {return discrete_critical_points;}
 
@@ -29,6 +42,65 @@ public: // cp io
 
 /////
 ////
+template <typename E>
+inline void critical_point_tracker_regular::push_detected_critical_point(const E& e, const feature_point_t& cp)
+{
+  if (enable_lock_free_detection)
+    detected_critical_points.local().push_back(cp);
+  else {
+    std::lock_guard<std::mutex> guard(mutex);
+    discrete_critical_points[element_t(e)] = cp;
+  }
+}
+
+inline void critical_point_tracker_regular::merge_detected_critical_points()
+{
+  if (!enable_lock_free_detection) return;
+
+  auto cps = detected_critical_points.merge();
+  std::sort(cps.begin(), cps.end(), [](const feature_point_t& a, const feature_point_t& b) {
+    return a.tag < b.tag;
+  });
+  cps.erase(std::unique(cps.begin(), cps.end(), [](const feature_point_t& a, const feature_point_t& b) {
+    return a.tag == b.tag;
+  }), cps.end());
+
+  put_critical_points(cps);
+}
+
+inline void critical_point_tracker_regular::simplify_critical_points_by_persistence()
+{
+  if (persistence_threshold <= 0) return;
+
+  const int nd = m.nd() - 1; // spatial dimensions
+  if (spatial_vertex_adjacency.size() == 0) {
+    if (comm.size() > 1 && is_root_proc())
+      warn("persistence-based simplification is computed on the local block of each process; results depend on the decomposition");
+
+    std::vector<int> lb(nd), ub(nd);
+    for (int j = 0; j < nd; j ++) {
+      lb[j] = local_array_domain.start(j);
+      ub[j] = lb[j] + local_array_domain.size(j) - 1;
+    }
+    simplicial_regular_mesh ms(nd);
+    ms.set_lb_ub(lb, ub);
+    spatial_vertex_adjacency = regular_mesh_vertex_adjacency(ms, nthreads);
+  }
+
+  critical_point_tracker::simplify_critical_points_by_persistence<element_t>(
+      discrete_critical_points, spatial_vertex_adjacency, 
+      [&](const feature_point_t& cp, std::vector<std::pair<int, int>>& verts) {
+        const element_t e(m, nd, cp.tag);
+        for (const auto &x : e.vertices(m)) {
+          int k = 0;
+          for (int j = nd - 1; j >= 0; j --)
+            k = k * local_array_domain.size(j) + x[j] - local_array_domain.start(j);
+          if (k >= 0 && k < int(spatial_vertex_adjacency.size()))
+            verts.push_back(std::make_pair(x[nd] == current_timestep ? 0 : 1, k));
+        }
+      });
+}
+
 inline std::vector<feature_point_t> critical_point_tracker_regular::get_critical_points() const
 {
   std::vector<feature_point_t> results;
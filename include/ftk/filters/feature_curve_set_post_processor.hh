@@ -2,72 +2,238 @@
 #define _FTK_FEATURE_CURVE_SET_PP_HH
 
 #include <ftk/config.hh>
+#include <ftk/object.hh>
 #include <ftk/features/feature_curve_set.hh>
 #include <ftk/utils/string.hh>
+#include <cmath>
 
 namespace ftk {
 
+// Post processing of feature curves with a comma-separated chain of ops, e.g.
+// "smooth_types,split,duration_pruning:2.0,persistence_pruning:0.1:0".
+// The chain is fused: each curve goes through all ops in one pass, and the
+// curves are processed in parallel.  Statistics are only recomputed when a
+// pruning op or split needs them.
+//
+// Pruning ops:
+//  - duration_pruning:value, discards curves with tmax-tmin < value
+//  - persistence_pruning:value[:k], discards curves whose range of the k-th
+//    scalar component (0 by default) along the curve is below value
+//  - extent_pruning:value, discards curves whose spatial bounding box has a
+//    diagonal shorter than value
 struct feature_curve_set_post_processor_t {
+  feature_curve_set_post_processor_t() {}
   feature_curve_set_post_processor_t(const std::string str) { parse_ops(str); }
 
-  void parse_ops(const std::string str) { ops = split(str, ","); }
+  void parse_ops(const std::string str);
   void reset() { ops.clear(); }
+  bool empty() const { return ops.empty(); }
+
+  void set_number_of_threads(int n) { nthreads = n; }
 
   void filter(feature_curve_set_t& trajs) const;
- 
+
+  // processes the given curves only; the resulting curves are inserted back
+  // with their original keys, or with the ids of the pieces if split
+  void filter(feature_curve_set_t& trajs,
+      const std::vector<feature_curve_set_t::iterator>& selected) const;
+
 protected:
-  std::vector<std::string> ops;
+  enum {
+    OP_SMOOTH_TYPES,
+    OP_ROTATE,
+    OP_SPLIT,
+    OP_DISCARD_INTERVAL_POINTS,
+    OP_REORDER,
+    OP_ADJUST_TIME,
+    OP_DERIVE_VELOCITY,
+    OP_DURATION_PRUNING,
+    OP_PERSISTENCE_PRUNING,
+    OP_EXTENT_PRUNING
+  };
+
+  struct op_t {
+    int type;
+    double value = 0;
+    int component = 0;
+  };
+
+  void run(feature_curve_t& curve, size_t i, int key, bool dirty,
+      std::vector<std::pair<int, feature_curve_t>>& results) const;
+
+  void process(std::vector<std::pair<int, feature_curve_t>>& curves,
+      std::vector<std::pair<int, feature_curve_t>>& results) const;
+
+protected:
+  std::vector<op_t> ops;
+  int nthreads = std::thread::hardware_concurrency();
 };
 
+inline void feature_curve_set_post_processor_t::parse_ops(const std::string str)
+{
+  ops.clear();
+  for (const auto &s : split(str, ",")) {
+    if (s.empty()) continue;
+    const auto args = split(s, ":");
+    const auto &name = args[0];
+
+    op_t op;
+    if (name == "smooth_types") op.type = OP_SMOOTH_TYPES;
+    else if (name == "rotate") op.type = OP_ROTATE;
+    else if (name == "split") op.type = OP_SPLIT;
+    else if (name == "discard_interval_points") op.type = OP_DISCARD_INTERVAL_POINTS;
+    else if (name == "reorder") op.type = OP_REORDER;
+    else if (name == "adjust_time") op.type = OP_ADJUST_TIME;
+    else if (name == "derive_velocity") op.type = OP_DERIVE_VELOCITY;
+    else if (name == "duration_pruning") op.type = OP_DURATION_PRUNING;
+    else if (name == "persistence_pruning") op.type = OP_PERSISTENCE_PRUNING;
+    else if (name == "extent_pruning") op.type = OP_EXTENT_PRUNING;
+    else
+      fatal(FTK_ERR_UNKNOWN_OPTIONS, s);
+
+    const bool pruning = op.type == OP_DURATION_PRUNING || op.type == OP_PERSISTENCE_PRUNING || op.type == OP_EXTENT_PRUNING;
+    if (pruning) {
+      if (args.size() < 2)
+        fatal(FTK_ERR_UNKNOWN_OPTIONS, s + ": missing threshold");
+      op.value = std::stod(args[1]);
+      if (op.type == OP_PERSISTENCE_PRUNING && args.size() > 2)
+        op.component = std::stoi(args[2]);
+      if (op.component < 0 || op.component >= FTK_CP_MAX_NUM_VARS)
+        fatal(FTK_ERR_UNKNOWN_OPTIONS, s + ": invalid scalar component");
+    } else if (args.size() > 1)
+      fatal(FTK_ERR_UNKNOWN_OPTIONS, s);
+
+    ops.push_back(op);
+  }
+}
+
+inline void feature_curve_set_post_processor_t::run(
+    feature_curve_t& c, size_t i, int key, bool dirty,
+    std::vector<std::pair<int, feature_curve_t>>& results) const
+{
+  auto update = [&]() {
+    if (dirty) {
+      c.update_statistics();
+      dirty = false;
+    }
+  };
+
+  for (; i < ops.size(); i ++) {
+    if (c.empty()) return;
+    const auto &op = ops[i];
+
+    switch (op.type) {
+    case OP_SMOOTH_TYPES:
+      c.smooth_ordinal_types();
+      c.smooth_interval_types();
+      dirty = true;
+      break;
+
+    case OP_ROTATE:
+      c.rotate();
+      dirty = true;
+      break;
+
+    case OP_SPLIT:
+      update();
+      if (!c.consistent_type) {
+        for (auto &piece : c.split())
+          if (!piece.empty()) {
+            const int id = piece[0].id;
+            run(piece, i+1, id, true, results);
+          }
+        return;
+      }
+      break;
+
+    case OP_DISCARD_INTERVAL_POINTS:
+      c.discard_interval_points();
+      dirty = true;
+      break;
+
+    case OP_REORDER:
+      c.reorder();
+      dirty = true;
+      break;
+
+    case OP_ADJUST_TIME:
+      c.adjust_time();
+      dirty = true;
+      break;
+
+    case OP_DERIVE_VELOCITY:
+      c.discard_interval_points();
+      c.derive_velocity();
+      dirty = true;
+      break;
+
+    case OP_DURATION_PRUNING:
+      update();
+      if (c.tmax - c.tmin < op.value) return;
+      break;
+
+    case OP_PERSISTENCE_PRUNING:
+      update();
+      if (c.persistence[op.component] < op.value) return;
+      break;
+
+    case OP_EXTENT_PRUNING:
+      update();
+      {
+        double d2 = 0;
+        for (int k = 0; k < 3; k ++)
+          d2 += (c.bbmax[k] - c.bbmin[k]) * (c.bbmax[k] - c.bbmin[k]);
+        if (std::sqrt(d2) < op.value) return;
+      }
+      break;
+
+    default: break;
+    }
+  }
+
+  if (c.empty()) return;
+  update();
+  results.push_back(std::make_pair(key, std::move(c)));
+}
+
+inline void feature_curve_set_post_processor_t::process(
+    std::vector<std::pair<int, feature_curve_t>>& curves,
+    std::vector<std::pair<int, feature_curve_t>>& results) const
+{
+  std::vector<std::vector<std::pair<int, feature_curve_t>>> partial(curves.size());
+  object::parallel_for(curves.size(), [&](int i) {
+    run(curves[i].second, 0, curves[i].first, true, partial[i]);
+  }, FTK_THREAD_PTHREAD, nthreads, false);
+
+  for (auto &p : partial)
+    for (auto &kv : p)
+      results.push_back(std::move(kv));
+}
+
 inline void feature_curve_set_post_processor_t::filter(feature_curve_set_t &trajs) const
 {
-  for (const auto op : ops) {
-    // if (op == "discard_high_cond") {
-    //   trajs.foreach([](ftk::feature_curve_t& t) {
-    //     t.discard_high_cond();
-    //     t.update_statistics();
-    //   });
-    // } else 
-    if (op == "smooth_types") {
-      trajs.foreach([](ftk::feature_curve_t& t) {
-        t.smooth_ordinal_types();
-        t.smooth_interval_types();
-        t.update_statistics();
-      });
-    } else if (op == "rotate") {
-      trajs.foreach([](ftk::feature_curve_t& t) {
-        t.rotate();
-        t.update_statistics();
-      });
-    } else if (starts_with(op, "duration_pruning")) {
-      // syntax: duration_pruning:value, e,g. duration_pruning:2.0
-      // TODO: parse duration threshold
-    } else if (op == "split") {
-      trajs.split_all();
-    } else if (op == "discard_interval_points") {
-      trajs.foreach([](ftk::feature_curve_t& t) {
-        t.discard_interval_points();
-        t.update_statistics();
-      });
-    } else if (op == "reorder") {
-      trajs.foreach([](ftk::feature_curve_t& t) {
-        t.reorder();
-        t.update_statistics();
-      });
-    } else if (op == "adjust_time") {
-      trajs.foreach([](ftk::feature_curve_t& t) {
-        t.adjust_time();
-        t.update_statistics();
-      });
-    } else if (op == "derive_velocity") {
-      trajs.foreach([](ftk::feature_curve_t& t) {
-        t.discard_interval_points();
-        t.derive_velocity();
-        t.update_statistics();
-      });
-    } else 
-      fatal(FTK_ERR_UNKNOWN_OPTIONS);
+  std::vector<feature_curve_set_t::iterator> selected;
+  for (auto it = trajs.begin(); it != trajs.end(); it ++)
+    selected.push_back(it);
+  filter(trajs, selected);
+}
+
+inline void feature_curve_set_post_processor_t::filter(feature_curve_set_t &trajs,
+    const std::vector<feature_curve_set_t::iterator>& selected) const
+{
+  if (ops.empty() || selected.empty()) return;
+
+  std::vector<std::pair<int, feature_curve_t>> curves, results;
+  curves.reserve(selected.size());
+  for (const auto &it : selected) {
+    curves.push_back(std::make_pair(it->first, std::move(it->second)));
+    trajs.erase(it);
   }
+
+  process(curves, results);
+
+  for (const auto &kv : results)
+    trajs.add(kv.second, kv.first);
 }
 
 } // namespace ftk
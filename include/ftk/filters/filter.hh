@@ -4,6 +4,7 @@
 #include <ftk/config.hh>
 #include <ftk/object.hh>
 #include <ftk/external/cxxopts.hpp>
+#include <ftk/utils/string.hh>
 #include <thread>
 #include <mutex>
 #include <thread>
@@ -68,6 +69,7 @@ inline void filter::use_thread_backend(const std::string& str)
 {
   if (str == "openmp") use_thread_backend( FTK_THREAD_OPENMP );
   else if (str == "tbb") use_thread_backend( FTK_THREAD_TBB );
+  else if (str == "pool") use_thread_backend( FTK_THREAD_POOL );
   else use_thread_backend( FTK_THREAD_PTHREAD );
 }
 
@@ -42,12 +42,34 @@ struct json_interface : public object {
   //    - pattern, string, required: e.g. "surface.vtp", "sliced-%04d.vtp"
   // - threshold, number, by default 0: threshold for some trackers, e.g. contour trackers
   // - accelerator, string, by default "none": none, cuda, or hipsycl
-  // - thread_model, string by default "pthread": pthread, openmp, or tbb
+  // - thread_backend, string by default "pthread": pthread, openmp, tbb, or pool
+  // - precision, string, by default "float64": float32 or float64; regular-grid critical 
+  //   point trackers store timesteps (and derived fields) in this precision, while 
+  //   computations are in double
   // - nblocks, int, by default 0: number of blocks; 0 will be replaced by the number of processes
   // - nthreads, int, by default 0: number of threads; 0 will replaced by the max available number of CPUs
   // - enable_streaming, bool, by default false
   // - enable_fast_detection, bool, by default true
-  // - post_processing_options, string, by default empty
+  // - enable_lock_free_detection, bool, by default false: collect detected critical points 
+  //   in per-thread buffers and merge them after each sweep
+  // - enable_distributed_tracing, bool, by default false: trace trajectories without gathering 
+  //   discrete critical points to the root process; trajectories stay distributed if the 
+  //   output is traced pvtp, and are gathered to the root process before writing otherwise
+  // - enable_lazy_derivatives, bool, by default false: for regular-grid critical point 
+  //   trackers, compute gradients and jacobians of scalar fields on the fly instead of 
+  //   storing them with each timestep; ignored with accelerators
+  // - enable_derivative_cache, bool, by default false: reuse gradients computed on the 
+  //   fly with a small per-thread cache
+  // - persistence_threshold, number, by default 0: if positive, critical point trackers 
+  //   drop detected extrema (and saddles cancelling them) whose persistence in the merge 
+  //   trees of the first scalar component is below the threshold; with regular-grid 
+  //   trackers on multiple processes, the merge trees only cover the local block
+  // - post_processing_options, string, by default empty: comma-separated post processing 
+  //   ops applied to traced critical points, e.g. "split,duration_pruning:2,extent_pruning:0.5"; 
+  //   ops are smooth_types, rotate, split, discard_interval_points, reorder, adjust_time, 
+  //   derive_velocity, duration_pruning:value, persistence_pruning:value[:component], and 
+  //   extent_pruning:value.  With streaming trajectories, each trajectory is post processed 
+  //   once it is complete
   // - xgc, json, optional: XGC-specific options
   //    - format, string, by default auto: auto, h5, or bp
   //    - path, string, optional: XGC data path, which contains xgc.mesh, xgc.bfield, units.m, 
@@ -85,6 +107,8 @@ private:
 
   void write_sliced_results(int k);
   void write_intercepted_results(int k, int nt);
+  void write_archived_traced_critical_points();
+  void collect_traced_critical_points(); // gather distributed trajectories unless written as pvtp pieces
 
 private:
   std::shared_ptr<critical_point_tracker> tracker;
@@ -135,10 +159,15 @@ void json_interface::configure(const json& j0)
   // add_boolean_option("enable_discarding_interval_points", false);
   // add_boolean_option("enable_discarding_degenerate_points", false);
   // add_boolean_option("enable_ignoring_degenerate_points", false);
+  add_boolean_option("enable_lock_free_detection", false);
+  add_boolean_option("enable_distributed_tracing", false);
+  add_boolean_option("enable_lazy_derivatives", false);
+  add_boolean_option("enable_derivative_cache", false);
   add_boolean_option("enable_timing", false);
 
   // add_number_option("duration_pruning_threshold", 0);
   add_number_option("nblocks", 1);
+  add_number_option("persistence_threshold", 0);
   
   /// application specific
   if (j.contains("xgc")) {
@@ -185,6 +214,14 @@ void json_interface::configure(const json& j0)
 
   add_string_option(j, "accelerator", false);
 
+  add_string_option(j, "post_processing_options", false);
+
+  add_string_option(j, "precision", false);
+  if (!j.contains("precision"))
+    j["precision"] = "float64";
+  else if (j["precision"] != "float32" && j["precision"] != "float64")
+    fatal("invalid precision");
+
   // output type
   static const std::set<std::string> valid_output_types = {
     "discrete", // discrete and un-traced critical points.  TODO: currently ignored
@@ -324,6 +361,24 @@ void json_interface::configure_tracker_general(diy::mpi::communicator comm)
   if (j["enable_streaming_trajectories"] == true)
     tracker->set_enable_streaming_trajectories(true);
 
+  if (j["enable_lock_free_detection"] == true)
+    tracker->set_enable_lock_free_detection(true);
+
+  if (j["enable_distributed_tracing"] == true)
+    tracker->set_enable_distributed_tracing(true);
+
+  if (j["enable_lazy_derivatives"] == true)
+    tracker->set_enable_lazy_derivatives(true);
+
+  if (j["enable_derivative_cache"] == true)
+    tracker->set_enable_derivative_cache(true);
+
+  if (j["persistence_threshold"].get<double>() > 0)
+    tracker->set_persistence_threshold(j["persistence_threshold"].get<double>());
+
+  if (j.contains("post_processing_options") && j["enable_streaming_trajectories"] == true)
+    tracker->set_streaming_post_processing_options(j["post_processing_options"]);
+
   if (j["enable_discarding_interval_points"] == true)
     tracker->set_enable_discarding_interval_points(true);
 
@@ -365,6 +420,13 @@ void json_interface::consume(ndarray_stream<> &stream, diy::mpi::communicator co
     consume_unstructured(stream, comm);
   else 
     consume_regular(stream, comm);
+
+  // streamed trajectories are post processed by the tracker as they complete
+  if (tracker && j.contains("post_processing_options") && j["enable_streaming_trajectories"] != true) {
+    feature_curve_set_post_processor_t pp(j["post_processing_options"].get<std::string>());
+    pp.set_number_of_threads(tracker->get_number_of_threads());
+    pp.filter(tracker->get_traced_critical_points());
+  }
 }
 
 void json_interface::consume_mpas(ndarray_stream<> &stream, diy::mpi::communicator comm)
@@ -470,6 +532,7 @@ void json_interface::consume_unstructured(ndarray_stream<> &stream, diy::mpi::co
   stream.start();
   stream.finish();
   tracker->finalize();
+  collect_traced_critical_points();
 }
 
 void json_interface::consume_xgc(ndarray_stream<> &stream, diy::mpi::communicator comm)
@@ -504,7 +567,7 @@ void json_interface::consume_xgc(ndarray_stream<> &stream, diy::mpi::communicato
 
   tracker->set_scalar_components({"dneOverne0", "psi"});
 
-  if (j.contains("archived_traced_critical_points_filename")) {
+  if (j.contains("archived_traced_critical_points_filename") && file_exists(j["archived_traced_critical_points_filename"].get<std::string>())) {
     fprintf(stderr, "reading archived traced critical points...\n");
     const std::string filename = j["archived_traced_critical_points_filename"];
     if (ends_with(filename, "json")) tracker->read_traced_critical_points_json(filename);
@@ -579,6 +642,30 @@ void json_interface::consume_xgc(ndarray_stream<> &stream, diy::mpi::communicato
   stream.start();
   stream.finish();
   tracker->finalize();
+  collect_traced_critical_points();
+  write_archived_traced_critical_points();
+}
+
+void json_interface::collect_traced_critical_points()
+{
+  if (j["enable_distributed_tracing"] != true) return;
+
+  const bool pieces = j.contains("output") && j["output_type"] == "traced" && j["output_format"] == "pvtp" 
+    && !j.contains("archived_traced_critical_points_filename");
+  if (!pieces)
+    tracker->gather_traced_critical_points();
+}
+
+void json_interface::write_archived_traced_critical_points()
+{
+  if (j.contains("archived_traced_critical_points_filename")) {
+    const std::string filename = j["archived_traced_critical_points_filename"];
+    if (!file_exists(filename)) {
+      fprintf(stderr, "writing archived traced critical points...\n");
+      if (ends_with(filename, "json")) tracker->write_traced_critical_points_json(filename);
+      else tracker->write_traced_critical_points_binary(filename);
+    }
+  }
 }
 
 void json_interface::write_sliced_results(int k)
@@ -662,7 +749,7 @@ void json_interface::consume_regular(ndarray_stream<> &stream, diy::mpi::communi
     tracker->set_input_array_partial(true); 
   tracker->initialize();
  
-  if (j.contains("archived_traced_critical_points_filename")) {
+  if (j.contains("archived_traced_critical_points_filename") && file_exists(j["archived_traced_critical_points_filename"].get<std::string>())) {
     fprintf(stderr, "reading archived traced critical points...\n");
     const std::string filename = j["archived_traced_critical_points_filename"];
     if (ends_with(filename, "json")) tracker->read_traced_critical_points_json(filename);
@@ -677,6 +764,7 @@ void json_interface::consume_regular(ndarray_stream<> &stream, diy::mpi::communi
     return;
   }
 
+  const bool single_precision = j["precision"] == "float32";
   auto push_timestep = [&](const ftk::ndarray<double>& field_data) {
     if (nv == 1) { // scalar field
 #if 0
@@ -687,10 +775,13 @@ void json_interface::consume_regular(ndarray_stream<> &stream, diy::mpi::communi
         tracker->push_scalar_field_snapshot(scalar);
       } else 
 #endif
-      tracker->push_scalar_field_snapshot(field_data);
+      if (single_precision) tracker->push_scalar_field_snapshot(ftk::ndarray<float>(field_data));
+      else tracker->push_scalar_field_snapshot(field_data);
+    }
+    else { // vector field
+      if (single_precision) tracker->push_vector_field_snapshot(ftk::ndarray<float>(field_data));
+      else tracker->push_vector_field_snapshot(field_data);
     }
-    else // vector field
-      tracker->push_vector_field_snapshot(field_data);
   };
 
   if (comm.size() > 1) 
@@ -713,6 +804,8 @@ void json_interface::consume_regular(ndarray_stream<> &stream, diy::mpi::communi
   auto t2 = clock_type::now();
   
   tracker->finalize();
+  collect_traced_critical_points();
+  write_archived_traced_critical_points();
   auto t3 = clock_type::now();
 
   if (comm.rank() == 0 && j["enable_timing"]) {
@@ -759,33 +852,17 @@ void json_interface::post_process()  // FIXME: legacy post processing code, to b
 {
   auto &trajs = tracker->get_traced_critical_points();
 
-  trajs.foreach([](ftk::feature_curve_t& t) {
-    // t.discard_high_cond();
-    t.smooth_ordinal_types();
-    t.smooth_interval_types();
-    t.rotate();
-    // t.discard_interval_points();
-    t.update_statistics();
-  });
-  if (j["duration_pruning_threshold"] > 0) {
-    const double threshold = j["duration_pruning_threshold"];
-    trajs.filter([&](const feature_curve_t& traj) {
-      if (traj.tmax - traj.tmin < threshold) return false;
-      else return true;
-    });
-  }
-  trajs.split_all();
-  if (j["enable_discarding_interval_points"] == true) {
-    trajs.foreach([](ftk::feature_curve_t& t) {
-      t.discard_interval_points();
-    });
-  }
-  trajs.foreach([](ftk::feature_curve_t& t) {
-    t.reorder();
-    t.adjust_time();
-    // t.relabel(k);
-    t.update_statistics();
-  });
+  std::string ops = "smooth_types,rotate";
+  if (j["duration_pruning_threshold"] > 0)
+    ops += ",duration_pruning:" + std::to_string(j["duration_pruning_threshold"].get<double>());
+  ops += ",split";
+  if (j["enable_discarding_interval_points"] == true)
+    ops += ",discard_interval_points";
+  ops += ",reorder,adjust_time";
+
+  feature_curve_set_post_processor_t pp(ops);
+  pp.set_number_of_threads(tracker->get_number_of_threads());
+  pp.filter(trajs);
   
   if (j.contains("xgc") && j["xgc"].contains("post_process") && j["xgc"]["post_process"] == true)
     xgc_post_process();
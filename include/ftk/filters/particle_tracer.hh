@@ -3,12 +3,17 @@
 
 #include <ftk/config.hh>
 #include <ftk/filters/tracker.hh>
+#include <ftk/features/feature_point_lite.hh>
+#include <ftk/features/feature_curve_set.hh>
+#include <ftk/numeric/rk4.hh>
+#include <ftk/numeric/rk45.hh>
 
 namespace ftk {
 
 enum {
   PARTICLE_TRACER_INTEGRATOR_RK1 = 0,
   PARTICLE_TRACER_INTEGRATOR_RK4 = 1,
+  PARTICLE_TRACER_INTEGRATOR_RK45 = 2, // adaptive dormand-prince w/ error control
   PARTICLE_TRACER_INTEGRATOR_SPHERICAL_RK1 = 5,
   PARTICLE_TRACER_INTEGRATOR_SPHERICAL_RK1_WITH_VERTICAL_VELOCITY = 6,
   PARTICLE_TRACER_INTEGRATOR_SPHERICAL_RK4_WITH_VERTICAL_VELOCITY = 7,
@@ -32,6 +37,8 @@ struct particle_tracer : public virtual tracker
   void write_trajectories(const std::string& filename);
   void write_geo_trajectories(const std::string& filename);
 
+  const feature_curve_set_t& get_trajectories() const { return trajectories; }
+
 public:
   void set_nsteps_per_day(int n) { nsteps_per_day = n; }
   void set_checkpoint_days(int n) { checkpoint_days = n; }
@@ -42,10 +49,29 @@ public: // will be overriden by above parameters
   void set_nsteps_per_interval(int n) { nsteps_per_interval = n; }
   void set_nsteps_per_checkpoint(int n) { nsteps_per_checkpoint = 16; }
 
+public: 
+  void set_integrator(int i) { integrator = i; }
+  void set_integrator(const std::string& str);
+  void set_tolerances(double atol, double rtol) { abs_tol = atol; rel_tol = rtol; } // for rk45
+  void set_batch_size(int n) { batch_size = std::max(1, n); } // number of particles advanced together
+
 protected:
   virtual bool eval_vt(const double *x, double *v, int *hint = NULL);  // w/ temporal interpolation
   virtual bool eval_v(int t, const double *x, double *v, int *hint = NULL) { return false; } // single timestep
 
+  // batched evaluation of n particles in structure-of-arrays form: the
+  // k-th channel of the j-th particle is x[k*n+j] (and v[k*n+j]); hints
+  // are two integers per particle
+  virtual void eval_vt_batch(int n, const double *x, double *v, bool *succ, int *hints);
+  virtual void eval_v_batch(int t, int n, const double *x, double *v, bool *succ, int *hints);
+
+  void update_timestep_batched();
+  void integrate_batch_rk4(feature_curve_t **trajs, int m);
+  void integrate_batch_rk45(feature_curve_t **trajs, int m);
+
+  void eval_vt_subset(int m, std::vector<int>& ids, const double *x, double *v, int *hints); // failed particles are removed from ids
+  void push_point(feature_curve_t& traj, int m, int j, const double *x, const double *v) const;
+
   int nd() const { return nd_; }
   double delta() const { return current_delta_t / nsteps_per_interval; }
 
@@ -70,6 +96,9 @@ protected:
 
   const int nd_;
   int integrator = PARTICLE_TRACER_INTEGRATOR_RK4;
+
+  double abs_tol = 1e-6, rel_tol = 1e-6;
+  int batch_size = 64;
 };
 
 //// 
@@ -127,6 +156,13 @@ inline void particle_tracer::prepare_timestep()
   V[1] = snapshots.size() > 1 ? snapshots[1]->get_ptr<double>("vector") : nullptr;
 }
 
+inline void particle_tracer::set_integrator(const std::string& str)
+{
+  if (str == "rk4") integrator = PARTICLE_TRACER_INTEGRATOR_RK4;
+  else if (str == "rk45") integrator = PARTICLE_TRACER_INTEGRATOR_RK45;
+  else fatal("unknown integrator " + str);
+}
+
 inline void particle_tracer::update_timestep()
 {
   if (comm.rank() == 0) fprintf(stderr, "current_timestep=%d\n", current_timestep);
@@ -141,6 +177,11 @@ inline void particle_tracer::update_timestep()
   if (!streamlines && this->snapshots.size() < 2) 
     return; // nothing can be done
 
+  if (integrator == PARTICLE_TRACER_INTEGRATOR_RK4 || integrator == PARTICLE_TRACER_INTEGRATOR_RK45) {
+    update_timestep_batched();
+    return;
+  }
+
   // fprintf(stderr, "#particles=%zu\n", this->particles.size());
   this->parallel_for_container(trajectories, [&](feature_curve_set_t::iterator it) {
   // for (auto &kv : trajectories) {
@@ -202,7 +243,7 @@ inline void particle_tracer::update_timestep()
     traj.push_back(p);
 
     // fprintf(stderr, "%f, %f, %f\n", p.x[0], p.x[1], p.t);
-  }, FTK_THREAD_PTHREAD, get_number_of_threads());
+  }, this->thread_backend, get_number_of_threads());
 }
 
 inline bool particle_tracer::eval_vt(
@@ -235,6 +276,296 @@ inline bool particle_tracer::eval_vt(
     return false;
 }
 
+inline void particle_tracer::eval_v_batch(int t, int n, const double *x, double *v, bool *succ, int *hints)
+{
+  // fallback: gather each particle and evaluate with eval_v
+  const int nx = nd_ + 1, nc = nch();
+  double xj[10], vj[10];
+  for (int j = 0; j < n; j ++) {
+    for (int k = 0; k < nx; k ++)
+      xj[k] = x[k*n+j];
+    succ[j] = eval_v(t, xj, vj, hints + 2*j);
+    if (succ[j])
+      for (int k = 0; k < nc; k ++)
+        v[k*n+j] = vj[k];
+  }
+}
+
+inline void particle_tracer::eval_vt_batch(int n, const double *x, double *v, bool *succ, int *hints)
+{
+  const int nc = nch();
+  const double eps = 1e-9; // tolerance of the temporal bound for roundoff in t + h
+
+  if (V[0] && V[1]) { // double time step
+    std::vector<double> v1(nc * n), w(n);
+    std::unique_ptr<bool[]> succ1(new bool[n]);
+
+    eval_v_batch(0, n, x, v, succ, hints);
+    eval_v_batch(1, n, x, v1.data(), succ1.get(), hints);
+
+    for (int j = 0; j < n; j ++) {
+      const double t = (x[nd_*n+j] - current_t) / current_delta_t;
+      succ[j] = succ[j] && succ1[j] && t >= -eps && t <= 1.0 + eps; // out of temporal bound
+      w[j] = std::min(1.0, std::max(0.0, t));
+    }
+
+    for (int k = 0; k < nc; k ++)
+      for (int j = 0; j < n; j ++)
+        v[k*n+j] = (1.0 - w[j]) * v[k*n+j] + w[j] * v1[k*n+j];
+  } else if (V[0]) // single time step
+    eval_v_batch(0, n, x, v, succ, hints);
+  else { // no timestep available
+    for (int j = 0; j < n; j ++)
+      succ[j] = false;
+    return;
+  }
+
+  for (int j = 0; j < n; j ++)
+    v[nd_*n+j] = 1.0; // time
+}
+
+inline void particle_tracer::eval_vt_subset(int m, std::vector<int>& ids, const double *x, double *v, int *hints)
+{
+  const int na = ids.size(), nx = nd_ + 1, nc = nch();
+  if (na == 0) return;
+
+  // compact the listed particles so that the batched evaluation runs over contiguous arrays
+  std::vector<double> xa(nx * na), va(nc * na);
+  std::vector<int> ha(2 * na);
+  std::unique_ptr<bool[]> sa(new bool[na]);
+
+  for (int k = 0; k < nx; k ++)
+    for (int a = 0; a < na; a ++)
+      xa[k*na+a] = x[k*m+ids[a]];
+  for (int a = 0; a < na; a ++) {
+    ha[a*2] = hints[ids[a]*2];
+    ha[a*2+1] = hints[ids[a]*2+1];
+  }
+
+  eval_vt_batch(na, xa.data(), va.data(), sa.get(), ha.data());
+
+  for (int k = 0; k < nc; k ++)
+    for (int a = 0; a < na; a ++)
+      v[k*m+ids[a]] = va[k*na+a];
+  for (int a = 0; a < na; a ++) {
+    hints[ids[a]*2] = ha[a*2];
+    hints[ids[a]*2+1] = ha[a*2+1];
+  }
+
+  int nb = 0;
+  for (int a = 0; a < na; a ++)
+    if (sa[a]) ids[nb ++] = ids[a];
+  ids.resize(nb);
+}
+
+inline void particle_tracer::push_point(feature_curve_t& traj, int m, int j, const double *x, const double *v) const
+{
+  feature_point_t p;
+  for (auto k = 0; k < nd_; k ++) {
+    p.x[k] = x[k*m+j];
+    p.v[k] = v[k*m+j];
+  }
+  p.t = x[nd_*m+j];
+  for (auto k = 0; k < nch() - nd() - 1; k ++)
+    p.scalar[k] = v[(k + nd() + 1)*m+j];
+  p.id = traj.id;
+  traj.push_back(p);
+}
+
+inline void particle_tracer::update_timestep_batched()
+{
+  std::vector<feature_curve_t*> trajs;
+  for (auto &kv : trajectories)
+    trajs.push_back(&kv.second);
+
+  const int n = trajs.size(),
+            nbatches = (n + batch_size - 1) / batch_size;
+
+  this->parallel_for(nbatches, [&](int b) {
+    const int j0 = b * batch_size, 
+              j1 = std::min(n, j0 + batch_size);
+    if (integrator == PARTICLE_TRACER_INTEGRATOR_RK45)
+      integrate_batch_rk45(trajs.data() + j0, j1 - j0);
+    else 
+      integrate_batch_rk4(trajs.data() + j0, j1 - j0);
+  }, this->thread_backend, get_number_of_threads());
+}
+
+inline void particle_tracer::integrate_batch_rk4(feature_curve_t **trajs, int m)
+{
+  const int nx = nd_ + 1, nc = nch();
+  const double h = delta();
+
+  std::vector<double> x(nx * m), xs(nx * m), v(nc * m, 0.0);
+  std::vector<double> k1(nc * m), k2(nc * m), k3(nc * m), k4(nc * m);
+  std::vector<int> hints(2 * m, -1);
+
+  for (int j = 0; j < m; j ++) {
+    const auto &p = trajs[j]->back();
+    for (int k = 0; k < nd_; k ++)
+      x[k*m+j] = p.x[k];
+    x[nd_*m+j] = p.t;
+  }
+
+  std::vector<int> ids(m);
+  for (int j = 0; j < m; j ++)
+    ids[j] = j;
+
+  auto stage = [&](const std::vector<double>& kk, double c) {
+    for (int k = 0; k < nx; k ++)
+      for (int j : ids)
+        xs[k*m+j] = x[k*m+j] + c * h * kk[k*m+j];
+  };
+
+  for (int step = 0; step < nsteps_per_interval && !ids.empty(); step ++) {
+    // checkpoints are recorded before the step with the velocity of the
+    // previous step, as in the per-particle integrators
+    if (step % nsteps_per_checkpoint == 0)
+      for (int j : ids)
+        push_point(*trajs[j], m, j, x.data(), v.data());
+
+    eval_vt_subset(m, ids, x.data(), k1.data(), hints.data());
+    for (int k = 0; k < nc; k ++)
+      for (int j : ids)
+        v[k*m+j] = k1[k*m+j];
+
+    stage(k1, 0.5);
+    eval_vt_subset(m, ids, xs.data(), k2.data(), hints.data());
+    stage(k2, 0.5);
+    eval_vt_subset(m, ids, xs.data(), k3.data(), hints.data());
+    stage(k3, 1.0);
+    eval_vt_subset(m, ids, xs.data(), k4.data(), hints.data());
+
+    for (int k = 0; k < nx; k ++)
+      for (int j : ids)
+        x[k*m+j] += h * (k1[k*m+j] + 2.0 * (k2[k*m+j] + k3[k*m+j]) + k4[k*m+j]) / 6.0;
+  }
+
+  // particles that failed stay at their last valid position
+  for (int j = 0; j < m; j ++)
+    push_point(*trajs[j], m, j, x.data(), v.data());
+}
+
+inline void particle_tracer::integrate_batch_rk45(feature_curve_t **trajs, int m)
+{
+  typedef dopri5_tableau<double> tab;
+  const int nx = nd_ + 1, nc = nch();
+  const double dt_checkpoint = delta() * nsteps_per_checkpoint,
+               hmin = delta() * 1e-6;
+
+  std::vector<double> x(nx * m), xs(nx * m), v(nc * m, 0.0);
+  std::vector<double> kk(tab::nstages * nc * m);
+  std::vector<double> h(m, delta()), hs(m), t_end(m), t_next(m);
+  std::vector<int> hints(2 * m, -1);
+  std::vector<bool> has_k1(m, false), at_checkpoint(m, true);
+
+  auto K = [&](int s) { return kk.data() + size_t(s) * nc * m; };
+
+  for (int j = 0; j < m; j ++) {
+    const auto &p = trajs[j]->back();
+    for (int k = 0; k < nd_; k ++)
+      x[k*m+j] = p.x[k];
+    x[nd_*m+j] = p.t;
+    t_end[j] = p.t + current_delta_t;
+    t_next[j] = std::min(t_end[j], p.t + dt_checkpoint);
+  }
+
+  std::vector<int> ids(m), ids1;
+  for (int j = 0; j < m; j ++)
+    ids[j] = j;
+
+  while (!ids.empty()) {
+    // velocities at the current positions, unless reused from the last stage of the previous step (fsal)
+    ids1.clear();
+    for (int j : ids)
+      if (!has_k1[j]) ids1.push_back(j);
+    eval_vt_subset(m, ids1, x.data(), K(0), hints.data());
+    for (int j : ids1)
+      has_k1[j] = true;
+
+    int nb = 0;
+    for (int j : ids) 
+      if (has_k1[j]) ids[nb ++] = j; // particles whose velocity cannot be evaluated are stopped
+    ids.resize(nb);
+
+    for (int j : ids) {
+      for (int k = 0; k < nc; k ++)
+        v[k*m+j] = K(0)[k*m+j];
+      if (at_checkpoint[j]) {
+        push_point(*trajs[j], m, j, x.data(), v.data());
+        at_checkpoint[j] = false;
+      }
+      hs[j] = std::min(h[j], t_next[j] - x[nd_*m+j]); // do not step over the next checkpoint
+    }
+
+    // the remaining stages; particles leaving the domain in any stage reject the step
+    ids1 = ids;
+    for (int s = 1; s < tab::nstages; s ++) {
+      for (int k = 0; k < nx; k ++)
+        for (int j : ids1) {
+          double y = x[k*m+j];
+          for (int i = 0; i < s; i ++)
+            y += hs[j] * tab::a[s][i] * K(i)[k*m+j];
+          xs[k*m+j] = y;
+        }
+      eval_vt_subset(m, ids1, xs.data(), K(s), hints.data());
+    }
+
+    std::vector<bool> evaluated(m, false);
+    for (int j : ids1)
+      evaluated[j] = true;
+
+    nb = 0;
+    for (int j : ids) {
+      double factor = 0.5;
+      bool accept = false;
+
+      if (evaluated[j]) {
+        double x0[10], x1[10], err[10];
+        for (int k = 0; k < nd_; k ++) {
+          x0[k] = x[k*m+j];
+          x1[k] = xs[k*m+j];
+          err[k] = 0;
+          for (int s = 0; s < tab::nstages; s ++)
+            err[k] += hs[j] * tab::e[s] * K(s)[k*m+j];
+        }
+        const double errnorm = rk45_error_norm(nd_, x0, x1, err, abs_tol, rel_tol);
+        factor = rk45_step_factor(errnorm);
+        accept = errnorm <= 1.0;
+      }
+
+      if (accept) {
+        for (int k = 0; k < nx; k ++)
+          x[k*m+j] = xs[k*m+j];
+        for (int k = 0; k < nc; k ++)
+          K(0)[k*m+j] = K(tab::nstages-1)[k*m+j]; // first same as last
+
+        const bool clipped = hs[j] < h[j];
+        if (x[nd_*m+j] >= t_next[j] - hmin) { // reached the checkpoint
+          x[nd_*m+j] = t_next[j];
+          at_checkpoint[j] = true;
+          t_next[j] = std::min(t_end[j], t_next[j] + dt_checkpoint);
+        }
+        h[j] = clipped ? std::max(h[j], hs[j] * factor) : hs[j] * factor;
+
+        if (x[nd_*m+j] >= t_end[j]) {
+          for (int k = 0; k < nc; k ++)
+            v[k*m+j] = K(0)[k*m+j];
+          continue; // done
+        }
+      } else {
+        h[j] = hs[j] * std::min(factor, 0.9);
+        if (h[j] < hmin) continue; // stuck, e.g., at the domain boundary
+      }
+      ids[nb ++] = j;
+    }
+    ids.resize(nb);
+  }
+
+  for (int j = 0; j < m; j ++)
+    push_point(*trajs[j], m, j, x.data(), v.data());
+}
+
 } // namespace ftk
 
 #endif
@@ -23,6 +23,10 @@ struct particle_tracer_regular : public particle_tracer, public regular_tracker
 
 protected:
   virtual bool eval_v(int t, const double *x, double *v, int *hint);
+  virtual void eval_v_batch(int t, int n, const double *x, double *v, bool *succ, int *hints);
+
+  template <int ns> 
+  static void mlerp_batch(const ndarray<double>& V, int n, const double *x, double *v, bool *succ);
 };
 
 ////
@@ -49,12 +53,79 @@ inline void particle_tracer_regular::initialize_particles_at_grid_points(std::ve
   fprintf(stderr, "#trajectories=%zu\n", trajectories.size());
 }
   
-bool particle_tracer_regular::eval_v(
+inline bool particle_tracer_regular::eval_v(
     int t, const double *x, double *v, int *hint)
 {
   return V[t]->mlerp(x, v);
 }
 
+inline void particle_tracer_regular::eval_v_batch(
+    int t, int n, const double *x, double *v, bool *succ, int *hints)
+{
+  const ndarray<double> &Vt = *V[t];
+  const int ns = Vt.nd() - 1;
+  if (Vt.multicomponents() != 1 || ns != nd() || Vt.dim(0) > nch())
+    return particle_tracer::eval_v_batch(t, n, x, v, succ, hints);
+
+  if (ns == 2) mlerp_batch<2>(Vt, n, x, v, succ);
+  else if (ns == 3) mlerp_batch<3>(Vt, n, x, v, succ);
+  else particle_tracer::eval_v_batch(t, n, x, v, succ, hints);
+}
+
+template <int ns>
+inline void particle_tracer_regular::mlerp_batch(
+    const ndarray<double>& V, int n, const double *x, double *v, bool *succ)
+{
+  // same as ndarray::mlerp, but the loop over particles is innermost so
+  // that it can be vectorized; out-of-bound particles are interpolated at
+  // the origin and flagged as failed
+  const int nc = V.dim(0);
+  size_t stride[ns];
+  stride[0] = nc;
+  for (int i = 1; i < ns; i ++)
+    stride[i] = stride[i-1] * V.dim(i);
+
+  std::vector<size_t> base(n);
+  std::vector<double> mu(ns * n);
+  for (int j = 0; j < n; j ++) {
+    bool inside = true;
+    size_t b = 0;
+    for (int i = 0; i < ns; i ++) {
+      const double xi = x[i*n+j];
+      if (!(xi >= 0 && xi < V.dim(i+1) - 1)) { inside = false; break; }
+      const double x0 = std::floor(xi);
+      mu[i*n+j] = xi - x0;
+      b += size_t(x0) * stride[i];
+    }
+    succ[j] = inside;
+    base[j] = inside ? b : 0;
+    if (!inside)
+      for (int i = 0; i < ns; i ++)
+        mu[i*n+j] = 0;
+  }
+
+  for (int k = 0; k < nc; k ++)
+    for (int j = 0; j < n; j ++)
+      v[k*n+j] = 0;
+
+  const double *p = V.data();
+  for (int corner = 0; corner < (1 << ns); corner ++) {
+    size_t offset = 0;
+    for (int i = 0; i < ns; i ++)
+      if ((corner >> i) & 1) offset += stride[i];
+
+    for (int j = 0; j < n; j ++) {
+      double coef = 1;
+      for (int i = 0; i < ns; i ++)
+        coef *= ((corner >> i) & 1) ? mu[i*n+j] : (1.0 - mu[i*n+j]);
+
+      const double *q = p + base[j] + offset;
+      for (int k = 0; k < nc; k ++)
+        v[k*n+j] += coef * q[k];
+    }
+  }
+}
+
 }
 
 #endif
@@ -3,6 +3,7 @@
 
 #include <ftk/config.hh>
 #include <ftk/mesh/lattice_partitioner.hh>
+#include <ftk/mesh/simplicial_regular_mesh.hh>
 #include <ftk/filters/tracker.hh>
 #include <ftk/external/diy/master.hpp>
 #include <ftk/external/diy/decomposition.hpp>
@@ -30,6 +31,8 @@ public:
   void initialize();
 
   lattice get_local_array_domain() const { return local_array_domain; }
+
+  std::set<int> get_neighbor_ranks() const; // ranks whose cores touch the local core
   
 public: // physics coordinates
   // void set_coordinates(const ndarray<double>& coords_) {coords = coords_; use_explicit_coords = true;}
@@ -64,16 +67,24 @@ protected:
   lattice domain, array_domain, 
           local_domain, local_array_domain;
 
+  std::vector<lattice> partition_cores; // cores of all ranks w/ the default partition
+
   bool use_explicit_coords = false;
   ndarray<double> coords; // legacy
 
 protected: // internal use
   template <typename I=int> void simplex_indices(const std::vector<std::vector<int>>& vertices, I indices[]) const;
+  template <int ND, typename I=int> void simplex_indices(int n, const int vertices[][ND], I indices[]) const;
 
   void element_for_ordinal(int k, std::function<void(element_t)> f) { element_for(true, k, f); }
   void element_for_interval(int k, std::function<void(element_t)> f) { element_for(false, k, f); }
   void element_for(bool ordinal, int k, std::function<void(element_t)> f);
 
+  // allocation-free variants; ND is the dimensionality of the spacetime mesh
+  template <int ND> void element_for_ordinal_fixed(int k, std::function<void(const simplicial_regular_mesh_element_fixed<ND>&)> f) { element_for_fixed<ND>(true, k, f); }
+  template <int ND> void element_for_interval_fixed(int k, std::function<void(const simplicial_regular_mesh_element_fixed<ND>&)> f) { element_for_fixed<ND>(false, k, f); }
+  template <int ND> void element_for_fixed(bool ordinal, int k, std::function<void(const simplicial_regular_mesh_element_fixed<ND>&)> f);
+
   bool locate_spatial_quad(const double *x, int *corner, double *quad_coords) const;
 };
 
@@ -137,6 +148,10 @@ inline void regular_tracker::initialize()
     // partitioner.partition(comm.size(), {}, ghost);
     partitioner.partition(comm.size()); 
 
+    partition_cores.clear();
+    for (int i = 0; i < comm.size(); i ++)
+      partition_cores.push_back(partitioner.get_core(i));
+
     local_domain = partitioner.get_core(comm.rank());
     // local_domain = partitioner.get_ext(comm.rank());
     local_array_domain = partitioner_array.add_ghost(local_domain, ghost, ghost);
@@ -185,6 +200,26 @@ inline void regular_tracker::initialize()
 #endif
 }
 
+inline std::set<int> regular_tracker::get_neighbor_ranks() const
+{
+  if (partition_cores.size() != comm.size())
+    return tracker::get_neighbor_ranks();
+
+  // cores that overlap with the local core grown by one in every direction
+  const lattice &l = partition_cores[comm.rank()];
+  std::set<int> ranks;
+  for (int r = 0; r < comm.size(); r ++) {
+    if (r == comm.rank()) continue;
+    const lattice &c = partition_cores[r];
+    bool adjacent = true;
+    for (int i = 0; i < l.nd(); i ++)
+      if (c.lower_bound(i) > l.upper_bound(i) + 1 || l.lower_bound(i) > c.upper_bound(i) + 1)
+        adjacent = false;
+    if (adjacent) ranks.insert(r);
+  }
+  return ranks;
+}
+
 template <typename I>
 inline void regular_tracker::simplex_indices(
     const std::vector<std::vector<int>>& vertices, I indices[]) const
@@ -193,6 +228,14 @@ inline void regular_tracker::simplex_indices(
     indices[i] = m.get_lattice().to_integer(vertices[i]);
 }
 
+template <int ND, typename I>
+inline void regular_tracker::simplex_indices(
+    int n, const int vertices[][ND], I indices[]) const
+{
+  for (int i = 0; i < n; i ++)
+    indices[i] = m.get_lattice().to_integer(vertices[i]);
+}
+
 inline void regular_tracker::element_for(bool ordinal, int k, std::function<void(element_t)> f) 
 {
   auto st = local_domain.starts(), sz = local_domain.sizes();
@@ -207,7 +250,21 @@ inline void regular_tracker::element_for(bool ordinal, int k, std::function<void
 
   m.element_for(k, local_spacetime_domain, 
       ordinal ? ELEMENT_SCOPE_ORDINAL : ELEMENT_SCOPE_INTERVAL, 
-      f, xl, nthreads, enable_set_affinity);
+      f, thread_backend, nthreads, enable_set_affinity);
+}
+
+template <int ND>
+inline void regular_tracker::element_for_fixed(bool ordinal, int k, std::function<void(const simplicial_regular_mesh_element_fixed<ND>&)> f) 
+{
+  auto st = local_domain.starts(), sz = local_domain.sizes();
+  st.push_back(current_timestep);
+  sz.push_back(1);
+
+  lattice local_spacetime_domain(st, sz);
+
+  m.element_for_fixed<ND>(k, local_spacetime_domain, 
+      ordinal ? ELEMENT_SCOPE_ORDINAL : ELEMENT_SCOPE_INTERVAL, 
+      f, thread_backend, nthreads, enable_set_affinity);
 }
 
 #if FTK_HAVE_VTK
@@ -0,0 +1,125 @@
+#ifndef _FTK_SURFACE_SLAB_STITCHER_HH
+#define _FTK_SURFACE_SLAB_STITCHER_HH
+
+#include <ftk/config.hh>
+#include <ftk/features/feature_surface.hh>
+#include <ftk/mesh/pentachoron_assembly.hh>
+#include <ftk/basic/simple_union_find.hh>
+#include <ftk/utils/gather.hh>
+#include <unordered_map>
+
+namespace ftk {
+
+// Builds a spacetime surface slab by slab, each slab being the surface
+// between timesteps t and t+1.  The intersections of a slab are those on
+// ordinal 2-simplices at t and t+1 and on interval 2-simplices in [t, t+1].
+// Points at t+1 are shared with the next slab; the stitcher only keeps a
+// map from their element ids to surface ids, so that a surface keeps its
+// id across slabs.  Surfaces that merge in a slab take the smallest id;
+// slabs that were already built are not relabeled.
+struct surface_slab_stitcher {
+  template <typename Map> // std::map<element, feature_point_t>
+  feature_surface_t build(const simplicial_regular_mesh& m, int t, const Map& intersections,
+      int thread_backend = FTK_THREAD_PTHREAD,
+      int nthreads = std::thread::hardware_concurrency(),
+      bool affinity = false);
+
+  // moves the intersections of slab t out of the (distributed) map of a 
+  // tracker, keeping those at t+1 for the next slab, and builds the slab on 
+  // the root proc, where the callback is invoked
+  template <typename Map>
+  void stream(const diy::mpi::communicator& comm, int root, 
+      const simplicial_regular_mesh& m, int t, Map& intersections,
+      std::function<void(int, const feature_surface_t&)> callback,
+      int thread_backend = FTK_THREAD_PTHREAD,
+      int nthreads = std::thread::hardware_concurrency(),
+      bool affinity = false);
+
+  void clear() { boundary.clear(); next_id = 0; }
+
+protected:
+  std::unordered_map<uint64_t, int> boundary; // element id of points at t+1 --> surface id
+  int next_id = 0;
+};
+
+/////
+template <typename Map>
+void surface_slab_stitcher::stream(const diy::mpi::communicator& comm, int root, 
+    const simplicial_regular_mesh& m, int t, Map& intersections,
+    std::function<void(int, const feature_surface_t&)> callback,
+    int thread_backend, int nthreads, bool affinity)
+{
+  Map slab;
+  for (auto it = intersections.begin(); it != intersections.end(); ) {
+    const auto &p = it->second;
+    if (p.timestep == t) {
+      slab.insert(*it);
+      it = intersections.erase(it);
+    } else {
+      if (p.timestep == t+1 && p.ordinal)
+        slab.insert(*it);
+      ++ it;
+    }
+  }
+  diy::mpi::gather(comm, slab, slab, root);
+
+  if (comm.rank() == root) {
+    const auto surf = build(m, t, slab, thread_backend, nthreads, affinity);
+    fprintf(stderr, "surface slab t=%d, #pts=%zu, #tri=%zu\n", t, surf.pts.size(), surf.tris.size());
+    if (callback)
+      callback(t, surf);
+  }
+}
+
+template <typename Map>
+feature_surface_t surface_slab_stitcher::build(const simplicial_regular_mesh& m, int t,
+    const Map& intersections, int thread_backend, int nthreads, bool affinity)
+{
+  feature_surface_t surf;
+  std::vector<uint64_t> tags;
+  for (const auto &kv : intersections) {
+    const auto &p = kv.second;
+    if ((p.ordinal && (p.timestep == t || p.timestep == t+1)) || (!p.ordinal && p.timestep == t)) {
+      surf.pts.push_back(p);
+      tags.push_back(kv.first.to_integer(m));
+    }
+  }
+
+  pentachoron_assembly assembly(m, 2);
+  assembly.set_time_slab(t);
+  surf.tris = assembly.assemble<3>(tags, thread_backend, nthreads, affinity);
+
+  const int n = surf.pts.size();
+  simple_union_find<int> uf(n);
+  for (const auto &tri : surf.tris) {
+    uf.unite(tri[0], tri[1]);
+    uf.unite(tri[0], tri[2]);
+  }
+
+  // ids carried over from the previous slab
+  std::vector<int> ids(n, -1);
+  for (int i = 0; i < n; i ++) {
+    if (!surf.pts[i].ordinal || surf.pts[i].timestep != t) continue;
+    const auto it = boundary.find(tags[i]);
+    if (it != boundary.end()) {
+      int &id = ids[uf.find(i)];
+      id = id < 0 ? it->second : std::min(id, it->second);
+    }
+  }
+
+  boundary.clear();
+  for (int i = 0; i < n; i ++) {
+    int &id = ids[uf.find(i)];
+    if (id < 0) id = next_id ++;
+    surf.pts[i].id = id;
+
+    if (surf.pts[i].ordinal && surf.pts[i].timestep == t+1)
+      boundary[tags[i]] = id;
+  }
+
+  return surf;
+}
+
+}
+
+#endif
@@ -10,6 +10,8 @@
 #include <ftk/geometry/write_polydata.hh>
 #include <ftk/ndarray/writer.hh>
 #include <ftk/numeric/fmod.hh>
+#include <ftk/mesh/pentachoron_assembly.hh>
+#include <ftk/filters/surface_slab_stitcher.hh>
 
 extern std::vector<ftk::feature_point_lite_t> 
 extract_tdgl_vortex_3dt_cuda(
@@ -40,6 +42,12 @@ struct tdgl_vortex_tracker_3d_regular : public virtual tdgl_vortex_tracker, publ
 public:
   void build_vortex_surfaces();
 
+  // build the surface between timesteps t and t+1 as soon as t+1 is
+  // processed and pass it to the callback on the root proc, instead of
+  // keeping all intersections until finalize()
+  void set_enable_streaming_surfaces(bool b) { enable_streaming_surfaces = b; }
+  void set_surface_slab_callback(std::function<void(int/*t*/, const feature_surface_t&)> f) { surface_slab_callback = f; }
+
   void read_surfaces(const std::string& filename, std::string format="auto");
 
   void write_intersections(const std::string& filename) const;
@@ -51,17 +59,21 @@ public:
 
 protected:
   typedef simplicial_regular_mesh_element element_t;
+  typedef simplicial_regular_mesh_element_fixed<4> fixed_element_t;
   
   std::map<element_t, feature_point_t> intersections;
-  std::set<element_t> related_cells;
 
   feature_surface_t surfaces;
 
+  bool enable_streaming_surfaces = false;
+  std::function<void(int, const feature_surface_t&)> surface_slab_callback;
+  surface_slab_stitcher stitcher;
+
 protected:
-  bool check_simplex(const element_t& s, feature_point_t& cp);
+  bool check_simplex(const fixed_element_t& s, feature_point_t& cp);
   
   void simplex_values(
-      const std::vector<std::vector<int>>& vertices,
+      const int vertices[3][4],
       float X[][4],
       float A[][3], 
       float rho[], float phi[],
@@ -84,12 +96,13 @@ inline void tdgl_vortex_tracker_3d_regular::finalize()
   if (comm.rank() == get_root_proc())
     fprintf(stderr, "max_accumulated_kernel_time=%f\n", accumulated_kernel_time);
   
+  if (enable_streaming_surfaces) // slabs are already built in update_timestep()
+    return;
+
   diy::mpi::gather(comm, intersections, intersections, get_root_proc());
-  diy::mpi::gather(comm, related_cells, related_cells, get_root_proc());
   
   if (comm.rank() == get_root_proc()) {
-    fprintf(stderr, "#intersecttions=%zu, #related_cells=%zu\n", 
-        intersections.size(), related_cells.size());
+    fprintf(stderr, "#intersecttions=%zu\n", intersections.size());
     build_vortex_surfaces();
   }
 }
@@ -98,56 +111,18 @@ inline void tdgl_vortex_tracker_3d_regular::build_vortex_surfaces()
 {
   fprintf(stderr, "building vortex surfaces...\n");
 
+  std::vector<uint64_t> tags;
   int i = 0;
   for (auto &kv : intersections) {
     kv.second.id = i ++;
     surfaces.pts.push_back(kv.second);
+    tags.push_back(kv.first.to_integer(m));
   }
 
-  std::mutex my_mutex;
-  auto add_tri = [&](int i0, int i1, int i2) {
-    std::lock_guard<std::mutex> guard(my_mutex);
-    surfaces.tris.push_back({i0, i1, i2});
-  };
-
-  parallel_for<element_t>(related_cells, [&](const element_t &e) {
-    int count = 0;
-    int ids[6];
-
-    std::set<element_t> unique_tris;
-    for (auto tet : e.sides(m))
-      for (auto tri : tet.sides(m))
-        unique_tris.insert(tri);
-
-    for (auto tri : unique_tris)
-      if (intersections.find(tri) != intersections.end())
-        ids[count ++] = intersections[tri].id;
-
-    if (count == 3) {
-      add_tri(ids[0], ids[1], ids[2]);
-    } else if (count == 4) {
-      // std::lock_guard<std::mutex> guard(my_mutex);
-      // surfaces.quads.push_back({ids[0], ids[1], ids[2], ids[3]});
-      add_tri(ids[0], ids[1], ids[2]);
-      add_tri(ids[0], ids[1], ids[3]);
-      add_tri(ids[0], ids[2], ids[3]);
-      add_tri(ids[1], ids[2], ids[3]);
-    } else if (count == 5) {
-      // std::lock_guard<std::mutex> guard(my_mutex);
-      // surfaces.pentagons.push_back({ids[0], ids[1], ids[2], ids[3], ids[4]});
-      add_tri(ids[0], ids[1], ids[2]);
-      add_tri(ids[0], ids[1], ids[3]);
-      add_tri(ids[0], ids[1], ids[4]);
-      add_tri(ids[0], ids[2], ids[3]);
-      add_tri(ids[0], ids[2], ids[4]);
-      add_tri(ids[0], ids[3], ids[4]);
-      add_tri(ids[1], ids[2], ids[3]);
-      add_tri(ids[1], ids[2], ids[4]);
-      add_tri(ids[2], ids[3], ids[4]);
-    } else {
-      fprintf(stderr, "irregular count=%d\n", count); // WIP: triangulation
-    }
-  }, FTK_THREAD_PTHREAD, nthreads, enable_set_affinity);
+  pentachoron_assembly assembly(m, 2);
+  surfaces.tris = assembly.assemble<3>(tags, thread_backend, nthreads, enable_set_affinity);
+  if (assembly.n_irregular() && comm.rank() == get_root_proc())
+    fprintf(stderr, "#irregular_pentachora=%zu\n", assembly.n_irregular());
 
   surfaces.relabel();
   fprintf(stderr, "#pts=%zu, #tri=%zu\n", surfaces.pts.size(), surfaces.tris.size());
@@ -159,15 +134,17 @@ inline void tdgl_vortex_tracker_3d_regular::reset()
 
   field_data_snapshots.clear();
   intersections.clear();
+  stitcher.clear();
 
   tdgl_vortex_tracker::reset();
 }
 
 inline bool tdgl_vortex_tracker_3d_regular::check_simplex(
-    const element_t& e, feature_point_t& p)
+    const fixed_element_t& e, feature_point_t& p)
 {
   if (!e.valid(m)) return false; // check if the 2-simplex is valid
-  const auto &vertices = e.vertices(m); // obtain the vertices of the simplex
+  int vertices[3][4]; // obtain the vertices of the simplex
+  e.vertices(m, vertices);
 
   float X[3][4], // coordinates
         A[3][3]; // averaged magnetic potential
@@ -230,32 +207,12 @@ inline void tdgl_vortex_tracker_3d_regular::update_timestep()
   typedef std::chrono::high_resolution_clock clock_type;
   auto t0 = clock_type::now();
 
-  auto get_relatetd_cels = [&](element_t e) {
-    std::set<element_t> my_related_cells;
-    
-    auto tets = e.side_of(m);
-    for (auto tet : tets) {
-      if (tet.valid(m)) {
-        auto pents = tet.side_of(m);
-        for (auto pent : pents)
-          if (pent.valid(m))
-            my_related_cells.insert(pent);
-      }
-    }
-
-    return my_related_cells;
-  };
-
-  auto func = [=](element_t e) {
+  auto func = [=](const fixed_element_t& fe) {
     feature_point_t p;
-    if (check_simplex(e, p)) {
-      std::set<element_t> my_related_cells = get_relatetd_cels(e);
-
-      {
-        std::lock_guard<std::mutex> guard(mutex);
-        intersections[e] = p;
-        related_cells.insert(my_related_cells.begin(), my_related_cells.end());
-      }
+    if (check_simplex(fe, p)) {
+      const element_t e(fe);
+      std::lock_guard<std::mutex> guard(mutex);
+      intersections[e] = p;
     }
   };
 
@@ -327,8 +284,6 @@ inline void tdgl_vortex_tracker_3d_regular::update_timestep()
       cp.timestep = current_timestep;
 
       intersections[e] = cp;
-      std::set<element_t> my_related_cells = get_relatetd_cels(e);
-      related_cells.insert(my_related_cells.begin(), my_related_cells.end());
     }
 
     if (field_data_snapshots.size() >= 2) { // interval
@@ -357,8 +312,6 @@ inline void tdgl_vortex_tracker_3d_regular::update_timestep()
         cp.timestep = current_timestep;
       
         intersections[e] = cp;
-        std::set<element_t> my_related_cells = get_relatetd_cels(e);
-        related_cells.insert(my_related_cells.begin(), my_related_cells.end());
       }
     }
 
@@ -366,30 +319,35 @@ inline void tdgl_vortex_tracker_3d_regular::update_timestep()
     fatal("FTK not compiled with CUDA.");
 #endif
   } else {
-    element_for_ordinal(2, func);
+    element_for_ordinal_fixed<4>(2, func);
     if (field_data_snapshots.size() >= 2) 
-      element_for_interval(2, func);
+      element_for_interval_fixed<4>(2, func);
   }
   
   auto t1 = clock_type::now();
   accumulated_kernel_time += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() * 1e-9;
+
+  if (enable_streaming_surfaces && current_timestep > start_timestep)
+    stitcher.stream(comm, get_root_proc(), m, current_timestep - 1, intersections, 
+        surface_slab_callback, thread_backend, nthreads, enable_set_affinity);
 }
   
 inline void tdgl_vortex_tracker_3d_regular::simplex_values(
-      const std::vector<std::vector<int>>& vertices,
+      const int vertices[3][4],
       float X[][4],
       float A[][3],
       float rho[], float phi[],
       float re[], float im[])
 {
-  for (int i = 0; i < vertices.size(); i ++) {
+  for (int i = 0; i < 3; i ++) {
     const int iv = vertices[i][3] == current_timestep ? 0 : 1;
     const auto &f = field_data_snapshots[iv];
 
-    const auto idx = f.rho.index(std::vector<size_t>({
+    const size_t local_idx[3] = {
           vertices[i][0] - local_array_domain.start(0), 
           vertices[i][1] - local_array_domain.start(1), 
-          vertices[i][2] - local_array_domain.start(2)}));
+          vertices[i][2] - local_array_domain.start(2)};
+    const auto idx = f.rho.index(local_idx);
     rho[i] = f.rho[idx];
     phi[i] = f.phi[idx];
     re[i] = f.re[idx];
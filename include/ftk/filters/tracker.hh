@@ -45,6 +45,9 @@ struct tracker : public filter
 
   static int str2tracker(const std::string&);
 
+  // ranks that may hold features adjacent to the local ones; all other ranks by default
+  virtual std::set<int> get_neighbor_ranks() const;
+
 public:
   virtual void initialize() = 0;
   virtual void finalize() = 0;
@@ -86,6 +89,14 @@ protected: // benchmark
 };
 
 ////////
+inline std::set<int> tracker::get_neighbor_ranks() const
+{
+  std::set<int> ranks;
+  for (int i = 0; i < comm.size(); i ++)
+    if (i != comm.rank()) ranks.insert(i);
+  return ranks;
+}
+
 inline int tracker::str2tracker(const std::string& s) 
 {
   if (s == "cp" || s == "critical_point") 
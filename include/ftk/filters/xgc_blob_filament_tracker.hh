@@ -659,7 +659,7 @@ inline void xgc_blob_filament_tracker::build_critical_line()
         line.edges.push_back(std::array<int, 2>({ids[0], ids[1]}));
       }
       else fprintf(stderr, "irregular count=%d\n", count);
-    }, FTK_THREAD_PTHREAD, nthreads, true);
+    }, thread_backend, nthreads, true);
 
   line.relabel();
   feature_curve_set_t curves = line.to_curve_set();
@@ -698,7 +698,7 @@ inline void xgc_blob_filament_tracker::build_critical_surfaces()
 #else // for all related 4-simplicies
   parallel_for<int>(related_cells, [=](const int e) {
     check_penta(e);
-  }, FTK_XL_NONE, nthreads, true);
+  }, thread_backend, nthreads, true);
 #endif
 
   surfaces.relabel();
@@ -6,6 +6,10 @@
 #include <ftk/filters/xgc_tracker.hh>
 #include <ftk/tracking_graph/tracking_graph.hh>
 #include <ftk/basic/duf.hh>
+#include <ftk/mesh/simplex_csr.hh>
+#include <functional>
+#include <limits>
+#include <ostream>
 
 #if FTK_HAVE_VTK
 #include <vtkThreshold.h>
@@ -13,6 +17,29 @@
 
 namespace ftk {
 
+// per-timestep attributes of a blob, i.e. a connected set of vertices
+// above the threshold on the 3D (multi-plane) mesh
+struct xgc_blob_t {
+  int id = -1; // consistent across timesteps
+  int timestep = 0;
+  size_t nverts = 0;
+  double area = 0.0; // dual areas of the vertices, summed over planes
+  double centroid[2] = {0.0, 0.0}; // area-weighted (r, z)
+  double peak = -std::numeric_limits<double>::max();
+  int peak_vertex = -1;
+  double psin_min = std::numeric_limits<double>::max(), 
+         psin_max = -std::numeric_limits<double>::max();
+};
+
+// Labels the vertices above the threshold timestep by timestep.  Each
+// timestep is labeled in a dense array with the lock-free (dense) duf, and
+// only the labels of the current and the previous timesteps are kept.
+// Blobs are relabeled across time by vertex overlap: the pairs of the
+// previous and current blobs are visited in decreasing overlap, and a
+// current blob inherits the id of a previous blob if neither has been
+// matched yet; other blobs get new ids.  The overlaps are kept as the
+// edges of the tracking graph, and the attributes of the blobs are
+// handed to the blob callback as soon as a timestep is labeled.
 struct xgc_blob_threshold_tracker : public xgc_tracker {
   xgc_blob_threshold_tracker(diy::mpi::communicator comm, 
       std::shared_ptr<simplicial_xgc_3d_mesh<>> m3) : xgc_tracker(comm, m3) {}
@@ -22,7 +49,7 @@ struct xgc_blob_threshold_tracker : public xgc_tracker {
 
   // int cpdims() const { return 0; }
   
-  void initialize() {}
+  void initialize();
   void update() {}
   void finalize();
 
@@ -30,8 +57,10 @@ struct xgc_blob_threshold_tracker : public xgc_tracker {
 
   void push_field_data_snapshot(const ndarray<double> &scalar);
 
+  void set_blob_callback(std::function<void(int/*t*/, const std::vector<xgc_blob_t>&)> f) { blob_callback = f; }
+
 public:
-  ndarray<int> get_sliced(int t) const;
+  ndarray<int> get_sliced(int t) const; // blob ids of vertices (-1 if below threshold); only the last two timesteps are available
   void write_sliced(int t, const std::string& pattern) const;
 #if FTK_HAVE_VTK
   vtkSmartPointer<vtkUnstructuredGrid> sliced_to_vtu_slices(int t) const;
@@ -39,13 +68,66 @@ public:
   // vtkSmartPointer<vtkUnstructuredGrid> sliced_to_vtu_partial_solid(int t) const;
 #endif
 
+  const std::vector<xgc_blob_t>& get_blobs() const { return blobs; } // blobs of the last labeled timestep
+  const tracking_graph<int, int, int>& get_tracking_graph() const { return graph; }
+  void write_blobs_text(std::ostream& os, bool header = false) const; // one line per blob of the last labeled timestep
+  void write_tracking_graph_dot(const std::string& filename) const { graph.generate_dot_file(filename); }
+
 protected:
   double threshold = 0.0;
-  duf<int> uf;
+
+  // vertex-vertex adjacency of the 3D mesh and per-vertex attributes of 
+  // the 2D mesh, built in initialize()
+  csr_adjacency<int> vertex_neighbors;
+  std::vector<double> vertex_areas, vertex_psin;
+
+  int labeled_timestep = -1;
+  ndarray<int> labels, labels_prev; // blob ids of the last two timesteps
+  std::vector<xgc_blob_t> blobs;
+  int next_id = 0;
+
+  tracking_graph<int, int, int> graph; // nodes are (timestep, blob id)
+  std::function<void(int, const std::vector<xgc_blob_t>&)> blob_callback;
 };
 
 /////
 
+inline void xgc_blob_threshold_tracker::initialize()
+{
+  const int m2n0 = m2->n(0), m3n0 = m3->n(0);
+
+  // dual areas: one third of the area of each incident triangle
+  vertex_areas.assign(m2n0, 0.0);
+  for (size_t t = 0; t < m2->n(2); t ++) {
+    int tri[3];
+    double x[3][2];
+    m2->get_triangle(t, tri);
+    for (int k = 0; k < 3; k ++)
+      m2->get_coords(tri[k], x[k]);
+    
+    const double a = std::abs((x[1][0] - x[0][0]) * (x[2][1] - x[0][1]) - (x[2][0] - x[0][0]) * (x[1][1] - x[0][1])) / 6.0;
+    for (int k = 0; k < 3; k ++)
+      vertex_areas[tri[k]] += a;
+  }
+
+  const bool has_psi = m2->get_psifield().size() == size_t(m2n0);
+  vertex_psin.resize(m2n0);
+  for (int i = 0; i < m2n0; i ++)
+    vertex_psin[i] = has_psi ? m2->psin(i) : std::nan("");
+
+  // adjacency from the edges of the 3D mesh
+  std::vector<int> rows, cols;
+  rows.reserve(m3->n(1) * 2);
+  cols.reserve(m3->n(1) * 2);
+  for (size_t e = 0; e < m3->n(1); e ++) {
+    int v[2];
+    m3->get_simplex(1, e, v);
+    rows.push_back(v[0]); cols.push_back(v[1]);
+    rows.push_back(v[1]); cols.push_back(v[0]);
+  }
+  vertex_neighbors.build(m3n0, rows, cols);
+}
+
 inline void xgc_blob_threshold_tracker::push_field_data_snapshot(const ndarray<double> &scalar)
 {
   ndarray<double> grad, J; // no grad or jacobian needed
@@ -62,41 +144,117 @@ inline void xgc_blob_threshold_tracker::push_field_data_snapshot(const ndarray<d
 inline void xgc_blob_threshold_tracker::update_timestep()
 {
   if (comm.rank() == 0) fprintf(stderr, "current_timestep=%d\n", current_timestep);
+  if (vertex_neighbors.size() == 0) initialize();
 
-  const int m3n0 = m3->n(0);
-  const auto &scalar = field_data_snapshots[0].scalar;
-  // for (int i = 0; i < m3n0; i ++) {
+  const int m2n0 = m2->n(0), m3n0 = m3->n(0);
+  const ndarray<double> values = m3->interpolate(field_data_snapshots[0].scalar); // all planes incl. virtual ones, in one pass
+  if (values.size() != size_t(m3n0)) 
+    fatal("xgc_blob_threshold_tracker: the number of vertices does not match the mesh; iphi>1 is not supported");
+
+  // connected components in the current timestep
+  duf<int> uf(comm, m3n0);
   parallel_for(m3n0, [&](int i) {
-    if (m3->interpolate(scalar, i) < threshold) return; // continue;
-    const int ei = i + current_timestep * m3n0;
-    // for (const auto j : m3->get_vertex_edge_vertex_nextnodes(i)) {
-    for (const auto j : m3->get_vertex_edge_vertex(i)) {
-      if (m3->interpolate(scalar, j) >= threshold) {
-        const int ej = j + current_timestep * m3n0;
-        uf.unite(ei, ej);
-      }
-    }
+    if (values[i] < threshold) return;
+    for (const int *j = vertex_neighbors.begin(i); j != vertex_neighbors.end(i); j ++)
+      if (*j > i && values[*j] >= threshold)
+        uf.unite(i, *j);
   });
 
-  if (field_data_snapshots.size() >= 2) {
-    const auto &scalar1 = field_data_snapshots[1].scalar;
-    // for (int i = 0; i < m3n0; i ++) {
-    parallel_for(m3n0, [&](int i) {
-      // if (scalar[i] < threshold || scalar1[i] < threshold) continue;
-      if (m3->interpolate(scalar, i) < threshold || m3->interpolate(scalar1, i) < threshold) return; // continue;
-      else
-        uf.unite(i + current_timestep * m3n0, i + (current_timestep+1) * m3n0);
-    });
+  // local labels; the root of a set is its smallest element, so the root 
+  // of every vertex is labeled before the vertex
+  ndarray<int> current({(size_t)m3n0}, -1);
+  int nlocal = 0;
+  for (int i = 0; i < m3n0; i ++) {
+    if (values[i] < threshold) continue;
+    const int r = uf.find(i);
+    current[i] = r == i ? nlocal ++ : current[r];
   }
-  
-  fprintf(stderr, "%zu\n", uf.size());
+
+  // attributes
+  std::vector<xgc_blob_t> local_blobs(nlocal);
+  for (int i = 0; i < m3n0; i ++) {
+    if (current[i] < 0) continue;
+    xgc_blob_t &b = local_blobs[current[i]];
+    const int i2 = i % m2n0;
+    double rz[2];
+    m2->get_coords(i2, rz);
+
+    b.nverts ++;
+    b.area += vertex_areas[i2];
+    b.centroid[0] += vertex_areas[i2] * rz[0];
+    b.centroid[1] += vertex_areas[i2] * rz[1];
+    if (values[i] > b.peak) {
+      b.peak = values[i];
+      b.peak_vertex = i;
+    }
+    b.psin_min = std::min(b.psin_min, vertex_psin[i2]);
+    b.psin_max = std::max(b.psin_max, vertex_psin[i2]);
+  }
+
+  // overlaps with the previous timestep, (previous id, current local label) --> #vertices
+  std::map<std::pair<int, int>, size_t> overlaps;
+  if (labeled_timestep == current_timestep - 1 && labels.size() == size_t(m3n0))
+    for (int i = 0; i < m3n0; i ++)
+      if (labels[i] >= 0 && current[i] >= 0)
+        overlaps[std::make_pair(labels[i], current[i])] ++;
+
+  std::vector<std::pair<std::pair<int, int>, size_t>> pairs(overlaps.begin(), overlaps.end());
+  std::stable_sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+  std::vector<int> ids(nlocal, -1);
+  std::set<int> continued;
+  for (const auto &p : pairs) {
+    const int id0 = p.first.first, l1 = p.first.second;
+    if (ids[l1] < 0 && continued.find(id0) == continued.end()) {
+      ids[l1] = id0;
+      continued.insert(id0);
+    }
+  }
+  for (int l = 0; l < nlocal; l ++)
+    if (ids[l] < 0) ids[l] = next_id ++;
+
+  for (int i = 0; i < m3n0; i ++)
+    if (current[i] >= 0) current[i] = ids[current[i]];
+
+  blobs.resize(nlocal);
+  for (int l = 0; l < nlocal; l ++) {
+    xgc_blob_t &b = local_blobs[l];
+    b.id = ids[l];
+    b.timestep = current_timestep;
+    if (b.area > 0) {
+      b.centroid[0] /= b.area;
+      b.centroid[1] /= b.area;
+    }
+    graph.add_node(current_timestep, b.id);
+    blobs[l] = b;
+  }
+  for (const auto &p : pairs)
+    graph.add_edge(current_timestep - 1, p.first.first, current_timestep, ids[p.first.second]);
+
+  labels_prev.swap(labels);
+  labels.swap(current);
+  labeled_timestep = current_timestep;
+
+  if (blob_callback)
+    blob_callback(current_timestep, blobs);
 }
 
 inline void xgc_blob_threshold_tracker::finalize()
 {
+  graph.detect_events();
 }
 
-void xgc_blob_threshold_tracker::write_sliced(int t, const std::string& pattern) const
+inline void xgc_blob_threshold_tracker::write_blobs_text(std::ostream& os, bool header) const
+{
+  if (header)
+    os << "# timestep id nverts area centroid_r centroid_z peak peak_vertex psin_min psin_max" << std::endl;
+  for (const auto &b : blobs)
+    os << b.timestep << " " << b.id << " " << b.nverts << " " << b.area << " " 
+       << b.centroid[0] << " " << b.centroid[1] << " " << b.peak << " " << b.peak_vertex << " "
+       << b.psin_min << " " << b.psin_max << std::endl;
+}
+
+inline void xgc_blob_threshold_tracker::write_sliced(int t, const std::string& pattern) const
 {
   const std::string filename = series_filename(pattern, t);
 
@@ -111,34 +269,33 @@ void xgc_blob_threshold_tracker::write_sliced(int t, const std::string& pattern)
 #endif
 }
 
-ndarray<int> xgc_blob_threshold_tracker::get_sliced(int t) const
+inline ndarray<int> xgc_blob_threshold_tracker::get_sliced(int t) const
 {
-  ndarray<int> array({m3->n(0)}, -1);
-  for (int i = 0; i < m3->n(0); i ++) {
-    const int e = i + t * m3->n(0);
-    if (uf.has(e)) 
-      array[i] = uf.find(e);
+  if (t == labeled_timestep) return labels;
+  else if (t == labeled_timestep - 1 && labels_prev.size()) return labels_prev;
+  else {
+    fatal("xgc_blob_threshold_tracker: only the last two timesteps are kept");
+    return ndarray<int>();
   }
-  return array;
 }
 
 #if FTK_HAVE_VTK
-vtkSmartPointer<vtkUnstructuredGrid> xgc_blob_threshold_tracker::sliced_to_vtu_slices(int t) const
+inline vtkSmartPointer<vtkUnstructuredGrid> xgc_blob_threshold_tracker::sliced_to_vtu_slices(int t) const
 {
   auto grid = m3->to_vtu_slices();
   grid->GetPointData()->AddArray( get_sliced(t).to_vtk_data_array("id") );
   return grid;
 }
 
-vtkSmartPointer<vtkUnstructuredGrid> xgc_blob_threshold_tracker::sliced_to_vtu_solid(int t) const
+inline vtkSmartPointer<vtkUnstructuredGrid> xgc_blob_threshold_tracker::sliced_to_vtu_solid(int t) const
 {
+  const ndarray<int> sliced = get_sliced(t);
   vtkSmartPointer<vtkUnstructuredGrid> grid = vtkUnstructuredGrid::New();
   vtkSmartPointer<vtkPoints> points = vtkPoints::New();
 
   std::map<int, vtkIdType> idmap;
   for (int i = 0; i < m3->n(0); i ++) {
-    const int e = i + t * m3->n(0);
-    if (uf.has(e)) {
+    if (sliced[i] >= 0) {
       double coords[3];
       m3->get_coords(i, coords);
       vtkIdType id = points->InsertNextPoint(coords[0], coords[1], coords[2]);
@@ -0,0 +1,281 @@
+#ifndef _FTK_XGC_POINCARE_TRACER_HH
+#define _FTK_XGC_POINCARE_TRACER_HH
+
+#include <ftk/config.hh>
+#include <ftk/filters/filter.hh>
+#include <ftk/numeric/linear_interpolation.hh>
+#include <ftk/mesh/simplicial_xgc_2d_mesh.hh>
+#include <ftk/mesh/simplicial_xgc_3d_mesh.hh>
+
+namespace ftk {
+
+// Multithreaded CPU engine for XGC Poincare plots.  Field lines are
+// integrated over full toroidal revolutions with the same Butcher RK5
+// scheme and the same (static or static + delta) magnetic field as the
+// CUDA engine (xft_compute_poincare_plot), so that both produce identical
+// plot and psin arrays.  Seeds are processed in batches; each seed keeps
+// the triangle of its last evaluation as the hint for the next point
+// location.
+struct xgc_poincare_tracer : public filter {
+  xgc_poincare_tracer(diy::mpi::communicator comm,
+      std::shared_ptr<simplicial_xgc_3d_mesh<>> mx3);
+
+  void set_seeds(const std::vector<double>& seeds_) { seeds = seeds_; } // r/z pairs
+  void set_number_of_revolutions(int n) { nrevs = n; }
+  void set_use_static_b(bool b) { use_static_b = b; }
+  void set_direction(int d) { dir = d >= 0 ? 1 : -1; }
+  void set_batch_size(int n) { batch_size = std::max(1, n); }
+
+  void load_apars(const ndarray<double>& apars); // derive delta B on all (virtual) poloidal planes
+
+  void update();
+  void compute_poincare_plot();
+  void compute_poincare_psin();
+
+  // layouts are the same as the CUDA engine: plot[(k*nseeds+i)*2+{0,1}] and psin[k*nseeds+i]
+  // for the k-th revolution of the i-th seed; lost field lines are marked as 1e38
+  const std::vector<double>& get_plot() const { return plot; }
+  const std::vector<double>& get_psin() const { return psin; }
+  const std::vector<double>& get_apars_upsample() const { return apars_upsample; }
+
+protected:
+  bool eval(const double rz[2], int p, double v[2], int &hint) const;
+  bool integrate2pi(double rz[2], int &hint) const;
+
+protected:
+  std::shared_ptr<simplicial_xgc_3d_mesh<>> mx3;
+  std::shared_ptr<simplicial_xgc_2d_mesh<>> mx2;
+  int nphi, iphi, vphi, np;
+
+  std::vector<double> seeds;
+  int nrevs = 1;
+  bool use_static_b = true;
+  int dir = 1;
+  int batch_size = 32;
+
+  std::vector<double> apars_upsample; // m2n0 * np
+  std::vector<std::vector<double>> deltaB; // np planes of 3 * m2n0
+
+  std::vector<double> plot, psin;
+};
+
+/////
+inline xgc_poincare_tracer::xgc_poincare_tracer(
+    diy::mpi::communicator comm,
+    std::shared_ptr<simplicial_xgc_3d_mesh<>> mx3_) :
+  filter(comm),
+  mx3(mx3_),
+  mx2(mx3_->get_m2()),
+  nphi(mx3_->get_nphi()),
+  iphi(mx3_->get_iphi()),
+  vphi(mx3_->get_vphi()),
+  np(nphi * vphi)
+{
+  if (!mx2->get_locator())
+    mx2->initialize_point_locator();
+}
+
+inline void xgc_poincare_tracer::load_apars(const ndarray<double>& apars)
+{
+  const int m2n0 = mx2->n(0);
+  const int nip = np * iphi;
+  const double dphi = 2 * M_PI / nip;
+  const double *As = apars.data();
+
+  // upsample apars to virtual planes
+  apars_upsample.resize(size_t(m2n0) * np);
+  parallel_for(np, [&](int p) {
+    const int p0 = p / vphi, p1 = (p0 + 1) % nphi;
+    for (int i = 0; i < m2n0; i ++) {
+      double &f = apars_upsample[size_t(p) * m2n0 + i];
+      if (p % vphi == 0)
+        f = As[size_t(p0) * m2n0 + i];
+      else {
+        const auto &l = mx3->get_interpolant(p % vphi, i);
+        if (l.tri0[0] < 0 || l.tri1[0] < 0) {
+          f = std::nan("");
+          continue;
+        }
+        const double beta = double(p) / vphi - p0, alpha = 1.0 - beta;
+        f = 0;
+        for (int k = 0; k < 3; k ++)
+          f += alpha * l.mu0[k] * As[size_t(p0) * m2n0 + l.tri0[k]]
+             + beta * l.mu1[k] * As[size_t(p1) * m2n0 + l.tri1[k]];
+      }
+    }
+  }, thread_backend, nthreads, enable_set_affinity);
+
+  // delta B = curl(As * b0), plane by plane
+  const double *bfield0 = mx2->get_bfield0().data(),
+               *curl_bfield0 = mx2->get_curl_bfield0().data();
+
+  deltaB.resize(np);
+  parallel_for(np, [&](int p) {
+    ndarray<double> Asp(&apars_upsample[size_t(p) * m2n0], {size_t(m2n0)});
+    const ndarray<double> gradAs = mx2->scalar_gradient(Asp);
+    const double *A = &apars_upsample[0];
+
+    const int pnext = (p + 1) % np,
+              pprev = (p + np - 1) % np;
+
+    std::vector<double> &dB = deltaB[p];
+    dB.resize(3 * m2n0);
+    for (int i = 0; i < m2n0; i ++) {
+      const double dAsdphi = (A[size_t(pnext)*m2n0+i] - A[size_t(pprev)*m2n0+i]) / (dphi * 2); // central difference
+      const double a = A[size_t(p)*m2n0+i];
+      dB[i*3]   =  gradAs[i*2+1] * bfield0[i*3+2] - dAsdphi * bfield0[i*3+1] + a * curl_bfield0[i*3];
+      dB[i*3+1] = -gradAs[i*2] * bfield0[i*3+2] + dAsdphi * bfield0[i*3] + a * curl_bfield0[i*3+1];
+      dB[i*3+2] =  gradAs[i*2] * bfield0[i*3+1] - gradAs[i*2+1] * bfield0[i*3] + a * curl_bfield0[i*3+2];
+    }
+  }, thread_backend, nthreads, enable_set_affinity);
+}
+
+inline bool xgc_poincare_tracer::eval(const double rz[2], int p, double v[2], int &hint) const
+{
+  double mu[3];
+  const int tid = mx2->get_locator()->locate(rz, mu, hint);
+  if (tid < 0)
+    return false;
+  hint = tid;
+
+  const double *staticB = mx2->get_bfield().data();
+  const int *tris = mx2->get_triangles().data();
+  const double *dB = use_static_b ? NULL : deltaB[((p % np) + np) % np].data();
+
+  double B[3][3], b[3];
+  for (int i = 0; i < 3; i ++) {
+    const int k = tris[tid*3+i];
+    for (int j = 0; j < 3; j ++)
+      B[i][j] = use_static_b ? staticB[k*3+j] : (staticB[k*3+j] + dB[k*3+j]);
+  }
+
+  lerp_s2v3(B, mu, b);
+  v[0] = rz[0] * b[0] / b[2];
+  v[1] = rz[0] * b[1] / b[2];
+  return true;
+}
+
+inline bool xgc_poincare_tracer::integrate2pi(double rz[2], int &hint) const
+{
+  // butcher's rk5, four (virtual) planes per step; see poincare_integrate2pi_butcher_rk5
+  const int nip = np * iphi;
+  const double half_h = 2 * M_PI / nip * dir;
+  const double h = half_h * 2;
+
+  double v[2];
+  for (int ii = 0; ii < iphi; ii ++) {
+    for (int ip = 0; ip < np; ip += 4) {
+      const int p = dir == 1 ? ip : (np - ip);
+
+      if (!eval(rz, p, v, hint)) return false;
+      const double k1[2] = {v[0], v[1]};
+
+      const double rz2[2] = {rz[0] + h*k1[0]/4,
+                             rz[1] + h*k1[1]/4};
+      if (!eval(rz2, p+dir, v, hint)) return false; // 1/4 delta
+      const double k2[2] = {v[0], v[1]};
+
+      const double rz3[2] = {rz[0] + h*k1[0]/8 + h*k2[0]/8,
+                             rz[1] + h*k1[1]/8 + h*k2[1]/8};
+      if (!eval(rz3, p+dir, v, hint)) return false; // 1/4 delta
+      const double k3[2] = {v[0], v[1]};
+
+      const double rz4[2] = {rz[0] - h*k2[0]/2 + h*k3[0],
+                             rz[1] - h*k2[1]/2 + h*k3[1]};
+      if (!eval(rz4, p+2*dir, v, hint)) return false; // 1/2 delta
+      const double k4[2] = {v[0], v[1]};
+
+      const double rz5[2] = {rz[0] + h*k1[0]*3/16 + h*k4[0]*9/16,
+                             rz[1] + h*k1[1]*3/16 + h*k4[1]*9/16};
+      if (!eval(rz5, p+3*dir, v, hint)) return false; // 3/4 delta
+      const double k5[2] = {v[0], v[1]};
+
+      const double rz6[2] = {rz[0] - h*k1[0]*3/7 + h*k2[0]*2/7 + h*k3[0]*12/7 - h*k4[0]*12/7 + h*k5[0]*8/7,
+                             rz[1] - h*k1[1]*3/7 + h*k2[1]*2/7 + h*k3[1]*12/7 - h*k4[1]*12/7 + h*k5[1]*8/7};
+      if (!eval(rz6, p+4*dir, v, hint)) return false; // 1 delta
+      const double k6[2] = {v[0], v[1]};
+
+      for (int i = 0; i < 2; i ++)
+        rz[i] = rz[i] + h * (7*k1[i] + 32*k3[i] + 12*k4[i] + 32*k5[i] + 7*k6[i]) / 90;
+    }
+  }
+  return true;
+}
+
+inline void xgc_poincare_tracer::update()
+{
+  compute_poincare_plot();
+  compute_poincare_psin();
+}
+
+inline void xgc_poincare_tracer::compute_poincare_plot()
+{
+  if (!use_static_b && deltaB.empty())
+    fatal("apars not loaded for tracing with the perturbed magnetic field");
+
+  const int nseeds = seeds.size() / 2;
+  plot.assign(size_t(nseeds) * nrevs * 2, 1e38);
+  std::copy(seeds.begin(), seeds.begin() + nseeds * 2, plot.begin()); // the 0th revolution
+
+  const int nbatches = (nseeds + batch_size - 1) / batch_size;
+  parallel_for(nbatches, [&](int b) {
+    const int i0 = b * batch_size,
+              i1 = std::min(nseeds, i0 + batch_size);
+
+    std::vector<int> hints(i1 - i0, -1);
+    std::vector<bool> alive(i1 - i0, true);
+    for (int k = 1; k < nrevs; k ++) {
+      for (int i = i0; i < i1; i ++) {
+        if (!alive[i-i0]) continue;
+
+        const size_t offset = size_t(k-1) * nseeds + i,
+                     offset1 = size_t(k) * nseeds + i;
+        double rz[2] = {plot[offset*2], plot[offset*2+1]};
+        if (integrate2pi(rz, hints[i-i0])) {
+          plot[offset1*2] = rz[0];
+          plot[offset1*2+1] = rz[1];
+        } else
+          alive[i-i0] = false; // remaining revolutions stay 1e38
+      }
+    }
+  }, thread_backend, nthreads, enable_set_affinity);
+}
+
+inline void xgc_poincare_tracer::compute_poincare_psin()
+{
+  const size_t n = plot.size() / 2;
+  const ndarray<double> psinfield = mx2->get_psinfield();
+  const int *tris = mx2->get_triangles().data();
+
+  psin.resize(n);
+  const int nbatches = (n + batch_size - 1) / batch_size;
+  parallel_for(nbatches, [&](int b) {
+    std::vector<size_t> ids; // points of alive seeds in the batch
+    std::vector<double> rz;
+    for (size_t i = size_t(b) * batch_size; i < std::min(n, size_t(b + 1) * batch_size); i ++) {
+      psin[i] = 1e38;
+      if (plot[i*2] > 1e37) continue;
+      ids.push_back(i);
+      rz.push_back(plot[i*2]);
+      rz.push_back(plot[i*2+1]);
+    }
+
+    std::vector<int> tids(ids.size());
+    std::vector<double> mu(ids.size() * 3);
+    mx2->get_locator()->locate_batch(ids.size(), rz.data(), tids.data(), mu.data());
+
+    for (size_t k = 0; k < ids.size(); k ++) {
+      const int tid = tids[k];
+      if (tid >= 0) {
+        double psins[3];
+        for (int j = 0; j < 3; j ++)
+          psins[j] = psinfield[tris[tid*3+j]];
+        psin[ids[k]] = lerp_s2(psins, &mu[k*3]);
+      }
+    }
+  }, thread_backend, nthreads, enable_set_affinity);
+}
+
+}
+
+#endif
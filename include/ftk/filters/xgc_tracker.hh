@@ -130,33 +130,7 @@ inline void xgc_tracker::push_field_data_snapshot(
 #endif
 
   ndarray<double> F, G, J;
-
-  F.reshape(scalar);
-  G.reshape(2, scalar.dim(0), scalar.dim(1));
-  G.set_multicomponents(1);
-  J.reshape(2, 2, scalar.dim(0), scalar.dim(1));
-  J.set_multicomponents(2);
-  
-  for (size_t i = 0; i < m3->get_nphi(); i ++) {
-    ndarray<double> f, grad, j;
-    auto slice = scalar.slice_time(i);
-    m2->smooth_scalar_gradient_jacobian(slice, f, grad, j);
-    // f = m2->smooth_scalar(slice);
-    // m2->scalar_gradient_jacobian(slice, grad, j);
-    // m2->scalar_gradient_jacobian(f, grad, j);
-    // if (i == 0)
-    //   m2->array_to_vtu("nonsmooth-grad.vtu", "grad", grad);
-    // f = slice;
-    for (size_t k = 0; k < m2->n(0); k ++) {
-      F(k, i) = f(k);
-      G(0, k, i) = grad(0, k);
-      G(1, k, i) = grad(1, k);
-      J(0, 0, k, i) = j(0, 0, k);
-      J(1, 0, k, i) = j(1, 0, k);
-      J(1, 1, k, i) = j(1, 1, k);
-      J(0, 1, k, i) = j(0, 1, k);
-    }
-  }
+  m3->smooth_scalar_gradient_jacobian(scalar, F, G, J); // all planes in one pass
 
   push_field_data_snapshot(F, G, J);
 }
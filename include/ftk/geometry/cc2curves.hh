@@ -2,7 +2,9 @@
 #define _FTK_CC2CURVE_HH
 
 #include <ftk/algorithms/cca.hh>
+#include <ftk/mesh/simplex_csr.hh>
 #include <list>
+#include <deque>
 #include <set>
 
 namespace ftk {
@@ -110,6 +112,61 @@ std::vector<std::vector<NodeType>> connected_component_to_linear_components(
   return linear_components;
 }
 
+// Same as above for a graph in CSR whose rows are sorted and free of self
+// loops.  The nodes of the component are given in ascending order, and their
+// neighbors are all in the component.  visited is indexed by node and must be
+// zero for the nodes of the component; components may be processed
+// concurrently with the same visited array.
+template <typename I>
+std::vector<std::vector<I>> connected_component_to_linear_components(
+    const std::vector<I>& component,
+    const csr_adjacency<I>& adj,
+    std::vector<char>& visited)
+{
+  std::vector<std::vector<I>> linear_components;
+  auto ordinary = [&](I i) { return adj.degree(i) <= 2; };
+  auto next = [&](I i) {
+    for (const I *p = adj.begin(i); p != adj.end(i); p ++)
+      if (ordinary(*p) && !visited[*p]) return *p;
+    return I(-1);
+  };
+
+  for (const auto seed : component) {
+    if (!ordinary(seed) || visited[seed]) continue;
+
+    std::deque<I> trace(1, seed);
+    visited[seed] = 1;
+
+    std::vector<I> seed_neighbors;
+    for (const I *p = adj.begin(seed); p != adj.end(seed); p ++)
+      if (ordinary(*p)) seed_neighbors.push_back(*p);
+
+    for (int dir = 0; dir < 2 && !seed_neighbors.empty(); dir ++) {
+      I current = dir == 0 ? seed_neighbors.front() : seed_neighbors.back();
+      while (current >= 0) {
+        if (!visited[current]) {
+          if (dir == 0) trace.push_back(current);
+          else trace.push_front(current);
+          visited[current] = 1;
+        }
+        current = next(current);
+      }
+      if (seed_neighbors.size() == 1) break; // only one direction available
+    }
+
+    linear_components.push_back(std::vector<I>(trace.begin(), trace.end()));
+  }
+
+  return linear_components;
+}
+
+template <typename I>
+bool is_loop(const std::vector<I>& linear_graph, const csr_adjacency<I>& adj)
+{
+  if (linear_graph.size() <= 1) return false;
+  return std::binary_search(adj.begin(linear_graph.front()), adj.end(linear_graph.front()), linear_graph.back());
+}
+
 template <typename NodeType>
 bool is_loop(const std::vector<NodeType>& linear_graph, std::function<std::set<NodeType>(NodeType)> neighbors)
 {
@@ -0,0 +1,175 @@
+#ifndef _FTK_MAPPED_CACHE_FILE_HH
+#define _FTK_MAPPED_CACHE_FILE_HH
+
+#include <ftk/config.hh>
+#include <ftk/error.hh>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ftk {
+
+enum {
+  FTK_CACHE_XGC_INTERPOLANTS = 1,
+  FTK_CACHE_SMOOTHING_KERNEL = 2
+};
+
+// Flat, versioned cache file that is read through mmap.  A fixed-size
+// header identifies the content (kind, mesh hash, nphi/iphi/vphi, sigma,
+// and the sizes of the index and value types) and is followed by up to
+// 8 raw arrays ("sections") aligned to 64 bytes.  Readers map the file
+// read-only and use the sections in place; since the mapping is shared,
+// all ranks on a node that map the same file share one copy in the page
+// cache.  Writers write to a temporary file and rename it, so concurrent
+// writers of the same cache never expose a partial file.
+struct mapped_cache_file {
+  static constexpr uint32_t version = 1;
+  static constexpr int max_sections = 8;
+
+  struct header_t {
+    char magic[8] = {'F', 'T', 'K', 'C', 'A', 'C', 'H', 'E'};
+    uint32_t version = mapped_cache_file::version;
+    uint32_t kind = 0;
+    uint64_t mesh_hash = 0;
+    int32_t nphi = 0, iphi = 0, vphi = 0;
+    int32_t sizeof_index = 0, sizeof_value = 0;
+    double sigma = 0;
+    uint32_t nsections = 0;
+    uint64_t offsets[max_sections] = {0}, sizes[max_sections] = {0}; // in bytes
+
+    bool same_key(const header_t& h) const {
+      return kind == h.kind && mesh_hash == h.mesh_hash
+        && nphi == h.nphi && iphi == h.iphi && vphi == h.vphi
+        && sizeof_index == h.sizeof_index && sizeof_value == h.sizeof_value
+        && sigma == h.sigma;
+    }
+  };
+
+  mapped_cache_file() {}
+  ~mapped_cache_file() { close(); }
+  mapped_cache_file(const mapped_cache_file&) = delete;
+  mapped_cache_file& operator=(const mapped_cache_file&) = delete;
+
+  // returns false if the file does not exist or is not a cache file;
+  // warns and returns false if the file was written for another key
+  bool open(const std::string& filename, const header_t& key);
+  void close();
+
+  static bool is_cache_file(const std::string& filename);
+  static void write(const std::string& filename, header_t header,
+      const std::vector<std::pair<const void*, size_t/*bytes*/>>& sections);
+
+  const header_t& header() const { return *reinterpret_cast<const header_t*>(base); }
+  template <typename T> const T* section(int i) const { return reinterpret_cast<const T*>(base + header().offsets[i]); }
+  template <typename T> size_t section_size(int i) const { return header().sizes[i] / sizeof(T); }
+
+protected:
+  const char *base = NULL;
+  size_t length = 0;
+};
+
+/////
+inline bool mapped_cache_file::is_cache_file(const std::string& filename)
+{
+  FILE *fp = fopen(filename.c_str(), "rb");
+  if (!fp) return false;
+
+  header_t h;
+  const bool succ = fread(h.magic, 1, 8, fp) == 8 && memcmp(h.magic, header_t().magic, 8) == 0;
+  fclose(fp);
+  return succ;
+}
+
+inline bool mapped_cache_file::open(const std::string& filename, const header_t& key)
+{
+  close();
+
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(header_t)) {
+    ::close(fd);
+    return false;
+  }
+
+  void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) return false;
+
+  base = static_cast<const char*>(p);
+  length = st.st_size;
+
+  const header_t &h = header();
+  if (memcmp(h.magic, key.magic, 8) != 0) {
+    close();
+    return false;
+  }
+  if (h.version != version || !h.same_key(key)) {
+    warn(FTK_ERR_FILE_FORMAT, "cache file " + filename + " was written with a different version or for a different mesh/parameters");
+    close();
+    return false;
+  }
+  for (uint32_t i = 0; i < h.nsections; i ++)
+    if (h.offsets[i] + h.sizes[i] > length) {
+      warn(FTK_ERR_FILE_FORMAT, "truncated cache file " + filename);
+      close();
+      return false;
+    }
+
+  return true;
+}
+
+inline void mapped_cache_file::close()
+{
+  if (base) munmap(const_cast<char*>(base), length);
+  base = NULL;
+  length = 0;
+}
+
+inline void mapped_cache_file::write(const std::string& filename, header_t h,
+    const std::vector<std::pair<const void*, size_t>>& sections)
+{
+  auto align = [](uint64_t x) { return (x + 63) / 64 * 64; };
+
+  h.nsections = sections.size();
+  uint64_t offset = align(sizeof(header_t));
+  for (size_t i = 0; i < sections.size(); i ++) {
+    h.offsets[i] = offset;
+    h.sizes[i] = sections[i].second;
+    offset = align(offset + sections[i].second);
+  }
+
+  const std::string tmp = filename + ".tmp." + std::to_string(getpid());
+  FILE *fp = fopen(tmp.c_str(), "wb");
+  if (!fp) {
+    warn(FTK_ERR_FILE_CANNOT_WRITE, tmp);
+    return;
+  }
+
+  static const char zeros[64] = {0};
+  bool succ = fwrite(&h, sizeof(header_t), 1, fp) == 1;
+  uint64_t pos = sizeof(header_t);
+  for (size_t i = 0; i < sections.size() && succ; i ++) {
+    succ = succ && fwrite(zeros, 1, h.offsets[i] - pos, fp) == h.offsets[i] - pos;
+    succ = succ && (sections[i].second == 0 || fwrite(sections[i].first, 1, sections[i].second, fp) == sections[i].second);
+    pos = h.offsets[i] + h.sizes[i];
+  }
+  succ = (fclose(fp) == 0) && succ;
+
+  if (succ && rename(tmp.c_str(), filename.c_str()) == 0) return;
+
+  warn(FTK_ERR_FILE_CANNOT_WRITE, filename);
+  remove(tmp.c_str());
+}
+
+}
+
+#endif
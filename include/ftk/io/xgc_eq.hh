@@ -2,14 +2,16 @@
 #define _FTK_XGC_EQ_HH
 
 #include <ftk/config.hh>
+#include <ftk/ndarray.hh>
+#include <ftk/numeric/rk4.hh>
 #include <ftk/utils/string.hh>
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <string>
 #include <ftk/external/json.hh>
 
 #if FTK_HAVE_VTK
-#include <vtkCellLocator.h>
-#include <vtkTupleInterpolator.h>
 #include <vtkLagrangeQuadrilateral.h>
 #include <vtkUnstructuredGrid.h>
 #include <vtkRectilinearGrid.h>
@@ -20,15 +22,25 @@
 
 namespace ftk {
 
+// The equilibrium psi(R, Z) is interpolated with bicubic (Catmull-Rom)
+// patches on the uniform rgrid/zgrid and I(psi) with a natural cubic
+// spline.  The coefficients are precomputed in initialize(), which parse()
+// and read_bp(filename) call after loading; the evaluators are then const,
+// allocation-free, and safe to call concurrently.  Points outside the
+// grid are extrapolated with the nearest patch.
 struct xgc_eq_t {
   void parse(const std::string& filename);
   void print() const;
 
-  void initialize(); // initialize shebangs for the interpolator
+  void initialize(); // precompute the coefficients of the interpolants
   void eval_b(const double rz[], double b[]) const;
   void eval_psi(const double rz[], double &psi, double &dpsi_dR, double &dpsi_dZ) const;
   double eval_I(double psi) const;
   void eval_L(const double rz[], double L[]) const;
+
+  // batched versions for n points rz[2n]
+  void eval_b(size_t n, const double rz[], double b[]) const; // b[3n]
+  void eval_psi(size_t n, const double rz[], double psi[], double dpsi[]) const; // psi[n], dpsi[2n] (d/dR, d/dZ)
  
   bool magnetic_map(double rzp[3], double phi_end, int nsteps=1024) const;
 
@@ -62,40 +74,91 @@ struct xgc_eq_t {
   ndarray<double> psi_rz; // 2D array
   ndarray<double> grad_psi_rz;
 
-protected: // for the interpolator
-#if FTK_HAVE_VTK
-  vtkSmartPointer<vtkUnstructuredGrid> vtu; // Lagrange quad grid
-  vtkSmartPointer<vtkCellLocator> locator;
-  vtkSmartPointer<vtkTupleInterpolator> interp; // 1D interpolator for I
-#endif
+protected: // for the interpolators
+  double dr = 1, dz = 1;
+  std::vector<double> psi_coeffs; // 16 coefficients per cell; a[p*4+q] for u^p v^q
+  std::vector<double> I_d2; // second derivatives of the spline of I
 };
 
 inline void xgc_eq_t::initialize()
 {
-#if FTK_HAVE_VTK
-  // 1D interpolation function for I(psi)
-  this->interp = vtkTupleInterpolator::New();
-  interp->SetNumberOfComponents(1);
-  for (int i = 0; i < this->mpsi; i ++) {
-    double tuple[1] = {this->I[i]};
-    interp->AddTuple(this->psigrid[i], tuple);
-  }
+  // partial derivatives (in grid units) at grid points with central 
+  // differences, and second-order one-sided differences at the boundaries
+  auto deriv = [](const double *f, int n, int stride, int i) {
+    if (n < 3) return n < 2 ? 0.0 : f[stride] - f[0];
+    else if (i == 0) return (-3*f[0] + 4*f[stride] - f[2*stride]) * 0.5;
+    else if (i == n-1) return (3*f[i*stride] - 4*f[(i-1)*stride] + f[(i-2)*stride]) * 0.5;
+    else return (f[(i+1)*stride] - f[(i-1)*stride]) * 0.5;
+  };
+
+  dr = (max_r - min_r) / (mr - 1);
+  dz = (max_z - min_z) / (mz - 1);
+
+  std::vector<double> fu(mr * mz), fv(mr * mz), fuv(mr * mz);
+  for (int j = 0; j < mz; j ++)
+    for (int i = 0; i < mr; i ++) {
+      fu[j*mr+i] = deriv(&psi_rz[j*mr], mr, 1, i);
+      fv[j*mr+i] = deriv(&psi_rz[i], mz, mr, j);
+    }
+  for (int j = 0; j < mz; j ++)
+    for (int i = 0; i < mr; i ++)
+      fuv[j*mr+i] = deriv(&fv[j*mr], mr, 1, i);
+
+  // bicubic hermite patches, A = M F M^T
+  static const double M[4][4] = {{1, 0, 0, 0}, {0, 0, 1, 0}, {-3, 3, -2, -1}, {2, -2, 1, 1}};
+  psi_coeffs.resize(size_t(std::max(mr-1, 1)) * std::max(mz-1, 1) * 16);
+  for (int j = 0; j < mz-1; j ++)
+    for (int i = 0; i < mr-1; i ++) {
+      const int v00 = j*mr+i, v10 = v00+1, v01 = v00+mr, v11 = v01+1;
+      const double F[4][4] = {
+        {psi_rz[v00], psi_rz[v01], fv[v00], fv[v01]},
+        {psi_rz[v10], psi_rz[v11], fv[v10], fv[v11]},
+        {fu[v00], fu[v01], fuv[v00], fuv[v01]},
+        {fu[v10], fu[v11], fuv[v10], fuv[v11]}};
+
+      double MF[4][4] = {0};
+      for (int p = 0; p < 4; p ++)
+        for (int q = 0; q < 4; q ++)
+          for (int k = 0; k < 4; k ++)
+            MF[p][q] += M[p][k] * F[k][q];
+
+      double *a = &psi_coeffs[(size_t(j)*(mr-1) + i) * 16];
+      for (int p = 0; p < 4; p ++)
+        for (int q = 0; q < 4; q ++) {
+          a[p*4+q] = 0;
+          for (int k = 0; k < 4; k ++)
+            a[p*4+q] += MF[p][k] * M[q][k];
+        }
+    }
 
-  // 2D interpolation grid for psi and its partial derivatives
-  this->vtu = this->to_vtu();
-  this->locator = vtkCellLocator::New();
-  locator->SetDataSet(this->vtu);
-  locator->BuildLocator();
-#endif
+  // natural cubic spline for I(psi)
+  I_d2.assign(mpsi, 0.0);
+  if (mpsi > 2) {
+    std::vector<double> c(mpsi, 0.0), d(mpsi, 0.0); // tridiagonal solve
+    for (int i = 1; i < mpsi-1; i ++) {
+      const double h0 = psigrid[i] - psigrid[i-1], h1 = psigrid[i+1] - psigrid[i];
+      const double rhs = 6 * ((I[i+1] - I[i]) / h1 - (I[i] - I[i-1]) / h0);
+      const double diag = 2 * (h0 + h1) - h0 * c[i-1];
+      c[i] = h1 / diag;
+      d[i] = (rhs - h0 * d[i-1]) / diag;
+    }
+    for (int i = mpsi-2; i > 0; i --)
+      I_d2[i] = d[i] - c[i] * I_d2[i+1];
+  }
 }
 
 inline double xgc_eq_t::eval_I(double psi) const
 {
-  double I[1] = {0.0};
-#if FTK_HAVE_VTK
-  interp->InterpolateTuple(psi, I);
-#endif
-  return I[0];
+  if (mpsi < 2) return mpsi == 1 ? I[0] : 0.0;
+  if (psi <= psigrid[0]) return I[0];
+  if (psi >= psigrid[mpsi-1]) return I[mpsi-1];
+
+  const double *g = psigrid.data();
+  const int i = std::min(int(std::upper_bound(g, g + mpsi, psi) - g) - 1, mpsi - 2);
+  const double h = g[i+1] - g[i], 
+               a = (g[i+1] - psi) / h, b = 1.0 - a;
+  return a * I[i] + b * I[i+1] 
+    + ((a*a*a - a) * I_d2[i] + (b*b*b - b) * I_d2[i+1]) * h * h / 6;
 }
 
 inline bool xgc_eq_t::magnetic_map(double rzp[], double phi_end, int nsteps) const
@@ -105,6 +168,7 @@ inline bool xgc_eq_t::magnetic_map(double rzp[], double phi_end, int nsteps) con
   for (int k = 0; k < nsteps; k ++) {
     if (!rk4<double>(3, rzp, [&](const double* rzp, double* v) {
           eval_L(rzp, v);
+          v[2] = 1.0; // dphi/dphi
           return true;
         }, delta))
       return false;
@@ -137,29 +201,39 @@ inline void xgc_eq_t::eval_L(const double rz[], double L[]) const
 
 inline void xgc_eq_t::eval_psi(const double rz[], double &psi, double &dpsi_dR, double &dpsi_dZ) const
 {
-#if FTK_HAVE_VTK
-  double closestPoint[3], pcoords[3], dist2;
-  int subId;
-  double weights[16], values[16], derivs[2];
-
-  double rz_[3] = {rz[0], rz[1], 0.0}; // make findcell() happy
-  auto cid = this->locator->FindCell(rz_);
-  auto cell = this->vtu->GetCell(cid);
-  cell->EvaluatePosition(rz, closestPoint, subId, pcoords, dist2, weights);
-
-  psi = 0.0;
-  for (int i = 0; i < 16; i ++) {
-    auto id = cell->GetPointId(i);
-    values[i] = this->psi_rz[id];
-    psi += weights[i] * values[i];
+  const double x = (rz[0] - min_r) / dr, y = (rz[1] - min_z) / dz;
+  const int i = std::min(std::max(int(std::floor(x)), 0), mr - 2),
+            j = std::min(std::max(int(std::floor(y)), 0), mz - 2);
+  const double u = x - i, v = y - j;
+  const double *a = &psi_coeffs[(size_t(j)*(mr-1) + i) * 16];
+
+  double f = 0, fu = 0, fv = 0;
+  for (int p = 3; p >= 0; p --) { // horner
+    double c = 0, cv = 0;
+    for (int q = 3; q >= 0; q --) {
+      c = c * v + a[p*4+q];
+      if (q > 0) cv = cv * v + q * a[p*4+q];
+    }
+    f = f * u + c;
+    fv = fv * u + cv;
+    if (p > 0) fu = fu * u + p * c;
   }
-  cell->Derivatives(subId, pcoords, values, 1, derivs);
-  
-  dpsi_dR = derivs[0];
-  dpsi_dZ = derivs[1];
-#else
-  assert(false); // not compiled with VTK
-#endif
+
+  psi = f;
+  dpsi_dR = fu / dr;
+  dpsi_dZ = fv / dz;
+}
+
+inline void xgc_eq_t::eval_psi(size_t n, const double rz[], double psi[], double dpsi[]) const
+{
+  for (size_t k = 0; k < n; k ++)
+    eval_psi(rz + k*2, psi[k], dpsi[k*2], dpsi[k*2+1]);
+}
+
+inline void xgc_eq_t::eval_b(size_t n, const double rz[], double b[]) const
+{
+  for (size_t k = 0; k < n; k ++)
+    eval_b(rz + k*2, b + k*3);
 }
 
 #if FTK_HAVE_VTK
@@ -315,6 +389,7 @@ inline void xgc_eq_t::parse(const std::string& filename)
   for (int i=0; i<mz; i++) 
     zgrid[i] = min_z + (max_z - min_z) / (mz - 1) * i;
 
+  initialize();
   // print();
 }
 
@@ -344,6 +419,7 @@ inline void xgc_eq_t::read_bp(const std::string f, diy::mpi::communicator comm)
   this->read_bp(io, reader);
 
   reader.Close();
+  initialize();
 }
 
 inline void xgc_eq_t::read_bp(adios2::IO &io, adios2::Engine& reader)
@@ -154,9 +154,7 @@ inline void xgc_stream::initialize()
   
   // smoothing kernels
   if (enable_initialize_smoothing_kernel) {
-    if (file_exists( smoothing_kernel_filename ))
-      m2->read_smoothing_kernel( smoothing_kernel_filename );
-    else {
+    if (!file_exists( smoothing_kernel_filename ) || !m2->read_smoothing_kernel( smoothing_kernel_filename )) {
       m2->build_smoothing_kernel_cached( smoothing_kernel_size );
       if (!smoothing_kernel_filename.empty())
         m2->write_smoothing_kernel( smoothing_kernel_filename );
@@ -165,9 +163,7 @@ inline void xgc_stream::initialize()
 
   // interpolants
   if (vphi > 1 && enable_initialize_interpolants) {
-    if (file_exists(interpolant_filename)) 
-      mx3->read_interpolants( interpolant_filename );
-    else {
+    if (!file_exists(interpolant_filename) || !mx3->read_interpolants( interpolant_filename )) {
       mx3->initialize_interpolants_cached();
       if (!interpolant_filename.empty())
         mx3->write_interpolants( interpolant_filename );
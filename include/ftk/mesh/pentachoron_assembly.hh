@@ -0,0 +1,366 @@
+#ifndef _FTK_PENTACHORON_ASSEMBLY_HH
+#define _FTK_PENTACHORON_ASSEMBLY_HH
+
+#include <ftk/config.hh>
+#include <ftk/object.hh>
+#include <ftk/mesh/simplicial_regular_mesh.hh>
+#include <ftk/algorithms/radix_sort.hh>
+#include <array>
+#include <vector>
+#include <set>
+
+namespace ftk {
+
+// Assembles features in the pentachora (4-simplices) of a 3D+time
+// simplicial regular mesh from the intersected k-simplices of the feature:
+//  - k=2: triangles of surfaces, e.g. vortex surfaces
+//  - k=1: tetrahedra of volumes, e.g. isovolumes
+// A pentachoron has ten k-faces for both k, so its intersected faces form
+// a 10-bit mask, and the patch of every mask is precomputed in a lookup
+// table over the local face indices.  Candidate pentachora are derived
+// from the intersected faces as integer ids and deduplicated with a radix
+// sort; the pentachora are then processed in parallel chunks.
+struct pentachoron_assembly {
+  pentachoron_assembly(const simplicial_regular_mesh& m, int k);
+
+  // tags[i] is the integer id of the i-th intersected k-simplex.  Returns
+  // the patches in indices of tags; N is 3 for k=2 and 4 for k=1
+  template <int N>
+  std::vector<std::array<int, N>> assemble(const std::vector<uint64_t>& tags,
+      int thread_backend = FTK_THREAD_PTHREAD,
+      int nthreads = std::thread::hardware_concurrency(),
+      bool affinity = false);
+
+  // if t >= 0, only the pentachora between timesteps t and t+1 are assembled
+  void set_time_slab(int t) { slab = t; }
+
+  // number of pentachora in the last assemble() whose masks do not
+  // correspond to a regular patch, e.g. due to degeneracies or partially
+  // evaluated pentachora on the boundary
+  size_t n_irregular() const { return nirregular; }
+
+public:
+  struct patch_t {
+    bool regular = false;
+    int ncells = 0;
+    std::array<std::array<int8_t, 4>, 9> cells; // local face indices
+  };
+
+  // local vertex indices of the ten k-faces, in lexicographic order
+  static std::vector<std::array<int, 3>> local_faces(int k);
+
+  static const std::vector<patch_t>& surface_table();
+  static const std::vector<patch_t>& volume_table();
+
+protected:
+  typedef simplicial_regular_mesh_element_fixed<4> element_t;
+  typedef std::tuple<int, std::array<int, 4>> typed_offset_t; // (type, offset)
+
+  const simplicial_regular_mesh& m;
+  const int k;
+
+  std::vector<std::array<typed_offset_t, 10>> faces; // pentachoron type -> k-faces
+  std::vector<std::vector<typed_offset_t>> cofaces; // k-simplex type -> pentachora
+
+  int slab = -1;
+  size_t nirregular = 0;
+};
+
+/////
+inline std::vector<std::array<int, 3>> pentachoron_assembly::local_faces(int k)
+{
+  std::vector<std::array<int, 3>> results;
+  for (int a = 0; a < 5; a ++)
+    for (int b = a+1; b < 5; b ++) {
+      if (k == 1) results.push_back({a, b, -1});
+      else
+        for (int c = b+1; c < 5; c ++)
+          results.push_back({a, b, c});
+    }
+  return results;
+}
+
+inline const std::vector<pentachoron_assembly::patch_t>& pentachoron_assembly::surface_table()
+{
+  // The surface in a pentachoron is a polygon whose vertices are on the
+  // intersected triangles; two of them are connected if they are the only
+  // intersected triangles of a tetrahedron.  Masks that form a single cycle
+  // are fan triangulated; other masks are fan triangulated in the local
+  // order as a fallback and flagged irregular.
+  static const std::vector<patch_t> table = []() {
+    const auto tris = local_faces(2);
+    std::vector<patch_t> table(1024);
+
+    for (int mask = 0; mask < 1024; mask ++) {
+      patch_t &p = table[mask];
+
+      std::vector<int> nodes;
+      for (int i = 0; i < 10; i ++)
+        if (mask & (1 << i)) nodes.push_back(i);
+      const size_t n = nodes.size();
+
+      std::vector<std::vector<int>> adj(10);
+      for (int j = 0; j < 5; j ++) { // the tetrahedron opposite to vertex j
+        std::vector<int> in;
+        for (const auto i : nodes)
+          if (tris[i][0] != j && tris[i][1] != j && tris[i][2] != j)
+            in.push_back(i);
+        if (in.size() == 2) {
+          adj[in[0]].push_back(in[1]);
+          adj[in[1]].push_back(in[0]);
+        }
+      }
+
+      std::vector<int> order;
+      bool cycle = n >= 3;
+      for (const auto i : nodes)
+        if (adj[i].size() != 2) cycle = false;
+      if (cycle) {
+        int prev = -1, cur = nodes[0];
+        do {
+          order.push_back(cur);
+          const int next = adj[cur][0] == prev ? adj[cur][1] : adj[cur][0];
+          prev = cur;
+          cur = next;
+        } while (cur != nodes[0] && order.size() <= n);
+        cycle = order.size() == n;
+      }
+
+      p.regular = cycle || n == 0;
+      if (!cycle) order = nodes;
+      if (n >= 3 && n <= 5)
+        for (size_t i = 1; i < n-1; i ++)
+          p.cells[p.ncells ++] = {int8_t(order[0]), int8_t(order[i]), int8_t(order[i+1]), -1};
+    }
+    return table;
+  }();
+  return table;
+}
+
+inline const std::vector<pentachoron_assembly::patch_t>& pentachoron_assembly::volume_table()
+{
+  // An isovolume separates the vertices of a pentachoron into two sets,
+  // and the intersected edges are those across the sets.  One isolated
+  // vertex gives a tetrahedron; two vertices {a, b} versus {c, d, e} give
+  // a prism between triangles (ac, ad, ae) and (bc, bd, be), which is
+  // split into three tetrahedra with the staircase pattern.  Since local
+  // vertices are sorted consistently across pentachora, neighboring prisms
+  // agree on the diagonals of their shared quadrilaterals.
+  static const std::vector<patch_t> table = []() {
+    const auto edges = local_faces(1);
+    auto edge = [&](int a, int b) {
+      if (a > b) std::swap(a, b);
+      for (int i = 0; i < 10; i ++)
+        if (edges[i][0] == a && edges[i][1] == b) return int8_t(i);
+      return int8_t(-1);
+    };
+
+    std::vector<patch_t> table(1024);
+    table[0].regular = true;
+
+    for (int s = 1; s < 31; s ++) { // s is the smaller set of vertices
+      std::vector<int> S, T;
+      for (int i = 0; i < 5; i ++)
+        if (s & (1 << i)) S.push_back(i);
+        else T.push_back(i);
+      if (S.size() > 2) continue;
+
+      int mask = 0;
+      for (const auto a : S)
+        for (const auto b : T)
+          mask |= 1 << edge(a, b);
+
+      patch_t &p = table[mask];
+      p.regular = true;
+      if (S.size() == 1) {
+        p.ncells = 1;
+        p.cells[0] = {edge(S[0], T[0]), edge(S[0], T[1]), edge(S[0], T[2]), edge(S[0], T[3])};
+      } else {
+        int8_t A[3], B[3];
+        for (int i = 0; i < 3; i ++) {
+          A[i] = edge(S[0], T[i]);
+          B[i] = edge(S[1], T[i]);
+        }
+        p.ncells = 3;
+        p.cells[0] = {A[0], A[1], A[2], B[2]};
+        p.cells[1] = {A[0], A[1], B[1], B[2]};
+        p.cells[2] = {A[0], B[0], B[1], B[2]};
+      }
+    }
+    return table;
+  }();
+  return table;
+}
+
+inline pentachoron_assembly::pentachoron_assembly(const simplicial_regular_mesh& m_, int k_)
+  : m(m_), k(k_)
+{
+  typedef simplicial_regular_mesh_element element;
+  if (m.nd() != 4 || (k != 1 && k != 2))
+    fatal("pentachoron_assembly requires a 4D mesh and k=1 or k=2");
+
+  auto to_offset = [](const std::vector<int>& corner) {
+    return std::array<int, 4>{corner[0], corner[1], corner[2], corner[3]};
+  };
+
+  // k-faces of each pentachoron type, matched to local faces by vertices
+  const auto locals = local_faces(k);
+  faces.resize(m.ntypes(4));
+  for (int type = 0; type < m.ntypes(4); type ++) {
+    const element pent(std::vector<int>(4, 0), 4, type);
+    const auto verts = pent.vertices(m);
+
+    std::set<element> elements = {pent};
+    for (int d = 4; d > k; d --) {
+      std::set<element> sides;
+      for (const auto &e : elements)
+        for (const auto &s : e.sides(m))
+          sides.insert(s);
+      elements = sides;
+    }
+
+    int nfound = 0;
+    for (const auto &f : elements) {
+      std::array<int, 3> local = {-1, -1, -1};
+      const auto fverts = f.vertices(m);
+      for (size_t i = 0; i < fverts.size(); i ++)
+        local[i] = std::find(verts.begin(), verts.end(), fverts[i]) - verts.begin();
+      std::sort(local.begin(), local.begin() + fverts.size());
+
+      const auto it = std::find(locals.begin(), locals.end(), local);
+      if (it != locals.end()) {
+        faces[type][it - locals.begin()] = std::make_tuple(f.type, to_offset(f.corner));
+        nfound ++;
+      }
+    }
+    if (nfound != 10)
+      fatal("unable to enumerate faces of pentachora");
+  }
+
+  // pentachora that contain each type of k-simplices
+  cofaces.resize(m.ntypes(k));
+  for (int type = 0; type < m.ntypes(k); type ++) {
+    std::set<element> elements = {element(std::vector<int>(4, 0), k, type)};
+    for (int d = k; d < 4; d ++) {
+      std::set<element> side_of;
+      for (const auto &e : elements)
+        for (const auto &s : e.side_of(m))
+          side_of.insert(s);
+      elements = side_of;
+    }
+
+    for (const auto &e : elements)
+      cofaces[type].push_back(std::make_tuple(e.type, to_offset(e.corner)));
+  }
+}
+
+template <int N>
+std::vector<std::array<int, N>> pentachoron_assembly::assemble(
+    const std::vector<uint64_t>& tags, int thread_backend, int nthreads, bool affinity)
+{
+  if (N != 4 - k + 1)
+    fatal("pentachoron_assembly: wrong number of vertices per cell");
+
+  const auto &table = k == 2 ? surface_table() : volume_table();
+
+  auto chunked_for = [&](size_t n, std::function<void(int, size_t, size_t)> f) {
+    const int nchunks = std::max(1, (int)std::min(size_t(std::max(1, nthreads)), (n + 4095) / 4096));
+    const size_t chunk_size = (n + nchunks - 1) / nchunks;
+    object::parallel_for(nchunks, [&](int c) {
+      f(c, std::min(n, c * chunk_size), std::min(n, (c+1) * chunk_size));
+    }, thread_backend, nchunks, affinity);
+    return nchunks;
+  };
+
+  auto sort_unique = [&](std::vector<uint64_t>& a) {
+    uint64_t max = 0;
+    for (const auto x : a)
+      max = std::max(max, x);
+    parallel_radix_sort(a, radix_sort_ndigits(max + 1), [](uint64_t x, int p) {
+      return (x >> (p * 8)) & 0xff;
+    }, nthreads);
+    a.erase(std::unique(a.begin(), a.end()), a.end());
+  };
+
+  // (tag, index) pairs sorted by tag for lookups
+  std::vector<std::pair<uint64_t, int>> sorted_tags(tags.size());
+  uint64_t max_tag = 0;
+  for (size_t i = 0; i < tags.size(); i ++) {
+    sorted_tags[i] = std::make_pair(tags[i], int(i));
+    max_tag = std::max(max_tag, tags[i]);
+  }
+  parallel_radix_sort(sorted_tags, radix_sort_ndigits(max_tag + 1),
+      [](const std::pair<uint64_t, int>& x, int p) {
+        return (x.first >> (p * 8)) & 0xff;
+      }, nthreads);
+
+  auto find = [&](uint64_t tag) {
+    const auto it = std::lower_bound(sorted_tags.begin(), sorted_tags.end(),
+        std::make_pair(tag, 0),
+        [](const std::pair<uint64_t, int>& a, const std::pair<uint64_t, int>& b) {
+          return a.first < b.first;
+        });
+    return (it != sorted_tags.end() && it->first == tag) ? it->second : -1;
+  };
+
+  // candidate pentachora
+  std::vector<std::vector<uint64_t>> candidates(std::max(1, nthreads));
+  const int nc0 = chunked_for(tags.size(), [&](int c, size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; i ++) {
+      const element_t f(m, k, tags[i]);
+      for (const auto &co : cofaces[f.type]) {
+        element_t e(4);
+        e.type = std::get<0>(co);
+        for (int j = 0; j < 4; j ++)
+          e.corner[j] = f.corner[j] + std::get<1>(co)[j];
+        if ((slab < 0 || e.corner[3] == slab) && e.valid(m))
+          candidates[c].push_back(e.to_integer(m));
+      }
+    }
+  });
+
+  std::vector<uint64_t> cells;
+  for (int c = 0; c < nc0; c ++)
+    cells.insert(cells.end(), candidates[c].begin(), candidates[c].end());
+  sort_unique(cells);
+
+  // patches of each pentachoron
+  std::vector<std::vector<std::array<int, N>>> patches(std::max(1, nthreads));
+  std::vector<size_t> irregular(std::max(1, nthreads), 0);
+  const int nc1 = chunked_for(cells.size(), [&](int c, size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; i ++) {
+      const element_t e(m, 4, cells[i]);
+
+      int ids[10], mask = 0;
+      for (int j = 0; j < 10; j ++) {
+        element_t f(k);
+        f.type = std::get<0>(faces[e.type][j]);
+        for (int l = 0; l < 4; l ++)
+          f.corner[l] = e.corner[l] + std::get<1>(faces[e.type][j])[l];
+        ids[j] = find(f.to_integer(m));
+        if (ids[j] >= 0) mask |= 1 << j;
+      }
+
+      const patch_t &p = table[mask];
+      if (!p.regular) irregular[c] ++;
+      for (int j = 0; j < p.ncells; j ++) {
+        std::array<int, N> cell;
+        for (int l = 0; l < N; l ++)
+          cell[l] = ids[p.cells[j][l]];
+        patches[c].push_back(cell);
+      }
+    }
+  });
+
+  nirregular = 0;
+  std::vector<std::array<int, N>> results;
+  for (int c = 0; c < nc1; c ++) {
+    results.insert(results.end(), patches[c].begin(), patches[c].end());
+    nirregular += irregular[c];
+  }
+  return results;
+}
+
+}
+
+#endif
@@ -4,23 +4,152 @@
 #include <ftk/config.hh>
 #include <ftk/mesh/aabb.hh>
 #include <ftk/mesh/simplicial_unstructured_2d_mesh.hh>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cmath>
 
 namespace ftk {
 
 template <typename I=int, typename F=double>
 struct point_locator_2d {
-  point_locator_2d(const simplicial_unstructured_2d_mesh<I, F>& m) : m2(m) {}
+  point_locator_2d(const simplicial_unstructured_2d_mesh<I, F>& m) : m2(m) { build_neighbors(); }
   virtual ~point_locator_2d() {}
 
   virtual void initialize() = 0;
   virtual I locate(const F x[], F mu[]) const = 0;
-  
+
   I locate(const F x[]) const { F mu[3]; return locate(x, mu);  }
+  I locate(const F x[], F mu[], I hint) const; // walk from the hinted triangle (e.g. the last hit of the same particle) first
+
+  // locates n points x[2n] and gets the triangle ids tids[n] (-1 if not
+  // found) and barycentric coordinates mu[3n].  Queries are visited along
+  // a Morton curve, and each query walks from the triangle of the previous
+  // one.  All locate functions are const and safe to call concurrently,
+  // e.g. on disjoint ranges of morton_order() from object::parallel_for.
+  void locate_batch(size_t n, const F x[], I tids[], F mu[]) const;
+  void locate_batch(size_t n, const size_t order[], const F x[], I tids[], F mu[]) const; // visits x[order[0]], ..., x[order[n-1]]
+  static std::vector<size_t> morton_order(size_t n, const F x[]);
+
+protected:
+  bool barycentric(I t, const F x[], F mu[]) const; // returns true if x is in triangle t
+  void build_neighbors();
 
 protected:
   const simplicial_unstructured_2d_mesh<I, F>& m2;
+
+  static const int max_walk_steps = 64;
+  std::vector<I> neighbors; // 3 per triangle; the k-th neighbor shares the edge opposite to the k-th vertex
 };
 
+/////
+template <typename I, typename F>
+void point_locator_2d<I, F>::build_neighbors()
+{
+  neighbors.resize(m2.n(2) * 3, -1);
+  for (I t = 0; t < m2.n(2); t ++) {
+    for (int k = 0; k < 3; k ++) { // the k-th edge is (k, k+1) and is opposite to vertex k+2
+      const I e = m2.triangle_edges(k, t);
+      for (int j = 0; j < 2; j ++) {
+        const I t1 = m2.edges_side_of(j, e);
+        if (t1 >= 0 && t1 != t)
+          neighbors[t*3 + (k+2)%3] = t1;
+      }
+    }
+  }
+}
+
+template <typename I, typename F>
+bool point_locator_2d<I, F>::barycentric(I t, const F x[], F mu[]) const
+{
+  const ndarray<F> &coords = m2.get_coords();
+  const ndarray<I> &conn = m2.get_triangles();
+  const F *p1 = &coords[conn[t*3]*2],
+          *p2 = &coords[conn[t*3+1]*2],
+          *p3 = &coords[conn[t*3+2]*2];
+
+  const F det = (p2[1] - p3[1])*(p1[0] - p3[0]) + (p3[0] - p2[0])*(p1[1] - p3[1]);
+  mu[0] = ((p2[1] - p3[1])*(x[0] - p3[0]) + (p3[0] - p2[0])*(x[1] - p3[1])) / det;
+  mu[1] = ((p3[1] - p1[1])*(x[0] - p3[0]) + (p1[0] - p3[0])*(x[1] - p3[1])) / det;
+  mu[2] = F(1) - mu[0] - mu[1];
+  return mu[0] >= 0 && mu[1] >= 0 && mu[2] >= 0;
+}
+
+template <typename I, typename F>
+I point_locator_2d<I, F>::locate(const F x[], F mu[], I hint) const
+{
+  // walk towards x across the edge opposite to the most negative
+  // barycentric coordinate; fall back to the full search if the walk
+  // leaves the mesh or takes too long
+  I t = hint;
+  for (int step = 0; step < max_walk_steps && t >= 0 && t < m2.n(2); step ++) {
+    if (barycentric(t, x, mu))
+      return t;
+    if (!std::isfinite(mu[0]) || !std::isfinite(mu[1]))
+      break;
+
+    const int k = std::min_element(mu, mu+3) - mu;
+    t = neighbors[t*3 + k];
+  }
+  return locate(x, mu);
+}
+
+template <typename I, typename F>
+std::vector<size_t> point_locator_2d<I, F>::morton_order(size_t n, const F x[])
+{
+  F lb[2] = {std::numeric_limits<F>::max(), std::numeric_limits<F>::max()},
+    ub[2] = {-std::numeric_limits<F>::max(), -std::numeric_limits<F>::max()};
+  for (size_t i = 0; i < n; i ++)
+    for (int j = 0; j < 2; j ++)
+      if (std::isfinite(x[i*2+j])) {
+        lb[j] = std::min(lb[j], x[i*2+j]);
+        ub[j] = std::max(ub[j], x[i*2+j]);
+      }
+
+  auto spread = [](uint64_t v) { // interleave the lower 32 bits with zeros
+    v &= 0xffffffff;
+    v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+    v = (v | (v << 8))  & 0x00ff00ff00ff00ffULL;
+    v = (v | (v << 4))  & 0x0f0f0f0f0f0f0f0fULL;
+    v = (v | (v << 2))  & 0x3333333333333333ULL;
+    v = (v | (v << 1))  & 0x5555555555555555ULL;
+    return v;
+  };
+
+  std::vector<uint64_t> codes(n);
+  for (size_t i = 0; i < n; i ++) {
+    uint64_t q[2];
+    for (int j = 0; j < 2; j ++) {
+      const F r = ub[j] > lb[j] ? (x[i*2+j] - lb[j]) / (ub[j] - lb[j]) : F(0);
+      q[j] = std::isfinite(r) ? uint64_t(std::min(std::max(r, F(0)), F(1)) * 4294967295.0) : 0xffffffff;
+    }
+    codes[i] = spread(q[0]) | (spread(q[1]) << 1);
+  }
+
+  std::vector<size_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return codes[a] < codes[b]; });
+  return order;
+}
+
+template <typename I, typename F>
+void point_locator_2d<I, F>::locate_batch(size_t n, const size_t order[], const F x[], I tids[], F mu[]) const
+{
+  I hint = -1;
+  for (size_t i = 0; i < n; i ++) {
+    const size_t j = order[i];
+    tids[j] = locate(x + j*2, mu + j*3, hint);
+    if (tids[j] >= 0) hint = tids[j];
+  }
+}
+
+template <typename I, typename F>
+void point_locator_2d<I, F>::locate_batch(size_t n, const F x[], I tids[], F mu[]) const
+{
+  const auto order = morton_order(n, x);
+  locate_batch(n, order.data(), x, tids, mu);
+}
+
 }
 
 #endif
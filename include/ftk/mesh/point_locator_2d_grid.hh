@@ -0,0 +1,106 @@
+#ifndef _FTK_POINT_LOCATOR_2D_GRID_HH
+#define _FTK_POINT_LOCATOR_2D_GRID_HH
+
+#include <ftk/mesh/point_locator_2d.hh>
+
+namespace ftk {
+
+// Point locator with a uniform grid over the bounding box of the mesh.
+// Each grid cell lists the triangles whose bounding boxes overlap the
+// cell; the lists are stored contiguously (CSR), so a query touches one
+// offset pair and one short run of triangle ids.  The grid has about as
+// many cells as the mesh has triangles.
+template <typename I=int, typename F=double>
+struct point_locator_2d_grid : public point_locator_2d<I, F> {
+  point_locator_2d_grid(const simplicial_unstructured_2d_mesh<I, F> &m)
+    : point_locator_2d<I, F>(m) { initialize(); }
+  virtual ~point_locator_2d_grid() {}
+
+  void initialize();
+  I locate(const F x[], F mu[]) const;
+
+protected:
+  template <typename Func> void for_each_cell(I t, Func f) const; // cells overlapped by the bounding box of triangle t
+
+protected:
+  F lb[2], h[2];
+  int nx = 1, ny = 1;
+  std::vector<size_t> cell_offsets; // nx*ny+1
+  std::vector<I> cell_triangles;
+};
+
+/////
+template <typename I, typename F>
+template <typename Func>
+void point_locator_2d_grid<I, F>::for_each_cell(I t, Func f) const
+{
+  const ndarray<F> &coords = this->m2.get_coords();
+  const ndarray<I> &conn = this->m2.get_triangles();
+
+  F A[2], B[2];
+  for (int j = 0; j < 2; j ++) {
+    A[j] = min3(coords[conn[t*3]*2+j], coords[conn[t*3+1]*2+j], coords[conn[t*3+2]*2+j]);
+    B[j] = max3(coords[conn[t*3]*2+j], coords[conn[t*3+1]*2+j], coords[conn[t*3+2]*2+j]);
+  }
+
+  const int i0 = std::max(0, int((A[0] - lb[0]) / h[0])), i1 = std::min(nx-1, int((B[0] - lb[0]) / h[0])),
+            j0 = std::max(0, int((A[1] - lb[1]) / h[1])), j1 = std::min(ny-1, int((B[1] - lb[1]) / h[1]));
+  for (int j = j0; j <= j1; j ++)
+    for (int i = i0; i <= i1; i ++)
+      f(size_t(j) * nx + i);
+}
+
+template <typename I, typename F>
+void point_locator_2d_grid<I, F>::initialize()
+{
+  const ndarray<F> &coords = this->m2.get_coords();
+  const size_t n0 = this->m2.n(0), n2 = this->m2.n(2);
+
+  F ub[2];
+  lb[0] = lb[1] = std::numeric_limits<F>::max();
+  ub[0] = ub[1] = -std::numeric_limits<F>::max();
+  for (size_t i = 0; i < n0; i ++)
+    for (int j = 0; j < 2; j ++) {
+      lb[j] = std::min(lb[j], coords[i*2+j]);
+      ub[j] = std::max(ub[j], coords[i*2+j]);
+    }
+
+  const F wx = std::max(ub[0] - lb[0], std::numeric_limits<F>::epsilon()),
+          wy = std::max(ub[1] - lb[1], std::numeric_limits<F>::epsilon());
+  nx = std::max(1, int(std::sqrt(F(n2) * wx / wy)));
+  ny = std::max(1, int(F(n2) / nx));
+  h[0] = wx / nx;
+  h[1] = wy / ny;
+
+  // count, then fill
+  cell_offsets.assign(size_t(nx) * ny + 1, 0);
+  for (size_t t = 0; t < n2; t ++)
+    for_each_cell(t, [&](size_t c) { cell_offsets[c+1] ++; });
+  for (size_t c = 0; c < size_t(nx) * ny; c ++)
+    cell_offsets[c+1] += cell_offsets[c];
+
+  std::vector<size_t> pos(cell_offsets.begin(), cell_offsets.end() - 1);
+  cell_triangles.resize(cell_offsets.back());
+  for (size_t t = 0; t < n2; t ++)
+    for_each_cell(t, [&](size_t c) { cell_triangles[pos[c] ++] = t; });
+}
+
+template <typename I, typename F>
+I point_locator_2d_grid<I, F>::locate(const F x[], F mu[]) const
+{
+  const F rx = (x[0] - lb[0]) / h[0], ry = (x[1] - lb[1]) / h[1];
+  if (!(rx >= 0 && rx <= nx && ry >= 0 && ry <= ny)) // also rejects nans
+    return -1;
+
+  const int i = std::min(nx-1, int(rx)), j = std::min(ny-1, int(ry));
+  const size_t c = size_t(j) * nx + i;
+  for (size_t k = cell_offsets[c]; k < cell_offsets[c+1]; k ++)
+    if (this->barycentric(cell_triangles[k], x, mu))
+      return cell_triangles[k];
+
+  return -1;
+}
+
+}
+
+#endif
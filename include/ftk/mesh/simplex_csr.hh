@@ -0,0 +1,202 @@
+#ifndef _FTK_SIMPLEX_CSR_HH
+#define _FTK_SIMPLEX_CSR_HH
+
+#include <ftk/config.hh>
+#include <ftk/object.hh>
+#include <ftk/algorithms/radix_sort.hh>
+#include <ftk/external/diy/serialization.hpp>
+#include <vector>
+#include <set>
+
+namespace ftk {
+
+// compressed sparse row adjacency: the neighbors of i are idx[ptr[i]..ptr[i+1])
+template <typename I=int>
+struct csr_adjacency {
+  std::vector<size_t> ptr;
+  std::vector<I> idx;
+
+  size_t size() const { return ptr.empty() ? 0 : ptr.size() - 1; }
+  size_t degree(I i) const { return ptr[i+1] - ptr[i]; }
+
+  const I* begin(I i) const { return idx.data() + ptr[i]; }
+  const I* end(I i) const { return idx.data() + ptr[i+1]; }
+
+  std::vector<I> vector(I i) const { return std::vector<I>(begin(i), end(i)); }
+  std::set<I> set(I i) const { return std::set<I>(begin(i), end(i)); }
+
+  // counting sort of (row, col) pairs; cols of the same row keep their input order
+  void build(size_t nrows, const std::vector<I>& rows, const std::vector<I>& cols);
+};
+
+template <typename I>
+void csr_adjacency<I>::build(size_t nrows, const std::vector<I>& rows, const std::vector<I>& cols)
+{
+  ptr.assign(nrows + 1, 0);
+  for (const auto r : rows)
+    ptr[r+1] ++;
+  for (size_t i = 0; i < nrows; i ++)
+    ptr[i+1] += ptr[i];
+
+  std::vector<size_t> pos(ptr.begin(), ptr.end() - 1);
+  idx.resize(rows.size());
+  for (size_t i = 0; i < rows.size(); i ++)
+    idx[pos[rows[i]] ++] = cols[i];
+}
+
+// Builds the unique (k-1)-simplices of a set of cells.  emit(c, j, v) writes
+// the sorted vertices of the j-th side of cell c.  Sides are emitted for all
+// cells in parallel and deduplicated with a parallel radix sort, so that the
+// resulting simplices are in lexicographic order.  Outputs:
+//  - simplices: K * nsimplices vertex ids
+//  - index: CSR from the first (smallest) vertex to the range of simplices
+//    starting with that vertex, used by find_sorted_simplex
+//  - cell_sides: nsides * ncells ids of the sides of each cell
+//  - side_of: CSR from each simplex to the (ascending) cells it bounds
+template <typename I, int K, typename Emit>
+void build_sorted_simplices(size_t nverts, size_t ncells, int nsides, Emit emit,
+    std::vector<I>& simplices,
+    std::vector<size_t>& index,
+    std::vector<I>& cell_sides,
+    csr_adjacency<I>& side_of,
+    int nthreads = std::thread::hardware_concurrency())
+{
+  struct record {
+    I v[K];
+    size_t ref; // cell * nsides + j
+  };
+
+  const size_t n = ncells * nsides;
+  const int nchunks = std::max(1, (int)std::min(size_t(std::max(1, nthreads)), (n + 4095) / 4096));
+  const size_t chunk_size = (n + nchunks - 1) / nchunks;
+  auto for_chunks = [&](std::function<void(int, size_t, size_t)> f) {
+    object::parallel_for(nchunks, [&](int c) {
+      f(c, std::min(n, c * chunk_size), std::min(n, (c+1) * chunk_size));
+    }, FTK_THREAD_PTHREAD, nchunks, false);
+  };
+
+  // emit sides per cell
+  std::vector<record> records(n);
+  for_chunks([&](int, size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; i ++) {
+      records[i].ref = i;
+      emit(i / nsides, i % nsides, records[i].v);
+    }
+  });
+
+  // sort by the key (v[0], ..., v[K-1]); the last vertex is the least significant
+  const int ndigits = radix_sort_ndigits(nverts);
+  parallel_radix_sort(records, K * ndigits, [ndigits](const record& r, int p) {
+    const int w = K - 1 - p / ndigits, s = (p % ndigits) * 8;
+    return (typename std::make_unsigned<I>::type(r.v[w]) >> s) & 0xff;
+  }, nchunks);
+
+  auto is_head = [&](size_t i) {
+    if (i == 0) return true;
+    for (int k = 0; k < K; k ++)
+      if (records[i].v[k] != records[i-1].v[k]) return true;
+    return false;
+  };
+
+  // assign ids to unique keys with a chunked prefix sum
+  std::vector<size_t> offsets(nchunks + 1, 0);
+  for_chunks([&](int c, size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; i ++)
+      if (is_head(i)) offsets[c+1] ++;
+  });
+  for (int c = 0; c < nchunks; c ++)
+    offsets[c+1] += offsets[c];
+  const size_t nsimplices = offsets[nchunks];
+
+  simplices.resize(nsimplices * K);
+  cell_sides.resize(n);
+  side_of.ptr.resize(nsimplices + 1);
+  side_of.idx.resize(n);
+  side_of.ptr[nsimplices] = n;
+
+  for_chunks([&](int c, size_t i0, size_t i1) {
+    size_t id = offsets[c];
+    for (size_t i = i0; i < i1; i ++) {
+      const record &r = records[i];
+      if (is_head(i)) {
+        id ++;
+        side_of.ptr[id-1] = i;
+        for (int k = 0; k < K; k ++)
+          simplices[(id-1)*K+k] = r.v[k];
+      }
+      side_of.idx[i] = r.ref / nsides;
+      cell_sides[r.ref] = id - 1;
+    }
+  });
+
+  // first-vertex index
+  index.assign(nverts + 1, 0);
+  for (size_t i = 0; i < nsimplices; i ++)
+    index[simplices[i*K] + 1] ++;
+  for (size_t i = 0; i < nverts; i ++)
+    index[i+1] += index[i];
+}
+
+// looks up a simplex with sorted vertices v in the output of build_sorted_simplices
+template <typename I, int K>
+bool find_sorted_simplex(const std::vector<I>& simplices, const std::vector<size_t>& index, const I v[], I &i)
+{
+  if (v[0] < 0 || size_t(v[0]) + 1 >= index.size()) return false;
+
+  auto less = [&](size_t j) { // simplex j < v
+    for (int k = 1; k < K; k ++)
+      if (simplices[j*K+k] != v[k]) return simplices[j*K+k] < v[k];
+    return false;
+  };
+
+  size_t lo = index[v[0]], hi = index[v[0]+1];
+  const size_t end = hi;
+  while (lo < hi) {
+    const size_t mid = (lo + hi) / 2;
+    if (less(mid)) lo = mid + 1;
+    else hi = mid;
+  }
+
+  if (lo == end) return false;
+  for (int k = 1; k < K; k ++)
+    if (simplices[lo*K+k] != v[k]) return false;
+
+  i = lo;
+  return true;
+}
+
+// vertex-to-edge and vertex-to-vertex adjacencies of sorted edges
+template <typename I>
+void build_vertex_edge_csr(size_t nverts, const std::vector<I>& edges,
+    csr_adjacency<I>& vertex_edges, csr_adjacency<I>& vertex_edge_vertex)
+{
+  const size_t nedges = edges.size() / 2;
+  std::vector<I> rows(nedges * 2), eids(nedges * 2), verts(nedges * 2);
+  for (size_t i = 0; i < nedges; i ++)
+    for (int j = 0; j < 2; j ++) {
+      rows[i*2+j] = edges[i*2+j];
+      eids[i*2+j] = i;
+      verts[i*2+j] = edges[i*2+1-j];
+    }
+
+  vertex_edges.build(nverts, rows, eids);
+  vertex_edge_vertex.build(nverts, rows, verts);
+}
+
+}
+
+namespace diy {
+  template <typename I> struct Serialization<ftk::csr_adjacency<I>> {
+    static void save(diy::BinaryBuffer& bb, const ftk::csr_adjacency<I>& m) {
+      diy::save(bb, m.ptr);
+      diy::save(bb, m.idx);
+    }
+
+    static void load(diy::BinaryBuffer& bb, ftk::csr_adjacency<I>& m) {
+      diy::load(bb, m.ptr);
+      diy::load(bb, m.idx);
+    }
+  };
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define _HYPERMESH_simplicial_regular_MESH_HH
 
 #include <ftk/config.hh>
+#include <array>
 #include <iostream>
 #include <sstream> 
 #include <vector>
@@ -43,6 +44,7 @@ enum {
 };
 
 struct simplicial_regular_mesh;
+template <int ND> struct simplicial_regular_mesh_element_fixed;
 
 struct simplicial_regular_mesh_element {
   friend class simplicial_regular_mesh;
@@ -102,6 +104,7 @@ struct simplicial_regular_mesh_element {
 
 struct simplicial_regular_mesh : public object {
   friend class simplicial_regular_mesh_element;
+  template <int> friend struct simplicial_regular_mesh_element_fixed;
   typedef simplicial_regular_mesh_element iterator;
 
   simplicial_regular_mesh(int n) : nd_(n), lattice_(n) {
@@ -190,6 +193,29 @@ struct simplicial_regular_mesh : public object {
       int nthreads=std::thread::hardware_concurrency(), 
       bool affinity = false) const;
 
+  // Same as element_for(), but elements are passed as fixed-dimension 
+  // elements, which do not allocate memory on the heap.  ND must be nd().
+  template <int ND>
+  void element_for_fixed(int d, const lattice& subdomain, int scope, 
+      std::function<void(const simplicial_regular_mesh_element_fixed<ND>&)> f,
+      int accelerator = FTK_XL_NONE,
+      int nthreads=std::thread::hardware_concurrency(), 
+      bool affinity = false) const;
+  
+  template <int ND>
+  void element_for_ordinal_fixed(int d, int t, 
+      std::function<void(const simplicial_regular_mesh_element_fixed<ND>&)> f,
+      int accelerator = FTK_XL_NONE,
+      int nthreads=std::thread::hardware_concurrency(), 
+      bool affinity = false) const;
+  
+  template <int ND>
+  void element_for_interval_fixed(int d, int t0, int t1, 
+      std::function<void(const simplicial_regular_mesh_element_fixed<ND>&)> f,
+      int accelerator = FTK_XL_NONE,
+      int nthreads=std::thread::hardware_concurrency(), 
+      bool affinity = false) const;
+
 #if 0
 public: // partitioning
   void partition(int np, std::vector<std::tuple<simplicial_regular_mesh, simplicial_regular_mesh>>& partitions);  
@@ -256,6 +282,43 @@ private:
   std::vector<std::vector<std::vector<std::tuple<int, std::vector<int>>>>> unit_simplex_side_of;
 };
 
+// Element with compile-time dimensionality.  The corner is stored in a 
+// std::array and vertices are written to caller-provided arrays, so that
+// no heap allocation happens when scanning simplices in the hot loops.
+// Converts to/from simplicial_regular_mesh_element when needed, e.g. as
+// keys of std::map.
+template <int ND>
+struct simplicial_regular_mesh_element_fixed {
+  simplicial_regular_mesh_element_fixed() : dim(0), type(0) {corner.fill(0);}
+  simplicial_regular_mesh_element_fixed(int d) : dim(d), type(0) {corner.fill(0);}
+  simplicial_regular_mesh_element_fixed(const simplicial_regular_mesh &m, int d, size_t work_index, 
+      const lattice& l, int scope = ELEMENT_SCOPE_ALL);
+  template <typename uint=uint64_t> simplicial_regular_mesh_element_fixed(const simplicial_regular_mesh& m, int d, uint i);
+  explicit simplicial_regular_mesh_element_fixed(const simplicial_regular_mesh_element& e);
+
+  operator simplicial_regular_mesh_element() const;
+  bool operator==(const simplicial_regular_mesh_element_fixed& e) const {return dim == e.dim && type == e.type && corner == e.corner;}
+  bool operator!=(const simplicial_regular_mesh_element_fixed& e) const {return !(*this == e);}
+
+  // writes dim+1 vertices to v and returns the number of vertices
+  int vertices(const simplicial_regular_mesh& m, int v[][ND]) const;
+
+  bool valid(const simplicial_regular_mesh& m) const;
+  bool is_ordinal(const simplicial_regular_mesh& m) const {return m.is_unit_simplex_type_ordinal[dim][type];}
+
+  void from_work_index(const simplicial_regular_mesh& m, size_t, const lattice& l, int scope = ELEMENT_SCOPE_ALL);
+
+  template <typename uint = uint64_t> uint to_integer(const simplicial_regular_mesh& m) const;
+  template <typename uint = uint64_t> void from_integer(const simplicial_regular_mesh& m, uint i);
+
+  // visit (d-1)-dimensional sides and (d+1)-dimensional cofaces w/o allocations
+  template <typename F> void foreach_side(const simplicial_regular_mesh& m, F f) const;
+  template <typename F> void foreach_side_of(const simplicial_regular_mesh& m, F f) const;
+
+  std::array<int, ND> corner;
+  int dim, type;
+};
+
 
 
 //////////////////////////////////
@@ -1044,6 +1107,181 @@ inline void simplicial_regular_mesh::element_for(
   parallel_for(ntasks, lambda, accelerator, nthreads, affinity);
 }
 
+template <int ND>
+inline void simplicial_regular_mesh::element_for_fixed(
+    int d, const lattice& l, int scope, 
+    std::function<void(const simplicial_regular_mesh_element_fixed<ND>&)> f,
+    int accelerator, int nthreads, bool affinity) const
+{
+  assert(ND == nd());
+
+  auto lambda = [=](size_t j) {
+    simplicial_regular_mesh_element_fixed<ND> e(*this, d, j, l, scope);
+    f(e);
+  };
+
+  const auto ntasks = l.n() * ntypes(d, scope);
+
+  parallel_for(ntasks, lambda, accelerator, nthreads, affinity);
+}
+
+template <int ND>
+inline void simplicial_regular_mesh::element_for_ordinal_fixed(
+    int d, int t, 
+    std::function<void(const simplicial_regular_mesh_element_fixed<ND>&)> f,
+    int accelerator, int nthreads, bool affinity) const
+{
+  auto st = lattice_.starts(), sz = lattice_.sizes();
+  st[nd()-1] = t;
+  sz[nd()-1] = 1;
+
+  lattice my_lattice(st, sz);
+  element_for_fixed<ND>(d, my_lattice, ELEMENT_SCOPE_ORDINAL, f, 
+      accelerator, nthreads, affinity);
+}
+
+template <int ND>
+inline void simplicial_regular_mesh::element_for_interval_fixed(
+    int d, int t0, int t1, 
+    std::function<void(const simplicial_regular_mesh_element_fixed<ND>&)> f,
+    int accelerator, int nthreads, bool affinity) const
+{
+  auto st = lattice_.starts(), sz = lattice_.sizes();
+  st[nd()-1] = t0;
+  sz[nd()-1] = std::max(1, t1 - t0); // intervals starting at t0, ..., t1-1
+
+  lattice my_lattice(st, sz);
+  element_for_fixed<ND>(d, my_lattice, ELEMENT_SCOPE_INTERVAL, f, 
+      accelerator, nthreads, affinity);
+}
+
+/////
+template <int ND>
+inline simplicial_regular_mesh_element_fixed<ND>::simplicial_regular_mesh_element_fixed(
+    const simplicial_regular_mesh &m, int d, size_t i, const lattice& l, int scope)
+  : dim(d)
+{
+  from_work_index(m, i, l, scope);
+}
+
+template <int ND>
+template <typename uint>
+inline simplicial_regular_mesh_element_fixed<ND>::simplicial_regular_mesh_element_fixed(
+    const simplicial_regular_mesh& m, int d, uint i)
+  : dim(d)
+{
+  from_integer(m, i);
+}
+
+template <int ND>
+inline simplicial_regular_mesh_element_fixed<ND>::simplicial_regular_mesh_element_fixed(
+    const simplicial_regular_mesh_element& e)
+  : dim(e.dim), type(e.type)
+{
+  assert(e.corner.size() == ND);
+  std::copy(e.corner.begin(), e.corner.end(), corner.begin());
+}
+
+template <int ND>
+inline simplicial_regular_mesh_element_fixed<ND>::operator simplicial_regular_mesh_element() const
+{
+  return simplicial_regular_mesh_element(
+      std::vector<int>(corner.begin(), corner.end()), dim, type);
+}
+
+template <int ND>
+inline int simplicial_regular_mesh_element_fixed<ND>::vertices(const simplicial_regular_mesh& m, int v[][ND]) const
+{
+  const auto &unit_vertices = m.unit_simplices[dim][type];
+  for (int i = 0; i < unit_vertices.size(); i ++)
+    for (int j = 0; j < ND; j ++)
+      v[i][j] = corner[j] + unit_vertices[i][j];
+  return unit_vertices.size();
+}
+
+template <int ND>
+inline bool simplicial_regular_mesh_element_fixed<ND>::valid(const simplicial_regular_mesh& m) const
+{
+  if (type < 0 || type >= m.ntypes(dim)) return false;
+  
+  const auto &unit_vertices = m.unit_simplices[dim][type];
+  for (int i = 0; i < unit_vertices.size(); i ++)
+    for (int j = 0; j < ND; j ++) {
+      const int x = corner[j] + unit_vertices[i][j];
+      if (x < m.lb(j) || x > m.ub(j))
+        return false;
+    }
+  return true;
+}
+
+template <int ND>
+inline void simplicial_regular_mesh_element_fixed<ND>::from_work_index(
+    const simplicial_regular_mesh& m, size_t i, const lattice& l, int scope)
+{
+  const auto nt = m.ntypes(dim, scope);
+  const auto itype = i % nt;
+  const auto ii = i / nt;
+ 
+  if (scope == ELEMENT_SCOPE_ORDINAL) type = m.unit_ordinal_simplex_types[dim][itype];
+  else if (scope == ELEMENT_SCOPE_INTERVAL) type = m.unit_interval_simplex_types[dim][itype];
+  else type = itype;
+
+  l.from_integer(ii, corner.data());
+}
+
+template <int ND>
+template <typename uint>
+uint simplicial_regular_mesh_element_fixed<ND>::to_integer(const simplicial_regular_mesh& m) const
+{
+  uint corner_index = 0;
+  for (int i = 0; i < ND; i ++)
+    corner_index += (corner[i] - m.lb(i)) * m.dimprod_[i];
+  return corner_index * m.ntypes(dim) + type;
+}
+
+template <int ND>
+template <typename uint>
+void simplicial_regular_mesh_element_fixed<ND>::from_integer(const simplicial_regular_mesh& m, uint index)
+{
+  type = index % m.ntypes(dim);
+  uint corner_index = index / m.ntypes(dim);
+
+  for (int i = ND - 1; i >= 0; i --) {
+    corner[i] = corner_index / m.dimprod_[i]; 
+    corner_index -= corner[i] * m.dimprod_[i];
+  }
+  for (int i = 0; i < ND; i ++) 
+    corner[i] += m.lb(i);
+}
+
+template <int ND>
+template <typename F>
+void simplicial_regular_mesh_element_fixed<ND>::foreach_side(const simplicial_regular_mesh& m, F f) const
+{
+  for (const auto &s : m.unit_simplex_sides[dim][type]) {
+    simplicial_regular_mesh_element_fixed<ND> side(dim-1);
+    side.type = std::get<0>(s);
+    const auto &offset = std::get<1>(s);
+    for (int i = 0; i < ND; i ++) 
+      side.corner[i] = corner[i] + offset[i];
+    f(side);
+  }
+}
+
+template <int ND>
+template <typename F>
+void simplicial_regular_mesh_element_fixed<ND>::foreach_side_of(const simplicial_regular_mesh& m, F f) const
+{
+  for (const auto &s : m.unit_simplex_side_of[dim][type]) {
+    simplicial_regular_mesh_element_fixed<ND> e(dim+1);
+    e.type = std::get<0>(s);
+    const auto &offset = std::get<1>(s);
+    for (int i = 0; i < ND; i ++) 
+      e.corner[i] = corner[i] + offset[i];
+    f(e);
+  }
+}
+
 #if 0 // FTK_HAVE_VTK
 inline std::shared_ptr<simplicial_regular_mesh> simplicial_regular_mesh::from_vtr(vtkSmartPointer<vtkRectilinearGrid> grid)
 {
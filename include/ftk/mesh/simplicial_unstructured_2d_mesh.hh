@@ -4,6 +4,8 @@
 #include <ftk/config.hh>
 #include <ftk/algorithms/bfs.hh>
 #include <ftk/mesh/simplicial_unstructured_mesh.hh>
+#include <ftk/mesh/simplex_csr.hh>
+#include <ftk/mesh/smoothing_kernel.hh>
 #include <ftk/numeric/linear_interpolation.hh>
 #include <ftk/numeric/gradient.hh>
 #include <ftk/numeric/sign_det.hh>
@@ -17,32 +19,6 @@ namespace ftk {
 
 template <typename I, typename F> struct point_locator_2d;
 
-template <typename I=int>
-struct hash_compare_tuple_i2 {
-  hash_compare_tuple_i2() {}
-  hash_compare_tuple_i2(const hash_compare_tuple_i2&) {}
-  ~hash_compare_tuple_i2() {}
-
-  bool equal(const std::tuple<I, I>& a, const std::tuple<I, I>& b) const { return a == b; }
-  size_t hash(const std::tuple<I, I>& x) const {
-    I a = std::get<0>(x), b = std::get<1>(x);
-    return a * b * 2654435761;
-  };
-};
-
-template <typename I=int>
-struct hash_compare_tuple_i3 {
-  hash_compare_tuple_i3() {}
-  hash_compare_tuple_i3(const hash_compare_tuple_i3&) {}
-  ~hash_compare_tuple_i3() {}
-
-  bool equal(const std::tuple<I, I, I>& a, const std::tuple<I, I, I>& b) const { return a == b; }
-  size_t hash(const std::tuple<I, I, I>& x) const {
-    I a = std::get<0>(x), b = std::get<1>(x), c = std::get<2>(x);
-    return a * b * c * 2654435761;
-  };
-};
-
 template <typename I=int, typename F=double>
 struct simplicial_unstructured_2d_mesh : // 2D triangular mesh
   public simplicial_unstructured_mesh<I, F>
@@ -67,18 +43,22 @@ struct simplicial_unstructured_2d_mesh : // 2D triangular mesh
   // numer of d-dimensional elements
   size_t n(int d, bool part=false) const;
 
+  // hash of vertex coordinates and triangles, used as the key of cache files
+  uint64_t hash() const { return (uint64_t(vertex_coords.hash()) << 32) | triangles.hash(); }
+
   void build_edges();
   void build_triangles();
 
   void build_smoothing_kernel_cached(F sigma);
   std::string default_smoothing_kernel_filename(F sigma) const;
 
-  bool has_smoothing_kernel() const { return smoothing_kernel.size() > 0; }
+  bool has_smoothing_kernel() const { return !smoothing_kernel.empty(); }
   void build_smoothing_kernel(F sigma);
-  const std::vector<std::vector<std::tuple<I, F>>> &get_smoothing_kernel() const { return smoothing_kernel; }
-  F get_smoothing_kernel_size() const { return sigma; }
+  std::vector<std::vector<std::tuple<I, F>>> get_smoothing_kernel() const { return smoothing_kernel.to_lists(); }
+  const smoothing_kernel_csr<I, F, 2>& get_smoothing_kernel_csr() const { return smoothing_kernel; }
+  F get_smoothing_kernel_size() const { return smoothing_kernel.get_sigma(); }
   void smooth_scalar_gradient_jacobian(
-      const ndarray<F>& f, 
+      const ndarray<F>& f, // n_vertices, or n_vertices * n_planes for a batch of planes
       // const F sigma,
       ndarray<F>& fs, // smoothed scalar field
       ndarray<F>& g,  // smoothed gradient field
@@ -142,7 +122,8 @@ public: // mesh access
   const ndarray<I>& get_edges() const {return edges;}
   const std::vector<std::set<I>>& get_vertex_triangles() const {return vertex_triangles;}
   
-  const std::set<I>& get_vertex_edge_vertex(I i) const {return vertex_edge_vertex[i];}
+  std::set<I> get_vertex_edge_vertex(I i) const {return vertex_edge_vertex.set(i);}
+  const csr_adjacency<I>& get_vertex_edge_vertex_csr() const {return vertex_edge_vertex;}
   
   int get_triangle_chi(I i) const { return triangles_chi[i] ? -1 : 1; }
 
@@ -161,13 +142,13 @@ protected:
 
 protected: // mesh connectivities
   ndarray<F> vertex_coords; // 2 * n_vertices
-  std::vector<std::set<I>> vertex_side_of;
-  std::vector<std::set<I>> vertex_edge_vertex;
+  csr_adjacency<I> vertex_side_of;
+  csr_adjacency<I> vertex_edge_vertex;
   std::vector<std::set<I>> vertex_triangles;
 
-  ndarray<I> edges; // 2 * n_edges
+  ndarray<I> edges; // 2 * n_edges, sorted
+  std::vector<size_t> edge_index; // first vertex to edges
   ndarray<I> edges_side_of; // 2 * n_edges
-  // std::map<std::tuple<I, I>, std::set<I>> edges_side_of;
 
   ndarray<I> triangles; // 3 * n_triangles
   ndarray<I> triangle_edges; // 3 * n_triangles
@@ -175,15 +156,6 @@ protected: // mesh connectivities
   
   std::vector<std::set<I>> triangle_edge_triangles;
 
-public: // additional mesh info
-#if FTK_HAVE_TBB
-  tbb::concurrent_hash_map<std::tuple<I, I>, int, hash_compare_tuple_i2<I>> edge_id_map;
-  tbb::concurrent_hash_map<std::tuple<I, I, I>, int, hash_compare_tuple_i3<I>> triangle_id_map;
-#else
-  std::map<std::tuple<I, I>, int> edge_id_map;
-  std::map<std::tuple<I, I, I>, int> triangle_id_map;
-#endif
-
 public: // partition
   bool is_partial() const { return partial; }
   I lid2gid(int d, I) const; // translate ID in the local partition to global ID
@@ -195,8 +167,7 @@ protected: // parallel partition
   std::map<I/*gid*/, I/*lid*/> part_triangles_gid, part_edges_gid, part_vertices_gid;
 
 private:
-  F sigma; // smoothing kernel size
-  std::vector<std::vector<std::tuple<I/*vert*/, F/*weight*/>>> smoothing_kernel;
+  smoothing_kernel_csr<I, F, 2> smoothing_kernel;
 };
 
 
@@ -240,9 +211,7 @@ template <typename I, typename F>
 void simplicial_unstructured_2d_mesh<I, F>::build_smoothing_kernel_cached(F sigma)
 {
   const auto f = default_smoothing_kernel_filename(sigma);
-  if (file_exists(f))
-    read_smoothing_kernel(f);
-  else {
+  if (!file_exists(f) || !read_smoothing_kernel(f) || smoothing_kernel.get_sigma() != sigma) {
     build_smoothing_kernel(sigma);
     write_smoothing_kernel(f);
   }
@@ -315,58 +284,28 @@ bool simplicial_unstructured_2d_mesh<I, F>::find_edge(const I v_[2], I &i) const
   I v[2] = {v_[0], v_[1]};
   if (v[0] > v[1]) std::swap(v[0], v[1]);
 
-#if FTK_HAVE_TBB
-  typename tbb::concurrent_hash_map<std::tuple<I, I>, int, hash_compare_tuple_i2<I>>::const_accessor it;
-  bool found = edge_id_map.find(it, std::make_tuple(v[0], v[1]));
-  if (found) {
-    i = it->second;
-    assert(edges(0, i) == v[0]);
-    assert(edges(1, i) == v[1]);
-    return true;
-  } else 
-    return false;
-#else
-  const auto it = edge_id_map.find( std::make_tuple(v[0], v[1]) );
-  if (it == edge_id_map.end()) return false;
-  else {
-    i = it->second;
-    // fprintf(stderr, "edges(0,i)=%d, v[0]=%d\n", edges(0, i), v[0]);
-    // fprintf(stderr, "edges(1,i)=%d, v[1]=%d\n", edges(1, i), v[1]);
-    assert(edges(0, i) == v[0]);
-    assert(edges(1, i) == v[1]);
-    return true;
-  }
-#endif
+  const auto &e = edges.std_vector();
+  return find_sorted_simplex<I, 2>(e, edge_index, v, i);
 }
 
 template <typename I, typename F>
 bool simplicial_unstructured_2d_mesh<I, F>::find_triangle(const I v_[3], I &i) const
 {
-  int v[3] = {v_[0], v_[1], v_[2]};
+  I v[3] = {v_[0], v_[1], v_[2]};
   std::sort(v, v+3);
 
-#if FTK_HAVE_TBB
-  typename tbb::concurrent_hash_map<std::tuple<I, I, I>, int, hash_compare_tuple_i3<I>>::const_accessor it;
-  bool found = triangle_id_map.find(it, std::make_tuple(v[0], v[1], v[2]));
-  if (found) {
-    i = it->second;
-    assert(triangles(0, i) == v[0]);
-    assert(triangles(1, i) == v[1]);
-    assert(triangles(2, i) == v[2]);
-    return true;
-  } else 
-    return false;
-#else
-  const auto it = triangle_id_map.find( std::make_tuple(v[0], v[1], v[2]) );
-  if (it == triangle_id_map.end()) return false;
-  else {
-    i = it->second;
-    assert(triangles(0, i) == v[0]);
-    assert(triangles(1, i) == v[1]);
-    assert(triangles(2, i) == v[2]);
-    return true;
+  // the triangle is one of the (at most two) triangles of the edge v0-v1
+  I e;
+  if (!find_edge(v, e)) return false;
+
+  for (int j = 0; j < 2; j ++) {
+    const I t = edges_side_of(j, e);
+    if (t >= 0 && triangles(2, t) == v[2]) {
+      i = t;
+      return true;
+    }
   }
-#endif
+  return false;
 }
 
 template <typename I, typename F>
@@ -390,9 +329,6 @@ void simplicial_unstructured_2d_mesh<I, F>::build_triangles()
     for (auto j = 0; j < 3; j ++)
       triangles(j, i) = v[j];
 
-    // triangle_id_map[ std::make_tuple(v[0], v[1], v[2]) ] = i;
-    triangle_id_map.insert( { std::make_tuple(v[0], v[1], v[2]), i } );
-
     for (int j = 0; j < 3; j ++)
       vertex_triangles[v[j]].insert(i);
   }
@@ -401,93 +337,35 @@ void simplicial_unstructured_2d_mesh<I, F>::build_triangles()
 template <typename I, typename F>
 void simplicial_unstructured_2d_mesh<I, F>::build_edges()
 {
-  // std::map<std::tuple<I, I>, std::set<I>> map_edges_side_of;
-  std::map<I, std::set<I>> map_edges_side_of;
-
-  int edge_count = 0;
-  auto add_edge = [&](I tid, I k, I v0, I v1) {
-    if (v0 > v1) std::swap(v0, v1);
-    const auto edge = std::make_tuple(v0, v1);
-    I id;
-#if FTK_HAVE_TBB
-    typename tbb::concurrent_hash_map<std::tuple<I, I>, int, hash_compare_tuple_i2<I>>::const_accessor it;
-    bool found = edge_id_map.find(it, edge);
-    if (!found) {
-      id = edge_count ++;
-      edge_id_map.insert( {edge, id} );
-    } else 
-      id = it->second;
-#else
-    if (edge_id_map.find(edge) == edge_id_map.end()) {
-      id = edge_count ++;
-      edge_id_map[edge] = id;
-    } else 
-      id = edge_id_map[edge];
-#endif
+  std::vector<I> edge_verts, tri_edges;
+  csr_adjacency<I> edge_triangles;
 
-    map_edges_side_of[id].insert(tid);
-    triangle_edges(k, tid) = id;
+  build_sorted_simplices<I, 2>(n(0), n(2), 3, 
+    [&](size_t i, int k, I v[2]) { // k-th edge is (k, k+1)
+      v[0] = triangles(k, i);
+      v[1] = triangles((k+1)%3, i);
+      if (v[0] > v[1]) std::swap(v[0], v[1]);
+    }, edge_verts, edge_index, tri_edges, edge_triangles);
 
-    // fprintf(stderr, "adding edge #%d (%d, %d) from triangle %d\n", id, v0, v1, tid);
-    // if (v0 == 0 && v1 == 1) {
-    //   fprintf(stderr, "{0, 1}, tid=%d\n", tid);
-    //   exit(1);
-    // }
-  };
+  const size_t nedges = edge_verts.size() / 2;
+  edges.copy_vector(edge_verts);
+  edges.reshape(2, nedges);
 
-  // fprintf(stderr, "triangles_88078=%d, %d, %d\n", triangles(0, 88078), triangles(1, 88078), triangles(2, 88078)); 
+  triangle_edges.copy_vector(tri_edges);
   triangle_edges.reshape(3, n(2));
-  for (auto i = 0; i < n(2); i ++) {
-    add_edge(i, 0, triangles(0, i), triangles(1, i));
-    add_edge(i, 1, triangles(1, i), triangles(2, i));
-    add_edge(i, 2, triangles(2, i), triangles(0, i));
-  }
-
-  edges.reshape(2, edge_id_map.size());
-  edges_side_of.reshape({2, edge_id_map.size()}, -1);
-  // int i = 0;
-  for (const auto &kv : edge_id_map) {
-    edges(0, kv.second) = std::get<0>(kv.first);
-    edges(1, kv.second) = std::get<1>(kv.first);
 
+  edges_side_of.reshape({2, nedges}, -1);
+  for (size_t i = 0; i < nedges; i ++) {
     int j = 0;
-    for (const auto tid : map_edges_side_of[kv.second])
-    // for (const auto tid : map_edges_side_of[i])
-      edges_side_of(j++, kv.second) = tid;
+    for (const I *p = edge_triangles.begin(i); p != edge_triangles.end(i) && j < 2; p ++)
+      edges_side_of(j++, i) = *p;
   }
 
-  // for (auto i = 0; i < edges_side_of.dim(1); i ++)
-  //   fprintf(stderr, "i=%d, tri0=%d, tri1=%d\n", i, edges_side_of(0, i), edges_side_of(1, i));
-
-#if 0
-  {
-    I v[2] = {0, 1};
-    I e;
-    find_edge(v, e);
-    auto s = side_of(1, e);
-    // auto s = edges_side_of[std::make_tuple(v[0], v[1])];
-    fprintf(stderr, "%zu, %d\n", s.size(), *s.begin());
-  }
-#endif
-  // exit(1);
-
-  vertex_side_of.resize(vertex_coords.dim(1));
-  // fprintf(stderr, "resizing vertex_side_of, %zu\n", vertex_coords.dim(1));
-
-  vertex_edge_vertex.resize(n(0));
-  for (const auto &kv : edge_id_map) {
-    const auto v0 = std::get<0>(kv.first),
-               v1 = std::get<1>(kv.first);
-    vertex_side_of[v0].insert(kv.second);
-    vertex_side_of[v1].insert(kv.second);
-  
-    vertex_edge_vertex[v0].insert(v1);
-    vertex_edge_vertex[v1].insert(v0);
-  }
+  build_vertex_edge_csr<I>(n(0), edge_verts, vertex_side_of, vertex_edge_vertex);
 
   // triangle_edge_triangles
   triangle_edge_triangles.resize(n(2));
-  for (int i = 0; i < n(2); i ++) {
+  for (size_t i = 0; i < nedges; i ++) {
     const I t0 = edges_side_of(0, i), 
             t1 = edges_side_of(1, i);
     if (t0 >= 0 && t1 >= 0) {
@@ -501,80 +379,16 @@ template <typename I, typename F>
 inline void simplicial_unstructured_2d_mesh<I, F>::build_smoothing_kernel(const F sigma)
 {
   fprintf(stderr, "building smoothing kernel...\n");
-  this->sigma = sigma;
-
-  const F sigma2 = sigma * sigma;
-  const F limit = F(3) * sigma;
-
-  auto neighbors = [&](I i) { return vertex_edge_vertex[i]; };
-  smoothing_kernel.resize(n(0));
-
-  // for (auto i = 0; i < n(0); i ++) {
-  object::parallel_for(n(0), [&](int i) {
-    std::set<I> set;
-    // const F xi[2] = {vertex_coords[i*2], vertex_coords[i*2+1]};
-    const F xi[2] = {vertex_coords(0, i), vertex_coords(1, i)};
-
-    auto criteron = [&](I j) {
-      // const F xj[2] = {vertex_coords[j*2], vertex_coords[j*2+1]};
-      const F xj[2] = {vertex_coords(0, j), vertex_coords(1, j)};
-      if (vector_dist_2norm_2(xi, xj) < limit) {
-        // fprintf(stderr, "%d (%f, %f) add %d (%f, %f)\n", i, xi[0], xi[1], j, xj[0], xj[1]);
-        // fprintf(stderr, "i=%d, x={%f, %f}\n", i, xi[0], xi[1]);
-        return true;
-      }
-      else return false;
-    };
-
-    auto operation = [&set](I j) {set.insert(j);};
-    // fprintf(stderr, "bfs for node %d...\n", i);
-    bfs<I, std::set<I>>(i, neighbors, operation, criteron);
-    // fprintf(stderr, "bfs for node %d done.\n", i);
-
-    auto &kernel = smoothing_kernel[i];
-    for (auto k : set) {
-      // const F xk[2] = {vertex_coords[2*k], vertex_coords[2*k+1]};
-      const F xk[2] = {vertex_coords(0, k), vertex_coords(1, k)};
-      const F d = vector_dist_2norm_2(xi, xk);
-      const F w = std::exp(-(d*d) / (2*sigma*sigma)) / (sigma * std::sqrt(2.0 * M_PI));
-      // fprintf(stderr, "d2=%f, w=%f\n", d2, w);
-      kernel.push_back( std::make_tuple(k, w) );
-      // fprintf(stderr, "i=%d, k=%d, %f\n", i, k, w); 
-    }
-
-    // normalization
-#if 0
-    F sum = 0;
-    for (int k = 0; k < kernel.size(); k ++)
-      sum += std::get<1>(kernel[k]);
-    for (int k = 0; k < kernel.size(); k ++) {
-      std::get<1>(kernel[k]) /= sum;
-      fprintf(stderr, "i=%d, k=%d, %f\n", i, k, std::get<1>(kernel[k]));// kernel.size());
-    }
-#endif
-  });
+  smoothing_kernel.build(vertex_coords, sigma);
 }
 
 template <typename I, typename F>
 ndarray<F> simplicial_unstructured_2d_mesh<I, F>::smooth_scalar(const ndarray<F>& f) const
 {
-  const F sigma2 = sigma * sigma, 
-          sigma4 = sigma2 * sigma2;
-
   ndarray<F> scalar;
-  scalar.reshape({n(0)});
-
-  // for (auto i = 0; i < smoothing_kernel.size(); i ++) {
-  this->parallel_for(smoothing_kernel.size(), [&](int i) {
-    for (auto j = 0; j < smoothing_kernel[i].size(); j ++) {
-      auto tuple = smoothing_kernel[i][j];
-      const auto k = std::get<0>(tuple);
-      const auto w = std::get<1>(tuple);
-
-      scalar[i] += f[k] * w;
-    }
-  });
+  scalar.reshape(f);
 
+  smoothing_kernel.apply(f.nelem() / n(0), f.data(), scalar.data(), NULL, NULL);
   return scalar;
 }
 
@@ -585,41 +399,21 @@ void simplicial_unstructured_2d_mesh<I, F>::smooth_scalar_gradient_jacobian(
     ndarray<F>& grad,  // smoothed gradient field
     ndarray<F>& J) const // smoothed jacobian field
 {
-  const F sigma2 = sigma * sigma, 
-          sigma4 = sigma2 * sigma2;
+  const size_t nplanes = f.nelem() / n(0);
 
-  scalar.reshape({n(0)});
-  grad.reshape({2, n(0)});
-  J.reshape({2, 2, n(0)});
-
-  // for (auto i = 0; i < smoothing_kernel.size(); i ++) {
-  this->parallel_for(smoothing_kernel.size(), [&](int i) {
-    for (auto j = 0; j < smoothing_kernel[i].size(); j ++) {
-      auto tuple = smoothing_kernel[i][j];
-      const auto k = std::get<0>(tuple);
-      const auto w = std::get<1>(tuple);
-    
-      // const F d[2] = {vertex_coords[k*2] - vertex_coords[i*2], 
-      //                 vertex_coords[k*2+1] - vertex_coords[i*2+1]};
-      const F d[2] = {vertex_coords(0, k) - vertex_coords(0, i),
-                      vertex_coords(1, k) - vertex_coords(1, i)};
-      // const F r2 = d[0]*d[0] + d[1]*d[1];
-      // const F r = std::sqrt(r2);
-
-      // scalar
-      scalar[i] += f[k] * w;
-
-      // gradient
-      grad(0, i) += - f[k] * w * d[0] / sigma2;
-      grad(1, i) += - f[k] * w * d[1] / sigma2;
-
-      // jacobian
-      J(0, 0, i) += (d[0]*d[0] / sigma2 - 1) / sigma2 * f[k] * w;
-      J(0, 1, i) += d[0]*d[1] / sigma4 * f[k] * w;
-      J(1, 0, i) += d[0]*d[1] / sigma4 * f[k] * w;
-      J(1, 1, i) += (d[1]*d[1] / sigma2 - 1) / sigma2 * f[k] * w;
-    }
-  });
+  if (nplanes == 1) {
+    scalar.reshape({n(0)});
+    grad.reshape({2, n(0)});
+    J.reshape({2, 2, n(0)});
+  } else {
+    scalar.reshape({n(0), nplanes});
+    grad.reshape({2, n(0), nplanes});
+    J.reshape({2, 2, n(0), nplanes});
+    grad.set_multicomponents(1);
+    J.set_multicomponents(2);
+  }
+
+  smoothing_kernel.apply(nplanes, f.data(), scalar.data(), grad.data(), J.data());
 }
 
 template <typename I, typename F>
@@ -746,7 +540,7 @@ template <typename I, typename F>
 std::set<I> simplicial_unstructured_2d_mesh<I, F>::side_of(int d, I i) const
 {
   if (d == 0)
-    return vertex_side_of[i];
+    return vertex_side_of.set(i);
   else if (d == 1) {
     std::set<I> results;
     for (int j = 0; j < 2; j ++) 
@@ -903,14 +697,22 @@ template <typename I, typename F>
 void simplicial_unstructured_2d_mesh<I, F>::write_smoothing_kernel(const std::string& f)
 {
   fprintf(stderr, "writing smoothing kernel to %s\n", f.c_str());
-  diy::serializeToFile(sigma, smoothing_kernel, f);
+  smoothing_kernel.write_mapped(f, hash());
 }
 
 template <typename I, typename F>
 bool simplicial_unstructured_2d_mesh<I, F>::read_smoothing_kernel(const std::string& f)
 {
   fprintf(stderr, "reading smoothing kernel from %s\n", f.c_str());
-  bool succ = diy::unserializeFromFile(f, sigma, smoothing_kernel);
+  if (mapped_cache_file::is_cache_file(f))
+    return smoothing_kernel.read_mapped(f, hash());
+
+  // legacy format: sigma followed by per-vertex lists
+  F sigma;
+  std::vector<std::vector<std::tuple<I, F>>> lists;
+  bool succ = diy::unserializeFromFile(f, sigma, lists);
+  if (succ)
+    smoothing_kernel.from_lists(vertex_coords, sigma, lists);
   return succ;
 }
 
@@ -1143,11 +945,10 @@ namespace diy {
       diy::save(bb, m.vertex_side_of);
       diy::save(bb, m.vertex_edge_vertex);
       diy::save(bb, m.edges);
+      diy::save(bb, m.edge_index);
       diy::save(bb, m.edges_side_of);
       diy::save(bb, m.triangles);
       diy::save(bb, m.triangle_edges);
-      diy::save(bb, m.edge_id_map);
-      diy::save(bb, m.triangle_id_map);
     }
    
     static void load(diy::BinaryBuffer& bb, ftk::simplicial_unstructured_2d_mesh<I, F>& m) {
@@ -1155,11 +956,10 @@ namespace diy {
       diy::load(bb, m.vertex_side_of);
       diy::load(bb, m.vertex_edge_vertex);
       diy::load(bb, m.edges);
+      diy::load(bb, m.edge_index);
       diy::load(bb, m.edges_side_of);
       diy::load(bb, m.triangles);
       diy::load(bb, m.triangle_edges);
-      diy::load(bb, m.edge_id_map);
-      diy::load(bb, m.triangle_id_map);
     }
   };
 } // namespace diy
@@ -3,8 +3,10 @@
 
 #include <ftk/config.hh>
 #include <ftk/mesh/simplicial_unstructured_mesh.hh>
+#include <ftk/mesh/simplex_csr.hh>
 #include <ftk/utils/string.hh>
 #include <ftk/numeric/sign_det.hh>
+#include <ftk/numeric/matrix_inverse.hh>
 
 namespace ftk {
 
@@ -30,6 +32,12 @@ struct simplicial_unstructured_3d_mesh : public simplicial_unstructured_mesh<I,
       ndarray<F>& j   // smoothed jacobian field
   ) const; 
 
+  // least-squares gradients at vertices over the edge-connected neighbors, 
+  // exact for linear fields.  f has nc components per vertex, i.e. (n0) 
+  // or (nc, n0); the result is (3, n0) or (3, nc, n0), e.g. the jacobian
+  // J(j1, j, i) = dv_j/dx_j1 of a vector field v in (3, n0)
+  ndarray<F> vertex_gradient(const ndarray<F>& f) const;
+
 public: // io
   static std::shared_ptr<simplicial_unstructured_3d_mesh<I, F>> from_file(const std::string& filename);
   void to_file(const std::string &filename) const;
@@ -55,7 +63,7 @@ private: // use get_simplex() and find_simplex instead
   const std::vector<std::tuple<I, I, I, I>>& get_tets() const {return tetrahedra;}
 
 public:
-  virtual std::set<I> sides(int d, I i) const { return std::set<int>(); } // TODO
+  virtual std::set<I> sides(int d, I i) const;
   virtual std::set<I> side_of(int d, I i) const;
 
   virtual void get_simplex(int d, I i, I simplex[]) const;
@@ -63,6 +71,7 @@ public:
   virtual void get_coords(I i, F coords[]) const;
 
   virtual const ndarray<F>& get_coords() const {return vertex_coords;}
+  const csr_adjacency<I>& get_vertex_edge_vertex_csr() const {return vertex_edge_vertex;}
 
 private:
   void initialize(bool reorder = false);
@@ -73,28 +82,22 @@ private:
 
 private: // mesh conn
   ndarray<F> vertex_coords; // 3*n_vert
-  std::vector<std::set<I>> vertex_side_of;
-  std::vector<std::set<I>> vertex_edge_vertex;
+  csr_adjacency<I> vertex_side_of;
+  csr_adjacency<I> vertex_edge_vertex;
 
-  // ndarray<I> edges;
-  std::vector<std::tuple<I, I>> edges;
-  std::vector<std::set<I>> edges_side_of;
+  std::vector<I> edges; // 2*n_edges, sorted
+  std::vector<size_t> edge_index; // first vertex to edges
+  csr_adjacency<I> edges_side_of;
 
-  // ndarray<I> triangles;
-  std::vector<std::tuple<I, I, I>> triangles;
-  ndarray<I> triangle_sides;
-  // ndarray<I> triangle_side_of;
-  std::vector<std::set<I>> triangle_side_of;
+  std::vector<I> triangles; // 3*n_triangles, sorted
+  std::vector<size_t> triangle_index; // first vertex to triangles
+  std::vector<I> triangle_sides; // 3*n_triangles
+  csr_adjacency<I> triangle_side_of;
 
   std::vector<std::tuple<I, I, I, I>> tetrahedra;
-  // ndarray<I> tetrahedra;
-  // ndarray<I> tetrahedra_sides;
+  std::vector<I> tetrahedra_sides; // 4*n_tets
 
 public:
-  std::map<std::tuple<I, I>, int> edge_id_map;
-  std::map<std::tuple<I, I, I>, int> triangle_id_map;
-  std::map<std::tuple<I, I, I, I>, int> tetrahedron_id_map;
-  
   std::vector<std::vector<std::tuple<I/*vert*/, F/*weight*/>>> smoothing_kernel;
 };
 
@@ -113,6 +116,8 @@ simplicial_unstructured_3d_mesh<I, F>::simplicial_unstructured_3d_mesh(
 
   // tetrahedra.copy_vector(tetrahedra_);
   // tetrahedra.reshape({4, tetrahedra_.size()/4});
+
+  initialize();
 }
 
 template <typename I, typename F>
@@ -137,151 +142,34 @@ void simplicial_unstructured_3d_mesh<I, F>::build_tetrahedra(bool reorder)
   // sort tets based on ids
   if (reorder)
     std::sort(tetrahedra.begin(), tetrahedra.end());
-
-  // tet id map
-  for (auto i = 0; i < n(3); i ++) {
-    // tetrahedron_id_map[ std::make_tuple(v[0], v[1], v[2], v[3]) ] = i;
-    tetrahedron_id_map[ tetrahedra[i] ] = i;
-  }
 }
 
 template <typename I, typename F>
 void simplicial_unstructured_3d_mesh<I, F>::build_triangles()
 {
-  // std::map<I, std::set<I>> map_triangle_side_of;
-  std::map<std::tuple<I, I, I>, std::set<I>> map_triangle_side_of;
-
-  // int triangle_count = 0;
-  auto add_triangle = [&](I tid, I v0, I v1, I v2) { // vertices are already sorted
-    const auto tri = std::make_tuple(v0, v1, v2);
-    map_triangle_side_of[tri].insert(tid);
-#if 0
-    I id;
-    if (triangle_id_map.find(tri) == triangle_id_map.end()) {
-      id = triangle_count ++;
-      triangle_id_map[tri] = id;
-    } else 
-      id = triangle_id_map[tri];
-
-    map_triangle_side_of[id].insert(tid);
-#endif
-  };
-
-  for (auto i = 0; i < n(3); i ++) {
-    // add_triangle(i, tetrahedra(0, i), tetrahedra(1, i), tetrahedra(2, i));
-    // add_triangle(i, tetrahedra(0, i), tetrahedra(1, i), tetrahedra(3, i));
-    // add_triangle(i, tetrahedra(0, i), tetrahedra(2, i), tetrahedra(3, i));
-    // add_triangle(i, tetrahedra(1, i), tetrahedra(2, i), tetrahedra(3, i));
-    const auto t = tetrahedra[i];
-    add_triangle(i, std::get<0>(t), std::get<1>(t), std::get<2>(t));
-    add_triangle(i, std::get<0>(t), std::get<1>(t), std::get<3>(t));
-    add_triangle(i, std::get<0>(t), std::get<2>(t), std::get<3>(t));
-    add_triangle(i, std::get<1>(t), std::get<2>(t), std::get<3>(t));
-  }
-
-  int count = 0;
-  triangles.resize(map_triangle_side_of.size());
-  triangle_side_of.resize(map_triangle_side_of.size());
-
-  for (const auto &kv : map_triangle_side_of) {
-    triangles[count] = kv.first;
-    triangle_side_of[count] = kv.second;
-    count ++;
-  }
-  
-  // tri id map
-  for (auto i = 0; i < n(2); i ++) {
-    triangle_id_map[ triangles[i] ] = i;
-  }
-
-#if 0
-  triangles.reshape(3, triangle_id_map.size());
-  triangle_side_of.resize(triangle_id_map.size());
-  for (const auto &kv : triangle_id_map) {
-    triangles(0, kv.second) = std::get<0>(kv.first);
-    triangles(1, kv.second) = std::get<1>(kv.first);
-    triangles(2, kv.second) = std::get<2>(kv.first);
-
-    for (const auto tid : map_triangle_side_of[kv.second])
-      triangle_side_of[kv.second].insert(tid);
-  }
-#endif
+  static const int faces[4][3] = {{0, 1, 2}, {0, 1, 3}, {0, 2, 3}, {1, 2, 3}};
+
+  build_sorted_simplices<I, 3>(n(0), n(3), 4, 
+    [&](size_t i, int j, I v[3]) { // vertices of tets are already sorted
+      I tet[4];
+      get_tetrahedron(i, tet);
+      for (int k = 0; k < 3; k ++)
+        v[k] = tet[faces[j][k]];
+    }, triangles, triangle_index, tetrahedra_sides, triangle_side_of);
 }
 
 template <typename I, typename F>
 void simplicial_unstructured_3d_mesh<I, F>::build_edges()
 {
-  // std::map<I, std::set<I>> map_edges_side_of;
-  std::map<std::tuple<I, I>, std::set<I>> map_edge_side_of;
-
-  // int edge_count = 0;
-  auto add_edge = [&](I tid, I v0, I v1) { // v0 < v1
-    const auto edge = std::make_tuple(v0, v1);
-    map_edge_side_of[edge].insert(tid);
-#if 0
-    I id;
-    if (edge_id_map.find(edge) == edge_id_map.end()) {
-      id = edge_count ++;
-      edge_id_map[edge] = id;
-    } else 
-      id = edge_id_map[edge];
-
-    map_edges_side_of[id].insert(tid);
-#endif
-  };
-
-  // fprintf(stderr, "triangles_88078=%d, %d, %d\n", triangles(0, 88078), triangles(1, 88078), triangles(2, 88078)); 
-  for (auto i = 0; i < n(2); i ++) {
-    const auto t = triangles[i];
-    // add_edge(i, triangles(0, i), triangles(1, i));
-    // add_edge(i, triangles(0, i), triangles(2, i));
-    // add_edge(i, triangles(1, i), triangles(2, i));
-    add_edge(i, std::get<0>(t), std::get<1>(t));
-    add_edge(i, std::get<0>(t), std::get<2>(t));
-    add_edge(i, std::get<1>(t), std::get<2>(t));
-  }
+  static const int edges_of_triangle[3][2] = {{0, 1}, {0, 2}, {1, 2}};
 
-  int count = 0;
-  edges.resize(map_edge_side_of.size());
-  edges_side_of.resize(map_edge_side_of.size());
-
-  for (const auto &kv : map_edge_side_of) {
-    edges[count] = kv.first;
-    edges_side_of[count] = kv.second;
-    count ++;
-  }
-
-  // edge id map
-  for (auto i = 0; i < n(1); i ++) {
-    edge_id_map[ edges[i] ] = i;
-  }
+  build_sorted_simplices<I, 2>(n(0), n(2), 3, 
+    [&](size_t i, int j, I v[2]) { // vertices of triangles are already sorted
+      v[0] = triangles[i*3 + edges_of_triangle[j][0]];
+      v[1] = triangles[i*3 + edges_of_triangle[j][1]];
+    }, edges, edge_index, triangle_sides, edges_side_of);
 
-#if 0
-  edges.reshape(2, edge_id_map.size());
-  edges_side_of.resize(edge_id_map.size());
-  for (const auto &kv : edge_id_map) {
-    edges(0, kv.second) = std::get<0>(kv.first);
-    edges(1, kv.second) = std::get<1>(kv.first);
-
-    for (const auto tid : map_edges_side_of[kv.second])
-      edges_side_of[kv.second].insert(tid);
-  }
-#endif
-
-  /////// 
-  vertex_side_of.resize(vertex_coords.dim(1));
-  // fprintf(stderr, "resizing vertex_side_of, %zu\n", vertex_coords.dim(1));
-
-  vertex_edge_vertex.resize(n(0));
-  for (const auto &kv : edge_id_map) {
-    const auto v0 = std::get<0>(kv.first),
-               v1 = std::get<1>(kv.first);
-    vertex_side_of[v0].insert(kv.second);
-    vertex_side_of[v1].insert(kv.second);
-  
-    vertex_edge_vertex[v0].insert(v1);
-    vertex_edge_vertex[v1].insert(v0);
-  }
+  build_vertex_edge_csr<I>(n(0), edges, vertex_side_of, vertex_edge_vertex);
 }
 
 template <typename I, typename F>
@@ -290,11 +178,9 @@ size_t simplicial_unstructured_3d_mesh<I, F>::n(int d, bool part /* TODO */) con
   if (d == 0) 
     return vertex_coords.dim(1);
   else if (d == 1)
-    // return edges.dim(1);
-    return edges.size();
+    return edges.size() / 2;
   else if (d == 2)
-    // return triangles.dim(1);
-    return triangles.size();
+    return triangles.size() / 3;
   else if (d == 3)
     // return tetrahedra.dim(1);
     return tetrahedra.size();
@@ -309,10 +195,7 @@ void simplicial_unstructured_3d_mesh<I, F>::initialize(bool reorder)
   build_edges();
   
   fprintf(stderr, "3d mesh initialized: #tet=%zu, #tri=%zu, #edge=%zu, #vert=%zu\n", 
-      tetrahedron_id_map.size(),
-      triangle_id_map.size(), 
-      edge_id_map.size(),
-      vertex_edge_vertex.size());
+      n(3), n(2), n(1), n(0));
 }
 
 template <typename I, typename F>
@@ -461,18 +344,16 @@ void simplicial_unstructured_3d_mesh<I, F>::get_tetrahedron(I i, I tet[]) const
 template <typename I, typename F>
 void simplicial_unstructured_3d_mesh<I, F>::get_triangle(I i, I tri[]) const
 {
-  const auto t = triangles[i];
-  tri[0] = std::get<0>(t); // triangles(0, i);
-  tri[1] = std::get<1>(t); // triangles(1, i);
-  tri[2] = std::get<2>(t); // triangles(2, i);
+  tri[0] = triangles[i*3];
+  tri[1] = triangles[i*3+1];
+  tri[2] = triangles[i*3+2];
 }
 
 template <typename I, typename F>
 void simplicial_unstructured_3d_mesh<I, F>::get_edge(I i, I v[]) const
 {
-  const auto e = edges[i];
-  v[0] = std::get<0>(e); // edges(0, i);
-  v[1] = std::get<1>(e); // edges(1, i);
+  v[0] = edges[i*2];
+  v[1] = edges[i*2+1];
 }
 
 template <typename I, typename F>
@@ -484,52 +365,38 @@ void simplicial_unstructured_3d_mesh<I, F>::get_coords(I i, F coords[]) const
 }
 
 template <typename I, typename F>
-bool simplicial_unstructured_3d_mesh<I, F>::find_edge(const I v[2], I &i) const
+bool simplicial_unstructured_3d_mesh<I, F>::find_edge(const I v_[2], I &i) const
 {
-  const auto it = edge_id_map.find( std::make_tuple(v[0], v[1]) );
-  if (it == edge_id_map.end()) return false;
-  else {
-    i = it->second;
-    // assert(edges(0, i) == v[0]);
-    // assert(edges(1, i) == v[1]);
-    return true;
-  }
+  I v[2] = {v_[0], v_[1]};
+  if (v[0] > v[1]) std::swap(v[0], v[1]);
+  return find_sorted_simplex<I, 2>(edges, edge_index, v, i);
 }
 
 template <typename I, typename F>
-bool simplicial_unstructured_3d_mesh<I, F>::find_triangle(const I v[3], I &i) const
+bool simplicial_unstructured_3d_mesh<I, F>::find_triangle(const I v_[3], I &i) const
 {
-  i = -1;
-  const auto it = triangle_id_map.find( std::make_tuple(v[0], v[1], v[2]) );
-  if (it == triangle_id_map.end()) return false;
-  else {
-    i = it->second;
-    // fprintf(stderr, "found triangle!!! %d\n", i);
-    // assert(triangles(0, i) == v[0]);
-    // assert(triangles(1, i) == v[1]);
-    // assert(triangles(2, i) == v[2]);
-    return true;
-  }
+  I v[3] = {v_[0], v_[1], v_[2]};
+  std::sort(v, v+3);
+  return find_sorted_simplex<I, 3>(triangles, triangle_index, v, i);
 }
 
 template <typename I, typename F>
-bool simplicial_unstructured_3d_mesh<I, F>::find_tetrahedron(const I v[4], I &i) const
+bool simplicial_unstructured_3d_mesh<I, F>::find_tetrahedron(const I v_[4], I &i) const
 {
-  const auto it = tetrahedron_id_map.find( std::make_tuple(v[0], v[1], v[2], v[3]) );
-  if (it == tetrahedron_id_map.end()) return false;
-  else {
-    i = it->second;
-    // assert(tetrahedra(0, i) == v[0]);
-    // assert(tetrahedra(1, i) == v[1]);
-    // assert(tetrahedra(2, i) == v[2]);
-    // assert(tetrahedra(3, i) == v[3]);
-    const auto t = tetrahedra[i];
-    assert(std::get<0>(t) == v[0]);
-    assert(std::get<1>(t) == v[1]);
-    assert(std::get<2>(t) == v[2]);
-    assert(std::get<3>(t) == v[3]);
-    return true;
+  I v[4] = {v_[0], v_[1], v_[2], v_[3]};
+  std::sort(v, v+4);
+
+  I tri;
+  if (!find_sorted_simplex<I, 3>(triangles, triangle_index, v, tri)) 
+    return false;
+
+  for (const I *p = triangle_side_of.begin(tri); p != triangle_side_of.end(tri); p ++) {
+    if (std::get<3>(tetrahedra[*p]) == v[3]) {
+      i = *p;
+      return true;
+    }
   }
+  return false;
 }
 
 template <typename I, typename F>
@@ -542,15 +409,28 @@ void simplicial_unstructured_3d_mesh<I, F>::element_for(int d, std::function<voi
     assert(false); // not implemented yet
 }
 
+template <typename I, typename F>
+std::set<I> simplicial_unstructured_3d_mesh<I, F>::sides(int d, I i) const
+{
+  if (d == 1)
+    return std::set<I>(edges.begin() + i*2, edges.begin() + i*2 + 2);
+  else if (d == 2)
+    return std::set<I>(triangle_sides.begin() + i*3, triangle_sides.begin() + i*3 + 3);
+  else if (d == 3)
+    return std::set<I>(tetrahedra_sides.begin() + i*4, tetrahedra_sides.begin() + i*4 + 4);
+  else
+    return std::set<I>();
+}
+
 template <typename I, typename F>
 std::set<I> simplicial_unstructured_3d_mesh<I, F>::side_of(int d, I i) const
 {
   if (d == 0)
-    return vertex_side_of[i];
+    return vertex_side_of.set(i);
   else if (d == 1) 
-    return edges_side_of[i];
+    return edges_side_of.set(i);
   else if (d == 2)
-    return triangle_side_of[i];
+    return triangle_side_of.set(i);
   else 
     return std::set<I>();
 }
@@ -561,7 +441,7 @@ inline void simplicial_unstructured_3d_mesh<I, F>::build_smoothing_kernel(const
   const F sigma2 = sigma * sigma;
   const F limit = F(3) * sigma;
 
-  auto neighbors = [&](I i) { return vertex_edge_vertex[i]; };
+  auto neighbors = [&](I i) { return vertex_edge_vertex.vector(i); };
   smoothing_kernel.resize(n(0));
 
   for (auto i = 0; i < n(0); i ++) {
@@ -576,7 +456,7 @@ inline void simplicial_unstructured_3d_mesh<I, F>::build_smoothing_kernel(const
     };
 
     auto operation = [&set](I j) {set.insert(j);};
-    bfs<I, std::set<I>>(i, neighbors, operation, criteron);
+    bfs<I, std::vector<I>>(i, neighbors, operation, criteron);
 
     auto &kernel = smoothing_kernel[i];
     for (auto k : set) {
@@ -650,6 +530,52 @@ void simplicial_unstructured_3d_mesh<I, F>::smooth_scalar_gradient_jacobian(
   });
 }
 
+template <typename I, typename F>
+ndarray<F> simplicial_unstructured_3d_mesh<I, F>::vertex_gradient(const ndarray<F>& f) const
+{
+  const size_t n0 = n(0), nc = f.size() / n0;
+
+  ndarray<F> g;
+  if (nc == 1) g.reshape({3, n0});
+  else g.reshape({3, nc, n0});
+
+  this->parallel_for(n0, [&](int i) {
+    const F *xi = &vertex_coords[i*3];
+    auto delta = [&](I j, F d[3]) {
+      for (int k = 0; k < 3; k ++)
+        d[k] = vertex_coords[j*3+k] - xi[k];
+    };
+
+    F M[3][3] = {0}, Minv[3][3];
+    for (const I *p = vertex_edge_vertex.begin(i); p != vertex_edge_vertex.end(i); p ++) {
+      F d[3];
+      delta(*p, d);
+      for (int k0 = 0; k0 < 3; k0 ++)
+        for (int k1 = 0; k1 < 3; k1 ++)
+          M[k0][k1] += d[k0] * d[k1];
+    }
+
+    const F det = matrix_inverse3x3(M, Minv);
+    if (!(std::abs(det) > std::numeric_limits<F>::epsilon())) // degenerate stencil, leave zeros
+      return;
+
+    for (size_t c = 0; c < nc; c ++) {
+      F b[3] = {0};
+      for (const I *p = vertex_edge_vertex.begin(i); p != vertex_edge_vertex.end(i); p ++) {
+        F d[3];
+        delta(*p, d);
+        const F df = f[*p * nc + c] - f[i*nc + c];
+        for (int k = 0; k < 3; k ++)
+          b[k] += d[k] * df;
+      }
+      for (int k = 0; k < 3; k ++)
+        g[(i*nc + c)*3 + k] = Minv[k][0] * b[0] + Minv[k][1] * b[1] + Minv[k][2] * b[2];
+    }
+  });
+
+  return g;
+}
+
 } // namespace ftk
 
 ///////// serialization
@@ -661,15 +587,14 @@ namespace diy {
       diy::save(bb, m.vertex_side_of);
       diy::save(bb, m.vertex_edge_vertex);
       diy::save(bb, m.edges);
+      diy::save(bb, m.edge_index);
       diy::save(bb, m.edges_side_of);
       diy::save(bb, m.triangles);
-      // diy::save(bb, m.triangle_sides);
+      diy::save(bb, m.triangle_index);
+      diy::save(bb, m.triangle_sides);
       diy::save(bb, m.triangle_side_of);
       diy::save(bb, m.tetrahedra);
-      // diy::save(bb, m.tetrahedra_sides);
-      diy::save(bb, m.edge_id_map);
-      diy::save(bb, m.triangle_id_map);
-      diy::save(bb, m.tetrahedron_id_map);
+      diy::save(bb, m.tetrahedra_sides);
     }
    
     static void load(diy::BinaryBuffer& bb, ftk::simplicial_unstructured_3d_mesh<I, F>& m) {
@@ -677,15 +602,14 @@ namespace diy {
       diy::load(bb, m.vertex_side_of);
       diy::load(bb, m.vertex_edge_vertex);
       diy::load(bb, m.edges);
+      diy::load(bb, m.edge_index);
       diy::load(bb, m.edges_side_of);
       diy::load(bb, m.triangles);
-      // diy::load(bb, m.triangle_sides);
+      diy::load(bb, m.triangle_index);
+      diy::load(bb, m.triangle_sides);
       diy::load(bb, m.triangle_side_of);
       diy::load(bb, m.tetrahedra);
-      // diy::load(bb, m.tetrahedra_sides);
-      diy::load(bb, m.edge_id_map);
-      diy::load(bb, m.triangle_id_map);
-      diy::load(bb, m.tetrahedron_id_map);
+      diy::load(bb, m.tetrahedra_sides);
     }
   };
 } // namespace diy
@@ -26,6 +26,8 @@ struct simplicial_unstructured_extruded_2d_mesh : public object {
   virtual int get_triangle_chi(I i) const;
   bool is_partial() const { return m2->is_partial(); }
 
+  std::shared_ptr<simplicial_unstructured_2d_mesh<I, F>> get_m2() const { return m2; }
+
 public: // element iteration
   void element_for(int d, std::function<void(I)> f, 
       // bool part = false,
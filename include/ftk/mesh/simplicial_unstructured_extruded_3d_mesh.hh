@@ -22,6 +22,8 @@ struct simplicial_unstructured_extruded_3d_mesh : public object { // extruded fr
   I flat_vertex_time(I i) const { return std::floor((double)i / n(0)); } // return i / m->n(0); }
   I extruded_vertex_id(I i, bool t=true) { return t ? i + m->n(0) : i; }
 
+  std::shared_ptr<simplicial_unstructured_3d_mesh<I, F>> get_m3() const { return m; }
+
   int tet_type(I i) const { return simplex_type(3, i); }
   int simplex_type(int d, I i) const;
 
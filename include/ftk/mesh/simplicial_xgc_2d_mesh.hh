@@ -4,6 +4,7 @@
 #include <ftk/config.hh>
 #include <ftk/mesh/simplicial_unstructured_2d_mesh.hh>
 #include <ftk/mesh/point_locator_2d_quad.hh>
+#include <ftk/mesh/point_locator_2d_grid.hh>
 #include <ftk/numeric/linear_interpolation.hh>
 #include <ftk/numeric/fmod.hh>
 #include <ftk/numeric/rk4.hh>
@@ -391,7 +392,7 @@ bool simplicial_xgc_2d_mesh<I, F>::magnetic_map(F rzp[3], F phi_end, int nsteps)
 template <typename I, typename F>
 void simplicial_xgc_2d_mesh<I, F>::initialize_point_locator()
 {
-  this->locator.reset( new point_locator_2d_quad<I, F>(*this) );
+  this->locator.reset( new point_locator_2d_grid<I, F>(*this) );
 }
 
 template <typename I, typename F>
@@ -7,6 +7,7 @@
 #include <ftk/mesh/simplicial_unstructured_extruded_2d_mesh.hh>
 #include <ftk/mesh/simplicial_unstructured_extruded_2d_mesh_implicit.hh>
 #include <ftk/numeric/xgc_interpolant.hh>
+#include <ftk/io/mapped_cache_file.hh>
 
 namespace ftk {
 
@@ -14,6 +15,9 @@ template <typename I=int, typename F=double>
 struct simplicial_xgc_3d_mesh : public simplicial_unstructured_3d_mesh<I, F> {
   simplicial_xgc_3d_mesh(std::shared_ptr<simplicial_xgc_2d_mesh<I, F>> m2_); // nphi and iphi must be specified before using
   simplicial_xgc_3d_mesh(std::shared_ptr<simplicial_xgc_2d_mesh<I, F>> m2_, int nphi, int iphi=1, int vphi=1);
+  // p_interpolants points into the own interpolants or the mapped file; meshes are shared by pointers
+  simplicial_xgc_3d_mesh(const simplicial_xgc_3d_mesh&) = delete;
+  simplicial_xgc_3d_mesh& operator=(const simplicial_xgc_3d_mesh&) = delete;
   // simplicial_xgc_3d_mesh(const std::string& mesh_filename);
 
   std::shared_ptr<simplicial_xgc_2d_mesh<I, F>> get_m2() const {return m2;}
@@ -110,14 +114,23 @@ public:
   void interpolate_central_difference(const ndarray<F>& scalar, const ndarray<F>& grad, const ndarray<F>& jacobian, 
       I i, F f[], F g[2], F j[2][2], I delta) const;
 
-  const xgc_interpolant_t<I, F>& get_interpolant(int v /*virtual plane id*/, I i/*vertex id*/) const { return interpolants[v][i]; }
+  const xgc_interpolant_t<I, F>& get_interpolant(int v /*virtual plane id, 1..vphi-1*/, I i/*vertex id*/) const { 
+    return p_interpolants[size_t(v - 1) * m2->n(0) + i]; 
+  }
  
-  void write_interpolants(const std::string& filename) const { diy::serializeToFile(interpolants, filename); }
-  void read_interpolants(const std::string& filename) { diy::unserializeFromFile(filename, interpolants); }
-  const std::vector<std::vector<xgc_interpolant_t<I, F>>>& get_interpolants() const { return interpolants; }
+  // interpolant files are flat cache files (see mapped_cache_file) keyed by the 
+  // mesh hash and nphi/iphi/vphi, and are used in place through mmap; files in 
+  // the legacy serialized format are still readable
+  void write_interpolants(const std::string& filename) const;
+  bool read_interpolants(const std::string& filename);
+  const xgc_interpolant_t<I, F>* get_interpolants() const { return p_interpolants; } // (vphi-1) * m2n0, starting from virtual plane 1
 
 protected:
-  std::vector<std::vector<xgc_interpolant_t<I, F>>> interpolants;
+  mapped_cache_file::header_t interpolant_cache_key() const;
+
+  std::vector<xgc_interpolant_t<I, F>> interpolants; // (vphi-1) * m2n0
+  const xgc_interpolant_t<I, F> *p_interpolants = NULL;
+  std::shared_ptr<mapped_cache_file> mapped_interpolants;
 
 public: // rotation
   void initialize_rotational_interpolants();
@@ -159,9 +172,7 @@ void simplicial_xgc_3d_mesh<I, F>::initialize_interpolants_cached()
   if (vphi == 1) return; // no interpolants needed
 
   const auto f = default_interpolant_filename();
-  if (file_exists(f))
-    read_interpolants(f);
-  else {
+  if (!file_exists(f) || !read_interpolants(f)) {
     initialize_interpolants();
     write_interpolants(f);
   }
@@ -407,42 +418,127 @@ void simplicial_xgc_3d_mesh<I, F>::initialize_interpolants()
   const F dphi = 2 * M_PI / (nphi * iphi);
  
   fprintf(stderr, "initializing interpolants...\n");
-  interpolants.resize(vphi);
+  mapped_interpolants.reset();
+  interpolants.resize(size_t(vphi - 1) * m2n0);
+
+  // the mapped points of neighboring vertices are close to each other, so
+  // they are located in batches along a Morton curve, each query walking 
+  // from the triangle of the previous one
+  const auto &locator = m2->get_locator();
+  const I chunk_size = 4096, nchunks = (m2n0 + chunk_size - 1) / chunk_size;
+  std::vector<F> x0(size_t(m2n0) * 2), x1(size_t(m2n0) * 2), 
+                 mu0(size_t(m2n0) * 3), mu1(size_t(m2n0) * 3);
+  std::vector<I> tids0(m2n0), tids1(m2n0);
+
   for (int v = 1; v < vphi; v ++) {
-    interpolants[v].resize(m2n0);
     const F beta = F(v) / vphi, alpha = F(1) - beta;
     this->parallel_for(m2n0, [&](int i) {
-    // for (I i = 0; i < m2n0; i ++) {
-      xgc_interpolant_t<I, F> &l = interpolants[v][i];
       F rzp0[3], rzp1[3];
         
       // backward integration
       m2->get_coords(i, rzp0);
       rzp0[2] = beta * dphi;
       m2->magnetic_map(rzp0, 0);
-      I tid0 = m2->locate(rzp0, l.mu0);
-      if (tid0 < 0) { // invalid triangle
-        l.tri0[0] = l.tri0[1] = l.tri0[2] = m2->nearest(rzp0);
-        l.mu0[0] = l.mu0[1] = l.mu0[2] = F(1) / 3;
-      } else {
-        m2->get_simplex(2, tid0, l.tri0);
-      }
+      x0[i*2] = rzp0[0]; 
+      x0[i*2+1] = rzp0[1];
      
       // forward integration
       m2->get_coords(i, rzp1);
       rzp1[2] = beta * dphi;
       m2->magnetic_map(rzp1, dphi);
-      I tid1 = m2->locate(rzp1, l.mu1);
-      if (tid1 < 0) { // invalid triangle
-        l.tri1[0] = l.tri1[1] = l.tri1[2] = m2->nearest(rzp1);
-        l.mu1[0] = l.mu1[1] = l.mu1[2] = F(1) / 3;
-      } else {
-        m2->get_simplex(2, tid1, l.tri1);
+      x1[i*2] = rzp1[0];
+      x1[i*2+1] = rzp1[1];
+    });
+
+    const auto order0 = point_locator_2d<I, F>::morton_order(m2n0, x0.data()), 
+               order1 = point_locator_2d<I, F>::morton_order(m2n0, x1.data());
+    this->parallel_for(nchunks, [&](int c) {
+      const I begin = c * chunk_size, n = std::min(chunk_size, m2n0 - begin);
+      locator->locate_batch(n, order0.data() + begin, x0.data(), tids0.data(), mu0.data());
+      locator->locate_batch(n, order1.data() + begin, x1.data(), tids1.data(), mu1.data());
+    });
+
+    this->parallel_for(m2n0, [&](int i) {
+      xgc_interpolant_t<I, F> &l = interpolants[size_t(v - 1) * m2n0 + i];
+      for (int k = 0; k < 3; k ++) {
+        l.mu0[k] = mu0[i*3+k];
+        l.mu1[k] = mu1[i*3+k];
       }
+
+      if (tids0[i] < 0) { // invalid triangle
+        F rz[2] = {x0[i*2], x0[i*2+1]};
+        l.tri0[0] = l.tri0[1] = l.tri0[2] = m2->nearest(rz);
+        l.mu0[0] = l.mu0[1] = l.mu0[2] = F(1) / 3;
+      } else 
+        m2->get_simplex(2, tids0[i], l.tri0);
+      
+      if (tids1[i] < 0) {
+        F rz[2] = {x1[i*2], x1[i*2+1]};
+        l.tri1[0] = l.tri1[1] = l.tri1[2] = m2->nearest(rz);
+        l.mu1[0] = l.mu1[1] = l.mu1[2] = F(1) / 3;
+      } else 
+        m2->get_simplex(2, tids1[i], l.tri1);
     });
   }
+  p_interpolants = interpolants.data();
   fprintf(stderr, "interpolants initialized.\n");
 }
+
+template <typename I, typename F>
+mapped_cache_file::header_t simplicial_xgc_3d_mesh<I, F>::interpolant_cache_key() const
+{
+  mapped_cache_file::header_t h;
+  h.kind = FTK_CACHE_XGC_INTERPOLANTS;
+  h.mesh_hash = m2->hash();
+  h.nphi = nphi;
+  h.iphi = iphi;
+  h.vphi = vphi;
+  h.sizeof_index = sizeof(I);
+  h.sizeof_value = sizeof(F);
+  return h;
+}
+
+template <typename I, typename F>
+void simplicial_xgc_3d_mesh<I, F>::write_interpolants(const std::string& filename) const
+{
+  const size_t n = size_t(vphi - 1) * m2->n(0);
+  mapped_cache_file::write(filename, interpolant_cache_key(), 
+      {{p_interpolants, n * sizeof(xgc_interpolant_t<I, F>)}});
+}
+
+template <typename I, typename F>
+bool simplicial_xgc_3d_mesh<I, F>::read_interpolants(const std::string& filename)
+{
+  const size_t m2n0 = m2->n(0);
+
+  if (mapped_cache_file::is_cache_file(filename)) {
+    std::shared_ptr<mapped_cache_file> f(new mapped_cache_file);
+    if (!f->open(filename, interpolant_cache_key()))
+      return false;
+    if (f->section_size<xgc_interpolant_t<I, F>>(0) != size_t(vphi - 1) * m2n0) {
+      warn(FTK_ERR_FILE_FORMAT, filename);
+      return false;
+    }
+
+    interpolants.clear();
+    mapped_interpolants = f;
+    p_interpolants = f->section<xgc_interpolant_t<I, F>>(0);
+    return true;
+  } else { // legacy format: one vector per virtual plane, the 0th being empty
+    std::vector<std::vector<xgc_interpolant_t<I, F>>> legacy;
+    if (!diy::unserializeFromFile(filename, legacy) || legacy.size() != vphi)
+      return false;
+
+    mapped_interpolants.reset();
+    interpolants.clear();
+    for (int v = 1; v < vphi; v ++) {
+      if (legacy[v].size() != m2n0) return false;
+      interpolants.insert(interpolants.end(), legacy[v].begin(), legacy[v].end());
+    }
+    p_interpolants = interpolants.data();
+    return true;
+  }
+}
   
 template <typename I, typename F>
 void simplicial_xgc_3d_mesh<I, F>::interpolate(
@@ -467,7 +563,7 @@ void simplicial_xgc_3d_mesh<I, F>::interpolate(
   } else { // virtual plane
     const int p0 = p / vphi, p1 = (p0 + 1) % nphi;
     const F beta = F(p) / vphi - p0, alpha = F(1) - beta;
-    const xgc_interpolant_t<I, F>& l = interpolants[p % vphi][i % m2n0];
+    const xgc_interpolant_t<I, F>& l = get_interpolant(p % vphi, i % m2n0);
 
     // init
     f[0] = 0;
@@ -506,7 +602,7 @@ F simplicial_xgc_3d_mesh<I, F>::interpolate(
   } else { // virtual plane
     const int p0 = p / vphi, p1 = (p0 + 1) % nphi;
     const F beta = F(p) / vphi - p0, alpha = F(1) - beta;
-    const xgc_interpolant_t<I, F>& l = interpolants[p % vphi][i % m2n0];
+    const xgc_interpolant_t<I, F>& l = get_interpolant(p % vphi, i % m2n0);
 
     F f0 = 0, f1 = 0;
     for (int k = 0; k < 3; k ++) {
@@ -528,7 +624,7 @@ F simplicial_xgc_3d_mesh<I, F>::interpolate(
 
   const int p0 = p / vphi, p1 = (p0 + 1) % nphi;
   const F beta = F(p) / vphi - p0, alpha = F(1) - beta;
-  const xgc_interpolant_t<I, F>& l = interpolants[pi % vphi][i % m2n0];
+  const xgc_interpolant_t<I, F>& l = get_interpolant(pi % vphi, i % m2n0);
 
   if (p % vphi == 0) { // non-virtual plane
     const int p0 = p / vphi;
@@ -537,7 +633,7 @@ F simplicial_xgc_3d_mesh<I, F>::interpolate(
   } else { // virtual plane
     const int p0 = p / vphi, p1 = (p0 + 1) % nphi;
     const F beta = F(p) / vphi - p0, alpha = F(1) - beta;
-    const xgc_interpolant_t<I, F>& l = interpolants[p % vphi][i % m2n0];
+    const xgc_interpolant_t<I, F>& l = get_interpolant(p % vphi, i % m2n0);
 
     F f0 = 0, f1 = 0;
     for (int k = 0; k < 3; k ++) {
@@ -589,19 +685,8 @@ void simplicial_xgc_3d_mesh<I, F>::interpolate_central_difference(
 template <typename I, typename F>
 ndarray<F> simplicial_xgc_3d_mesh<I, F>::smooth_scalar(const ndarray<F>& scalar) const
 {
-  ndarray<double> result;
-  result.reshape(scalar);
-  
-  for (size_t i = 0; i < nphi; i ++) {
-    auto slice = scalar.slice_time(i);
-    auto f = m2->smooth_scalar(slice);
-    for (size_t k = 0; k < m2->n(0); k ++)
-      result(k, i) = f(k);
-  }
-
-  return result;
+  return m2->smooth_scalar(scalar); // all planes in one pass
 }
-  
 
 template <typename I, typename F>
 void simplicial_xgc_3d_mesh<I, F>::smooth_scalar_gradient_jacobian(
@@ -611,26 +696,14 @@ void simplicial_xgc_3d_mesh<I, F>::smooth_scalar_gradient_jacobian(
       ndarray<F>& J   // smoothed jacobian field
   ) const
 {
-  S.reshape(scalar);
-  G.reshape(2, scalar.dim(0), scalar.dim(1));
+  m2->smooth_scalar_gradient_jacobian(scalar, S, G, J); // all planes in one pass
+  if (S.nd() == 1) { // single plane
+    S.reshape(scalar.dim(0), 1);
+    G.reshape(2, scalar.dim(0), 1);
+    J.reshape(2, 2, scalar.dim(0), 1);
+  }
   G.set_multicomponents(1);
-  J.reshape(2, 2, scalar.dim(0), scalar.dim(1));
   J.set_multicomponents(2);
-  
-  for (size_t i = 0; i < scalar.dim(1) /* nphi */; i ++) {
-    ndarray<double> f, grad, j;
-    auto slice = scalar.slice_time(i);
-    m2->smooth_scalar_gradient_jacobian(slice, f, grad, j);
-    for (size_t k = 0; k < m2->n(0); k ++) {
-      S(k, i) = f(k);
-      G(0, k, i) = grad(0, k);
-      G(1, k, i) = grad(1, k);
-      J(0, 0, k, i) = j(0, 0, k);
-      J(1, 0, k, i) = j(1, 0, k);
-      J(1, 1, k, i) = j(1, 1, k);
-      J(0, 1, k, i) = j(0, 1, k);
-    }
-  }
 }
 
 template <typename I, typename F>
@@ -752,7 +825,7 @@ ndarray<F> simplicial_xgc_3d_mesh<I, F>::interpolate(
       const int p0 = i / vphi, p1 = (p0 + 1) % nphi;
       const F beta = F(i) / vphi - p0, alpha = F(1) - beta;
       // fprintf(stderr, "p0=%d, p1=%d, alpha=%f, beta=%f\n", p0, p1, alpha, beta);
-      const std::vector<xgc_interpolant_t<I, F>>& ls = interpolants[i % vphi];
+      const xgc_interpolant_t<I, F>* ls = &get_interpolant(i % vphi, 0);
 
       for (int j = 0; j < m2n0; j ++) {
         const xgc_interpolant_t<I, F>& l = ls[j];
@@ -0,0 +1,401 @@
+#ifndef _FTK_SMOOTHING_KERNEL_HH
+#define _FTK_SMOOTHING_KERNEL_HH
+
+#include <ftk/config.hh>
+#include <ftk/object.hh>
+#include <ftk/ndarray.hh>
+#include <ftk/mesh/simplex_csr.hh>
+#include <ftk/io/mapped_cache_file.hh>
+#include <cmath>
+#include <tuple>
+
+namespace ftk {
+
+// Gaussian smoothing kernel on mesh vertices as a sparse matrix in CSR.
+// Each nonzero carries precomputed weights for the smoothed scalar, its
+// gradient, and its (symmetric) Hessian, so that all three are evaluated
+// in one fused SpMV.  Weights are stored term by term (w, wg[c*nnz+j],
+// wh[h*nnz+j]) to keep the inner loops over contiguous arrays.  The
+// arrays are either owned or used in place from a mapped cache file.
+template <typename I=int, typename F=double, int nd=2>
+struct smoothing_kernel_csr {
+  static constexpr int nh = nd * (nd + 1) / 2; // number of unique hessian entries
+  static int hessian_index(int a, int b) { if (a > b) std::swap(a, b); return a * nd - a * (a - 1) / 2 + (b - a); }
+
+  smoothing_kernel_csr() {}
+  smoothing_kernel_csr(const smoothing_kernel_csr& k) { *this = k; }
+  smoothing_kernel_csr(smoothing_kernel_csr&& k) { *this = std::move(k); }
+  smoothing_kernel_csr& operator=(const smoothing_kernel_csr&); // the views are rebound to the own arrays
+  smoothing_kernel_csr& operator=(smoothing_kernel_csr&&);
+
+  size_t size() const { return n; }
+  size_t nnz() const { return m; }
+  bool empty() const { return m == 0; }
+  F get_sigma() const { return sigma; }
+
+  // neighbors within 3 sigma are found with a uniform grid of bin size 3 sigma
+  void build(const ndarray<F>& coords, F sigma, int nthreads = std::thread::hardware_concurrency());
+
+  // conversion from/to the list-of-(vertex, weight) form used by kernel files and the cuda engine
+  void from_lists(const ndarray<F>& coords, F sigma, const std::vector<std::vector<std::tuple<I, F>>>& lists);
+  std::vector<std::vector<std::tuple<I, F>>> to_lists() const;
+
+  // flat cache files keyed by the mesh hash and sigma
+  void write_mapped(const std::string& filename, uint64_t mesh_hash) const;
+  bool read_mapped(const std::string& filename, uint64_t mesh_hash, F sigma); 
+  bool read_mapped(const std::string& filename, uint64_t mesh_hash); // any sigma
+
+  // Smooths nfields scalar fields stored one after another (f[p*n+i]) in one
+  // pass.  Outputs follow the same field-major layout with nd components
+  // (grad[(p*n+i)*nd+c]) and nd*nd components (jac[(p*n+i)*nd*nd+a+b*nd])
+  // per vertex; any output may be null.
+  void apply(size_t nfields, const F *f, F *scalar, F *grad, F *jac,
+      int nthreads = std::thread::hardware_concurrency()) const;
+
+protected:
+  void compute_weights(const ndarray<F>& coords, int nthreads);
+  void bind(); // point the views to the owned arrays
+  static mapped_cache_file::header_t cache_key(uint64_t mesh_hash, F sigma);
+
+  template <typename Func> void for_blocks(size_t n, int nthreads, Func f) const;
+
+public:
+  F sigma = 0;
+  csr_adjacency<I> adj;
+  std::vector<F> w, wg, wh; // nnz, nd*nnz, nh*nnz
+
+protected: // views
+  size_t n = 0, m = 0;
+  const size_t *p_ptr = NULL;
+  const I *p_idx = NULL;
+  const F *p_w = NULL, *p_wg = NULL, *p_wh = NULL;
+  std::shared_ptr<mapped_cache_file> mapped;
+};
+
+/////
+template <typename I, typename F, int nd>
+template <typename Func>
+void smoothing_kernel_csr<I, F, nd>::for_blocks(size_t n, int nthreads, Func f) const
+{
+  const size_t bs = 1024;
+  const int nblocks = (n + bs - 1) / bs;
+  if (nblocks == 0) return;
+  object::parallel_for(nblocks, [&](int b) {
+    f(b * bs, std::min(n, (b + 1) * bs));
+  }, FTK_THREAD_PTHREAD, std::max(1, nthreads), false);
+}
+
+template <typename I, typename F, int nd>
+void smoothing_kernel_csr<I, F, nd>::build(const ndarray<F>& coords, F sigma_, int nthreads)
+{
+  sigma = sigma_;
+  const F limit = F(3) * sigma;
+  const size_t n = coords.dim(1), stride = coords.dim(0);
+  const F *x = coords.data();
+
+  // bounding box and bins; the bin size grows if the grid would be much larger than the mesh
+  F lb[nd], ub[nd];
+  for (int c = 0; c < nd; c ++) {
+    lb[c] = std::numeric_limits<F>::max();
+    ub[c] = -std::numeric_limits<F>::max();
+  }
+  for (size_t i = 0; i < n; i ++)
+    for (int c = 0; c < nd; c ++) {
+      lb[c] = std::min(lb[c], x[i*stride+c]);
+      ub[c] = std::max(ub[c], x[i*stride+c]);
+    }
+
+  F h = limit;
+  size_t dims[nd], ncells;
+  while (1) {
+    ncells = 1;
+    for (int c = 0; c < nd; c ++) {
+      dims[c] = size_t((ub[c] - lb[c]) / h) + 1;
+      ncells *= dims[c];
+    }
+    if (ncells <= 4 * n + 64) break;
+    else h *= 2;
+  }
+
+  auto bin_coords = [&](size_t i, size_t b[nd]) {
+    for (int c = 0; c < nd; c ++)
+      b[c] = std::min(dims[c] - 1, size_t((x[i*stride+c] - lb[c]) / h));
+  };
+
+  std::vector<I> rows(n), cols(n);
+  for (size_t i = 0; i < n; i ++) {
+    size_t b[nd], id = 0;
+    bin_coords(i, b);
+    for (int c = nd - 1; c >= 0; c --)
+      id = id * dims[c] + b[c];
+    rows[i] = id;
+    cols[i] = i;
+  }
+  csr_adjacency<I> bins;
+  bins.build(ncells, rows, cols);
+
+  auto for_neighbors = [&](size_t i, std::function<void(I)> f) {
+    size_t b[nd];
+    bin_coords(i, b);
+
+    int nstencil = 1;
+    for (int c = 0; c < nd; c ++) nstencil *= 3;
+
+    for (int s = 0; s < nstencil; s ++) {
+      int off[nd];
+      for (int c = 0, t = s; c < nd; c ++, t /= 3)
+        off[c] = t % 3 - 1;
+
+      size_t id = 0;
+      bool valid = true;
+      for (int c = nd - 1; c >= 0; c --) {
+        const long bc = long(b[c]) + off[c];
+        if (bc < 0 || bc >= long(dims[c])) { valid = false; break; }
+        id = id * dims[c] + bc;
+      }
+      if (!valid) continue;
+
+      for (const I *p = bins.begin(id); p != bins.end(id); p ++) {
+        F d2 = 0;
+        for (int c = 0; c < nd; c ++) {
+          const F d = x[size_t(*p)*stride+c] - x[i*stride+c];
+          d2 += d * d;
+        }
+        if (std::sqrt(d2) < limit) f(*p);
+      }
+    }
+  };
+
+  // count, then fill rows in ascending vertex order
+  adj.ptr.assign(n + 1, 0);
+  for_blocks(n, nthreads, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; i ++)
+      for_neighbors(i, [&](I) { adj.ptr[i+1] ++; });
+  });
+  for (size_t i = 0; i < n; i ++)
+    adj.ptr[i+1] += adj.ptr[i];
+
+  adj.idx.resize(adj.ptr[n]);
+  for_blocks(n, nthreads, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; i ++) {
+      size_t j = adj.ptr[i];
+      for_neighbors(i, [&](I k) { adj.idx[j ++] = k; });
+      std::sort(adj.idx.begin() + adj.ptr[i], adj.idx.begin() + adj.ptr[i+1]);
+    }
+  });
+
+  compute_weights(coords, nthreads);
+  bind();
+}
+
+template <typename I, typename F, int nd>
+void smoothing_kernel_csr<I, F, nd>::from_lists(const ndarray<F>& coords, F sigma_,
+    const std::vector<std::vector<std::tuple<I, F>>>& lists)
+{
+  sigma = sigma_;
+  adj.ptr.resize(lists.size() + 1);
+  adj.ptr[0] = 0;
+  for (size_t i = 0; i < lists.size(); i ++)
+    adj.ptr[i+1] = adj.ptr[i] + lists[i].size();
+
+  adj.idx.resize(adj.ptr.back());
+  for (size_t i = 0; i < lists.size(); i ++)
+    for (size_t j = 0; j < lists[i].size(); j ++)
+      adj.idx[adj.ptr[i] + j] = std::get<0>(lists[i][j]);
+
+  compute_weights(coords, std::thread::hardware_concurrency());
+  bind();
+}
+
+template <typename I, typename F, int nd>
+std::vector<std::vector<std::tuple<I, F>>> smoothing_kernel_csr<I, F, nd>::to_lists() const
+{
+  std::vector<std::vector<std::tuple<I, F>>> lists(size());
+  for (size_t i = 0; i < size(); i ++)
+    for (size_t j = p_ptr[i]; j < p_ptr[i+1]; j ++)
+      lists[i].push_back(std::make_tuple(p_idx[j], p_w[j]));
+  return lists;
+}
+
+template <typename I, typename F, int nd>
+smoothing_kernel_csr<I, F, nd>& smoothing_kernel_csr<I, F, nd>::operator=(const smoothing_kernel_csr& k)
+{
+  if (this == &k) return *this;
+  sigma = k.sigma;
+  adj = k.adj;
+  w = k.w; wg = k.wg; wh = k.wh;
+  n = k.n; m = k.m;
+  p_ptr = k.p_ptr; p_idx = k.p_idx;
+  p_w = k.p_w; p_wg = k.p_wg; p_wh = k.p_wh;
+  mapped = k.mapped; // mapped views stay valid as the mapping is shared
+  if (!mapped) bind();
+  return *this;
+}
+
+template <typename I, typename F, int nd>
+smoothing_kernel_csr<I, F, nd>& smoothing_kernel_csr<I, F, nd>::operator=(smoothing_kernel_csr&& k)
+{
+  if (this == &k) return *this;
+  sigma = k.sigma;
+  adj = std::move(k.adj);
+  w = std::move(k.w); wg = std::move(k.wg); wh = std::move(k.wh);
+  n = k.n; m = k.m;
+  p_ptr = k.p_ptr; p_idx = k.p_idx;
+  p_w = k.p_w; p_wg = k.p_wg; p_wh = k.p_wh;
+  mapped = std::move(k.mapped);
+  if (!mapped) bind();
+
+  k.adj = csr_adjacency<I>();
+  k.w.clear(); k.wg.clear(); k.wh.clear();
+  k.bind(); // leave the source empty
+  return *this;
+}
+
+template <typename I, typename F, int nd>
+void smoothing_kernel_csr<I, F, nd>::bind()
+{
+  mapped.reset();
+  n = adj.size();
+  m = adj.idx.size();
+  p_ptr = adj.ptr.data();
+  p_idx = adj.idx.data();
+  p_w = w.data();
+  p_wg = wg.data();
+  p_wh = wh.data();
+}
+
+template <typename I, typename F, int nd>
+mapped_cache_file::header_t smoothing_kernel_csr<I, F, nd>::cache_key(uint64_t mesh_hash, F sigma)
+{
+  mapped_cache_file::header_t h;
+  h.kind = FTK_CACHE_SMOOTHING_KERNEL;
+  h.mesh_hash = mesh_hash;
+  h.vphi = nd; // dimensionality of the kernel
+  h.sizeof_index = sizeof(I);
+  h.sizeof_value = sizeof(F);
+  h.sigma = sigma;
+  return h;
+}
+
+template <typename I, typename F, int nd>
+void smoothing_kernel_csr<I, F, nd>::write_mapped(const std::string& filename, uint64_t mesh_hash) const
+{
+  mapped_cache_file::write(filename, cache_key(mesh_hash, sigma), {
+      {p_ptr, (n + 1) * sizeof(size_t)}, 
+      {p_idx, m * sizeof(I)}, 
+      {p_w, m * sizeof(F)}, 
+      {p_wg, nd * m * sizeof(F)}, 
+      {p_wh, nh * m * sizeof(F)}});
+}
+
+template <typename I, typename F, int nd>
+bool smoothing_kernel_csr<I, F, nd>::read_mapped(const std::string& filename, uint64_t mesh_hash, F sigma_)
+{
+  std::shared_ptr<mapped_cache_file> f(new mapped_cache_file);
+  if (!f->open(filename, cache_key(mesh_hash, sigma_)))
+    return false;
+
+  adj.ptr.clear(); adj.idx.clear();
+  w.clear(); wg.clear(); wh.clear();
+
+  sigma = sigma_;
+  n = f->section_size<size_t>(0) - 1;
+  m = f->section_size<I>(1);
+  p_ptr = f->section<size_t>(0);
+  p_idx = f->section<I>(1);
+  p_w = f->section<F>(2);
+  p_wg = f->section<F>(3);
+  p_wh = f->section<F>(4);
+  mapped = f;
+  return true;
+}
+
+template <typename I, typename F, int nd>
+bool smoothing_kernel_csr<I, F, nd>::read_mapped(const std::string& filename, uint64_t mesh_hash)
+{
+  mapped_cache_file::header_t key; // peek sigma
+  if (!mapped_cache_file::is_cache_file(filename)) return false;
+
+  FILE *fp = fopen(filename.c_str(), "rb");
+  if (!fp) return false;
+  const bool succ = fread(&key, sizeof(key), 1, fp) == 1;
+  fclose(fp);
+  
+  return succ && read_mapped(filename, mesh_hash, key.sigma);
+}
+
+template <typename I, typename F, int nd>
+void smoothing_kernel_csr<I, F, nd>::compute_weights(const ndarray<F>& coords, int nthreads)
+{
+  const F sigma2 = sigma * sigma,
+          sigma4 = sigma2 * sigma2;
+  const size_t n = adj.size(), m = adj.idx.size(), stride = coords.dim(0);
+  const F *x = coords.data();
+
+  w.resize(m);
+  wg.resize(nd * m);
+  wh.resize(nh * m);
+
+  for_blocks(n, nthreads, [&](size_t i0, size_t i1) {
+    for (size_t i = i0; i < i1; i ++) {
+      for (size_t j = adj.ptr[i]; j < adj.ptr[i+1]; j ++) {
+        const size_t k = adj.idx[j];
+        F d[nd], d2 = 0;
+        for (int c = 0; c < nd; c ++) {
+          d[c] = x[k*stride+c] - x[i*stride+c];
+          d2 += d[c] * d[c];
+        }
+
+        const F wj = std::exp(-d2 / (2*sigma2)) / (sigma * std::sqrt(2.0 * M_PI));
+        w[j] = wj;
+        for (int c = 0; c < nd; c ++)
+          wg[c*m + j] = -wj * d[c] / sigma2;
+        for (int a = 0; a < nd; a ++)
+          for (int b = a; b < nd; b ++)
+            wh[hessian_index(a, b)*m + j] = a == b ?
+              (d[a]*d[a] / sigma2 - 1) / sigma2 * wj : d[a]*d[b] / sigma4 * wj;
+      }
+    }
+  });
+}
+
+template <typename I, typename F, int nd>
+void smoothing_kernel_csr<I, F, nd>::apply(size_t nfields, const F *f,
+    F *scalar, F *grad, F *jac, int nthreads) const
+{
+  const size_t *ptr = p_ptr;
+  const I *idx = p_idx;
+  const F *pw = p_w, *pwg = p_wg, *pwh = p_wh;
+
+  for_blocks(n, nthreads, [&](size_t i0, size_t i1) {
+    for (size_t p = 0; p < nfields; p ++) {
+      const F *fp = f + p * n;
+      for (size_t i = i0; i < i1; i ++) {
+        F s = 0, g[nd] = {0}, hs[nh] = {0};
+        for (size_t j = ptr[i]; j < ptr[i+1]; j ++) {
+          const F fk = fp[idx[j]];
+          s += pw[j] * fk;
+          for (int c = 0; c < nd; c ++)
+            g[c] += pwg[c*m + j] * fk;
+          for (int h = 0; h < nh; h ++)
+            hs[h] += pwh[h*m + j] * fk;
+        }
+
+        const size_t o = p * n + i;
+        if (scalar)
+          scalar[o] = s;
+        if (grad)
+          for (int c = 0; c < nd; c ++)
+            grad[o*nd + c] = g[c];
+        if (jac)
+          for (int a = 0; a < nd; a ++)
+            for (int b = 0; b < nd; b ++)
+              jac[o*nd*nd + a + b*nd] = hs[hessian_index(a, b)];
+      }
+    }
+  });
+}
+
+}
+
+#endif
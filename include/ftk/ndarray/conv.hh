@@ -3,7 +3,10 @@
 
 #include <cmath>
 #include <string>
+#include <complex>
+#include <map>
 #include <ftk/ndarray.hh>
+#include <ftk/numeric/fft.hh>
 
 namespace ftk {
 
@@ -210,6 +213,217 @@ ndarray<T> conv3D_gaussian(
   return res;
 }
 
+// Separable Gaussian filters.  A d-dimensional Gaussian is the product of
+// 1D Gaussians, so the smoothing is done with one 1D pass per axis, which
+// costs O(k*d) instead of O(k^d) per sample.  Samples outside the array
+// take the value of the nearest boundary sample, so that the output has
+// the same shape as the input and constant fields are preserved.  Large
+// kernels are applied with FFTs along each line.
+enum {
+  FTK_CONV_AUTO = 0,
+  FTK_CONV_DIRECT = 1,
+  FTK_CONV_FFT = 2
+};
+
+// kernels of size larger than this use FFTs in FTK_CONV_AUTO
+static const size_t FTK_CONV_FFT_MIN_KSIZE = 65;
+
+// 1D Gaussian kernel of size 2r+1 (order=0), or its first (order=1) and 
+// second (order=2) derivatives.  The derivative kernels are normalized so 
+// that they are exact for polynomials up to degree two.
+template <typename T>
+std::vector<T> gaussian_kernel1D(T sigma, int r, int order = 0)
+{
+  const int size = 2*r + 1;
+  std::vector<double> g(size);
+  double sum = 0;
+  for (int o = -r; o <= r; o ++)
+    sum += (g[o+r] = std::exp(-o*o / (2. * sigma * sigma)));
+  for (auto &x : g) x /= sum;
+
+  double m2 = 0; // second moment of the kernel
+  for (int o = -r; o <= r; o ++)
+    m2 += o * o * g[o+r];
+
+  std::vector<double> w(size);
+  if (order == 0) w = g;
+  else if (order == 1) {
+    for (int o = -r; o <= r; o ++)
+      w[o+r] = o * g[o+r] / m2;
+  } else {
+    double s = 0;
+    for (int o = -r; o <= r; o ++) {
+      w[o+r] = (o * o - m2) * g[o+r];
+      s += o * o * w[o+r];
+    }
+    for (auto &x : w) x *= 2 / s;
+  }
+
+  return std::vector<T>(w.begin(), w.end());
+}
+
+// correlates the array (with shape dims) with the kernel w along the given
+// axis: out(.., i, ..) = sum_k w[k] * in(.., i+k-r, ..)
+template <typename T>
+void conv1D_axis(const T* in, T* out,
+    const std::vector<size_t> &dims, int axis, 
+    const std::vector<T>& w, int method = FTK_CONV_AUTO)
+{
+  const long r = w.size() / 2;
+  size_t inner = 1, outer = 1;
+  for (int i = 0; i < axis; i ++) inner *= dims[i];
+  for (int i = axis+1; i < dims.size(); i ++) outer *= dims[i];
+  const long n = dims[axis];
+  const auto clamp = [n](long i) { return std::min(std::max(0L, i), n-1); };
+
+  if (method == FTK_CONV_AUTO)
+    method = w.size() >= FTK_CONV_FFT_MIN_KSIZE ? FTK_CONV_FFT : FTK_CONV_DIRECT;
+
+  if (method == FTK_CONV_FFT) {
+    // the correlation is the convolution with the reversed kernel; 
+    // out[i] is the (i+2r)-th entry of the (circular) convolution with 
+    // the padded line, which does not wrap around
+    const size_t len = n + 2*r, N = fft_size(len);
+    std::vector<std::complex<double>> K(N, 0.0);
+    for (size_t k = 0; k < w.size(); k ++)
+      K[k] = w[w.size()-1-k];
+    fft_radix2(K);
+
+#pragma omp parallel for
+    for (long l = 0; l < outer * inner; l ++) {
+      const size_t o = l / inner, q = l % inner;
+      const T *src = in + o * n * inner + q;
+      T *dst = out + o * n * inner + q;
+
+      std::vector<std::complex<double>> a(N, 0.0);
+      for (long i = 0; i < len; i ++)
+        a[i] = src[clamp(i - r) * inner];
+      fft_radix2(a);
+      for (size_t i = 0; i < N; i ++)
+        a[i] *= K[i];
+      fft_radix2(a, true);
+      for (long i = 0; i < n; i ++)
+        dst[i * inner] = a[i + 2*r].real();
+    }
+  } else if (inner == 1) { // contiguous lines; pad each line so that the interior loop has no bounds checks
+#pragma omp parallel for
+    for (long o = 0; o < outer; o ++) {
+      const T *src = in + o * n;
+      T *dst = out + o * n;
+
+      std::vector<T> buf(n + 2*r);
+      for (long i = 0; i < n + 2*r; i ++)
+        buf[i] = src[clamp(i - r)];
+      
+      std::fill(dst, dst + n, T(0));
+      for (size_t k = 0; k < w.size(); k ++) {
+        const T wk = w[k];
+        const T *b = buf.data() + k;
+        for (long i = 0; i < n; i ++)
+          dst[i] += wk * b[i];
+      }
+    }
+  } else { // strided lines; the interior loop runs over the contiguous inner dimensions
+#pragma omp parallel for
+    for (long l = 0; l < outer * n; l ++) {
+      const size_t o = l / n, i = l % n;
+      T *dst = out + (o * n + i) * inner;
+      
+      std::fill(dst, dst + inner, T(0));
+      for (size_t k = 0; k < w.size(); k ++) {
+        const T wk = w[k];
+        const T *src = in + (o * n + clamp(long(i) + long(k) - r)) * inner;
+        for (size_t q = 0; q < inner; q ++)
+          dst[q] += wk * src[q];
+      }
+    }
+  }
+}
+
+// smooths all spatial dimensions (i.e. excluding multicomponent and time 
+// dimensions) with a Gaussian of size 2*(ksize/2)+1
+template <typename T>
+ndarray<T> conv_gaussian_separable(
+    const ndarray<T> &data, T sigma, size_t ksize = 5, 
+    int method = FTK_CONV_AUTO)
+{
+  const int d0 = data.multicomponents(), 
+            d1 = data.nd() - (data.has_time() ? 1 : 0);
+  const auto w = gaussian_kernel1D(sigma, ksize/2);
+
+  ndarray<T> res(data), tmp(data);
+  for (int axis = d0; axis < d1; axis ++) {
+    res.swap(tmp);
+    conv1D_axis(tmp.data(), res.data(), data.shape(), axis, w, method);
+  }
+  return res;
+}
+
+// smooths a 2D or 3D scalar field with a Gaussian of size 2*(ksize/2)+1, 
+// and derives the gradient and the Jacobian of the gradient (the Hessian) 
+// of the smoothed field w.r.t. grid indices in the same pass: the 1D 
+// passes with the Gaussian and its derivatives are shared between the 
+// outputs, e.g. df/dx, df/dy, d2f/dx2, and d2f/dxdy all reuse the 
+// Gaussian-smoothed pass along z.
+template <typename T>
+void conv_gaussian_gradient_jacobian(
+    const ndarray<T> &data, T sigma, size_t ksize,
+    ndarray<T> &scalar, // smoothed scalar field
+    ndarray<T> &grad,  // smoothed gradient field
+    ndarray<T> &J, // smoothed jacobian field
+    int method = FTK_CONV_AUTO)
+{
+  const int nd = data.nd();
+  const size_t n = data.nelem();
+  const auto dims = data.shape();
+  std::vector<T> w[3];
+  for (int order = 0; order < 3; order ++)
+    w[order] = gaussian_kernel1D(sigma, ksize/2, order);
+
+  // derivatives of the smoothed field, indexed by the orders along each 
+  // axis processed so far
+  std::map<std::vector<int>, std::vector<T>> passes;
+  passes[{}] = data.std_vector();
+  for (int axis = 0; axis < nd; axis ++) {
+    std::map<std::vector<int>, std::vector<T>> next;
+    for (const auto &kv : passes) {
+      int sum = 0; 
+      for (auto o : kv.first) sum += o;
+      for (int order = 0; order + sum <= 2; order ++) {
+        auto key = kv.first;
+        key.push_back(order);
+        auto &out = next[key];
+        out.resize(n);
+        conv1D_axis(kv.second.data(), out.data(), dims, axis, w[order], method);
+      }
+    }
+    passes.swap(next);
+  }
+
+  std::vector<size_t> gdims(dims), jdims(dims);
+  gdims.insert(gdims.begin(), nd);
+  jdims.insert(jdims.begin(), {size_t(nd), size_t(nd)});
+  scalar.reshape(dims);
+  grad.reshape(gdims);
+  J.reshape(jdims);
+  
+  std::vector<int> key(nd, 0);
+  std::copy(passes[key].begin(), passes[key].end(), &scalar[0]);
+  for (int i = 0; i < nd; i ++) {
+    key.assign(nd, 0); key[i] = 1;
+    const auto &g = passes[key];
+    for (size_t k = 0; k < n; k ++) 
+      grad[k*nd + i] = g[k];
+    
+    for (int j = 0; j < nd; j ++) {
+      key.assign(nd, 0); key[i] ++; key[j] ++;
+      const auto &h = passes[key];
+      for (size_t k = 0; k < n; k ++)
+        J[k*nd*nd + j*nd + i] = h[k];
+    }
+  }
+}
+
 template <typename T>
 ndarray<T> conv_gaussian(
     const ndarray<T> &data, T sigma,
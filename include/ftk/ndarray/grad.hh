@@ -333,6 +333,87 @@ ndarray<T> Jv_dot_v(const ndarray<T>& V)
   return Jvv;
 }
 
+// Pointwise versions of the derivatives above, for evaluating derived fields
+// on the fly without materializing them.  The stencils and boundary 
+// handling are identical to the array versions, so the results are the same.
+
+// gradient2D(scalar) at (i, j)
+template <typename T>
+void gradient2D_at(const ndarray<T>& scalar, int i, int j, T g[2])
+{
+  const int DW = scalar.dim(0), DH = scalar.dim(1);
+  const auto f = [&](int i, int j) {
+    i = std::min(std::max(0, i), DW-1);
+    j = std::min(std::max(0, j), DH-1);
+    return scalar(i, j);
+  };
+
+  g[0] = (f(i+1, j) - f(i-1, j)) * (DW-1);
+  g[1] = (f(i, j+1) - f(i, j-1)) * (DH-1);
+}
+
+// jacobian2D<T, true>(gradient2D(scalar)) at (i, j); H[a][b] is the (a, b) component
+template <typename T>
+void hessian2D_at(const ndarray<T>& scalar, int i, int j, T H[2][2])
+{
+  const int DW = scalar.dim(0), DH = scalar.dim(1);
+  const auto g = [&](int c, int i, int j) {
+    T gij[2];
+    gradient2D_at(scalar, 
+        std::min(std::max(0, i), DW-1), 
+        std::min(std::max(0, j), DH-1), gij);
+    return gij[c];
+  };
+
+  const T H00 = g(0, i+1, j) - g(0, i-1, j) * (DW-1),
+          H01 = g(0, i, j+1) - g(0, i, j-1) * (DH-1),
+          H10 = g(1, i+1, j) - g(1, i-1, j) * (DW-1), 
+          H11 = g(1, i, j+1) - g(1, i, j-1) * (DH-1);
+
+  H[0][0] = H00;
+  H[1][1] = H11;
+  H[0][1] = H[1][0] = (H01 + H10) * 0.5;
+}
+
+// gradient3D(scalar) at (i, j, k)
+template <typename T>
+void gradient3D_at(const ndarray<T>& scalar, int i, int j, int k, T g[3])
+{
+  const int DW = scalar.dim(0), DH = scalar.dim(1), DD = scalar.dim(2);
+  if (i < 1 || i >= DW-1 || j < 1 || j >= DH-1 || k < 1 || k >= DD-1) {
+    g[0] = g[1] = g[2] = 0;
+    return;
+  }
+  
+  g[0] = 0.5 * (scalar(i+1, j, k) - scalar(i-1, j, k));
+  g[1] = 0.5 * (scalar(i, j+1, k) - scalar(i, j-1, k));
+  g[2] = 0.5 * (scalar(i, j, k+1) - scalar(i, j, k-1));
+}
+
+// jacobian3D(gradient3D(scalar)) at (i, j, k); H[a][b] is the (a, b) component
+template <typename T>
+void hessian3D_at(const ndarray<T>& scalar, int i, int j, int k, T H[3][3])
+{
+  const int DW = scalar.dim(0), DH = scalar.dim(1), DD = scalar.dim(2), b = 2;
+  if (i < b || i >= DW-b || j < b || j >= DH-b || k < b || k >= DD-b) {
+    for (int a = 0; a < 3; a ++)
+      for (int c = 0; c < 3; c ++)
+        H[a][c] = 0;
+    return;
+  }
+
+  T gm[3][3], gp[3][3]; // gradients at the minus/plus neighbors along each axis
+  for (int c = 0; c < 3; c ++) {
+    const int d[3] = {c == 0, c == 1, c == 2};
+    gradient3D_at(scalar, i-d[0], j-d[1], k-d[2], gm[c]);
+    gradient3D_at(scalar, i+d[0], j+d[1], k+d[2], gp[c]);
+  }
+
+  for (int a = 0; a < 3; a ++)
+    for (int c = 0; c < 3; c ++)
+      H[a][c] = 0.5 * (gp[c][a] - gm[c][a]);
+}
+
 }
 
 #endif
@@ -5,6 +5,9 @@
 #include <fstream>
 #include <chrono>
 #include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <ftk/ndarray.hh>
 #include <ftk/ndarray/synthetic.hh>
 #include <ftk/filters/streaming_filter.hh>
@@ -53,6 +56,12 @@ struct ndarray_stream : public object {
   //  - perturbation, number.  Add gaussian perturbation to the data
   //  - clamp, array of two numbers (min, max).  Clamp the range of the input data 
   //    with the given min and max values
+  //  - async, boolean.  Read timesteps in background threads while the callback runs
+  //  - async_prefetch, integer.  Number of timesteps that can be read ahead of the 
+  //    callback in async mode.  The default is 2
+  //  - async_readers, integer.  Number of reader threads in async mode.  Only effective
+  //    for synthetic data and formats with independent per-timestep reads (float32, 
+  //    float64, vti, nc, h5) without MPI.  The default is 1
 
   void set_input_source_json_file(const std::string& filename);
   void set_input_source_json(const json& j_);
@@ -93,6 +102,7 @@ protected:
   ndarray<T> request_timestep_file_bp4(int k);
   template <typename T1> ndarray<T> request_timestep_file_binary(int k);
 
+  ndarray<T> request_timestep(int k);
   ndarray<T> request_timestep_synthetic(int k);
   ndarray<T> request_timestep_synthetic_woven(int k);
   ndarray<T> request_timestep_synthetic_moving_extremum_2d(int k);
@@ -108,6 +118,7 @@ protected:
 
 public:
   bool is_partial_read_supported() const;
+  bool is_concurrent_read_supported() const; // if timesteps can be read by multiple threads
 
   void set_part(const lattice& e) { 
     part = true; ext = e; 
@@ -1597,7 +1608,7 @@ void ndarray_stream<T>::modified_callback(int k, const ndarray<T> &array)
   if (j.contains("spatial-smoothing-kernel")) {
     const int ksize = j["spatial-smoothing-kernel-size"];
     const T sigma = j["spatial-smoothing-kernel"];
-    ndarray<T> array1 = conv_gaussian(array, sigma, ksize, ksize/2);
+    ndarray<T> array1 = conv_gaussian_separable(array, sigma, ksize);
     f2(array1);
   } else
     f2(array);
@@ -1615,72 +1626,87 @@ void ndarray_stream<T>::start()
   }
 
   const int nt = j["n_timesteps"];
-  const bool async = j.contains("async");
+  const bool async = j.contains("async") && j["async"] != false;
 
   if (async) {
-    std::condition_variable cond;
-    std::mutex mtx;
-    bool all_done = false;
-    int current_timestep;
-    ndarray<T> array;
-
-    std::thread producer([&]() {
-      for (int i = 0; i < nt; i ++) {
-        // fprintf(stderr, "reading timestep %d\n", i);
-        ndarray<T> array1;
+    const int nslots = std::max(1, j.value("async_prefetch", 2)),
+              nreaders = is_concurrent_read_supported() ? std::max(1, j.value("async_readers", 1)) : 1;
+    const bool serialized_read = nreaders > 1 && j["type"] == "file" 
+      && (j["format"] == "nc" || j["format"] == "h5"); // netcdf/hdf5 may not be built thread-safe
+
+    // bounded ring of prefetched timesteps; timestep i goes to slot i % nslots,
+    // which is free once timestep i - nslots is taken by the consumer
+    std::vector<std::shared_ptr<ndarray<T>>> slots(nslots);
+    int next_timestep = 0, // next timestep to be read
+        n_consumed = 0, // number of timesteps taken by the consumer
+        n_available = nt; // reduced if the input ends early
+    std::mutex mtx, io_mtx;
+    std::condition_variable cond_ready, cond_free;
+
+    auto reader = [&]() {
+      while (1) {
+        int i;
+        {
+          std::unique_lock<std::mutex> lock(mtx);
+          cond_free.wait(lock, [&]() {return next_timestep >= n_available || next_timestep < n_consumed + nslots;});
+          if (next_timestep >= n_available) return;
+          i = next_timestep ++;
+        }
 
         auto t1 = std::chrono::high_resolution_clock::now();
-        if (j["type"] == "synthetic") {
-          array1 = request_timestep_synthetic(i);
-        } else if (j["type"] == "file") {
-          array1 = request_timestep_file(i);
-        }
+        std::shared_ptr<ndarray<T>> array;
+        if (serialized_read) {
+          std::lock_guard<std::mutex> guard(io_mtx);
+          array = std::make_shared<ndarray<T>>(request_timestep(i));
+        } else 
+          array = std::make_shared<ndarray<T>>(request_timestep(i));
         auto t2 = std::chrono::high_resolution_clock::now();
         float t = std::chrono::duration_cast<std::chrono::nanoseconds>(t2-t1).count() * 1e-9;
         fprintf(stderr, "timestep=%d, t_io=%f\n", i, t);
 
         {
-          std::unique_lock<std::mutex> lock(mtx);
-
-          array = array1;
-          current_timestep = i;
-          if (i == nt-1 || array1.empty()) {
-            all_done = true;
-          }
-          cond.notify_one();
+          std::lock_guard<std::mutex> guard(mtx);
+          if (array->empty()) // all files are read
+            n_available = std::min(n_available, i);
+          else 
+            slots[i % nslots] = array;
         }
+        cond_ready.notify_one();
+        cond_free.notify_all(); // wake up other readers if n_available is changed
       }
-      // fprintf(stderr, "exiting reader thread..\n");
-    });
-
-    { // consumer
-      std::unique_lock<std::mutex> lock(mtx);
-      while (!all_done) {
-        cond.wait(lock); // , [&](){return all_done;});
-      
-        auto t1 = std::chrono::high_resolution_clock::now();
-        modified_callback(current_timestep, array);
-        auto t2 = std::chrono::high_resolution_clock::now();
-        float t = std::chrono::duration_cast<std::chrono::nanoseconds>(t2-t1).count() * 1e-9;
-        fprintf(stderr, "timestep=%d, t_compute=%f\n", current_timestep, t);
+    };
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < nreaders; i ++)
+      readers.push_back(std::thread(reader));
+
+    for (int i = 0; ; i ++) { // consumer
+      std::shared_ptr<ndarray<T>> array;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cond_ready.wait(lock, [&]() {return i >= n_available || slots[i % nslots];});
+        if (i >= n_available) break;
+        array.swap(slots[i % nslots]);
+        n_consumed = i + 1;
       }
+      cond_free.notify_all();
+
+      auto t1 = std::chrono::high_resolution_clock::now();
+      modified_callback(i, *array);
+      auto t2 = std::chrono::high_resolution_clock::now();
+      float t = std::chrono::duration_cast<std::chrono::nanoseconds>(t2-t1).count() * 1e-9;
+      fprintf(stderr, "timestep=%d, t_compute=%f\n", i, t);
     }
 
-    producer.join();
+    for (auto &r : readers)
+      r.join();
   } else {
     for (size_t i = 0; i < nt; i ++) {
       auto t0 = std::chrono::high_resolution_clock::now();
-      ndarray<T> array;
-      if (j["type"] == "synthetic") {
-        array = request_timestep_synthetic(i);
-        // fprintf(stderr, "requested data ncd=%zu, ncd1=%zu\n", array.multicomponents(), array1.multicomponents());
-      }
-      else if (j["type"] == "file") {
-        array = request_timestep_file(i);
-        if (array.empty()) {
-          fprintf(stderr, "got empty array; all files are read.\n"); 
-          break;
-        }
+      ndarray<T> array = request_timestep(i);
+      if (array.empty()) {
+        fprintf(stderr, "got empty array; all files are read.\n"); 
+        break;
       }
       auto t1 = std::chrono::high_resolution_clock::now();
 
@@ -1694,6 +1720,17 @@ void ndarray_stream<T>::start()
     }
   }
 }
+
+template <typename T>
+ndarray<T> ndarray_stream<T>::request_timestep(int k)
+{
+  if (j["type"] == "synthetic") 
+    return request_timestep_synthetic(k);
+  else if (j["type"] == "file")
+    return request_timestep_file(k);
+  else 
+    return ndarray<T>();
+}
  
 template <typename T>
 void ndarray_stream<T>::finish() 
@@ -1702,6 +1739,19 @@ void ndarray_stream<T>::finish()
     temporal_filter.finish();
 }
 
+template <typename T>
+bool ndarray_stream<T>::is_concurrent_read_supported() const
+{
+  if (j["type"] == "synthetic") 
+    return true;
+  else if (comm.size() > 1) // reads may be collective
+    return false;
+  else {
+    const std::string fmt = j["format"];
+    return fmt == "float32" || fmt == "float64" || fmt == "vti" || fmt == "nc" || fmt == "h5";
+  }
+}
+
 template <typename T>
 bool ndarray_stream<T>::is_partial_read_supported() const
 {
@@ -0,0 +1,55 @@
+#ifndef _FTK_FFT_HH
+#define _FTK_FFT_HH
+
+#include <ftk/config.hh>
+#include <complex>
+#include <vector>
+#include <cmath>
+
+namespace ftk {
+
+// smallest power of two that is no less than n
+inline size_t fft_size(size_t n)
+{
+  size_t m = 1;
+  while (m < n) m <<= 1;
+  return m;
+}
+
+// in-place iterative radix-2 FFT; the size of a must be a power of two.
+// the inverse transform is scaled by 1/n.
+template <typename T>
+void fft_radix2(std::vector<std::complex<T>>& a, bool inverse = false)
+{
+  const size_t n = a.size();
+  if (n < 2) return;
+
+  for (size_t i = 1, j = 0; i < n; i ++) { // bit reversal
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j) std::swap(a[i], a[j]);
+  }
+
+  for (size_t len = 2; len <= n; len <<= 1) {
+    const T theta = (inverse ? 2 : -2) * T(M_PI) / len;
+    const std::complex<T> wlen(std::cos(theta), std::sin(theta));
+    for (size_t i = 0; i < n; i += len) {
+      std::complex<T> w(1);
+      for (size_t j = 0; j < len/2; j ++) {
+        const std::complex<T> u = a[i+j], v = a[i+j+len/2] * w;
+        a[i+j] = u + v;
+        a[i+j+len/2] = u - v;
+        w *= wlen;
+      }
+    }
+  }
+
+  if (inverse)
+    for (auto &x : a) x /= T(n);
+}
+
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef _FTK_RK45_HH
+#define _FTK_RK45_HH
+
+#include <ftk/config.hh>
+#include <cmath>
+#include <algorithm>
+
+namespace ftk {
+
+// Butcher tableau of the Dormand-Prince embedded RK5(4) pair; b is the
+// 5th order solution, e = b - b* is the difference to the 4th order one
+template <typename T=double>
+struct dopri5_tableau {
+  static constexpr int nstages = 7;
+
+  static constexpr T c[7] = {0, T(1)/5, T(3)/10, T(4)/5, T(8)/9, 1, 1};
+  static constexpr T a[7][6] = {
+    {0},
+    {T(1)/5},
+    {T(3)/40, T(9)/40},
+    {T(44)/45, T(-56)/15, T(32)/9},
+    {T(19372)/6561, T(-25360)/2187, T(64448)/6561, T(-212)/729},
+    {T(9017)/3168, T(-355)/33, T(46732)/5247, T(49)/176, T(-5103)/18656},
+    {T(35)/384, 0, T(500)/1113, T(125)/192, T(-2187)/6784, T(11)/84}
+  };
+  static constexpr T b[7] = {T(35)/384, 0, T(500)/1113, T(125)/192, T(-2187)/6784, T(11)/84, 0};
+  static constexpr T e[7] = {T(71)/57600, 0, T(-71)/16695, T(71)/1920, T(-17253)/339200, T(22)/525, T(-1)/40};
+};
+
+template <typename T> constexpr T dopri5_tableau<T>::c[7];
+template <typename T> constexpr T dopri5_tableau<T>::a[7][6];
+template <typename T> constexpr T dopri5_tableau<T>::b[7];
+template <typename T> constexpr T dopri5_tableau<T>::e[7];
+
+// scaled rms norm of the local error estimate, as in Hairer et al.
+template <typename T=double>
+T rk45_error_norm(int nd, const T *x0, const T *x1, const T *err, T atol, T rtol)
+{
+  T sum = 0;
+  for (int i = 0; i < nd; i ++) {
+    const T sc = atol + rtol * std::max(std::abs(x0[i]), std::abs(x1[i]));
+    sum += (err[i] / sc) * (err[i] / sc);
+  }
+  return std::sqrt(sum / nd);
+}
+
+// step size factor for the next (or the retried) step given the error norm
+template <typename T=double>
+T rk45_step_factor(T errnorm, T safety = 0.9, T fmin = 0.2, T fmax = 5.0)
+{
+  if (errnorm <= T(0)) return fmax;
+  return std::min(fmax, std::max(fmin, safety * std::pow(errnorm, T(-0.2))));
+}
+
+}
+
+#endif
@@ -11,6 +11,7 @@
 #include <algorithm>
 #include <ftk/config.hh>
 #include <ftk/error.hh>
+#include <ftk/utils/thread_pool.hh>
 #include <ftk/external/diy/mpi.hpp>
 #include <unistd.h>
 #include <sched.h>
@@ -27,7 +28,8 @@ enum { // thread backend
   FTK_THREAD_NONE = 0,
   FTK_THREAD_PTHREAD = 0,
   FTK_THREAD_OPENMP = 1,
-  FTK_THREAD_TBB = 6
+  FTK_THREAD_TBB = 6,
+  FTK_THREAD_POOL = 7 // persistent workers w/ chunked work stealing
 };
 
 enum { 
@@ -80,6 +82,9 @@ struct object {
         f(j);
 
       std::for_each(workers.begin(), workers.end(), [](std::thread &t) {t.join();});
+    } else if (thread_backend == FTK_THREAD_POOL) {
+      thread_pool::instance().parallel_for(ntasks, 
+          [&](size_t j) {f(j);}, nthreads, affinity);
     } else if (thread_backend == FTK_THREAD_OPENMP) {
 #if FTK_HAVE_OPENMP
       fprintf(stderr, "parallelization w/ openmp...\n");
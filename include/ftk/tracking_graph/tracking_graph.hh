@@ -94,7 +94,8 @@ template <class TimeIndexType, class LabelIdType, class GlobalLabelIdType, class
 bool tracking_graph<TimeIndexType, LabelIdType, GlobalLabelIdType, WeightType>::has_node(TimeIndexType t, LabelIdType l) const 
 {
   std::unique_lock<std::mutex> lock(mutex);
-  return nodes.find(std::make_pair(t, l)) != nodes.end();
+  auto it = nodes.find(t);
+  return it != nodes.end() && it->second.find(std::make_pair(t, l)) != it->second.end();
 }
   
 template <class TimeIndexType, class LabelIdType, class GlobalLabelIdType, class WeightType>
@@ -105,7 +106,7 @@ bool tracking_graph<TimeIndexType, LabelIdType, GlobalLabelIdType, WeightType>::
   auto it = right_links.find(std::make_pair(t0, l0)); 
   if (it == right_links.end()) 
     return false;
-  else if (it->find(std::make_pair(t1, l1)) == it->end())
+  else if (it->second.find(std::make_pair(t1, l1)) == it->second.end())
     return false;
   else return true;
 }
@@ -0,0 +1,64 @@
+#ifndef _FTK_DIRECT_MAPPED_CACHE_HH
+#define _FTK_DIRECT_MAPPED_CACHE_HH
+
+#include <ftk/config.hh>
+#include <atomic>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+namespace ftk {
+
+// A small direct-mapped cache of n-component values for the calling
+// thread, used to reuse values derived on the fly (e.g. gradients) across
+// neighboring simplices.  Entries are keyed by 64-bit ids.  Each owner
+// holds an epoch from next_cache_epoch() and draws a new one whenever the
+// underlying data may change; a change of epoch drops the entries of the
+// thread.  Owners that share a thread evict each other, which only costs
+// recomputation.
+inline uint64_t next_cache_epoch()
+{
+  static std::atomic<uint64_t> e(0);
+  return ++ e;
+}
+
+template <typename T, int n, size_t capacity=4096>
+struct direct_mapped_cache {
+  // copies the values of key to v; derive(v) computes them on a miss
+  template <typename Func>
+  static void get(uint64_t epoch, uint64_t key, T v[n], Func derive);
+
+private:
+  struct entry_t {
+    uint64_t key;
+    T v[n];
+  };
+};
+
+/////
+template <typename T, int n, size_t capacity>
+template <typename Func>
+void direct_mapped_cache<T, n, capacity>::get(uint64_t epoch, uint64_t key, T v[n], Func derive)
+{
+  static const uint64_t empty = std::numeric_limits<uint64_t>::max();
+  thread_local uint64_t my_epoch = 0;
+  thread_local std::vector<entry_t> entries;
+
+  if (my_epoch != epoch) {
+    entries.resize(capacity);
+    for (auto &e : entries)
+      e.key = empty;
+    my_epoch = epoch;
+  }
+
+  entry_t &e = entries[key % capacity];
+  if (e.key != key) {
+    derive(e.v);
+    e.key = key;
+  }
+  std::copy(e.v, e.v + n, v);
+}
+
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef _DIYEXT_NEIGHBOR_EXCHANGE_HH
+#define _DIYEXT_NEIGHBOR_EXCHANGE_HH
+
+#include <ftk/external/diy/mpi.hpp>
+#include <ftk/utils/serialization.hh>
+#include <map>
+#include <set>
+
+namespace diy { namespace mpi {
+
+// point-to-point exchange of one container with each neighbor rank; the
+// neighbor relation must be symmetric.  Missing entries in outgoing are
+// sent as empty containers.
+template <typename Container>
+inline void neighbor_exchange(const communicator& comm,
+    const std::set<int>& neighbors,
+    const std::map<int/*rank*/, Container>& outgoing,
+    std::map<int/*rank*/, Container>& incoming)
+{
+  incoming.clear();
+
+#if FTK_HAVE_MPI
+  const int nn = neighbors.size();
+  std::vector<std::string> sendbufs(nn), recvbufs(nn);
+  std::vector<int> sendsizes(nn), recvsizes(nn);
+  std::vector<MPI_Request> reqs(2 * nn);
+
+  int i = 0;
+  for (const int r : neighbors) {
+    auto it = outgoing.find(r);
+    serializeToString(it == outgoing.end() ? Container() : it->second, sendbufs[i]);
+    sendsizes[i] = sendbufs[i].size();
+    i ++;
+  }
+
+  // sizes
+  i = 0;
+  for (const int r : neighbors) {
+    MPI_Irecv(&recvsizes[i], 1, MPI_INT, r, 0, comm, &reqs[i]);
+    MPI_Isend(&sendsizes[i], 1, MPI_INT, r, 0, comm, &reqs[nn+i]);
+    i ++;
+  }
+  MPI_Waitall(2*nn, reqs.data(), MPI_STATUSES_IGNORE);
+
+  // payloads
+  i = 0;
+  for (const int r : neighbors) {
+    recvbufs[i].resize(recvsizes[i]);
+    MPI_Irecv(&recvbufs[i][0], recvsizes[i], MPI_CHAR, r, 1, comm, &reqs[i]);
+    MPI_Isend(&sendbufs[i][0], sendsizes[i], MPI_CHAR, r, 1, comm, &reqs[nn+i]);
+    i ++;
+  }
+  MPI_Waitall(2*nn, reqs.data(), MPI_STATUSES_IGNORE);
+
+  i = 0;
+  for (const int r : neighbors) {
+    unserializeFromString(recvbufs[i], incoming[r]);
+    i ++;
+  }
+#endif
+}
+
+} // namespace mpi
+} // namespace diy
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef _FTK_THREAD_LOCAL_BUFFER_HH
+#define _FTK_THREAD_LOCAL_BUFFER_HH
+
+#include <ftk/config.hh>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <vector>
+
+namespace ftk {
+
+// A set of per-thread append-only buffers.  Each worker thread gets its
+// own std::vector on first access; the mutex is only taken once per
+// thread per epoch, so concurrent appends do not contend.  After the
+// parallel section, the buffers are merged by the calling thread.
+template <typename T>
+struct thread_local_buffer {
+  thread_local_buffer() : epoch(next_epoch()) {}
+  thread_local_buffer(const thread_local_buffer&) = delete;
+  thread_local_buffer& operator=(const thread_local_buffer&) = delete;
+
+  std::vector<T>& local(); // buffer of the calling thread
+
+  size_t size() const; // total number of elements in all buffers
+  std::vector<T> merge(); // concatenate and clear all buffers
+  void clear();
+
+private:
+  static uint64_t next_epoch() {
+    static std::atomic<uint64_t> e(0);
+    return ++ e;
+  }
+
+private:
+  uint64_t epoch; // invalidates cached thread-local pointers after clear()
+  std::mutex mutex;
+  std::list<std::vector<T>> buffers; // list for stable addresses
+};
+
+/////
+template <typename T>
+std::vector<T>& thread_local_buffer<T>::local()
+{
+  thread_local uint64_t my_epoch = 0;
+  thread_local std::vector<T> *my_buffer = NULL;
+
+  if (my_epoch != epoch) {
+    std::lock_guard<std::mutex> guard(mutex);
+    buffers.emplace_back();
+    my_buffer = &buffers.back();
+    my_epoch = epoch;
+  }
+  return *my_buffer;
+}
+
+template <typename T>
+size_t thread_local_buffer<T>::size() const
+{
+  size_t n = 0;
+  for (const auto &b : buffers)
+    n += b.size();
+  return n;
+}
+
+template <typename T>
+std::vector<T> thread_local_buffer<T>::merge()
+{
+  std::vector<T> results;
+  results.reserve(size());
+  for (auto &b : buffers)
+    results.insert(results.end(),
+        std::make_move_iterator(b.begin()), std::make_move_iterator(b.end()));
+  clear();
+  return results;
+}
+
+template <typename T>
+void thread_local_buffer<T>::clear()
+{
+  std::lock_guard<std::mutex> guard(mutex);
+  buffers.clear();
+  epoch = next_epoch();
+}
+
+}
+
+#endif
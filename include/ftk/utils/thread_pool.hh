@@ -0,0 +1,195 @@
+#ifndef _FTK_THREAD_POOL_HH
+#define _FTK_THREAD_POOL_HH
+
+#include <ftk/config.hh>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <sched.h>
+#include <pthread.h>
+
+namespace ftk {
+
+// A process-wide pool of persistent worker threads for parallel_for.
+// The task range is cut into one contiguous block per participating
+// thread; each thread consumes its own block chunk by chunk, and steals
+// chunks from other blocks once its own block is exhausted.  Workers are
+// created lazily and reused across calls, so sweeping simplices every
+// timestep does not spawn threads.  Nested calls (from inside a task)
+// run serially in the calling thread.
+struct thread_pool {
+  static thread_pool& instance() {
+    static thread_pool pool;
+    return pool;
+  }
+
+  ~thread_pool();
+
+  void parallel_for(size_t ntasks, const std::function<void(size_t)>& f,
+      int nthreads = std::thread::hardware_concurrency(),
+      bool affinity = false);
+
+  int size() const {return workers.size();} // number of worker threads
+
+private:
+  thread_pool() {}
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  struct alignas(64) block_t {
+    std::atomic<size_t> next;
+    size_t end;
+  };
+
+  void grow(int nworkers);
+  void worker_main(int i);
+  void run(int participant); // process own block, then steal from others
+
+  static void set_affinity(int cpu);
+  static bool& in_task() {
+    thread_local bool b = false;
+    return b;
+  }
+
+private:
+  std::mutex job_mutex; // serializes jobs from different caller threads
+
+  std::mutex mutex;
+  std::condition_variable cv_job, cv_done;
+  uint64_t generation = 0;
+  int nparticipants = 0, nbusy = 0;
+  bool stopping = false, pin = false;
+
+  const std::function<void(size_t)> *func = NULL;
+  size_t grain = 1;
+  std::unique_ptr<block_t[]> blocks;
+
+  std::vector<std::thread> workers;
+};
+
+/////
+inline thread_pool::~thread_pool()
+{
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    stopping = true;
+  }
+  cv_job.notify_all();
+  for (auto &t : workers)
+    t.join();
+}
+
+inline void thread_pool::set_affinity(int cpu)
+{
+#if !defined(_MSC_VER) && !defined(__APPLE__)
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+#endif
+}
+
+inline void thread_pool::grow(int nworkers)
+{
+  while (workers.size() < nworkers) {
+    const int i = workers.size();
+    workers.push_back(std::thread([this, i]() {worker_main(i);}));
+  }
+}
+
+inline void thread_pool::worker_main(int i)
+{
+  uint64_t my_generation = 0;
+  bool pinned = false;
+
+  while (1) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv_job.wait(lock, [&]() {return stopping || generation != my_generation;});
+      if (stopping) return;
+      my_generation = generation;
+      if (i + 1 >= nparticipants) continue; // not needed for this job
+    }
+
+    if (pin && !pinned) {
+      set_affinity(i + 1);
+      pinned = true;
+    }
+
+    in_task() = true;
+    run(i + 1);
+    in_task() = false;
+
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      if (-- nbusy == 0)
+        cv_done.notify_one();
+    }
+  }
+}
+
+inline void thread_pool::run(int p)
+{
+  const auto &f = *func;
+  for (int k = 0; k < nparticipants; k ++) {
+    block_t &b = blocks[(p + k) % nparticipants]; // own block first
+    while (1) {
+      const size_t i0 = b.next.fetch_add(grain, std::memory_order_relaxed);
+      if (i0 >= b.end) break;
+      const size_t i1 = std::min(i0 + grain, b.end);
+      for (size_t i = i0; i < i1; i ++)
+        f(i);
+    }
+  }
+}
+
+inline void thread_pool::parallel_for(size_t ntasks, const std::function<void(size_t)>& f, int nthreads, bool affinity)
+{
+  nthreads = std::max(1, std::min<int>(nthreads, std::min<size_t>(ntasks, std::numeric_limits<int>::max())));
+  if (nthreads <= 1 || in_task()) { // serial or nested
+    for (size_t i = 0; i < ntasks; i ++)
+      f(i);
+    return;
+  }
+
+  std::lock_guard<std::mutex> job_guard(job_mutex);
+
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    grow(nthreads - 1);
+
+    blocks.reset(new block_t[nthreads]);
+    const size_t block_size = (ntasks + nthreads - 1) / nthreads;
+    for (int i = 0; i < nthreads; i ++) {
+      blocks[i].next = std::min(ntasks, i * block_size);
+      blocks[i].end = std::min(ntasks, (i + 1) * block_size);
+    }
+    grain = std::max(size_t(1), block_size / 64);
+
+    func = &f;
+    pin = affinity;
+    nparticipants = nthreads;
+    nbusy = nthreads - 1;
+    generation ++;
+  }
+  cv_job.notify_all();
+
+  if (affinity) set_affinity(0);
+  in_task() = true;
+  run(0);
+  in_task() = false;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  cv_done.wait(lock, [&]() {return nbusy == 0;});
+  func = NULL;
+}
+
+}
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef _PYFTK_CRITICAL_POINT_TRACKER_STREAM_HH
+#define _PYFTK_CRITICAL_POINT_TRACKER_STREAM_HH
+
+#include <ftk/config.hh>
+#include <ftk/ndarray.hh>
+#include <ftk/filters/critical_point_tracker_2d_regular.hh>
+#include <ftk/filters/critical_point_tracker_3d_regular.hh>
+#include <ftk/filters/critical_point_tracker_2d_unstructured.hh>
+#include <ftk/filters/critical_point_tracker_3d_unstructured.hh>
+#include <ftk/mesh/simplicial_unstructured_extruded_2d_mesh_implicit.hh>
+#include <stdexcept>
+
+// The part of pyftk's streaming critical point trackers that does not
+// depend on pybind11: a tracker that is fed one timestep at a time, and
+// the factories of regular and unstructured trackers.  Inputs are read in
+// place from contiguous buffers with the expected number of elements; the
+// tracker keeps its own copy of the (at most two) timesteps it needs.  The
+// shapes follow the other functions of pyftk, i.e. (W, H[, D]) for scalar
+// fields and (nc, W, H[, D]) or (nc, n) for vector fields.
+struct critical_point_tracker_stream {
+  critical_point_tracker_stream(std::shared_ptr<ftk::critical_point_tracker> t,
+      const std::vector<size_t>& scalar_shape, const std::vector<size_t>& vector_shape)
+    : tracker(t), scalar_shape(scalar_shape), vector_shape(vector_shape) { tracker->initialize(); }
+
+  template <typename T> void push_scalar(const T *p, size_t n) {
+    tracker->push_scalar_field_snapshot(to_ndarray(p, n, scalar_shape));
+    advance();
+  }
+
+  template <typename T> void push_vector(const T *p, size_t n) {
+    tracker->push_vector_field_snapshot(to_ndarray(p, n, vector_shape));
+    advance();
+  }
+
+  void finish() {
+    if (finished) return;
+    if (nt > 0) tracker->update_timestep();
+    tracker->finalize();
+    finished = true;
+  }
+
+  std::vector<ftk::feature_point_t> get_critical_points() const { return tracker->get_critical_points(); }
+  std::vector<ftk::feature_point_t> get_traced_critical_points() const { // id is the trajectory id
+    std::vector<ftk::feature_point_t> pts;
+    for (const auto &kv : tracker->get_traced_critical_points())
+      for (const auto &p : kv.second) {
+        pts.push_back(p);
+        pts.back().id = kv.first;
+      }
+    return pts;
+  }
+
+  int get_num_timesteps() const { return nt; }
+
+public:
+  static std::shared_ptr<critical_point_tracker_stream> new_regular(
+      diy::mpi::communicator comm, const std::vector<size_t>& dims, const std::string& field);
+  static std::shared_ptr<critical_point_tracker_stream> new_2d_unstructured(
+      diy::mpi::communicator comm, const ftk::ndarray<double>& coords, const ftk::ndarray<int>& triangles);
+  static std::shared_ptr<critical_point_tracker_stream> new_3d_unstructured(
+      diy::mpi::communicator comm, const ftk::ndarray<double>& coords, const ftk::ndarray<int>& tets);
+
+protected:
+  void advance() {
+    if (finished) throw std::runtime_error("the tracker is already finished");
+    if (nt ++ != 0) tracker->advance_timestep();
+  }
+
+  template <typename T>
+  static ftk::ndarray<T> to_ndarray(const T *p, size_t n, const std::vector<size_t>& shape) {
+    size_t n0 = 1;
+    for (auto d : shape) n0 *= d;
+    if (n != n0)
+      throw std::runtime_error("Number of elements does not match the shape of the tracker");
+
+    ftk::ndarray<T> array;
+    array.from_array(p, shape);
+    return array;
+  }
+
+protected:
+  std::shared_ptr<ftk::critical_point_tracker> tracker;
+  const std::vector<size_t> scalar_shape, vector_shape;
+  int nt = 0;
+  bool finished = false;
+};
+
+/////
+inline std::shared_ptr<critical_point_tracker_stream> critical_point_tracker_stream::new_regular(
+    diy::mpi::communicator comm, const std::vector<size_t>& dims, const std::string& field)
+{
+  const int nd = dims.size();
+  const bool scalar = field == "scalar";
+  if (!scalar && field != "vector")
+    throw std::runtime_error("field must be either scalar or vector");
+  for (auto d : dims)
+    if (d < (scalar ? 5 : 3))
+      throw std::runtime_error("the domain is too small");
+
+  // the indentation is needed because the jacobian field (and the gradient field of scalars) are derived
+  const int margin = scalar ? 2 : 1;
+  std::vector<size_t> lb(nd, margin), sizes(nd), vshape(dims);
+  for (int i = 0; i < nd; i ++)
+    sizes[i] = dims[i] - margin - 1;
+  vshape.insert(vshape.begin(), nd);
+
+  std::shared_ptr<ftk::critical_point_tracker_regular> t;
+  if (nd == 2) t.reset(new ftk::critical_point_tracker_2d_regular(comm));
+  else if (nd == 3) t.reset(new ftk::critical_point_tracker_3d_regular(comm));
+  else throw std::runtime_error("Number of dimensions must be 2 or 3");
+
+  t->set_scalar_field_source( scalar ? ftk::SOURCE_GIVEN : ftk::SOURCE_NONE );
+  t->set_vector_field_source( scalar ? ftk::SOURCE_DERIVED : ftk::SOURCE_GIVEN );
+  t->set_jacobian_field_source( ftk::SOURCE_DERIVED );
+  t->set_jacobian_symmetric( scalar );
+  t->set_domain(ftk::lattice(std::vector<size_t>(lb), sizes));
+  t->set_array_domain(ftk::lattice(std::vector<size_t>(nd, 0), dims));
+  t->set_input_array_partial( false );
+
+  return std::make_shared<critical_point_tracker_stream>(t, dims, vshape);
+}
+
+inline std::shared_ptr<critical_point_tracker_stream> critical_point_tracker_stream::new_2d_unstructured(
+    diy::mpi::communicator comm, const ftk::ndarray<double>& coords, const ftk::ndarray<int>& triangles)
+{
+  if (coords.nd() != 2 || coords.dim(0) != 2 || triangles.nd() != 2 || triangles.dim(0) != 3)
+    throw std::runtime_error("coords and triangles must be in shapes of (2, n) and (3, m)");
+
+  std::shared_ptr<ftk::simplicial_unstructured_2d_mesh<>> m2(
+      new ftk::simplicial_unstructured_2d_mesh<>(coords, triangles));
+  std::shared_ptr<ftk::simplicial_unstructured_extruded_2d_mesh_implicit<>> m3(
+      new ftk::simplicial_unstructured_extruded_2d_mesh_implicit<>(m2));
+  std::shared_ptr<ftk::critical_point_tracker> t(new ftk::critical_point_tracker_2d_unstructured(comm, m3));
+
+  const size_t n = m2->n(0);
+  return std::make_shared<critical_point_tracker_stream>(t, std::vector<size_t>({n}), std::vector<size_t>({2, n}));
+}
+
+inline std::shared_ptr<critical_point_tracker_stream> critical_point_tracker_stream::new_3d_unstructured(
+    diy::mpi::communicator comm, const ftk::ndarray<double>& coords, const ftk::ndarray<int>& tets)
+{
+  if (coords.nd() != 2 || coords.dim(0) != 3 || tets.nd() != 2 || tets.dim(0) != 4)
+    throw std::runtime_error("coords and tets must be in shapes of (3, n) and (4, m)");
+
+  std::shared_ptr<ftk::simplicial_unstructured_3d_mesh<>> m3(
+      new ftk::simplicial_unstructured_3d_mesh<>(coords.std_vector(), tets.std_vector()));
+  std::shared_ptr<ftk::critical_point_tracker> t(new ftk::critical_point_tracker_3d_unstructured(comm, m3));
+
+  const size_t n = m3->n(0);
+  return std::make_shared<critical_point_tracker_stream>(t, std::vector<size_t>({n}), std::vector<size_t>({3, n}));
+}
+
+#endif
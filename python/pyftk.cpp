@@ -3,12 +3,34 @@
 #include <pybind11/numpy.h>
 #include <ftk/ndarray.hh>
 #include <ftk/filters/json_interface.hh>
+#include "critical_point_tracker_stream.hh"
 
 diy::mpi::environment env;
 diy::mpi::communicator comm;
 
 namespace py = pybind11;
 
+// one row of the structured arrays returned by the streaming trackers
+struct critical_point_record_t {
+  double x, y, z, t;
+  int type;
+  double scalar;
+  unsigned long long id;
+};
+
+PYBIND11_NUMPY_DTYPE(critical_point_record_t, x, y, z, t, type, scalar, id);
+
+static py::array_t<critical_point_record_t> to_records(const std::vector<ftk::feature_point_t>& pts)
+{
+  py::array_t<critical_point_record_t> records(pts.size());
+  auto r = records.mutable_unchecked<1>();
+  for (size_t i = 0; i < pts.size(); i ++) {
+    const auto &p = pts[i];
+    r(i) = critical_point_record_t{p.x[0], p.x[1], p.x[2], p.t, int(p.type), p.scalar[0], p.id};
+  }
+  return records;
+}
+
 PYBIND11_MODULE(pyftk, m) {
   m.doc() = R"pbdoc(FTK Python bindings)pbdoc";
  
@@ -141,6 +163,48 @@ PYBIND11_MODULE(pyftk, m) {
     return result;
   }, R"pbdoc(Track 2D critical points)pbdoc");
 
+  // arrays are read in place if they are C-contiguous float32/float64 arrays
+  using float_array_t = py::array_t<float, py::array::c_style | py::array::forcecast>;
+  using double_array_t = py::array_t<double, py::array::c_style | py::array::forcecast>;
+  using int_array_t = py::array_t<int, py::array::c_style | py::array::forcecast>;
+
+  py::class_<critical_point_tracker_stream, std::shared_ptr<critical_point_tracker_stream>>(trackers, "critical_point_tracker", 
+      R"pbdoc(Streaming critical point tracker; push one timestep at a time, call finish() after the last timestep, and get results as structured arrays with fields x, y, z, t, type, scalar, and id)pbdoc")
+    .def("push_scalar_field", [](critical_point_tracker_stream& t, float_array_t a) { t.push_scalar(a.data(), a.size()); })
+    .def("push_scalar_field", [](critical_point_tracker_stream& t, double_array_t a) { t.push_scalar(a.data(), a.size()); }, 
+        R"pbdoc(Push the scalar field of the next timestep)pbdoc")
+    .def("push_vector_field", [](critical_point_tracker_stream& t, float_array_t a) { t.push_vector(a.data(), a.size()); })
+    .def("push_vector_field", [](critical_point_tracker_stream& t, double_array_t a) { t.push_vector(a.data(), a.size()); }, 
+        R"pbdoc(Push the vector field of the next timestep)pbdoc")
+    .def("finish", &critical_point_tracker_stream::finish, R"pbdoc(Track the last timestep and trace trajectories)pbdoc")
+    .def("get_critical_points", [](const critical_point_tracker_stream& t) { return to_records(t.get_critical_points()); }, 
+        R"pbdoc(Critical points detected so far)pbdoc")
+    .def("get_traced_critical_points", [](const critical_point_tracker_stream& t) { return to_records(t.get_traced_critical_points()); }, 
+        R"pbdoc(Traced critical points, available after finish(); id is the trajectory id)pbdoc")
+    .def_property_readonly("num_timesteps", &critical_point_tracker_stream::get_num_timesteps);
+
+  trackers.def("critical_point_tracker_2d_regular", [](size_t DW, size_t DH, const std::string& field) {
+    return critical_point_tracker_stream::new_regular(comm, {DW, DH}, field);
+  }, py::arg("width"), py::arg("height"), py::arg("field") = "scalar",
+  R"pbdoc(Create a streaming tracker for 2D regular-grid scalar or vector fields)pbdoc");
+
+  trackers.def("critical_point_tracker_3d_regular", [](size_t DW, size_t DH, size_t DD, const std::string& field) {
+    return critical_point_tracker_stream::new_regular(comm, {DW, DH, DD}, field);
+  }, py::arg("width"), py::arg("height"), py::arg("depth"), py::arg("field") = "scalar",
+  R"pbdoc(Create a streaming tracker for 3D regular-grid scalar or vector fields)pbdoc");
+
+  trackers.def("critical_point_tracker_2d_unstructured", [](double_array_t coords, int_array_t triangles) {
+    return critical_point_tracker_stream::new_2d_unstructured(comm, 
+        ftk::ndarray<double>(coords), ftk::ndarray<int>(triangles));
+  }, py::arg("coords"), py::arg("triangles"),
+  R"pbdoc(Create a streaming tracker for 2D vector fields on a triangular mesh)pbdoc");
+  
+  trackers.def("critical_point_tracker_3d_unstructured", [](double_array_t coords, int_array_t tets) {
+    return critical_point_tracker_stream::new_3d_unstructured(comm, 
+        ftk::ndarray<double>(coords), ftk::ndarray<int>(tets));
+  }, py::arg("coords"), py::arg("tets"),
+  R"pbdoc(Create a streaming tracker for 3D vector fields on a tetrahedral mesh)pbdoc");
+
   py::module synth = m.def_submodule("synthesizers", "Synthetic data generator");
   synth.def("spiral_woven", [](int DW, int DH, int DT) {
     auto array = ftk::synthetic_woven_2Dt<double>(DW, DH, DT);
@@ -0,0 +1,230 @@
+#include <fstream>
+#include <chrono>
+#include <sys/resource.h>
+#include "ftk/external/cxxopts.hpp"
+#include "ftk/external/json.hh"
+#include "ftk/filters/json_interface.hh"
+#include "ftk/filters/critical_point_tracker_2d_regular.hh"
+#include "ftk/filters/critical_point_tracker_3d_regular.hh"
+#include "ftk/utils/string.hh"
+
+// Throughput benchmark for the regular critical point trackers.  Each
+// run drives a tracker through a synthetic ndarray_stream and reports
+// one json object per line with timings of I/O (data generation),
+// derivation (gradients/jacobians), detection, and tracing, as well as
+// simplex and critical point throughputs and the peak RSS of the process.
+// With --precision float32, the stream generates float arrays that the
+// tracker stores as is, so float and double pipelines can be compared.
+//
+// Example:
+//   ftk.bench --synthetic woven --width 256 --height 256 --timesteps 16
+//     --nthreads 1,2,4 --thread-backend pthread,pool --precision float32,float64 -o results.jsonl
+
+using namespace ftk;
+using nlohmann::json;
+
+typedef std::chrono::high_resolution_clock clock_type;
+
+static double elapsed(clock_type::time_point t0, clock_type::time_point t1)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() * 1e-9;
+}
+
+static size_t peak_rss_kb()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+  return usage.ru_maxrss / 1024; // bytes on macos
+#else
+  return usage.ru_maxrss; // kilobytes on linux
+#endif
+}
+
+template <typename T>
+static json bench_critical_point_tracker(diy::mpi::communicator comm,
+    const json& jstream, const std::string& backend, int nthreads, bool lock_free)
+{
+  ndarray_stream<T> stream(comm);
+  stream.configure(jstream);
+
+  const auto js = stream.get_json();
+  const size_t nd = stream.n_dimensions(),
+               DW = js["dimensions"][0],
+               DH = js["dimensions"].size() > 1 ? js["dimensions"][1].template get<int>() : 0,
+               DD = js["dimensions"].size() > 2 ? js["dimensions"][2].template get<int>() : 0,
+               DT = js["n_timesteps"];
+  const size_t nv = stream.n_components();
+  const size_t ghost = nv == 1 ? 2 : 1; // derived gradients and/or jacobians need ghost layers
+
+  std::shared_ptr<critical_point_tracker_regular> tracker;
+  if (nd == 2) {
+    tracker.reset(new critical_point_tracker_2d_regular(comm));
+    tracker->set_array_domain(lattice({0, 0}, {DW, DH}));
+    tracker->set_domain(lattice({ghost, ghost}, {DW-2*ghost+1, DH-2*ghost+1}));
+  } else {
+    tracker.reset(new critical_point_tracker_3d_regular(comm));
+    tracker->set_array_domain(lattice({0, 0, 0}, {DW, DH, DD}));
+    tracker->set_domain(lattice({ghost, ghost, ghost}, {DW-2*ghost+1, DH-2*ghost+1, DD-2*ghost+1}));
+  }
+
+  if (nv == 1) { // scalar field
+    tracker->set_scalar_field_source( SOURCE_GIVEN );
+    tracker->set_vector_field_source( SOURCE_DERIVED );
+    tracker->set_jacobian_field_source( SOURCE_DERIVED );
+    tracker->set_jacobian_symmetric( true );
+  } else { // vector field
+    tracker->set_scalar_field_source( SOURCE_NONE );
+    tracker->set_vector_field_source( SOURCE_GIVEN );
+    tracker->set_jacobian_field_source( SOURCE_DERIVED );
+    tracker->set_jacobian_symmetric( false );
+  }
+
+  tracker->use_thread_backend(backend);
+  tracker->set_number_of_threads(nthreads);
+  tracker->set_enable_lock_free_detection(lock_free);
+  tracker->initialize();
+
+  double t_io = 0, t_derive = 0, t_detect = 0, t_trace = 0;
+  auto t_last = clock_type::now();
+
+  stream.set_callback([&](int k, const ndarray<T> &field_data) {
+    auto t0 = clock_type::now();
+    t_io += elapsed(t_last, t0);
+
+    if (nv == 1) tracker->push_scalar_field_snapshot(field_data);
+    else tracker->push_vector_field_snapshot(field_data);
+    auto t1 = clock_type::now();
+    t_derive += elapsed(t0, t1);
+
+    if (k != 0) tracker->advance_timestep();
+    if (k == DT-1) tracker->update_timestep();
+    t_last = clock_type::now();
+    t_detect += elapsed(t1, t_last);
+  });
+
+  auto t0 = clock_type::now();
+  t_last = t0;
+  stream.start();
+  stream.finish();
+  t_io += elapsed(t_last, clock_type::now()); // trailing time spent in the stream
+
+  auto t1 = clock_type::now();
+  tracker->finalize();
+  t_trace = elapsed(t1, clock_type::now());
+
+  // number of simplices scanned: ordinal cells for every timestep,
+  // interval cells for every pair of adjacent timesteps
+  simplicial_regular_mesh m(nd + 1);
+  size_t nspatial = 1;
+  for (int i = 0; i < nd; i ++)
+    nspatial *= (i == 0 ? DW : i == 1 ? DH : DD) - 2*ghost + 1;
+  const size_t nsimplices = nspatial *
+    (m.ntypes(nd, ELEMENT_SCOPE_ORDINAL) * DT + m.ntypes(nd, ELEMENT_SCOPE_INTERVAL) * (DT - 1));
+  const size_t npoints = tracker->get_discrete_critical_points().size();
+  const size_t ntrajs = tracker->get_traced_critical_points().size();
+
+  const double t_total = t_io + t_derive + t_detect + t_trace;
+  json jr = {
+    {"synthetic", js["name"]},
+    {"dimensions", js["dimensions"]},
+    {"n_timesteps", DT},
+    {"thread_backend", backend},
+    {"nthreads", nthreads},
+    {"lock_free_detection", lock_free},
+    {"precision", sizeof(T) == sizeof(float) ? "float32" : "float64"},
+    {"n_simplices", nsimplices},
+    {"n_critical_points", npoints},
+    {"n_trajectories", ntrajs},
+    {"t_io", t_io},
+    {"t_derivation", t_derive},
+    {"t_detection", t_detect},
+    {"t_tracing", t_trace},
+    {"t_total", t_total},
+    {"simplices_per_sec", t_detect > 0 ? nsimplices / t_detect : 0.0},
+    {"critical_points_per_sec", t_detect > 0 ? npoints / t_detect : 0.0},
+    {"peak_rss_kb", peak_rss_kb()}
+  };
+  return jr;
+}
+
+int main(int argc, char **argv)
+{
+  diy::mpi::environment env(argc, argv);
+  diy::mpi::communicator comm;
+
+  std::string synthetic, backends_str, nthreads_str, precisions_str, output_filename;
+  int width = 0, height = 0, depth = 0, timesteps = 0, repeat = 1;
+  bool lock_free = false;
+
+  cxxopts::Options options(argv[0]);
+  options.add_options()
+    ("synthetic", "Synthetic data {woven|double_gyre|merger_2d|moving_extremum_3d|tornado}",
+     cxxopts::value<std::string>(synthetic)->default_value("woven"))
+    ("w,width", "Width (0 for the default size of the synthetic case)",
+     cxxopts::value<int>(width))
+    ("h,height", "Height",
+     cxxopts::value<int>(height))
+    ("d,depth", "Depth",
+     cxxopts::value<int>(depth))
+    ("timesteps", "Number of timesteps (0 for the default of the synthetic case)",
+     cxxopts::value<int>(timesteps))
+    ("thread-backend", "Comma-separated thread backends, e.g. pthread,pool",
+     cxxopts::value<std::string>(backends_str)->default_value("pthread"))
+    ("nthreads", "Comma-separated numbers of threads, e.g. 1,2,4",
+     cxxopts::value<std::string>(nthreads_str)->default_value(std::to_string(std::thread::hardware_concurrency())))
+    ("lock-free-detection", "Collect detected critical points in per-thread buffers",
+     cxxopts::value<bool>(lock_free))
+    ("precision", "Comma-separated precisions of the stream and the stored timesteps, e.g. float32,float64",
+     cxxopts::value<std::string>(precisions_str)->default_value("float64"))
+    ("repeat", "Number of runs for each configuration",
+     cxxopts::value<int>(repeat))
+    ("o,output", "Output file (json lines); results are written to stdout if not given",
+     cxxopts::value<std::string>(output_filename))
+    ("help", "Print usage");
+  auto results = options.parse(argc, argv);
+
+  if (results.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  json jstream = {
+    {"type", "synthetic"},
+    {"name", synthetic}
+  };
+  if (width > 0) {
+    std::vector<int> dims = {width, height > 0 ? height : width};
+    if (synthetic == "moving_extremum_3d" || synthetic == "tornado")
+      dims.push_back(depth > 0 ? depth : width);
+    jstream["dimensions"] = dims;
+  }
+  if (timesteps > 0)
+    jstream["n_timesteps"] = timesteps;
+
+  std::ofstream ofs;
+  if (!output_filename.empty()) {
+    ofs.open(output_filename);
+    if (!ofs.is_open())
+      fatal("cannot open output file " + output_filename);
+  }
+  std::ostream &os = output_filename.empty() ? std::cout : ofs;
+
+  for (const auto &precision : split(precisions_str, ","))
+    for (const auto &backend : split(backends_str, ","))
+      for (const auto &nt : split(nthreads_str, ","))
+        for (int r = 0; r < repeat; r ++) {
+          json jr;
+          if (precision == "float32")
+            jr = bench_critical_point_tracker<float>(comm, jstream, backend, std::stoi(nt), lock_free);
+          else if (precision == "float64")
+            jr = bench_critical_point_tracker<double>(comm, jstream, backend, std::stoi(nt), lock_free);
+          else 
+            fatal("invalid precision " + precision);
+          jr["run"] = r;
+          if (comm.rank() == 0)
+            os << jr.dump() << std::endl;
+        }
+
+  return 0;
+}
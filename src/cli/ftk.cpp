@@ -38,14 +38,19 @@ std::string output_pattern, output_type, output_format;
 std::string mesh_filename;
 std::string archived_intersections_filename, // archived_discrete_critical_points_filename,
   archived_traced_filename; // archived_traced_critical_points_filename;
-std::string thread_backend, accelerator;
+std::string thread_backend, accelerator, precision;
 std::string type_filter_str;
 int nthreads = std::thread::hardware_concurrency();
 bool affinity = false, async = false;
+int async_prefetch = 2, async_readers = 1;
 bool verbose = false, timing = false, help = false;
 int nblocks; 
 bool enable_streaming_trajectories = false,
      enable_computing_degrees = false,
+     enable_lock_free_detection = false,
+     enable_lazy_derivatives = false,
+     enable_derivative_cache = false,
+     enable_distributed_tracing = false,
      disable_robust_detection = false;
 int intercept_length = 2;
 
@@ -60,6 +65,9 @@ std::vector<std::string> input_filenames;
 // contour/levelset specific
 double threshold = 0.0;
 
+// critical point specific
+double persistence_threshold = 0.0;
+
 // adios2 specific
 std::string adios_config_file;
 std::string adios_name = "BPReader";
@@ -87,6 +95,8 @@ int xgc_nphi = 1, xgc_iphi = 1, xgc_vphi = 1;
 int pt_nsteps_per_interval = 128;
 int pt_nsteps_per_checkpoint = 16;
 double pt_delta_t = 1.0;
+std::string pt_integrator = "rk4";
+double pt_tolerance = 1e-6;
 std::vector<int> pt_seed_strides;
 std::vector<double> pt_seed_box;
 
@@ -161,8 +171,9 @@ static const std::string
         str_critical_point_type_saddle("saddle");
 
 static const std::set<std::string>
-        set_valid_thread_backend({str_none, "pthread", "openmp", "tbb"}),
+        set_valid_thread_backend({str_none, "pthread", "openmp", "tbb", "pool"}),
         set_valid_accelerator({str_none, "cuda", "sycl"}),
+        set_valid_precision({str_float32, str_float64}),
         set_valid_input_format({str_auto, str_float32, str_float64, str_netcdf, str_hdf5, str_vti, str_vtu, str_adios2}),
         set_valid_input_dimension({str_auto, str_two, str_three});
 
@@ -190,6 +201,8 @@ static void initialize_critical_point_tracker(diy::mpi::communicator comm)
   if (accelerator != str_none)
     j_tracker["accelerator"] = accelerator;
 
+  j_tracker["precision"] = precision;
+
   if (thread_backend != str_none)
     j_tracker["thread_backend"] = thread_backend;
 
@@ -208,6 +221,24 @@ static void initialize_critical_point_tracker(diy::mpi::communicator comm)
   if (disable_robust_detection)
     j_tracker["enable_robust_detection"] = false;
 
+  if (enable_lock_free_detection)
+    j_tracker["enable_lock_free_detection"] = true;
+
+  if (enable_distributed_tracing)
+    j_tracker["enable_distributed_tracing"] = true;
+
+  if (enable_lazy_derivatives)
+    j_tracker["enable_lazy_derivatives"] = true;
+
+  if (enable_derivative_cache)
+    j_tracker["enable_derivative_cache"] = true;
+
+  if (persistence_threshold > 0)
+    j_tracker["persistence_threshold"] = persistence_threshold;
+
+  if (!post_processing_options.empty())
+    j_tracker["post_processing_options"] = post_processing_options;
+
   j_tracker["type_filter"] = type_filter_str;
 
   if (fixed_quantization_factor)
@@ -249,12 +280,7 @@ static void execute_critical_point_tracker(diy::mpi::communicator comm)
  
   // if (!disable_post_processing)
   //    wrapper->post_process();
- 
-  if (!post_processing_options.empty()) {
-    auto &trajs = wrapper->get_tracker()->get_traced_critical_points();
-    feature_curve_set_post_processor_t pp(post_processing_options);
-    pp.filter(trajs);
-  }
+  // post processing options are applied by the wrapper
 
   wrapper->write();
 }
@@ -421,9 +447,7 @@ void initialize_xgc(diy::mpi::communicator comm)
     return; // skip interpolants, smoothing kernel
 
   if (xgc_use_smoothing_kernel) {
-    if (file_exists(xgc_smoothing_kernel_filename))
-      mx2->read_smoothing_kernel(xgc_smoothing_kernel_filename);
-    else {
+    if (!file_exists(xgc_smoothing_kernel_filename) || !mx2->read_smoothing_kernel(xgc_smoothing_kernel_filename)) {
       mx2->build_smoothing_kernel(xgc_smoothing_kernel_size);
       if (!xgc_smoothing_kernel_filename.empty())
         mx2->write_smoothing_kernel(xgc_smoothing_kernel_filename);
@@ -431,9 +455,7 @@ void initialize_xgc(diy::mpi::communicator comm)
   }
   
   if (xgc_interpolant_filename.length() > 0) {
-    if (file_exists( xgc_interpolant_filename ))
-      mx3->read_interpolants( xgc_interpolant_filename );
-    else {
+    if (!file_exists( xgc_interpolant_filename ) || !mx3->read_interpolants( xgc_interpolant_filename )) {
       mx3->initialize_interpolants();
       mx3->write_interpolants( xgc_interpolant_filename );
     }
@@ -542,6 +564,15 @@ void initialize_xgc_blob_threshold_tracker(diy::mpi::communicator comm)
   tracker->set_threshold( threshold );
   tracker->initialize();
 
+  const bool write_blobs = output_type == "blobs"; // per-blob attributes, one line per blob per timestep
+  std::ofstream blobs_ofs;
+  if (write_blobs) {
+    blobs_ofs.open(output_pattern);
+    tracker->set_blob_callback([&](int t, const std::vector<xgc_blob_t>&) {
+      tracker->write_blobs_text(blobs_ofs, t == 0);
+    });
+  }
+
   stream->set_callback([&](int k, const ndarray<double> &data) {
     auto scalar = data.get_transpose();
     tracker->push_field_data_snapshot(scalar);
@@ -556,8 +587,12 @@ void initialize_xgc_blob_threshold_tracker(diy::mpi::communicator comm)
     if (k != 0) tracker->advance_timestep();
     if (k == stream->n_timesteps() - 1) tracker->update_timestep();
 
-    if (k > 0)
-      tracker->write_sliced(k-1, output_pattern);
+    if (!write_blobs) {
+      if (k > 0)
+        tracker->write_sliced(k-1, output_pattern);
+      if (k == stream->n_timesteps() - 1)
+        tracker->write_sliced(k, output_pattern);
+    }
 #endif      
     // mx->scalar_to_vtu_slices_file(filename, "scalar", scalar);
   });
@@ -657,6 +692,8 @@ void initialize_particle_tracer(diy::mpi::communicator comm)
   tr->set_nsteps_per_interval(pt_nsteps_per_interval);
   tr->set_nsteps_per_checkpoint(pt_nsteps_per_checkpoint);
   tr->set_delta_t( pt_delta_t ); // TODO: for now, a day per timestep
+  tr->set_integrator( pt_integrator );
+  tr->set_tolerances( pt_tolerance, pt_tolerance );
 
   if (nd == 2) tr->set_domain(lattice({0, 0}, {DW-1, DH-1}));
   else tr->set_domain(lattice({0, 0, 0}, {DW-1, DH-1, DD-1}));
@@ -723,6 +760,13 @@ void initialize_critical_line_tracker(diy::mpi::communicator comm)
     if (accelerator == "cuda")
       tracker_critical_line_regular->use_accelerator(FTK_XL_CUDA);
 
+    if (enable_streaming_trajectories && output_type == "traced") { // one file per slab, e.g. surface-%04d.vtp
+      tracker_critical_line_regular->set_enable_streaming_surfaces(true);
+      tracker_critical_line_regular->set_surface_slab_callback([](int t, const feature_surface_t& surf) {
+        surf.save(series_filename(output_pattern, t), output_format);
+      });
+    }
+
     tracker_critical_line = tracker_critical_line_regular;
   }
     
@@ -747,7 +791,7 @@ void execute_critical_line_tracker(diy::mpi::communicator comm)
   tracker_critical_line->finalize();
   if (output_type == "sliced")
     tracker_critical_line->write_sliced(output_pattern);
-  else if (output_type == "traced")
+  else if (output_type == "traced" && !(enable_streaming_trajectories && tracker_critical_line_regular))
     tracker_critical_line->write_surfaces(output_pattern, output_format);
 }
 
@@ -784,6 +828,13 @@ void initialize_tdgl_tracker(diy::mpi::communicator comm)
   tracker_tdgl->set_number_of_threads(nthreads);
   if (accelerator == "cuda")
     tracker_tdgl->use_accelerator(ftk::FTK_XL_CUDA);
+
+  if (enable_streaming_trajectories && output_type == "traced") { // one file per slab, e.g. surface-%04d.vtp
+    tracker_tdgl->set_enable_streaming_surfaces(true);
+    tracker_tdgl->set_surface_slab_callback([](int t, const feature_surface_t& surf) {
+      surf.save(series_filename(output_pattern, t), output_format);
+    });
+  }
 }
 
 void execute_tdgl_tracker(diy::mpi::communicator comm)
@@ -813,7 +864,7 @@ void execute_tdgl_tracker(diy::mpi::communicator comm)
     tracker_tdgl->write_intersections(output_pattern);
   else if (output_type == "sliced")
     tracker_tdgl->write_sliced(output_pattern);
-  else 
+  else if (!(enable_streaming_trajectories && output_type == "traced" && archived_traced_filename.empty())) // slabs are already written
     tracker_tdgl->write_surfaces(output_pattern, output_format);
 }
 
@@ -836,8 +887,11 @@ static inline nlohmann::json args_to_input_stream_json(cxxopts::ParseResult& res
       j["filenames"] = results["input"].as<std::string>();
   }
 
-  if (results.count("async"))
+  if (results.count("async")) {
     j["async"] = true;
+    j["async_prefetch"] = async_prefetch;
+    j["async_readers"] = async_readers;
+  }
 
   if (results.count("synthetic")) {
     j["type"] = "synthetic";
@@ -930,6 +984,9 @@ int parse_arguments(int argc, char **argv, diy::mpi::communicator comm)
     ("pt-nsteps-per-interval", "Particle tracing: Number of steps per interval", cxxopts::value<int>(pt_nsteps_per_interval))
     ("pt-nsteps-per-checkpoint", "Particle tracing: Number of steps per checkpoint", cxxopts::value<int>(pt_nsteps_per_checkpoint))
     ("pt-delta-t", "Particle tracing: Delta t per timestep", cxxopts::value<double>(pt_delta_t))
+    ("pt-integrator", "Particle tracing: Integrator {rk4|rk45}; rk45 adapts step sizes with error control", 
+     cxxopts::value<std::string>(pt_integrator)->default_value("rk4"))
+    ("pt-tolerance", "Particle tracing: Absolute and relative error tolerance of the rk45 integrator", cxxopts::value<double>(pt_tolerance))
     ("pt-seed-strides", "Particle tracing: Seed strides, e.g., '4', '1,4', or '1,4,4'", cxxopts::value<std::string>())
     ("ptgeo-seeds", "Geo particle tracing: Seed in a geobox: nlat,lat0,lat1,nlon,lon0,lon1,nz,z0,z1", cxxopts::value<std::string>())
     ("ptgeo-nsteps-per-day", "Geo particle tracing: Number of steps per earth day", cxxopts::value<int>(ptgeo_nsteps_per_day))
@@ -940,7 +997,7 @@ int parse_arguments(int argc, char **argv, diy::mpi::communicator comm)
     // ("mpas-data-path", "MPAS: data path", cxxopts::value<std::string>(mpas_data_path))
     ("o,output", "Output file, either one single file (e.g. out.vtp) or a pattern (e.g. out-%05d.vtp)", 
      cxxopts::value<std::string>(output_pattern))
-    ("output-type", "Output type {discrete|traced|sliced|intercepted}, by default traced", 
+    ("output-type", "Output type {discrete|traced|sliced|intercepted|blobs}, by default traced", 
      cxxopts::value<std::string>(output_type)->default_value("traced"))
     ("output-format", "Output format {text|vtp|vtu|ply}.  The default behavior is to automatically determine format by filename", 
      cxxopts::value<std::string>(output_format)->default_value(str_auto))
@@ -950,7 +1007,7 @@ int parse_arguments(int argc, char **argv, diy::mpi::communicator comm)
      cxxopts::value<int>(intercept_length)->default_value("2"))
     ("type-filter", "Type filter: ane single or a combination of critical point types, e.g. `min', `max', `saddle', `min|max'",
      cxxopts::value<std::string>(type_filter_str))
-    ("thread-backend", "Thread backends {pthread|openmp|tbb}",
+    ("thread-backend", "Thread backends {pthread|openmp|tbb|pool}",
      cxxopts::value<std::string>(thread_backend)->default_value(str_none))
     ("affinity", "Enable thread affinity", 
      cxxopts::value<bool>(affinity))
@@ -960,20 +1017,36 @@ int parse_arguments(int argc, char **argv, diy::mpi::communicator comm)
      cxxopts::value<bool>(timing))
     ("a,accelerator", "Accelerator {none|cuda|sycl} (experimental)",
      cxxopts::value<std::string>(accelerator)->default_value(str_none))
+    ("precision", "Precision of stored timesteps {float32|float64}; float32 halves the memory of regular critical point trackers",
+     cxxopts::value<std::string>(precision)->default_value(str_float64))
     ("device", "Device ID(s)", 
      cxxopts::value<std::string>(device_ids)->default_value("0"))
     ("device-buffer", "Device buffer size in MB", 
      cxxopts::value<int>(device_buffer_size)->default_value("512"))
-    ("stream",  "Stream trajectories (experimental)",
+    ("stream",  "Stream trajectories (experimental); for tdgl_vortex and critical_line, write the traced surface slab by slab to the output pattern",
      cxxopts::value<bool>(enable_streaming_trajectories))
     ("compute-degrees", "Compute degrees instead of types", 
      cxxopts::value<bool>(enable_computing_degrees)->default_value("false"))
-    ("post-process", "Post process based on given options",
+    ("post-process", "Post process trajectories with comma-separated ops, e.g. split,duration_pruning:2,persistence_pruning:0.1[:k],extent_pruning:0.5; applied to each trajectory once complete with --stream",
      cxxopts::value<std::string>(post_processing_options)->default_value(""))
     ("no-robust-detection", "Disable robust detection (faster than robust detection)",
      cxxopts::value<bool>(disable_robust_detection))
+    ("lock-free-detection", "Collect detected critical points in per-thread buffers (experimental)",
+     cxxopts::value<bool>(enable_lock_free_detection))
+    ("distributed-tracing", "Trace trajectories without gathering critical points to the root process; use with pvtp outputs to write one piece per process",
+     cxxopts::value<bool>(enable_distributed_tracing))
+    ("lazy-derivatives", "Compute gradients and Jacobians of scalar fields on the fly instead of storing them with each timestep",
+     cxxopts::value<bool>(enable_lazy_derivatives))
+    ("derivative-cache", "Cache gradients computed on the fly in small per-thread caches; use with --lazy-derivatives",
+     cxxopts::value<bool>(enable_derivative_cache))
+    ("persistence-threshold", "Drop critical points of scalar fields whose merge tree persistence is below the threshold",
+     cxxopts::value<double>(persistence_threshold)->default_value("0"))
     ("async", "Asynchronous I/O", 
      cxxopts::value<bool>(async))
+    ("async-prefetch", "Number of timesteps prefetched in asynchronous I/O", 
+     cxxopts::value<int>(async_prefetch)->default_value("2"))
+    ("async-readers", "Number of reader threads in asynchronous I/O", 
+     cxxopts::value<int>(async_readers)->default_value("1"))
     ("v,verbose", "Verbose outputs", cxxopts::value<bool>(verbose))
     ("help", "Print usage", cxxopts::value<bool>(help));
   auto results = options.parse(argc, argv);
@@ -982,6 +1055,9 @@ int parse_arguments(int argc, char **argv, diy::mpi::communicator comm)
   if (set_valid_accelerator.find(accelerator) == set_valid_accelerator.end())
     fatal(options, "invalid '--accelerator'");
 
+  if (set_valid_precision.find(precision) == set_valid_precision.end())
+    fatal(options, "invalid '--precision'");
+
   if (output_pattern.empty())
     fatal(options, "Missing '--output'.");
 
@@ -7,7 +7,10 @@
 #include <ftk/geometry/write_polydata.hh>
 #include <ftk/geometry/points2vtk.hh>
 #include <ftk/ndarray/writer.hh>
+#include <ftk/filters/xgc_poincare_tracer.hh>
+#if FTK_HAVE_CUDA
 #include <ftk/filters/xgc_blob_filament_tracker.cuh>
+#endif
 #include <ftk/external/cxxopts.hpp>
 #include <mutex>
 #include <limits>
@@ -140,6 +143,7 @@ void write_results(
     const int nrakes, 
     const int nrevs)
 {
+#if FTK_HAVE_VTK
   vtkSmartPointer<vtkPolyData> poly = vtkPolyData::New();
   vtkSmartPointer<vtkPoints> points = vtkPoints::New();
   vtkSmartPointer<vtkCellArray> verts = vtkCellArray::New();
@@ -216,6 +220,33 @@ void write_results(
   poly->GetPointData()->AddArray(rev);
 
   write_polydata(filename, poly);
+#else
+  // w/o vtk, the same point data are written as text, one line per point
+  FILE *fp = fopen(filename.c_str(), "w");
+  if (!fp) fatal(FTK_ERR_FILE_CANNOT_OPEN);
+  fprintf(fp, "# rev id r z psin psin0 delta_psin offset_psin0\n");
+
+  for (int i = 0; i < nrevs; i ++) {
+    for (int j = 0; j < nrakes; j ++) {
+      for (int k = 0; k < nseeds_per_rake; k ++) {
+        const int idx = i * nrakes * nseeds_per_rake + j * nseeds_per_rake + k;
+        const int idx0 = j* nseeds_per_rake + k;
+        const int idx_last = i == 0 ? idx0 : 
+          ((i-1) * nrakes * nseeds_per_rake + j * nseeds_per_rake + k);
+        
+        if (results[idx*2] > 1e37) 
+          fprintf(fp, "%d %d nan nan nan nan nan nan\n", i, idx0);
+        else
+          fprintf(fp, "%d %d %.17g %.17g %.17g %.17g %.17g %.17g\n", i, idx0, 
+              results[idx*2], results[idx*2+1], 
+              poincare_psin[idx], poincare_psin[idx0], 
+              poincare_psin[idx_last] - poincare_psin[idx], 
+              poincare_psin[idx] - poincare_psin[idx0]);
+      }
+    }
+  }
+  fclose(fp);
+#endif
 }
 
 int main(int argc, char **argv)
@@ -229,12 +260,18 @@ int main(int argc, char **argv)
   bool trace_static = false;
   bool trace_reverse = false;
   bool xpoint = false;
+  bool use_cpu = false;
+  int nthreads = std::thread::hardware_concurrency();
+  std::string thread_backend;
 
   cxxopts::Options options(argv[0]);
   options.add_options()
     ("p,path", "XGC data path; will automatically read mesh, bfield, and units.m files", cxxopts::value<std::string>(path))
     ("i,input", "input", cxxopts::value<std::string>(input))
     ("d,device", "device id", cxxopts::value<int>(device)->default_value("0"))
+    ("cpu", "use the multithreaded cpu engine instead of cuda", cxxopts::value<bool>(use_cpu))
+    ("nthreads", "number of threads for the cpu engine", cxxopts::value<int>(nthreads))
+    ("thread-backend", "thread backend for the cpu engine {pthread|pool|openmp|tbb}", cxxopts::value<std::string>(thread_backend)->default_value("pthread"))
     ("static", "trace with static magnetic field", cxxopts::value<bool>(trace_static))
     ("reverse", "trace in reverse direction", cxxopts::value<bool>(trace_reverse))
     ("psin0", "psin0", cxxopts::value<double>(psin0)->default_value("0.8"))
@@ -295,6 +332,41 @@ int main(int argc, char **argv)
   const int n0 = mx2->n(0); // apars.dim(0);
   const int nphi = mx3->get_nphi(), iphi = mx3->get_iphi();
 
+#if !FTK_HAVE_CUDA
+  use_cpu = true;
+#endif
+
+  if (use_cpu) {
+    xgc_poincare_tracer tracer(MPI_COMM_WORLD, mx3);
+    tracer.set_number_of_threads(nthreads);
+    tracer.use_thread_backend(thread_backend);
+    tracer.set_seeds(seeds);
+    tracer.set_number_of_revolutions(nrevs);
+    tracer.set_use_static_b(trace_static);
+    tracer.set_direction(trace_reverse ? -1 : 1);
+
+    if (!trace_static) {
+      mx3->initialize_interpolants_cached();
+
+      ftk::ndarray<double> apars;
+      apars.read_bp(input, "apars");
+      tracer.load_apars(apars);
+
+      if (apars_filenames.size() > 0) {
+        write_apars(mx2, nphi * vphi, apars_filenames, tracer.get_apars_upsample().data());
+        return 0;
+      }
+    }
+
+    tracer.update();
+
+    fprintf(stderr, "writing...\n");
+    write_results(output, tracer.get_plot().data(), tracer.get_psin().data(), 
+        nseeds_per_rake, nrakes, nrevs);
+    return 0;
+  }
+
+#if FTK_HAVE_CUDA
   xft_ctx_t *ctx;
   xft_create_poincare_ctx(&ctx, nseeds, nrevs, device);
   
@@ -310,7 +382,7 @@ int main(int argc, char **argv)
 
   xft_load_psin(ctx, mx2->get_psinfield().data());
 
-  const auto bvh = std::static_pointer_cast<point_locator_2d_quad<>>(mx2->get_locator())->to_bvh();
+  const auto bvh = point_locator_2d_quad<>(*mx2).to_bvh(); // the device code walks a quadtree
   xft_load_bvh(ctx, bvh);
 
   if (!trace_static) {
@@ -382,6 +454,7 @@ int main(int argc, char **argv)
   
   fprintf(stderr, "exiting...\n");
   xft_destroy_ctx(&ctx);
+#endif
 
   return 0;
 }
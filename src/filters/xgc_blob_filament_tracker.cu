@@ -1435,20 +1435,18 @@ void xft_derive_interpolants(ctx_t *c)
   checkLastCudaError("[FTK-CUDA] deriving interpolants");
 }
 
-void xft_load_interpolants(ctx_t *c, const std::vector<std::vector<ftk::xgc_interpolant_t<>>> &interpolants)
+void xft_load_interpolants(ctx_t *c, const ftk::xgc_interpolant_t<> *interpolants)
 {
-  fprintf(stderr, "loading interpolants, %zu, %zu\n", c->vphi, interpolants.size());
-  assert(c->vphi == interpolants.size());
+  fprintf(stderr, "loading interpolants, %zu\n", c->vphi);
 
   cudaMalloc((void**)&c->d_interpolants, 
       size_t(c->m2n0) * sizeof(ftk::xgc_interpolant_t<>) * c->vphi);
   checkLastCudaError("[FTK-CUDA] loading xgc interpolants, malloc 0");
 
-  for (size_t i = 1; i < interpolants.size(); i ++) {
-    cudaMemcpy(c->d_interpolants + (i-1) * size_t(c->m2n0), // * sizeof(ftk::xgc_interpolant_t<>), 
-        interpolants[i].data(), size_t(c->m2n0) * sizeof(ftk::xgc_interpolant_t<>), cudaMemcpyHostToDevice);
-    checkLastCudaError("[FTK-CUDA] loading xgc interpolants, memcpy");
-  }
+  // interpolants of virtual planes 1..vphi-1 are contiguous on the host
+  cudaMemcpy(c->d_interpolants, interpolants, 
+      size_t(c->m2n0) * sizeof(ftk::xgc_interpolant_t<>) * (c->vphi - 1), cudaMemcpyHostToDevice);
+  checkLastCudaError("[FTK-CUDA] loading xgc interpolants, memcpy");
   
   checkLastCudaError("[FTK-CUDA] loading xgc interpolants");
   
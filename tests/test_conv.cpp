@@ -90,3 +90,71 @@ TEST_CASE("3D_conv_gaussian_test") {
   r.to_vector(res);
   REQUIRE(res == ans);
 }
+
+TEST_CASE("2D_conv_gaussian_separable_test") {
+  const size_t W = 23, H = 17, ksize = 5, r = ksize/2;
+  ftk::ndarray<double> d({W, H});
+  for (size_t i = 0; i < d.nelem(); i ++)
+    d[i] = std::sin(0.37*i) + 0.01*i;
+
+  const auto r0 = ftk::conv2D_gaussian(d, 1.5, ksize, ksize, r),
+             r1 = ftk::conv_gaussian_separable(d, 1.5, ksize, ftk::FTK_CONV_DIRECT),
+             r2 = ftk::conv_gaussian_separable(d, 1.5, ksize, ftk::FTK_CONV_FFT);
+  REQUIRE(r1.shape() == d.shape());
+
+  for (size_t y = 0; y < H; y ++)
+    for (size_t x = 0; x < W; x ++) {
+      REQUIRE(r2(x, y) == Approx(r1(x, y)).margin(epsilon));
+      if (x >= r && x < W-r && y >= r && y < H-r) // conv2D zero-pads and divides by the kernel size
+        REQUIRE(r0(x, y) * ksize * ksize == Approx(r1(x, y)).margin(epsilon));
+    }
+}
+
+TEST_CASE("3D_conv_gaussian_separable_test") {
+  ftk::ndarray<double> d({9, 8, 7});
+  for (size_t i = 0; i < d.nelem(); i ++)
+    d[i] = std::cos(0.11*i*i);
+
+  const auto r1 = ftk::conv_gaussian_separable(d, 2.0, 7, ftk::FTK_CONV_DIRECT),
+             r2 = ftk::conv_gaussian_separable(d, 2.0, 7, ftk::FTK_CONV_FFT);
+  for (size_t i = 0; i < d.nelem(); i ++)
+    REQUIRE(r2[i] == Approx(r1[i]).margin(epsilon));
+
+  // constant fields are preserved at the boundaries
+  ftk::ndarray<double> c({9, 8, 7}, 3.0);
+  const auto rc = ftk::conv_gaussian_separable(c, 2.0, 7);
+  for (size_t i = 0; i < c.nelem(); i ++)
+    REQUIRE(rc[i] == Approx(3.0).margin(epsilon));
+}
+
+TEST_CASE("3D_conv_gaussian_gradient_jacobian_test") {
+  const int W = 12, H = 11, D = 10, ksize = 5, r = ksize/2;
+  const auto f = [](double x, double y, double z) {
+    return 0.3*x*x - 0.2*x*y + 0.5*y*z + 0.1*z*z + x - 2*y + 0.7*z;
+  };
+
+  ftk::ndarray<double> d({size_t(W), size_t(H), size_t(D)});
+  for (int z = 0; z < D; z ++)
+    for (int y = 0; y < H; y ++)
+      for (int x = 0; x < W; x ++)
+        d(x, y, z) = f(x, y, z);
+
+  ftk::ndarray<double> scalar, grad, J;
+  ftk::conv_gaussian_gradient_jacobian(d, 1.0, ksize, scalar, grad, J);
+  const auto smoothed = ftk::conv_gaussian_separable(d, 1.0, ksize);
+
+  const double H0[3][3] = {{0.6, -0.2, 0}, {-0.2, 0, 0.5}, {0, 0.5, 0.2}};
+  for (int z = r; z < D-r; z ++)
+    for (int y = r; y < H-r; y ++)
+      for (int x = r; x < W-r; x ++) {
+        REQUIRE(scalar(x, y, z) == Approx(smoothed(x, y, z)).margin(epsilon));
+
+        // the derivative kernels are exact for quadratic fields
+        const double g[3] = {0.6*x - 0.2*y + 1, -0.2*x + 0.5*z - 2, 0.5*y + 0.2*z + 0.7};
+        for (int i = 0; i < 3; i ++) {
+          REQUIRE(grad(i, x, y, z) == Approx(g[i]).margin(1e-6));
+          for (int j = 0; j < 3; j ++)
+            REQUIRE(J(i, j, x, y, z) == Approx(H0[i][j]).margin(1e-6));
+        }
+      }
+}
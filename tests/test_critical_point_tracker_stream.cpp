@@ -0,0 +1,145 @@
+#define CATCH_CONFIG_RUNNER
+#include "catch.hh"
+#include <ftk/ndarray/synthetic.hh>
+#include "critical_point_tracker_stream.hh"
+#include "main.hh"
+
+// the streaming trackers of pyftk, w/o the numpy frontend
+
+static size_t count_trajectories(const std::vector<ftk::feature_point_t>& pts)
+{
+  std::set<unsigned long long> ids;
+  for (const auto &p : pts)
+    ids.insert(p.id);
+  return ids.size();
+}
+
+template <typename T>
+static size_t track_woven_streaming(int DW, int DH, int DT)
+{
+  diy::mpi::communicator world;
+  const ftk::ndarray<T> data = ftk::synthetic_woven_2Dt<T>(DW, DH, DT); // each timestep is a contiguous block
+
+  auto tracker = critical_point_tracker_stream::new_regular(world, {size_t(DW), size_t(DH)}, "scalar");
+  for (int t = 0; t < DT; t ++)
+    tracker->push_scalar(data.data() + t * DW * DH, DW * DH);
+  tracker->finish();
+  REQUIRE(tracker->get_num_timesteps() == DT);
+
+  return count_trajectories(tracker->get_traced_critical_points());
+}
+
+TEST_CASE("critical_point_tracker_stream_woven") {
+  // same as test_streaming_critical_point_tracking_spiral_woven in the python tests
+  REQUIRE(track_woven_streaming<double>(10, 10, 20) == 30);
+  REQUIRE(track_woven_streaming<float>(10, 10, 20) == 30);
+}
+
+TEST_CASE("critical_point_tracker_stream_errors") {
+  diy::mpi::communicator world;
+  REQUIRE_THROWS(critical_point_tracker_stream::new_regular(world, {10, 10}, "tensor"));
+  REQUIRE_THROWS(critical_point_tracker_stream::new_regular(world, {10, 4}, "scalar"));
+  REQUIRE_THROWS(critical_point_tracker_stream::new_regular(world, {10, 10, 10, 10}, "vector"));
+
+  auto tracker = critical_point_tracker_stream::new_regular(world, {10, 10}, "scalar");
+  std::vector<double> data(99);
+  REQUIRE_THROWS(tracker->push_scalar(data.data(), data.size()));
+
+  data.resize(100);
+  tracker->push_scalar(data.data(), data.size());
+  tracker->finish();
+  REQUIRE_THROWS(tracker->push_scalar(data.data(), data.size()));
+}
+
+TEST_CASE("critical_point_tracker_stream_double_gyre_2d_unstructured") {
+  diy::mpi::communicator world;
+  const int nx = 41, ny = 21, nt = 16;
+
+  // the double gyre on a triangulated [0, 2] x [0, 1] grid
+  ftk::ndarray<double> coords;
+  coords.reshape(2, nx*ny);
+  for (int j = 0; j < ny; j ++)
+    for (int i = 0; i < nx; i ++) {
+      coords(0, i + j*nx) = 2.0 * i / (nx - 1);
+      coords(1, i + j*nx) = 1.0 * j / (ny - 1);
+    }
+
+  ftk::ndarray<int> triangles;
+  triangles.reshape(3, 2*(nx-1)*(ny-1));
+  int k = 0;
+  for (int j = 0; j < ny-1; j ++)
+    for (int i = 0; i < nx-1; i ++) {
+      const int v = i + j*nx;
+      triangles(0, k) = v; triangles(1, k) = v+1; triangles(2, k) = v+nx+1; k ++;
+      triangles(0, k) = v; triangles(1, k) = v+nx+1; triangles(2, k) = v+nx; k ++;
+    }
+
+  ftk::ndarray<double> coords3;
+  coords3.reshape(3, nx*ny);
+  REQUIRE_THROWS(critical_point_tracker_stream::new_2d_unstructured(world, coords3, triangles));
+
+  auto tracker = critical_point_tracker_stream::new_2d_unstructured(world, coords, triangles);
+  for (int t = 0; t < nt; t ++) {
+    const auto v = ftk::synthetic_double_gyre_unstructured<double>(coords, static_cast<double>(t));
+    tracker->push_vector(v.data(), v.nelem());
+  }
+  tracker->finish();
+
+  const auto pts = tracker->get_traced_critical_points();
+  if (world.rank() == 0) {
+    REQUIRE(count_trajectories(pts) > 0);
+    for (const auto &p : pts) {
+      REQUIRE(p.t >= 0.0);
+      REQUIRE(p.t <= nt - 1);
+    }
+  }
+}
+
+TEST_CASE("critical_point_tracker_stream_moving_extremum_3d_unstructured") {
+  diy::mpi::communicator world;
+  const int n = 9, nt = 4;
+
+  // [-1, 1]^3 split into cubes of six tetrahedra each
+  std::vector<double> coords;
+  for (int k = 0; k < n; k ++)
+    for (int j = 0; j < n; j ++)
+      for (int i = 0; i < n; i ++) {
+        coords.push_back(-1.0 + 2.0 * i / (n - 1));
+        coords.push_back(-1.0 + 2.0 * j / (n - 1));
+        coords.push_back(-1.0 + 2.0 * k / (n - 1));
+      }
+
+  std::vector<int> tets;
+  auto id = [&](int i, int j, int k) { return i + n * (j + n * k); };
+  for (int k = 0; k < n-1; k ++)
+    for (int j = 0; j < n-1; j ++)
+      for (int i = 0; i < n-1; i ++) {
+        const int v0 = id(i, j, k), v7 = id(i+1, j+1, k+1);
+        const int path[7] = {id(i+1, j, k), id(i+1, j+1, k), id(i, j+1, k),
+          id(i, j+1, k+1), id(i, j, k+1), id(i+1, j, k+1), id(i+1, j, k)};
+        for (int l = 0; l < 6; l ++)
+          for (const int v : {v0, path[l], path[l+1], v7})
+            tets.push_back(v);
+      }
+
+  ftk::ndarray<double> c;
+  c.reshape(3, n*n*n); c.from_vector(coords);
+  ftk::ndarray<int> tt;
+  tt.reshape(4, tets.size() / 4); tt.from_vector(tets);
+
+  auto tracker = critical_point_tracker_stream::new_3d_unstructured(world, c, tt);
+  for (int i = 0; i < nt; i ++) {
+    const auto grad = ftk::synthetic_moving_extremum_grad_unstructured<double, 3>(
+        c, {0.0, 0.0, 0.0}, {0.1, 0.1, 0.1}, static_cast<double>(i));
+    tracker->push_vector(grad.data(), grad.nelem());
+  }
+  tracker->finish();
+
+  const auto pts = tracker->get_traced_critical_points();
+  if (world.rank() == 0) {
+    REQUIRE(count_trajectories(pts) == 1);
+    for (const auto &p : pts) // the extremum moves from the origin along (0.1, 0.1, 0.1)
+      for (int d = 0; d < 3; d ++)
+        REQUIRE(p.x[d] == Approx(0.1 * p.t).margin(0.05));
+  }
+}
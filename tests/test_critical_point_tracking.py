@@ -12,5 +12,15 @@ class MainTest(unittest.TestCase):
         result = pyftk.trackers.track_critical_points_2d_scalar(data)
         self.assertEqual(len(result), 30)
 
+    def test_streaming_critical_point_tracking_spiral_woven(self):
+        data = pyftk.synthesizers.spiral_woven(10, 10, 20)
+        steps = data.reshape(20, 10, 10) # each timestep is a contiguous block
+        tracker = pyftk.trackers.critical_point_tracker_2d_regular(10, 10)
+        for t in range(20):
+            tracker.push_scalar_field(steps[t])
+        tracker.finish()
+        traced = tracker.get_traced_critical_points()
+        self.assertEqual(len(set(traced['id'])), 30)
+
 if __name__ == '__main__':
     unittest.main()
@@ -0,0 +1,119 @@
+#define CATCH_CONFIG_RUNNER
+#include "catch.hh"
+#include "constants.hh"
+#include <ftk/filters/critical_point_tracker_2d_unstructured.hh>
+
+using nlohmann::json;
+
+// lengths and loop flags of the traced curves, sorted; available on the root
+static std::vector<std::pair<size_t, bool>> curve_signature(const ftk::feature_curve_set_t& trajs)
+{
+  std::vector<std::pair<size_t, bool>> signature;
+  for (const auto &kv : trajs)
+    signature.push_back(std::make_pair(kv.second.size(), kv.second.loop));
+  std::sort(signature.begin(), signature.end());
+  return signature;
+}
+
+static std::vector<std::pair<size_t, bool>> track_cp_regular(const json jstream, const json jconfig = json())
+{
+  ftk::ndarray_stream<> stream;
+  stream.configure(jstream);
+
+  ftk::json_interface consumer;
+  consumer.configure(jconfig);
+  consumer.consume(stream);
+  consumer.post_process();
+
+  auto tracker = std::dynamic_pointer_cast<ftk::critical_point_tracker>( consumer.get_tracker() );
+  return curve_signature(tracker->get_traced_critical_points());
+}
+
+// the double gyre on a triangulated [0, 2] x [0, 1] grid
+static std::vector<std::pair<size_t, bool>> track_cp_double_gyre_unstructured(bool distributed)
+{
+  diy::mpi::communicator world;
+  const int nx = 41, ny = 21, nt = 16;
+
+  ftk::ndarray<double> coords;
+  coords.reshape(2, nx*ny);
+  for (int j = 0; j < ny; j ++)
+    for (int i = 0; i < nx; i ++) {
+      coords(0, i + j*nx) = 2.0 * i / (nx - 1);
+      coords(1, i + j*nx) = 1.0 * j / (ny - 1);
+    }
+
+  ftk::ndarray<int> triangles;
+  triangles.reshape(3, 2*(nx-1)*(ny-1));
+  int k = 0;
+  for (int j = 0; j < ny-1; j ++)
+    for (int i = 0; i < nx-1; i ++) {
+      const int v = i + j*nx;
+      triangles(0, k) = v; triangles(1, k) = v+1; triangles(2, k) = v+nx+1; k ++;
+      triangles(0, k) = v; triangles(1, k) = v+nx+1; triangles(2, k) = v+nx; k ++;
+    }
+
+  std::shared_ptr<ftk::simplicial_unstructured_2d_mesh<>> m(
+      new ftk::simplicial_unstructured_2d_mesh<>(coords, triangles));
+  std::shared_ptr<ftk::simplicial_unstructured_extruded_2d_mesh<>> m3(
+      new ftk::simplicial_unstructured_extruded_2d_mesh_implicit<>(m));
+
+  ftk::critical_point_tracker_2d_unstructured tracker(world, m3);
+  tracker.set_enable_distributed_tracing(distributed);
+  tracker.initialize();
+
+  for (int i = 0; i < nt; i ++) {
+    auto data = ftk::synthetic_double_gyre_unstructured<double>(
+        m->get_coords(), static_cast<double>(i));
+    tracker.push_field_data_snapshot(
+        ftk::ndarray<double>(), data, ftk::ndarray<double>());
+
+    if (i != 0) tracker.advance_timestep();
+    else tracker.update_timestep();
+  }
+
+  tracker.finalize();
+  if (distributed)
+    tracker.gather_traced_critical_points();
+
+  return curve_signature(tracker.get_traced_critical_points());
+}
+
+// distributed tracing stitches curves across ranks; the results must be the 
+// same as tracing the gathered critical points on the root.  The reference 
+// runs with the same decomposition, as detection depends on it slightly
+TEST_CASE("critical_point_tracking_distributed_woven") {
+  diy::mpi::communicator world;
+  auto result0 = track_cp_regular(js_woven_synthetic);
+  auto result = track_cp_regular(js_woven_synthetic, {
+    {"enable_distributed_tracing", true}
+  });
+  if (world.rank() == 0) {
+    REQUIRE(result0.size() == 56);
+    REQUIRE(result == result0);
+  }
+}
+
+TEST_CASE("critical_point_tracking_distributed_merger_2d") {
+  diy::mpi::communicator world;
+  auto result0 = track_cp_regular(js_merger_2d_synthetic);
+  auto result = track_cp_regular(js_merger_2d_synthetic, {
+    {"enable_distributed_tracing", true}
+  });
+  if (world.rank() == 0) {
+    REQUIRE(result0.size() > 0);
+    REQUIRE(result == result0);
+  }
+}
+
+TEST_CASE("critical_point_tracking_distributed_double_gyre_unstructured") {
+  diy::mpi::communicator world;
+  auto result0 = track_cp_double_gyre_unstructured(false);
+  auto result = track_cp_double_gyre_unstructured(true);
+  if (world.rank() == 0) {
+    REQUIRE(result0.size() > 0);
+    REQUIRE(result == result0);
+  }
+}
+
+#include "main.hh"
@@ -89,4 +89,40 @@ TEST_CASE("critical_point_tracking_moving_extremum_3d_random_motion") {
   }
 }
 
+TEST_CASE("critical_point_tracking_moving_extremum_3d_lazy_derivatives") {
+  json js = js_moving_extremum_3d_synthetic;
+  js["dimensions"] = {16, 16, 16};
+  js["x0"] = {7.3, 7.6, 7.1};
+  js["dir"] = {0.3, -0.2, 0.1};
+  js["n_timesteps"] = 4;
+
+  auto track = [&](const json& jc) {
+    ftk::ndarray_stream<> stream;
+    stream.configure(js);
+
+    ftk::json_interface consumer;
+    consumer.configure(jc);
+    consumer.consume(stream);
+    consumer.post_process();
+
+    auto tracker = std::dynamic_pointer_cast<ftk::critical_point_tracker_3d_regular>( consumer.get_tracker() );
+    return tracker->get_critical_points();
+  };
+
+  diy::mpi::communicator comm;
+  const auto points0 = track(json());
+  const auto points1 = track({{"enable_lazy_derivatives", true}, {"enable_derivative_cache", true}});
+
+  if (comm.rank() == 0) {
+    REQUIRE(points0.size() > 0);
+    REQUIRE(points1.size() == points0.size());
+    for (size_t i = 0; i < points0.size(); i ++) {
+      REQUIRE(points1[i].tag == points0[i].tag);
+      REQUIRE(points1[i].type == points0[i].type);
+      for (int k = 0; k < 3; k ++)
+        REQUIRE(points1[i].x[k] == points0[i].x[k]);
+    }
+  }
+}
+
 #include "main.hh"
@@ -80,4 +80,71 @@ TEST_CASE("critical_point_tracking_moving_extremum_3d_unstructured") {
 }
 #endif
 
+TEST_CASE("critical_point_tracking_moving_extremum_3d_unstructured_scalar") {
+  diy::mpi::communicator world;
+
+  // a regular grid with six tetrahedra per cube
+  const int n = 9;
+  const double h = 2.0 / (n - 1);
+  std::vector<double> coords;
+  for (int k = 0; k < n; k ++)
+    for (int j = 0; j < n; j ++)
+      for (int i = 0; i < n; i ++) {
+        coords.push_back(-1.0 + i*h);
+        coords.push_back(-1.0 + j*h);
+        coords.push_back(-1.0 + k*h);
+      }
+
+  std::vector<int> tets;
+  const int perms[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+  for (int k = 0; k < n-1; k ++)
+    for (int j = 0; j < n-1; j ++)
+      for (int i = 0; i < n-1; i ++)
+        for (int p = 0; p < 6; p ++) {
+          int x[3] = {i, j, k};
+          tets.push_back(x[0] + x[1]*n + x[2]*n*n);
+          for (int q = 0; q < 3; q ++) {
+            x[perms[p][q]] ++;
+            tets.push_back(x[0] + x[1]*n + x[2]*n*n);
+          }
+        }
+
+  std::shared_ptr<ftk::simplicial_unstructured_3d_mesh<>> m(
+      new ftk::simplicial_unstructured_3d_mesh<>(coords, tets));
+
+  auto track = [&](bool lock_free) {
+    ftk::critical_point_tracker_3d_unstructured tracker(world, m);
+    tracker.set_enable_lock_free_detection(lock_free);
+    tracker.initialize();
+
+    const int nt = 6;
+    for (int t = 0; t < nt; t ++) {
+      const double c[3] = {-0.33 + 0.1*t, 0.07 + 0.05*t, 0.11};
+      ftk::ndarray<double> scalar;
+      scalar.reshape(m->n(0));
+      for (size_t i = 0; i < m->n(0); i ++) {
+        double d2 = 0;
+        for (int k = 0; k < 3; k ++)
+          d2 += (coords[i*3+k] - c[k]) * (coords[i*3+k] - c[k]);
+        scalar[i] = -d2;
+      }
+
+      tracker.push_scalar_field_snapshot(scalar);
+      if (t != 0) tracker.advance_timestep();
+      if (t == nt-1) tracker.update_timestep();
+    }
+    tracker.finalize();
+    return tracker.get_traced_critical_points();
+  };
+
+  auto trajs = track(true), trajs1 = track(false);
+  if (world.rank() == 0) {
+    REQUIRE(trajs.size() == 1);
+    REQUIRE(trajs1.size() == 1);
+    REQUIRE(trajs.begin()->second.size() == trajs1.begin()->second.size());
+    for (const auto &p : trajs.begin()->second)
+      REQUIRE(p.type == ftk::CRITICAL_POINT_3D_MAXIMUM);
+  }
+}
+
 #include "main.hh"
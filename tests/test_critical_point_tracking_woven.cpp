@@ -36,6 +36,156 @@ TEST_CASE("critical_point_tracking_woven_synthetic") {
     REQUIRE(std::get<0>(result) == woven_n_trajs);
 }
 
+TEST_CASE("critical_point_tracking_woven_lock_free_detection") {
+  auto result = track_cp2d(js_woven_synthetic, {
+    {"enable_lock_free_detection", true}
+  });
+  diy::mpi::communicator world;
+  if (world.rank() == 0)
+    REQUIRE(std::get<0>(result) == woven_n_trajs);
+}
+
+TEST_CASE("critical_point_tracking_woven_distributed_tracing") {
+  auto result = track_cp2d(js_woven_synthetic, {
+    {"enable_distributed_tracing", true}
+  });
+  diy::mpi::communicator world;
+  if (world.rank() == 0)
+    REQUIRE(std::get<0>(result) == woven_n_trajs);
+}
+
+TEST_CASE("critical_point_tracking_woven_lazy_derivatives") {
+  auto result0 = track_cp2d(js_woven_synthetic);
+  auto result = track_cp2d(js_woven_synthetic, {
+    {"enable_lazy_derivatives", true}
+  });
+  auto result1 = track_cp2d(js_woven_synthetic, {
+    {"enable_lazy_derivatives", true}, 
+    {"enable_derivative_cache", true},
+    {"thread_backend", "pool"}, 
+    {"nthreads", 4}
+  });
+  diy::mpi::communicator world;
+  if (world.rank() == 0) {
+    REQUIRE(std::get<0>(result) == woven_n_trajs);
+    REQUIRE(result == result0);
+    REQUIRE(result1 == result0);
+  }
+}
+
+TEST_CASE("critical_point_tracking_woven_single_precision") {
+  auto result = track_cp2d(js_woven_synthetic, {
+    {"precision", "float32"}
+  });
+  auto result1 = track_cp2d(js_woven_synthetic, {
+    {"precision", "float32"},
+    {"enable_lazy_derivatives", true}
+  });
+  diy::mpi::communicator world;
+  if (world.rank() == 0) {
+    REQUIRE(std::get<0>(result) == woven_n_trajs);
+    REQUIRE(result1 == result);
+  }
+}
+
+TEST_CASE("critical_point_tracking_woven_thread_pool") {
+  auto result = track_cp2d(js_woven_synthetic, {
+    {"thread_backend", "pool"}, 
+    {"nthreads", 4}
+  });
+  diy::mpi::communicator world;
+  if (world.rank() == 0)
+    REQUIRE(std::get<0>(result) == woven_n_trajs);
+}
+
+TEST_CASE("critical_point_tracking_woven_async_prefetch") {
+  json js = js_woven_synthetic;
+  js["async"] = true;
+  js["async_prefetch"] = 3;
+  js["async_readers"] = 2;
+
+  auto result = track_cp2d(js);
+  diy::mpi::communicator world;
+  if (world.rank() == 0)
+    REQUIRE(std::get<0>(result) == woven_n_trajs);
+}
+
+TEST_CASE("critical_point_tracking_woven_archived_traced_binary") {
+  const std::string filename = "woven_archived_traced.bin";
+  std::remove(filename.c_str());
+
+  auto result = track_cp2d(js_woven_synthetic, { // tracks and writes the archive
+    {"archived_traced_critical_points_filename", filename}
+  });
+  auto result1 = track_cp2d(js_woven_synthetic, { // reads the archive
+    {"archived_traced_critical_points_filename", filename}
+  });
+
+  diy::mpi::communicator world;
+  if (world.rank() == 0) {
+    REQUIRE(std::get<0>(result) == woven_n_trajs);
+    REQUIRE(std::get<0>(result1) == woven_n_trajs);
+    REQUIRE(ftk::feature_curve_set_t::read_binary_ncurves(filename) == woven_n_trajs);
+
+    ftk::feature_curve_set_t all, window;
+    all.read_binary(filename);
+    window.read_binary(filename, 2, 3);
+    REQUIRE(window.size() > 0);
+    REQUIRE(window.size() <= all.size());
+    for (const auto &kv : window)
+      for (const auto &p : kv.second)
+        REQUIRE((p.t >= 2 && p.t <= 3));
+
+    const auto curve = ftk::feature_curve_set_t::read_binary_curve(filename, 0);
+    REQUIRE(curve.size() == all.begin()->second.size());
+    REQUIRE(curve.id == all.begin()->first);
+  }
+
+  world.barrier();
+  if (world.rank() == 0)
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("critical_point_tracking_woven_pruning") {
+  auto track = [](const std::string& ops, bool streaming) {
+    ftk::ndarray_stream<> stream;
+    stream.configure(js_woven_synthetic);
+
+    ftk::json_interface consumer;
+    consumer.configure({
+      {"post_processing_options", ops},
+      {"enable_streaming_trajectories", streaming}
+    });
+    consumer.consume(stream);
+    return consumer.get_tracker()->get_traced_critical_points();
+  };
+
+  const double duration = 2.0, extent = 1.0, persistence = 0.05;
+  const std::string ops = "smooth_types,rotate,split,reorder,adjust_time";
+  const std::string pruning = ",duration_pruning:2,extent_pruning:1,persistence_pruning:0.05:0";
+
+  diy::mpi::communicator world;
+  for (int streaming = 0; streaming < 2; streaming ++) {
+    const auto all = track(ops, streaming), pruned = track(ops + pruning, streaming);
+    if (world.rank() == 0) {
+      REQUIRE(pruned.size() > 0);
+      REQUIRE(pruned.size() < all.size());
+      for (const auto &kv : pruned) {
+        const auto &c = kv.second;
+        double d2 = 0;
+        for (int k = 0; k < 3; k ++)
+          d2 += (c.bbmax[k] - c.bbmin[k]) * (c.bbmax[k] - c.bbmin[k]);
+        REQUIRE(c.consistent_type != 0);
+        REQUIRE(c.tmax - c.tmin >= duration);
+        REQUIRE(std::sqrt(d2) >= extent);
+        REQUIRE(c.persistence[0] >= persistence);
+        if (streaming) REQUIRE(c.complete);
+      }
+      REQUIRE(track(ops + ",duration_pruning:1e9", streaming).size() == 0);
+    }
+  }
+}
+
 TEST_CASE("critical_point_tracking_woven_float64") {
   auto result = track_cp2d(js_woven_float64);
   diy::mpi::communicator world;
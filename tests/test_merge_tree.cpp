@@ -0,0 +1,200 @@
+#define CATCH_CONFIG_RUNNER
+#include "catch.hh"
+#include <ftk/algorithms/merge_tree.hh>
+#include <ftk/algorithms/sweep_and_merge.h>
+#include <ftk/filters/critical_point_tracker_2d_regular.hh>
+#include <ftk/filters/critical_point_tracker_2d_unstructured.hh>
+#include <ftk/mesh/simplicial_unstructured_extruded_2d_mesh_implicit.hh>
+#include <random>
+
+// elder-rule persistence pairs with a serial union-find sweep over all vertices
+static std::set<std::pair<int, int>> reference_persistence_pairs(
+    const ftk::csr_adjacency<int>& adj, const std::vector<double>& f, bool join)
+{
+  const int n = adj.size();
+  const auto rank = ftk::rank_vertices<int, double>(n, f.data());
+  auto up = [&](int i) { return join ? rank[i] : n - 1 - rank[i]; };
+
+  std::vector<int> order(n);
+  for (int i = 0; i < n; i ++)
+    order[n - 1 - up(i)] = i;
+
+  std::vector<int> parent(n, -1), top(n);
+  auto find = [&](int x) { while (parent[x] != x) x = parent[x]; return x; };
+
+  std::set<std::pair<int, int>> pairs;
+  for (const auto v : order) {
+    parent[v] = top[v] = v;
+    for (const int *p = adj.begin(v); p != adj.end(v); p ++) {
+      if (parent[*p] < 0) continue;
+      const int rv = find(v), rw = find(*p);
+      if (rv == rw) continue;
+      const int elder = up(top[rv]) > up(top[rw]) ? rv : rw, younger = elder == rv ? rw : rv;
+      if (top[younger] != v) pairs.insert(std::make_pair(top[younger], v));
+      parent[younger] = elder;
+    }
+  }
+  return pairs;
+}
+
+TEST_CASE("contour_tree_path") {
+  const std::vector<double> f = {0, 3, 1, 4, 2, 5};
+  auto ct = ftk::build_contour_tree<int, double>(6, f, [](int i) {
+    std::set<int> neighbors;
+    if (i > 0) neighbors.insert(i-1);
+    if (i < 5) neighbors.insert(i+1);
+    return neighbors;
+  });
+
+  REQUIRE(ct.size() == 6);
+  REQUIRE(ct.upper_nodes(0) == std::set<int>({1}));
+  REQUIRE(ct.upper_nodes(2) == std::set<int>({1, 3}));
+  REQUIRE(ct.upper_nodes(4) == std::set<int>({3, 5}));
+  REQUIRE(ct.upper_degree(5) == 0);
+}
+
+TEST_CASE("merge_tree_persistence_pairs_2d") {
+  ftk::simplicial_regular_mesh m(2);
+  m.set_lb_ub({0, 0}, {23, 17});
+  const auto adj = ftk::regular_mesh_vertex_adjacency(m, 4);
+  REQUIRE(adj.size() == 24 * 18);
+
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> d(0, 1);
+
+  for (int k = 0; k < 10; k ++) {
+    std::vector<double> f(adj.size());
+    for (auto &x : f) // with plenty of ties in the even cases
+      x = k % 2 ? d(gen) : std::round(d(gen) * 4);
+
+    const auto rank = ftk::rank_vertices<int, double>(f.size(), f.data(), 4);
+    for (int join = 0; join < 2; join ++) {
+      ftk::merge_tree<int> t(adj, rank, join, 4);
+      t.build();
+      const std::set<std::pair<int, int>> pairs(t.get_persistence_pairs().begin(), t.get_persistence_pairs().end());
+      REQUIRE(pairs == reference_persistence_pairs(adj, f, join));
+      REQUIRE(t.get_essential_extrema().size() == 1);
+    }
+
+    // the contour tree of a simply connected domain is a tree whose
+    // leaves are the maxima and minima
+    const auto ct = ftk::build_contour_tree<int, double>(adj, f.data(), 4);
+    size_t narcs = 0, nleaves = 0, nextrema = 0;
+    for (const auto i : ct.get_nodes()) {
+      narcs += ct.upper_degree(i);
+      if (ct.is_leaf(i)) nleaves ++;
+    }
+    for (int join = 0; join < 2; join ++) {
+      ftk::merge_tree<int> t(adj, rank, join, 4);
+      nextrema += t.get_extrema().size();
+    }
+    REQUIRE(narcs + 1 == ct.size());
+    REQUIRE(nleaves == nextrema);
+  }
+}
+
+TEST_CASE("critical_point_persistence_simplification_2d") {
+  const int DW = 64, DH = 64;
+  ftk::ndarray<double> scalar;
+  scalar.reshape(DW, DH);
+  for (int j = 0; j < DH; j ++)
+    for (int i = 0; i < DW; i ++) {
+      const double x = (i - 32.0) / 12.0, y = (j - 32.0) / 12.0;
+      scalar(i, j) = exp(-x*x - y*y) + 0.01 * cos(1.3 * i) * cos(1.1 * j);
+    }
+
+  auto count_maxima = [&](double threshold) {
+    diy::mpi::communicator comm;
+    ftk::critical_point_tracker_2d_regular tracker(comm);
+    tracker.set_scalar_field_source( ftk::SOURCE_GIVEN );
+    tracker.set_vector_field_source( ftk::SOURCE_DERIVED );
+    tracker.set_jacobian_field_source( ftk::SOURCE_DERIVED );
+    tracker.set_jacobian_symmetric( true );
+    tracker.set_domain(ftk::lattice({2, 2}, {DW-3, DH-3}));
+    tracker.set_array_domain(ftk::lattice({0, 0}, {DW, DH}));
+    tracker.set_persistence_threshold(threshold);
+    tracker.initialize();
+
+    tracker.push_scalar_field_snapshot(scalar);
+    tracker.update_timestep();
+
+    int n = 0;
+    for (const auto &cp : tracker.get_critical_points())
+      if (cp.type == ftk::CRITICAL_POINT_2D_MAXIMUM) n ++;
+    return n;
+  };
+
+  REQUIRE(count_maxima(0) > 1);
+  REQUIRE(count_maxima(0.1) == 1);
+}
+
+TEST_CASE("critical_point_persistence_simplification_2d_unstructured") {
+  const int DW = 64, DH = 64, nt = 3;
+  ftk::ndarray<double> coords;
+  coords.reshape(2, DW*DH);
+  for (int j = 0; j < DH; j ++)
+    for (int i = 0; i < DW; i ++) {
+      coords(0, i + j*DW) = i;
+      coords(1, i + j*DW) = j;
+    }
+
+  ftk::ndarray<int> triangles;
+  triangles.reshape(3, 2*(DW-1)*(DH-1));
+  int k = 0;
+  for (int j = 0; j < DH-1; j ++)
+    for (int i = 0; i < DW-1; i ++) {
+      const int v = i + j*DW;
+      triangles(0, k) = v; triangles(1, k) = v+1; triangles(2, k) = v+DW+1; k ++;
+      triangles(0, k) = v; triangles(1, k) = v+DW+1; triangles(2, k) = v+DW; k ++;
+    }
+
+  std::shared_ptr<ftk::simplicial_unstructured_2d_mesh<>> m(
+      new ftk::simplicial_unstructured_2d_mesh<>(coords, triangles));
+  std::shared_ptr<ftk::simplicial_unstructured_extruded_2d_mesh<>> m3(
+      new ftk::simplicial_unstructured_extruded_2d_mesh_implicit<>(m));
+
+  // the same field as above, with the analytic gradient and hessian
+  const int n = DW * DH;
+  ftk::ndarray<double> scalar({1, (size_t)n}), grad({2, (size_t)n}), hess({2, 2, (size_t)n});
+  for (int j = 0; j < DH; j ++)
+    for (int i = 0; i < DW; i ++) {
+      const int k = i + j*DW;
+      const double x = (i - 32.0) / 12.0, y = (j - 32.0) / 12.0, 
+                   g = exp(-x*x - y*y), a = 1.3 * i, b = 1.1 * j;
+      scalar(0, k) = g + 0.01 * cos(a) * cos(b);
+      grad(0, k) = -2 * x / 12.0 * g - 0.013 * sin(a) * cos(b);
+      grad(1, k) = -2 * y / 12.0 * g - 0.011 * cos(a) * sin(b);
+      hess(0, 0, k) = (4 * x*x - 2) / 144.0 * g - 0.01 * 1.69 * cos(a) * cos(b);
+      hess(1, 1, k) = (4 * y*y - 2) / 144.0 * g - 0.01 * 1.21 * cos(a) * cos(b);
+      hess(0, 1, k) = hess(1, 0, k) = 4 * x * y / 144.0 * g + 0.01 * 1.43 * sin(a) * sin(b);
+    }
+
+  // maxima of each timestep of a static field; the persistence of a 
+  // timestep is computed with the first snapshot or reused from the last step
+  auto count_maxima = [&](double threshold) {
+    diy::mpi::communicator comm;
+    ftk::critical_point_tracker_2d_unstructured tracker(comm, m3);
+    tracker.set_persistence_threshold(threshold);
+    tracker.initialize();
+
+    for (int t = 0; t < nt; t ++) {
+      tracker.push_field_data_snapshot(scalar, grad, hess);
+      if (t != 0) tracker.advance_timestep();
+    }
+    tracker.update_timestep();
+
+    std::vector<int> counts(nt, 0);
+    for (const auto &cp : tracker.get_critical_points())
+      if (cp.ordinal && cp.type == ftk::CRITICAL_POINT_2D_MAXIMUM)
+        counts[cp.timestep] ++;
+    return counts;
+  };
+
+  const auto counts0 = count_maxima(0), counts = count_maxima(0.1);
+  for (int t = 0; t < nt; t ++) {
+    REQUIRE(counts0[t] > 1);
+    REQUIRE(counts[t] == 1);
+  }
+}
+
+#include "main.hh"
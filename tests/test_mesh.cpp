@@ -1,9 +1,16 @@
 #define CATCH_CONFIG_RUNNER
 #include "catch.hh"
 #include <ftk/mesh/simplicial_unstructured_2d_mesh.hh>
+#include <ftk/mesh/simplicial_unstructured_3d_mesh.hh>
 #include <ftk/mesh/simplicial_unstructured_extruded_2d_mesh.hh>
 #include <ftk/mesh/simplicial_unstructured_extruded_2d_mesh_implicit.hh>
 #include <ftk/mesh/simplicial_unstructured_extruded_3d_mesh.hh>
+#include <ftk/mesh/simplicial_regular_mesh.hh>
+#include <ftk/mesh/point_locator_2d_quad.hh>
+#include <ftk/mesh/point_locator_2d_grid.hh>
+#include <ftk/mesh/pentachoron_assembly.hh>
+#include <ftk/filters/surface_slab_stitcher.hh>
+#include <ftk/io/xgc_eq.hh>
 #include <ftk/ndarray.hh>
 
 #if FTK_HAVE_VTK
@@ -162,6 +169,503 @@ TEST_CASE("mesh_2d_unstructured_find") {
 }
 #endif
 
+TEST_CASE("mesh_2d_unstructured_csr") {
+  // triangulated 16x12 grid with permuted triangle vertices
+  const int nx = 16, ny = 12;
+  std::vector<double> coords;
+  for (int j = 0; j < ny; j ++)
+    for (int i = 0; i < nx; i ++) {
+      coords.push_back(i);
+      coords.push_back(j);
+    }
+
+  std::vector<int> tris;
+  for (int j = 0; j < ny-1; j ++)
+    for (int i = 0; i < nx-1; i ++) {
+      const int v = j*nx + i;
+      const int t[2][3] = {{v+nx+1, v, v+1}, {v+nx, v+nx+1, v}};
+      for (int k = 0; k < 2; k ++)
+        for (int l = 0; l < 3; l ++)
+          tris.push_back(t[k][l]);
+    }
+
+  ftk::simplicial_unstructured_2d_mesh<> m(
+      ftk::ndarray<double>(coords.data(), {2, coords.size()/2}),
+      ftk::ndarray<int>(tris.data(), {3, tris.size()/3}));
+
+  // reference edges
+  std::map<std::tuple<int, int>, std::set<int>> ref;
+  for (int i = 0; i < m.n(2); i ++) {
+    int tri[3];
+    m.get_simplex(2, i, tri);
+    for (int k = 0; k < 3; k ++)
+      ref[std::make_tuple(std::min(tri[k], tri[(k+1)%3]), std::max(tri[k], tri[(k+1)%3]))].insert(i);
+  }
+  REQUIRE(m.n(1) == ref.size());
+
+  for (const auto &kv : ref) {
+    int v[2] = {std::get<1>(kv.first), std::get<0>(kv.first)}, e;
+    REQUIRE(m.find_simplex(1, v, e));
+    REQUIRE(m.side_of(1, e) == kv.second);
+    for (const auto t : kv.second)
+      REQUIRE(m.sides(2, t).count(e) == 1);
+  }
+
+  for (int i = 0; i < m.n(2); i ++) {
+    int tri[3], i1;
+    m.get_simplex(2, i, tri);
+    std::swap(tri[0], tri[2]);
+    REQUIRE(m.find_simplex(2, tri, i1));
+    REQUIRE(i == i1);
+  }
+
+  int v[2] = {0, nx+2}, e;
+  REQUIRE(!m.find_simplex(1, v, e));
+}
+
+TEST_CASE("mesh_2d_unstructured_smoothing_kernel") {
+  const int nx = 24, ny = 20;
+  const double sigma = 0.15;
+  std::vector<double> coords;
+  srand(0);
+  for (int j = 0; j < ny; j ++)
+    for (int i = 0; i < nx; i ++) {
+      coords.push_back(0.1 * i + 0.02 * rand() / RAND_MAX);
+      coords.push_back(0.1 * j + 0.02 * rand() / RAND_MAX);
+    }
+
+  std::vector<int> tris;
+  for (int j = 0; j < ny-1; j ++)
+    for (int i = 0; i < nx-1; i ++) {
+      const int v = j*nx + i;
+      const int t[6] = {v, v+1, v+nx+1, v, v+nx+1, v+nx};
+      tris.insert(tris.end(), t, t+6);
+    }
+
+  const size_t n = nx * ny, nplanes = 3;
+  ftk::simplicial_unstructured_2d_mesh<> m(
+      ftk::ndarray<double>(coords.data(), {2, n}),
+      ftk::ndarray<int>(tris.data(), {3, tris.size()/3}));
+  m.build_smoothing_kernel(sigma);
+
+  ftk::ndarray<double> f;
+  f.reshape(n, nplanes);
+  for (size_t i = 0; i < f.nelem(); i ++)
+    f[i] = std::sin(0.37 * i) + 0.01 * (i % 17);
+
+  ftk::ndarray<double> S, G, J;
+  m.smooth_scalar_gradient_jacobian(f, S, G, J);
+  REQUIRE(S.dim(1) == nplanes);
+
+  // brute force over all vertices within 3 sigma
+  const double s2 = sigma * sigma;
+  for (size_t p = 0; p < nplanes; p ++) {
+    ftk::ndarray<double> S1, G1, J1;
+    m.smooth_scalar_gradient_jacobian(f.slice_time(p), S1, G1, J1);
+
+    for (size_t i = 0; i < n; i ++) {
+      double s = 0, g[2] = {0}, h[2][2] = {0};
+      for (size_t k = 0; k < n; k ++) {
+        const double d[2] = {coords[k*2] - coords[i*2], coords[k*2+1] - coords[i*2+1]};
+        const double r = std::sqrt(d[0]*d[0] + d[1]*d[1]);
+        if (r >= 3 * sigma) continue;
+        const double w = std::exp(-r*r / (2*s2)) / (sigma * std::sqrt(2.0 * M_PI)), fk = f(k, p);
+        s += w * fk;
+        for (int a = 0; a < 2; a ++) {
+          g[a] += -fk * w * d[a] / s2;
+          for (int b = 0; b < 2; b ++)
+            h[a][b] += (d[a]*d[b] / s2 - (a == b)) / s2 * fk * w;
+        }
+      }
+
+      REQUIRE(S(i, p) == Approx(s).margin(1e-9));
+      REQUIRE(S1(i) == S(i, p));
+      for (int a = 0; a < 2; a ++) {
+        REQUIRE(G(a, i, p) == Approx(g[a]).margin(1e-8));
+        REQUIRE(G1(a, i) == G(a, i, p));
+        for (int b = 0; b < 2; b ++) {
+          REQUIRE(J(a, b, i, p) == Approx(h[a][b]).margin(1e-6));
+          REQUIRE(J1(a, b, i) == J(a, b, i, p));
+        }
+      }
+    }
+  }
+
+  // round trip through the list form used by kernel files
+  const auto lists = m.get_smoothing_kernel();
+  ftk::smoothing_kernel_csr<> k1;
+  k1.from_lists(m.get_coords(), sigma, lists);
+  REQUIRE(k1.adj.idx == m.get_smoothing_kernel_csr().adj.idx);
+  REQUIRE(k1.wh == m.get_smoothing_kernel_csr().wh);
+
+  // copies and moves use their own arrays
+  ftk::smoothing_kernel_csr<> k2;
+  {
+    ftk::smoothing_kernel_csr<> k0(k1);
+    k2 = std::move(k0);
+    REQUIRE(k0.empty());
+  }
+  REQUIRE(k2.to_lists() == k1.to_lists());
+
+  // round trip through a mapped cache file
+  const std::string filename = "test_mesh_smoothing_kernel.ftk";
+  m.write_smoothing_kernel(filename);
+  REQUIRE(ftk::mapped_cache_file::is_cache_file(filename));
+
+  ftk::simplicial_unstructured_2d_mesh<> m1(
+      ftk::ndarray<double>(coords.data(), {2, n}),
+      ftk::ndarray<int>(tris.data(), {3, tris.size()/3}));
+  REQUIRE(m1.read_smoothing_kernel(filename));
+  REQUIRE(m1.get_smoothing_kernel_size() == sigma);
+  REQUIRE(m1.get_smoothing_kernel_csr().nnz() == m.get_smoothing_kernel_csr().nnz());
+
+  ftk::ndarray<double> S2, G2, J2;
+  m1.smooth_scalar_gradient_jacobian(f, S2, G2, J2);
+  REQUIRE(S2.std_vector() == S.std_vector());
+  REQUIRE(G2.std_vector() == G.std_vector());
+  REQUIRE(J2.std_vector() == J.std_vector());
+
+  // the cache is rejected for a different mesh
+  coords[0] += 0.01;
+  ftk::simplicial_unstructured_2d_mesh<> m2(
+      ftk::ndarray<double>(coords.data(), {2, n}),
+      ftk::ndarray<int>(tris.data(), {3, tris.size()/3}));
+  REQUIRE(!m2.read_smoothing_kernel(filename));
+  REQUIRE(!m2.has_smoothing_kernel());
+  std::remove(filename.c_str());
+}
+
+TEST_CASE("mesh_3d_unstructured_csr") {
+  // freudenthal tetrahedralization of a 6x5x4 grid
+  const int nx = 6, ny = 5, nz = 4;
+  std::vector<double> coords;
+  for (int k = 0; k < nz; k ++)
+    for (int j = 0; j < ny; j ++)
+      for (int i = 0; i < nx; i ++) {
+        coords.push_back(i);
+        coords.push_back(j);
+        coords.push_back(k);
+      }
+
+  const int perms[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+  const int strides[3] = {1, nx, nx*ny};
+  std::vector<int> tets;
+  for (int k = 0; k < nz-1; k ++)
+    for (int j = 0; j < ny-1; j ++)
+      for (int i = 0; i < nx-1; i ++)
+        for (int p = 0; p < 6; p ++) {
+          int v = (k*ny + j)*nx + i;
+          tets.push_back(v);
+          for (int l = 0; l < 3; l ++) {
+            v += strides[perms[p][l]];
+            tets.push_back(v);
+          }
+        }
+
+  ftk::simplicial_unstructured_3d_mesh<> m(coords, tets);
+  REQUIRE(m.n(3) == tets.size() / 4);
+
+  std::map<std::tuple<int, int, int>, std::set<int>> ref;
+  for (int i = 0; i < m.n(3); i ++) {
+    int tet[4];
+    m.get_simplex(3, i, tet);
+    for (int l = 0; l < 4; l ++) {
+      int tri[3], c = 0;
+      for (int q = 0; q < 4; q ++)
+        if (q != l) tri[c++] = tet[q];
+      ref[std::make_tuple(tri[0], tri[1], tri[2])].insert(i);
+    }
+
+    int i1;
+    std::swap(tet[0], tet[3]);
+    REQUIRE(m.find_simplex(3, tet, i1));
+    REQUIRE(i == i1);
+  }
+  REQUIRE(m.n(2) == ref.size());
+
+  int i = 0;
+  for (const auto &kv : ref) { // ids follow the lexicographic order
+    int tri[3];
+    m.get_simplex(2, i, tri);
+    REQUIRE(std::make_tuple(tri[0], tri[1], tri[2]) == kv.first);
+    REQUIRE(m.side_of(2, i) == kv.second);
+    for (const auto t : kv.second)
+      REQUIRE(m.sides(3, t).count(i) == 1);
+
+    for (const auto e : m.sides(2, i)) {
+      int edge[2];
+      m.get_simplex(1, e, edge);
+      REQUIRE(m.side_of(1, e).count(i) == 1);
+      REQUIRE(m.side_of(0, edge[0]).count(e) == 1);
+      REQUIRE(m.side_of(0, edge[1]).count(e) == 1);
+    }
+    i ++;
+  }
+}
+
+TEST_CASE("mesh_regular_fixed_element") {
+  ftk::simplicial_regular_mesh m(3);
+  m.set_lb_ub({0, 0, 0}, {4, 5, 2});
+
+  typedef ftk::simplicial_regular_mesh_element element_t;
+  typedef ftk::simplicial_regular_mesh_element_fixed<3> fixed_element_t;
+
+  for (int d = 0; d <= 3; d ++) {
+    const auto &l = m.get_lattice();
+    const size_t n = l.n() * m.ntypes(d);
+    for (size_t i = 0; i < n; i ++) {
+      element_t e(m, d, i, l);
+      fixed_element_t fe(m, d, i, l);
+
+      REQUIRE(element_t(fe) == e);
+      REQUIRE(fe.valid(m) == e.valid(m));
+      REQUIRE(fe.is_ordinal(m) == e.is_ordinal(m));
+      REQUIRE(fe.to_integer(m) == e.to_integer(m));
+      REQUIRE(fixed_element_t(m, d, e.to_integer(m)) == fe);
+
+      int verts[4][3];
+      const auto nv = fe.vertices(m, verts);
+      const auto vertices = e.vertices(m);
+      REQUIRE(nv == vertices.size());
+      for (int j = 0; j < nv; j ++)
+        for (int k = 0; k < 3; k ++)
+          REQUIRE(verts[j][k] == vertices[j][k]);
+
+      if (d > 0) {
+        std::vector<element_t> sides;
+        fe.foreach_side(m, [&](const fixed_element_t& s) {sides.push_back(s);});
+        REQUIRE(sides == e.sides(m));
+      }
+      if (d < 3) {
+        std::vector<element_t> side_of;
+        fe.foreach_side_of(m, [&](const fixed_element_t& s) {side_of.push_back(s);});
+        REQUIRE(side_of == e.side_of(m));
+      }
+    }
+  }
+}
+
+TEST_CASE("mesh_regular_pentachoron_assembly") {
+  ftk::simplicial_regular_mesh m(4);
+  m.set_lb_ub({0, 0, 0, 0}, {3, 3, 3, 3});
+
+  typedef ftk::simplicial_regular_mesh_element element_t;
+
+  // generic linear fields
+  auto f = [](const std::vector<int>& x) { return x[0] + 1.7*x[1] + 2.3*x[2] + 0.9*x[3] - 4.05; };
+  auto u = [](const std::vector<int>& x) { return 1.1*x[0] - 0.7*x[1] + 0.3*x[2] + 0.5*x[3] - 0.55; };
+  auto v = [](const std::vector<int>& x) { return 0.2*x[0] + 0.9*x[1] - 1.3*x[2] + 0.4*x[3] + 0.65; };
+
+  std::vector<uint64_t> edges, tris;
+  m.element_for(1, [&](element_t e) {
+    if (!e.valid(m)) return;
+    const auto x = e.vertices(m);
+    if ((f(x[0]) > 0) != (f(x[1]) > 0))
+      edges.push_back(e.to_integer(m));
+  }, ftk::FTK_XL_NONE, 1);
+  m.element_for(2, [&](element_t e) {
+    if (!e.valid(m)) return;
+    const auto x = e.vertices(m);
+    double s[3];
+    for (int i = 0; i < 3; i ++) {
+      const int j = (i+1) % 3;
+      s[i] = u(x[i]) * v(x[j]) - u(x[j]) * v(x[i]);
+    }
+    if ((s[0] > 0 && s[1] > 0 && s[2] > 0) || (s[0] < 0 && s[1] < 0 && s[2] < 0))
+      tris.push_back(e.to_integer(m));
+  }, ftk::FTK_XL_NONE, 1);
+
+  size_t expected_tets = 0;
+  m.element_for(4, [&](element_t e) {
+    if (!e.valid(m)) return;
+    int npositive = 0;
+    for (const auto &x : e.vertices(m))
+      if (f(x) > 0) npositive ++;
+    if (npositive == 1 || npositive == 4) expected_tets += 1;
+    else if (npositive == 2 || npositive == 3) expected_tets += 3;
+  }, ftk::FTK_XL_NONE, 1);
+
+  ftk::pentachoron_assembly volume_assembly(m, 1);
+  const auto tets = volume_assembly.assemble<4>(edges, ftk::FTK_THREAD_PTHREAD, 2);
+  REQUIRE(volume_assembly.n_irregular() == 0);
+  REQUIRE(tets.size() == expected_tets);
+  REQUIRE(tets.size() > 0);
+
+  ftk::pentachoron_assembly surface_assembly(m, 2);
+  const auto triangles = surface_assembly.assemble<3>(tris, ftk::FTK_THREAD_PTHREAD, 2);
+  REQUIRE(surface_assembly.n_irregular() == 0);
+  REQUIRE(triangles.size() > 0);
+  for (const auto &t : triangles) {
+    REQUIRE(t[0] != t[1]);
+    REQUIRE(t[1] != t[2]);
+    REQUIRE(t[0] != t[2]);
+  }
+}
+
+TEST_CASE("mesh_regular_surface_slabs") {
+  ftk::simplicial_regular_mesh m(4);
+  m.set_lb_ub({0, 0, 0, 0}, {3, 3, 3, 3});
+
+  typedef ftk::simplicial_regular_mesh_element element_t;
+
+  auto u = [](const std::vector<int>& x) { return 1.1*x[0] - 0.7*x[1] + 0.3*x[2] + 0.5*x[3] - 0.55; };
+  auto v = [](const std::vector<int>& x) { return 0.2*x[0] + 0.9*x[1] - 1.3*x[2] + 0.4*x[3] + 0.65; };
+
+  std::map<element_t, ftk::feature_point_t> intersections;
+  std::vector<uint64_t> tags;
+  m.element_for(2, [&](element_t e) {
+    if (!e.valid(m)) return;
+    const auto x = e.vertices(m);
+    double s[3];
+    for (int i = 0; i < 3; i ++) {
+      const int j = (i+1) % 3;
+      s[i] = u(x[i]) * v(x[j]) - u(x[j]) * v(x[i]);
+    }
+    if ((s[0] > 0 && s[1] > 0 && s[2] > 0) || (s[0] < 0 && s[1] < 0 && s[2] < 0)) {
+      ftk::feature_point_t p;
+      p.ordinal = e.is_ordinal(m);
+      p.timestep = e.corner[3];
+      intersections[e] = p;
+    }
+  }, ftk::FTK_XL_NONE, 1);
+  for (const auto &kv : intersections)
+    tags.push_back(kv.first.to_integer(m));
+
+  ftk::pentachoron_assembly assembly(m, 2);
+  const size_t ntris = assembly.assemble<3>(tags).size();
+
+  ftk::surface_slab_stitcher stitcher;
+  std::map<element_t, int> ids; // surface ids of points on slab boundaries
+  size_t ntris_slabs = 0;
+  for (int t = 0; t < 3; t ++) {
+    const auto surf = stitcher.build(m, t, intersections);
+    ntris_slabs += surf.tris.size();
+
+    size_t k = 0;
+    for (const auto &kv : intersections) {
+      const auto &p = kv.second;
+      if (!((p.ordinal && (p.timestep == t || p.timestep == t+1)) || (!p.ordinal && p.timestep == t)))
+        continue;
+      if (p.ordinal && p.timestep == t && ids.count(kv.first))
+        REQUIRE(surf.pts[k].id == ids[kv.first]);
+      if (p.ordinal && p.timestep == t+1)
+        ids[kv.first] = surf.pts[k].id;
+      k ++;
+    }
+    REQUIRE(k == surf.pts.size());
+  }
+  REQUIRE(ntris_slabs == ntris);
+}
+
+TEST_CASE("mesh_2d_unstructured_point_locator") {
+  const int nx = 37, ny = 23;
+  std::vector<double> coords;
+  srand(0);
+  for (int j = 0; j < ny; j ++)
+    for (int i = 0; i < nx; i ++) {
+      coords.push_back(0.1 * i + 0.04 * rand() / RAND_MAX);
+      coords.push_back(0.05 * j + 0.02 * rand() / RAND_MAX);
+    }
+
+  std::vector<int> tris;
+  for (int j = 0; j < ny-1; j ++)
+    for (int i = 0; i < nx-1; i ++) {
+      const int v = j*nx + i;
+      const int t[6] = {v, v+1, v+nx+1, v, v+nx+1, v+nx};
+      tris.insert(tris.end(), t, t+6);
+    }
+
+  ftk::simplicial_unstructured_2d_mesh<> m(
+      ftk::ndarray<double>(coords.data(), {2, coords.size()/2}),
+      ftk::ndarray<int>(tris.data(), {3, tris.size()/3}));
+  ftk::point_locator_2d_quad<> quad(m);
+  ftk::point_locator_2d_grid<> grid(m);
+
+  const size_t n = 5000;
+  std::vector<double> x(n * 2);
+  for (size_t i = 0; i < n; i ++) { // including points outside the mesh
+    x[i*2] = -0.1 + 3.8 * rand() / RAND_MAX;
+    x[i*2+1] = -0.1 + 1.3 * rand() / RAND_MAX;
+  }
+
+  std::vector<int> tids(n);
+  std::vector<double> mus(n * 3);
+  grid.locate_batch(n, x.data(), tids.data(), mus.data());
+
+  for (size_t i = 0; i < n; i ++) {
+    double mu[3], mu1[3];
+    const int t0 = quad.locate(&x[i*2], mu), 
+              t1 = grid.locate(&x[i*2], mu1);
+    REQUIRE((t0 >= 0) == (t1 >= 0));
+    REQUIRE((t0 >= 0) == (tids[i] >= 0));
+    if (tids[i] < 0) continue;
+    
+    // points on shared edges may be found in either triangle
+    int tri[3];
+    m.get_triangle(tids[i], tri);
+    for (int j = 0; j < 2; j ++) {
+      double y = 0;
+      for (int k = 0; k < 3; k ++) {
+        REQUIRE(mus[i*3+k] >= 0);
+        y += mus[i*3+k] * coords[tri[k]*2+j];
+      }
+      REQUIRE(y == Approx(x[i*2+j]).margin(1e-9));
+    }
+  }
+}
+
+TEST_CASE("mesh_xgc_equilibrium_interpolation") {
+  // quadratic psi and linear I are reproduced exactly by the interpolants
+  auto psi = [](double r, double z) { return 0.3*r*r - 0.2*r*z + 0.5*z*z + 0.1*r - 0.4*z + 1.0; };
+  auto I = [](double p) { return 2.0 - 0.5 * p; };
+
+  ftk::xgc_eq_t eq;
+  eq.mr = 33; eq.mz = 41; eq.mpsi = 17;
+  eq.min_r = 1.0; eq.max_r = 2.5; 
+  eq.min_z = -1.0; eq.max_z = 1.0;
+
+  eq.rgrid.reshape(eq.mr);
+  for (int i = 0; i < eq.mr; i ++)
+    eq.rgrid[i] = eq.min_r + (eq.max_r - eq.min_r) / (eq.mr - 1) * i;
+  eq.zgrid.reshape(eq.mz);
+  for (int i = 0; i < eq.mz; i ++)
+    eq.zgrid[i] = eq.min_z + (eq.max_z - eq.min_z) / (eq.mz - 1) * i;
+  eq.psi_rz.reshape(eq.mr, eq.mz);
+  for (int j = 0; j < eq.mz; j ++)
+    for (int i = 0; i < eq.mr; i ++)
+      eq.psi_rz[j*eq.mr + i] = psi(eq.rgrid[i], eq.zgrid[j]);
+
+  eq.psigrid.reshape(eq.mpsi);
+  eq.I.reshape(eq.mpsi);
+  for (int i = 0; i < eq.mpsi; i ++) {
+    eq.psigrid[i] = 0.5 + 0.1 * i * i; // nonuniform
+    eq.I[i] = I(eq.psigrid[i]);
+  }
+  eq.initialize();
+
+  const size_t n = 1000;
+  std::vector<double> rz(n * 2), psis(n), dpsis(n * 2), bs(n * 3);
+  srand(0);
+  for (size_t k = 0; k < n; k ++) {
+    rz[k*2] = eq.min_r + (eq.max_r - eq.min_r) * rand() / RAND_MAX;
+    rz[k*2+1] = eq.min_z + (eq.max_z - eq.min_z) * rand() / RAND_MAX;
+  }
+  eq.eval_psi(n, rz.data(), psis.data(), dpsis.data());
+  eq.eval_b(n, rz.data(), bs.data());
+
+  for (size_t k = 0; k < n; k ++) {
+    const double r = rz[k*2], z = rz[k*2+1];
+    REQUIRE(psis[k] == Approx(psi(r, z)).margin(1e-10));
+    REQUIRE(dpsis[k*2] == Approx(0.6*r - 0.2*z + 0.1).margin(1e-10));
+    REQUIRE(dpsis[k*2+1] == Approx(-0.2*r + z - 0.4).margin(1e-10));
+
+    REQUIRE(bs[k*3] == Approx(-dpsis[k*2+1] / r).margin(1e-10));
+    REQUIRE(bs[k*3+1] == Approx(dpsis[k*2] / r).margin(1e-10));
+    const double p = std::min(std::max(psis[k], eq.psigrid[0]), eq.psigrid[eq.mpsi-1]);
+    REQUIRE(bs[k*3+2] == Approx(-I(p) / r).margin(1e-10));
+  }
+}
+
 #include "main.hh"
 
 #if 0
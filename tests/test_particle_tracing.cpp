@@ -0,0 +1,65 @@
+#define CATCH_CONFIG_RUNNER
+#include "catch.hh"
+#include <cmath>
+#include <ftk/filters/particle_tracer_regular.hh>
+
+const int W = 64, H = 64;
+const double cx = 32.0, cy = 32.0, r = 10.0;
+
+// steady rigid rotation around (cx, cy); trace one particle for 1 radian
+static const ftk::feature_curve_t& trace_rotation(
+    ftk::particle_tracer_regular& tracer, const std::string& integrator)
+{
+  ftk::ndarray<double> V({2, size_t(W), size_t(H)});
+  V.set_multicomponents(1);
+  for (int j = 0; j < H; j ++)
+    for (int i = 0; i < W; i ++) {
+      V(0, i, j) = -(j - cy);
+      V(1, i, j) = i - cx;
+    }
+
+  tracer.set_domain(ftk::lattice({0, 0}, {W-1, H-1}));
+  tracer.set_array_domain(ftk::lattice({0, 0}, {W, H}));
+  tracer.set_ntimesteps(1); // streamlines
+  tracer.set_end_timestep(0);
+  tracer.set_number_of_threads(1);
+  tracer.set_integrator(integrator);
+  tracer.set_tolerances(1e-9, 1e-9);
+  tracer.initialize();
+
+  const double seed[3] = {cx + r, cy, 0.0};
+  tracer.initialize_particles(1, seed, 3, true);
+
+  tracer.push_field_data_snapshot("vector", V);
+  tracer.update_timestep();
+  tracer.finalize();
+
+  return tracer.get_trajectories().begin()->second;
+}
+
+TEST_CASE("particle_tracing_rotation_rk4") {
+  diy::mpi::communicator world;
+  ftk::particle_tracer_regular tracer(world, 2);
+  const auto &traj = trace_rotation(tracer, "rk4");
+
+  REQUIRE(traj.back().t == Approx(1.0));
+  REQUIRE(traj.back().x[0] == Approx(cx + r * std::cos(1.0)).margin(1e-6));
+  REQUIRE(traj.back().x[1] == Approx(cy + r * std::sin(1.0)).margin(1e-6));
+}
+
+TEST_CASE("particle_tracing_rotation_rk45") {
+  diy::mpi::communicator world;
+  ftk::particle_tracer_regular tracer(world, 2), tracer4(world, 2);
+  const auto &traj = trace_rotation(tracer, "rk45");
+  const auto &traj4 = trace_rotation(tracer4, "rk4");
+
+  REQUIRE(traj.size() == traj4.size()); // same checkpoints
+  for (int i = 0; i < traj.size(); i ++) {
+    const double theta = traj[i].t;
+    REQUIRE(traj[i].t == Approx(traj4[i].t));
+    REQUIRE(traj[i].x[0] == Approx(cx + r * std::cos(theta)).margin(1e-6));
+    REQUIRE(traj[i].x[1] == Approx(cy + r * std::sin(theta)).margin(1e-6));
+  }
+}
+
+#include "main.hh"
@@ -2,6 +2,8 @@
 #include "catch.hh"
 #include <ftk/basic/union_find.hh>
 #include <ftk/basic/simple_union_find.hh>
+#include <ftk/basic/duf.hh>
+#include <ftk/object.hh>
 #include <string>
 
 // test (sparse) union-find
@@ -38,4 +40,34 @@ TEST_CASE("simple_union_find") {
   REQUIRE(!UF.same_set(1, 5));
 }
 
+// concurrent union-find: chains of n/k elements, united from multiple threads
+template <typename UF>
+static void test_concurrent_duf(UF& uf, int n, int k)
+{
+  ftk::object::parallel_for(n, [&](int i) {
+    if (i + k < n) uf.unite(i + k, i);
+  }, ftk::FTK_THREAD_PTHREAD, 4, false);
+
+  REQUIRE(uf.size() == n);
+  REQUIRE(uf.get_roots().size() == k);
+  for (int i = 0; i < n; i ++)
+    REQUIRE(uf.find(i) == i % k); // roots are the smallest elements
+}
+
+TEST_CASE("duf_dense_concurrent") {
+  diy::mpi::communicator world;
+  ftk::duf<int> uf(world, 10000);
+  REQUIRE(uf.is_dense());
+  REQUIRE(!uf.has(5));
+  test_concurrent_duf(uf, 10000, 7);
+  REQUIRE(uf.has(5));
+}
+
+TEST_CASE("duf_sharded_concurrent") {
+  diy::mpi::communicator world;
+  ftk::duf<int> uf(world);
+  REQUIRE(!uf.is_dense());
+  test_concurrent_duf(uf, 10000, 7);
+}
+
 #include "main.hh"
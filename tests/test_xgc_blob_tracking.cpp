@@ -0,0 +1,203 @@
+#define CATCH_CONFIG_RUNNER
+#include "catch.hh"
+#include <ftk/filters/xgc_blob_threshold_tracker.hh>
+#include <ftk/ndarray.hh>
+#include <sstream>
+#include "main.hh"
+
+// a synthetic xgc-like mesh: a regularly triangulated n x n grid of unit size
+// on the outboard side of the magnetic axis, with nphi planes; the dual area
+// of every interior vertex is h^2, and psin grows linearly with r - r0
+const int n = 41, nphi = 4;
+const double h = 1.0 / (n - 1);
+const ftk::xgc_units_t units;
+
+double coord_r(int i) { return units.eq_axis_r + i * h; }
+double coord_z(int j) { return units.eq_axis_z - 0.5 + j * h; }
+
+std::shared_ptr<ftk::simplicial_xgc_3d_mesh<>> synthetic_xgc_mesh()
+{
+  ftk::ndarray<double> coords({2, (size_t)n*n});
+  for (int j = 0; j < n; j ++)
+    for (int i = 0; i < n; i ++) {
+      coords(0, i + j*n) = coord_r(i);
+      coords(1, i + j*n) = coord_z(j);
+    }
+
+  ftk::ndarray<int> triangles({3, (size_t)2*(n-1)*(n-1)});
+  int k = 0;
+  for (int j = 0; j < n-1; j ++)
+    for (int i = 0; i < n-1; i ++) {
+      const int v = i + j*n;
+      triangles(0, k) = v; triangles(1, k) = v+1; triangles(2, k) = v+n+1; k ++;
+      triangles(0, k) = v; triangles(1, k) = v+n+1; triangles(2, k) = v+n; k ++;
+    }
+
+  ftk::ndarray<double> psi;
+  psi.reshape(n*n);
+  ftk::ndarray<int> nextnodes;
+  nextnodes.reshape(n*n);
+  for (int k = 0; k < n*n; k ++) {
+    psi[k] = units.psi_x * (k % n) * h;
+    nextnodes[k] = k; // no field following
+  }
+
+  std::shared_ptr<ftk::simplicial_xgc_2d_mesh<>> m2(
+      new ftk::simplicial_xgc_2d_mesh<>(coords, triangles, psi, nextnodes));
+  return std::shared_ptr<ftk::simplicial_xgc_3d_mesh<>>(
+      new ftk::simplicial_xgc_3d_mesh<>(m2, nphi));
+}
+
+struct disk_t {
+  int ci, cj, r; // center and radius in grid units
+};
+
+// 1 inside the disks and 0 outside, identical on all planes
+ftk::ndarray<double> synthetic_blobs(const std::vector<disk_t>& disks)
+{
+  ftk::ndarray<double> scalar;
+  scalar.reshape(n*n, nphi);
+  for (int p = 0; p < nphi; p ++)
+    for (int j = 0; j < n; j ++)
+      for (int i = 0; i < n; i ++) {
+        double f = 0.0;
+        for (const auto &d : disks)
+          if ((i-d.ci)*(i-d.ci) + (j-d.cj)*(j-d.cj) <= d.r*d.r)
+            f = 1.0;
+        scalar[n*n*p + i + j*n] = f;
+      }
+  return scalar;
+}
+
+// drives the tracker timestep by timestep as the xgc stream in the cli does
+void track(ftk::xgc_blob_threshold_tracker& tracker,
+    const std::vector<std::vector<disk_t>>& frames)
+{
+  tracker.set_threshold(0.5);
+  tracker.initialize();
+  for (int k = 0; k < frames.size(); k ++) {
+    tracker.push_field_data_snapshot(synthetic_blobs(frames[k]));
+    if (k != 0) tracker.advance_timestep();
+    if (k == frames.size() - 1) tracker.update_timestep();
+  }
+  tracker.finalize();
+}
+
+// number of lattice points in a disk of radius r, r = 4, 6
+int lattice_points(int r) { return r == 4 ? 49 : 113; }
+
+TEST_CASE("xgc_blob_threshold_tracking_moving_disks") {
+  diy::mpi::communicator world;
+  auto m3 = synthetic_xgc_mesh();
+  ftk::xgc_blob_threshold_tracker tracker(world, m3);
+
+  const int nt = 5, r = 6;
+  std::vector<std::vector<disk_t>> frames;
+  for (int t = 0; t < nt; t ++) // one moving and one static disk
+    frames.push_back({{10 + t, 12, r}, {30, 28, r}});
+
+  std::ostringstream ss;
+  std::vector<std::vector<ftk::xgc_blob_t>> history;
+  tracker.set_blob_callback([&](int t, const std::vector<ftk::xgc_blob_t>& blobs) {
+    tracker.write_blobs_text(ss, t == 0);
+    history.push_back(blobs);
+  });
+  track(tracker, frames);
+
+  REQUIRE(history.size() == nt);
+  int id_moving = -1, id_static = -1;
+  for (int t = 0; t < nt; t ++) {
+    REQUIRE(history[t].size() == 2);
+    for (const auto &b : history[t]) {
+      REQUIRE(b.timestep == t);
+      REQUIRE(b.nverts == nphi * lattice_points(r));
+      REQUIRE(b.area == Approx(b.nverts * h * h));
+      REQUIRE(b.area == Approx(nphi * M_PI * r*r*h*h).epsilon(0.05));
+
+      const bool moving = b.centroid[1] < units.eq_axis_z;
+      const disk_t &d = frames[t][moving ? 0 : 1];
+      REQUIRE(b.centroid[0] == Approx(coord_r(d.ci)));
+      REQUIRE(b.centroid[1] == Approx(coord_z(d.cj)));
+      REQUIRE(b.psin_min == Approx((d.ci - r) * h));
+      REQUIRE(b.psin_max == Approx((d.ci + r) * h));
+
+      int &id = moving ? id_moving : id_static;
+      if (t == 0) id = b.id;
+      else {
+        REQUIRE(b.id == id); // ids persist across timesteps
+        REQUIRE(tracker.get_tracking_graph().has_edge(t-1, id, t, id));
+      }
+    }
+  }
+  REQUIRE(id_moving != id_static);
+
+  // the labels of the last two timesteps are kept
+  const auto labels = tracker.get_sliced(nt-1);
+  REQUIRE(labels.size() == m3->n(0));
+  REQUIRE(labels[frames[nt-1][0].ci + frames[nt-1][0].cj * n] == id_moving);
+  REQUIRE(labels[0] == -1);
+
+  // one header line and one line per blob per timestep
+  std::istringstream is(ss.str());
+  std::string line;
+  int nlines = 0;
+  std::getline(is, line);
+  REQUIRE(line.rfind("# timestep id nverts area", 0) == 0);
+  while (std::getline(is, line)) {
+    int t, id;
+    std::istringstream(line) >> t >> id;
+    REQUIRE(t == nlines / 2);
+    REQUIRE((id == id_moving || id == id_static));
+    nlines ++;
+  }
+  REQUIRE(nlines == 2 * nt);
+}
+
+TEST_CASE("xgc_blob_threshold_tracking_merge_split") {
+  diy::mpi::communicator world;
+  auto m3 = synthetic_xgc_mesh();
+  ftk::xgc_blob_threshold_tracker tracker(world, m3);
+
+  // a small disk approaches a large one, merges, and leaves again
+  const std::vector<std::vector<disk_t>> frames = {
+    {{14, 20, 6}, {28, 20, 4}},
+    {{14, 20, 6}, {22, 20, 4}},
+    {{14, 20, 6}, {28, 20, 4}}
+  };
+
+  std::vector<std::vector<ftk::xgc_blob_t>> history;
+  tracker.set_blob_callback([&](int, const std::vector<ftk::xgc_blob_t>& blobs) {
+    history.push_back(blobs);
+  });
+  track(tracker, frames);
+  REQUIRE(history.size() == 3);
+
+  auto large = [](const std::vector<ftk::xgc_blob_t>& blobs) {
+    return blobs[0].nverts > blobs[1].nverts ? blobs[0] : blobs[1];
+  };
+  auto small = [](const std::vector<ftk::xgc_blob_t>& blobs) {
+    return blobs[0].nverts > blobs[1].nverts ? blobs[1] : blobs[0];
+  };
+
+  REQUIRE(history[0].size() == 2);
+  const int id_large = large(history[0]).id,
+            id_small = small(history[0]).id;
+  REQUIRE(small(history[0]).nverts == nphi * lattice_points(4));
+
+  // the merged blob continues the blob with the largest overlap
+  REQUIRE(history[1].size() == 1);
+  REQUIRE(history[1][0].id == id_large);
+  REQUIRE(tracker.get_tracking_graph().has_edge(0, id_large, 1, id_large));
+  REQUIRE(tracker.get_tracking_graph().has_edge(0, id_small, 1, id_large));
+
+  // after the split, the large disk keeps the id and the small one gets a new id
+  REQUIRE(history[2].size() == 2);
+  REQUIRE(large(history[2]).id == id_large);
+  const int id_new = small(history[2]).id;
+  REQUIRE(id_new != id_large);
+  REQUIRE(id_new != id_small);
+  REQUIRE(tracker.get_tracking_graph().has_edge(1, id_large, 2, id_large));
+  REQUIRE(tracker.get_tracking_graph().has_edge(1, id_large, 2, id_new));
+  REQUIRE(large(history[2]).centroid[0] == Approx(coord_r(14)));
+  REQUIRE(small(history[2]).centroid[0] == Approx(coord_r(28)));
+}